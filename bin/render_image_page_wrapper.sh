@@ -10,15 +10,15 @@ SHOW_HELP="${ROOT}/show_help.sh"
 
 usage() {
   cat >&2 <<EOF
-Usage: ./bin/render_image_page_wrapper.sh [send_image_page options...] <image.png>
+Usage: ./bin/render_image_page_wrapper.sh [send_image_page options...] <image.png|.jpg|.jpeg|.webp>
 
 This wrapper forces:
   --no-send
   -k=<folder>=<prefix>
 
 Where:
-  folder = <image path without .png>
-  prefix = <basename without .png>
+  folder = <image path without extension>
+  prefix = <basename without extension>
 
 Example:
   ./bin/render_image_page_wrapper.sh -q=80 mymedia/wallpapers/valley.png
@@ -36,7 +36,7 @@ img=""
 
 for ((i=${#orig[@]}-1; i>=0; i--)); do
   a="${orig[$i]}"
-  if [[ "${a}" != -* ]] && [[ "${a}" == *.png ]]; then
+  if [[ "${a}" != -* ]] && [[ "${a,,}" == *.png || "${a,,}" == *.jpg || "${a,,}" == *.jpeg || "${a,,}" == *.webp ]]; then
     img="${a}"
     unset 'orig[i]'
     break
@@ -44,7 +44,7 @@ for ((i=${#orig[@]}-1; i>=0; i--)); do
 done
 
 if [ -z "${img}" ]; then
-  # fallback: if the last arg is non-option, treat as image even if not .png (send_image_page will error)
+  # fallback: if the last arg is non-option, treat as image even without a known extension (send_image_page will error)
   last="${orig[-1]:-}"
   if [ -n "${last}" ] && [[ "${last}" != -* ]]; then
     img="${last}"
@@ -99,15 +99,15 @@ fi
 base="$(basename -- "${img}")"
 dir="$(dirname -- "${img}")"
 
-case "${base}" in
-  *.png) ;;
+case "${base,,}" in
+  *.png|*.jpg|*.jpeg|*.webp) ;;
   *)
-    echo "Expected a .png file: ${img_in}" >&2
+    echo "Expected a .png, .jpg, .jpeg or .webp file: ${img_in}" >&2
     exit 1
     ;;
 esac
 
-name="${base%.png}"
+name="${base%.*}"
 out_dir="${dir}/${name}"
 
 exec "${SEND_BIN}" --no-send --no-tile-optimize "-k=${out_dir}=${name}" "${args[@]}" "${img}"
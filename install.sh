@@ -362,7 +362,7 @@ install_dependencies() {
       log "Installing Debian/Ubuntu dependencies..."
       sudo apt update
       sudo apt install -y build-essential pkg-config git ca-certificates \
-        libhidapi-dev libusb-1.0-0-dev zlib1g-dev libpng-dev \
+        libhidapi-dev libusb-1.0-0-dev zlib1g-dev libpng-dev libjpeg-dev \
         libyaml-dev libssl-dev ffmpeg libavformat-dev libavcodec-dev \
         libavutil-dev libswscale-dev imagemagick librsvg2-bin \
         librsvg2-dev libcairo2-dev libusb-dev jq bc netcat-openbsd \
@@ -371,7 +371,7 @@ install_dependencies() {
     arch)
       log "Installing Arch Linux dependencies..."
       sudo pacman -S --needed base-devel pkg-config git ca-certificates \
-        hidapi libusb zlib libpng libyaml openssl ffmpeg \
+        hidapi libusb zlib libpng libjpeg-turbo libyaml openssl ffmpeg \
         imagemagick librsvg cairo libusb jq bc netcat socat \
         noto-fonts noto-fonts-emoji
       ;;
@@ -83,6 +83,13 @@ parse_btn_evt() {
   return 1
 }
 
+# Quote a path for a draw_batch job line: "..." with \ escapes, the form its parser documents.
+batch_quote() {
+  local s="${1//\\/\\\\}"
+  s="${s//\"/\\\"}"
+  printf '"%s"' "${s}"
+}
+
 ensure_pregen() {
   local empty="${PREGEN_DIR}/slot_empty.png"
   local reset="${PREGEN_DIR}/reset.png"
@@ -91,24 +98,33 @@ ensure_pregen() {
   local exit14="${PREGEN_DIR}/exit14.png"
   local label_style="${PREGEN_DIR}/label_style.json"
 
-  # palette colors (5): R, G, B, Y, P
-  local c0="${PREGEN_DIR}/c0.png"
-  local c1="${PREGEN_DIR}/c1.png"
-  local c2="${PREGEN_DIR}/c2.png"
-  local c3="${PREGEN_DIR}/c3.png"
-  local c4="${PREGEN_DIR}/c4.png"
-
-  if [ ! -f "${empty}" ]; then
-    "${ROOT}/icons/draw_square" 111111 --size="${ICON_SIZE}" "${empty}" >/dev/null
-    "${ROOT}/icons/draw_optimize" -c=32 "${empty}" >/dev/null 2>&1 || true
+  # Flat tiles: one draw_batch process for all the missing ones (draw_square + draw_optimize otherwise).
+  local jobs="" tile color colors i
+  [ -f "${empty}" ] || jobs+="$(batch_quote "${empty}") square 111111 --size=${ICON_SIZE} ; optimize -c=32"$'\n'
+  colors=(FF1744 00FF4C 2196F3 FFD700 B000FF)   # palette colors (5): R, G, B, Y, P -> c0..c4.png
+  for i in 0 1 2 3 4; do
+    tile="${PREGEN_DIR}/c${i}.png"
+    color="${colors[$i]}"
+    [ -f "${tile}" ] || jobs+="$(batch_quote "${tile}") square ${color} --size=${ICON_SIZE} ; optimize -c=64"$'\n'
+  done
+  if [ -n "${jobs}" ]; then
+    if [ -x "${ROOT}/icons/draw_batch" ]; then
+      printf '%s' "${jobs}" | "${ROOT}/icons/draw_batch" >/dev/null 2>&1 || true
+    else
+      if [ ! -f "${empty}" ]; then
+        "${ROOT}/icons/draw_square" 111111 --size="${ICON_SIZE}" "${empty}" >/dev/null
+        "${ROOT}/icons/draw_optimize" -c=32 "${empty}" >/dev/null 2>&1 || true
+      fi
+      for i in 0 1 2 3 4; do
+        tile="${PREGEN_DIR}/c${i}.png"
+        if [ ! -f "${tile}" ]; then
+          "${ROOT}/icons/draw_square" "${colors[$i]}" --size="${ICON_SIZE}" "${tile}" >/dev/null
+          "${ROOT}/icons/draw_optimize" -c=64 "${tile}" >/dev/null 2>&1 || true
+        fi
+      done
+    fi
   fi
 
-  if [ ! -f "${c0}" ]; then "${ROOT}/icons/draw_square" FF1744 --size="${ICON_SIZE}" "${c0}" >/dev/null; "${ROOT}/icons/draw_optimize" -c=64 "${c0}" >/dev/null 2>&1 || true; fi
-  if [ ! -f "${c1}" ]; then "${ROOT}/icons/draw_square" 00FF4C --size="${ICON_SIZE}" "${c1}" >/dev/null; "${ROOT}/icons/draw_optimize" -c=64 "${c1}" >/dev/null 2>&1 || true; fi
-  if [ ! -f "${c2}" ]; then "${ROOT}/icons/draw_square" 2196F3 --size="${ICON_SIZE}" "${c2}" >/dev/null; "${ROOT}/icons/draw_optimize" -c=64 "${c2}" >/dev/null 2>&1 || true; fi
-  if [ ! -f "${c3}" ]; then "${ROOT}/icons/draw_square" FFD700 --size="${ICON_SIZE}" "${c3}" >/dev/null; "${ROOT}/icons/draw_optimize" -c=64 "${c3}" >/dev/null 2>&1 || true; fi
-  if [ ! -f "${c4}" ]; then "${ROOT}/icons/draw_square" B000FF --size="${ICON_SIZE}" "${c4}" >/dev/null; "${ROOT}/icons/draw_optimize" -c=64 "${c4}" >/dev/null 2>&1 || true; fi
-
   if [ ! -f "${reset}" ]; then
     "${ROOT}/icons/draw_square" transparent --size="${ICON_SIZE}" "${reset}" >/dev/null
     "${ROOT}/icons/draw_mdi" mdi:restart FFFFFF --size=160 "${reset}" >/dev/null
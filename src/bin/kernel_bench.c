@@ -0,0 +1,531 @@
+// Microbenchmarks des noyaux image et de la construction des ZIP d'upload (make bench).
+//
+// Chaque cas (noyau x image) est chauffé (-w), puis mesuré sur -n échantillons; la sortie donne
+// médiane, p90, p99, min, max et moyenne en µs par appel, en tableau et en JSON (-o). Les noyaux
+// sont ceux des outils, appelés par leurs en-têtes partagés (src/icons/fd_*.h):
+//   quantize_colors      send_image_page, fd_quant_rgba (8 couleurs, tuile 196x196)
+//   apply_dithering      send_image_page, fd_dither_fs_rgba (grille 6x6x6, page entière)
+//   resize_icon          draw_normalize, carré centré -> 100x100 (fd_resample, triangle)
+//   draw_over            draw_over, redimensionnement du dessus + fd_raster_over_image
+//   draw_optimize        draw_optimize, fd_opt_quantize (64 couleurs) + PNG indexé (niveau 9)
+//   blend_overlay        draw_border, carré arrondi plein (196, rayon 20%)
+//   build_zip_from_icons ZIP de page 14 icônes avec recherche du padding (fd_devzip_solve, le
+//                        code qu'appelle le daemon)
+//   has_invalid_bytes    contrôle des octets 0x00/0x7c en tête de paquet (fd_devzip_bad_bytes, idem)
+// Images: synthétiques fixes (générateur déterministe) et échantillons du dépôt
+// (assets/pregen/error.png, mymedia/wallpapers/pinefluid.png), chemins relatifs à la racine.
+// -b compare les médianes à un JSON précédent (même machine) pour juger une optimisation.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "../icons/fd_devzip.h"
+#include "../icons/fd_dither.h"
+#include "../icons/fd_optimize.h"
+#include "../icons/fd_path.h"
+#include "../icons/fd_png.h"
+#include "../icons/fd_quant.h"
+#include "../icons/fd_raster.h"
+#include "../icons/fd_resample.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define BTN 196
+#define WIDE_W (BTN + 50 + BTN)
+#define MAX_CASES 64
+
+typedef struct {
+    char name[48];
+    uint8_t *rgba;
+    int w, h;
+} image_t;
+
+typedef struct bench_case bench_case_t;
+struct bench_case {
+    const char *kernel;
+    char input[64];
+    int w, h;
+    int calls;                                  // appels par échantillon (noyaux très courts)
+    void (*prep)(bench_case_t *c);              // hors mesure, avant chaque échantillon
+    int (*run)(bench_case_t *c);
+    const image_t *img, *top;
+    uint8_t *work, *dst;
+    size_t bytes;
+    fd_devzip_t *zip;
+    const fd_devzip_icon_t *icons;
+    int icon_count;
+    char note[48];
+    double *samples;                            // µs par appel
+    double median, p90, p99, min, max, mean;
+};
+
+static fd_quant_t g_quant;
+static fd_resampler_t g_rs;
+static fd_png_enc_t g_enc;
+static uint8_t *g_png_out;
+static size_t g_png_cap;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static void show_help(FILE *out, const char *prog) {
+    fprintf(out, "Usage: %s [-n N] [-w N] [-k noyau] [-o sortie.json] [-b reference.json]\n\n", prog);
+    fprintf(out, "Microbenchmarks des noyaux image et des ZIP d'upload (médiane et percentiles par appel).\n\n");
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -n N    échantillons mesurés par cas (défaut 50)\n");
+    fprintf(out, "  -w N    échantillons de chauffe par cas (défaut 5)\n");
+    fprintf(out, "  -k NOM  seulement les noyaux dont le nom contient NOM\n");
+    fprintf(out, "  -o F    écrit les résultats en JSON dans F\n");
+    fprintf(out, "  -b F    compare les médianes à un JSON précédent\n");
+    fprintf(out, "  -h      cette aide\n");
+}
+
+// --- Images ---
+
+// Générateur fixe (LCG) : les images synthétiques sont identiques d'une machine à l'autre.
+static uint32_t g_seed = 0x600fdecu;
+static uint32_t rnd(void) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return g_seed >> 8;
+}
+
+static uint8_t clamp_u8(int v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static int image_alloc(image_t *im, const char *name, int w, int h) {
+    snprintf(im->name, sizeof(im->name), "%s", name);
+    im->w = w;
+    im->h = h;
+    im->rgba = calloc((size_t)w * (size_t)h, 4);
+    return im->rgba ? 0 : -1;
+}
+
+// Icône type preset: fond transparent, carré arrondi uni, disque en dégradé (bords anti-aliasés).
+static int synth_icon(image_t *im) {
+    if (image_alloc(im, "synth_icon", BTN, BTN) != 0) return -1;
+    fd_rrect_t rr = fd_rrect_centered(BTN, BTN, 180, 180, 36);
+    fd_raster_fill_rrect(im->rgba, BTN, BTN, (size_t)BTN * 4, &rr, 0x22, 0x33, 0x44);
+    for (int y = 0; y < BTN; y++) {
+        for (int x = 0; x < BTN; x++) {
+            double dx = x - 98.0, dy = y - 90.0;
+            double d = dx * dx + dy * dy;
+            if (d > 56.0 * 56.0) continue;
+            double cov = d > 55.0 * 55.0 ? 56.0 - sqrt(d) : 1.0;
+            uint8_t *px = im->rgba + ((size_t)y * BTN + (size_t)x) * 4;
+            fd_raster_over(px, clamp_u8(255 - y), clamp_u8(120 + x / 2), 0xe0, (unsigned)(cov * 255.0));
+        }
+    }
+    return 0;
+}
+
+// Photo type fond d'écran: dégradés croisés + bruit (beaucoup de couleurs).
+static int synth_photo(image_t *im) {
+    if (image_alloc(im, "synth_photo", 640, 360) != 0) return -1;
+    for (int y = 0; y < im->h; y++) {
+        for (int x = 0; x < im->w; x++) {
+            uint8_t *px = im->rgba + ((size_t)y * (size_t)im->w + (size_t)x) * 4;
+            int n = (int)(rnd() % 25) - 12;
+            px[0] = clamp_u8(x * 255 / im->w + n);
+            px[1] = clamp_u8(y * 255 / im->h + n);
+            px[2] = clamp_u8(((x + y) & 255) / 2 + 64 + n);
+            px[3] = 255;
+        }
+    }
+    return 0;
+}
+
+static int image_load(image_t *im, const char *root, const char *rel) {
+    char path[PATH_MAX];
+    if (fd_resolve_root_relative(root, rel, path, sizeof(path)) != 0) return -1;
+    fd_png_dec_t dec;
+    fd_png_dec_init(&dec);
+    if (fd_png_load(&dec, path) != 0) {
+        fd_png_dec_free(&dec);
+        return -1;
+    }
+    const char *base = strrchr(rel, '/');
+    char name[48];
+    snprintf(name, sizeof(name), "%.40s", base ? base + 1 : rel);
+    char *dot = strrchr(name, '.');
+    if (dot) *dot = 0;
+    int rc = image_alloc(im, name, dec.w, dec.h);
+    if (rc == 0) memcpy(im->rgba, dec.rgba, (size_t)dec.w * (size_t)dec.h * 4);
+    fd_png_dec_free(&dec);
+    return rc;
+}
+
+static int image_crop(image_t *dst, const image_t *src, const char *suffix, int x0, int y0, int w, int h) {
+    char name[48];
+    snprintf(name, sizeof(name), "%.32s%.8s", src->name, suffix);
+    if (x0 + w > src->w || y0 + h > src->h || image_alloc(dst, name, w, h) != 0) return -1;
+    for (int y = 0; y < h; y++) {
+        memcpy(dst->rgba + (size_t)y * (size_t)w * 4, src->rgba + ((size_t)(y0 + y) * (size_t)src->w + (size_t)x0) * 4,
+               (size_t)w * 4);
+    }
+    return 0;
+}
+
+// --- Noyaux ---
+
+static void prep_copy(bench_case_t *c) {
+    memcpy(c->work, c->img->rgba, c->bytes);
+}
+
+static int run_quantize(bench_case_t *c) {
+    return fd_quant_rgba(&g_quant, c->work, c->w, c->h, 8, 0) > 0 ? 0 : -1;
+}
+
+static int run_dither(bench_case_t *c) {
+    fd_dither_fs_rgba(c->work, c->w, c->h, (size_t)c->w * 4, 6);
+    return 0;
+}
+
+// draw_normalize: carré centré, puis redimensionné vers sa taille cible.
+static int run_resize(bench_case_t *c) {
+    const image_t *im = c->img;
+    int side = im->w < im->h ? im->w : im->h;
+    const uint8_t *sq = im->rgba + ((size_t)((im->h - side) / 2) * (size_t)im->w + (size_t)((im->w - side) / 2)) * 4;
+    return fd_resample_rgba(&g_rs, sq, side, side, (size_t)im->w * 4, c->dst, 100, 100, 100 * 4, FD_FILTER_TRIANGLE, 0);
+}
+
+static int run_over(bench_case_t *c) {
+    uint8_t *top = fd_resample_rgba_alloc(c->top->rgba, c->top->w, c->top->h, c->w, c->h, FD_FILTER_TRIANGLE, 0);
+    if (!top) return -1;
+    fd_raster_over_image(c->work, top, (size_t)c->w * (size_t)c->h);
+    free(top);
+    return 0;
+}
+
+static int run_optimize(bench_case_t *c) {
+    uint8_t pal[256][4];
+    int pal_n = 0;
+    size_t len = 0;
+    if (fd_opt_quantize(c->work, c->w, c->h, 64, NULL, pal, &pal_n, c->dst, NULL) != 0) return -1;
+    return fd_png_encode_indexed_z(&g_enc, c->dst, c->w, c->h, (size_t)c->w, (const uint8_t (*)[4])pal, pal_n,
+                                   Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY, FD_PNG_FILTER_NONE, g_png_out, g_png_cap,
+                                   &len);
+}
+
+static int run_border(bench_case_t *c) {
+    fd_rrect_t rr = fd_rrect_centered(c->w, c->h, BTN, BTN, BTN * 20 / 100);
+    fd_raster_fill_rrect(c->work, c->w, c->h, (size_t)c->w * 4, &rr, 0x30, 0x60, 0x90);
+    return 0;
+}
+
+static int run_zip(bench_case_t *c) {
+    int pad = 0;
+    size_t patched = 0;
+    if (fd_devzip_solve(c->zip, c->icons, c->icon_count, FD_DEVZIP_MAX_PAD, &pad, &patched) != 0) return -1;
+    snprintf(c->note, sizeof(c->note), "pad=%d patched=%zu zip=%zu", pad, patched, c->zip->zip_len);
+    return 0;
+}
+
+static volatile int g_sink;
+
+static int run_invalid(bench_case_t *c) {
+    g_sink += fd_devzip_bad_bytes(c->zip->zip, c->zip->zip_len);
+    return 0;
+}
+
+// --- Page d'icônes pour les ZIP ---
+
+typedef struct {
+    fd_devzip_icon_t icons[14];
+    char names[14][32];
+    uint8_t *png[14];
+    fd_devzip_t zip;
+} page_t;
+
+// 13 tuiles + la large (bouton 14), encodées comme les outils draw_* (RGBA 8 bits, FD_PNG_SMALL).
+static int page_build(page_t *pg, const image_t *src, const char *tag) {
+    memset(pg, 0, sizeof(*pg));
+    fd_devzip_init(&pg->zip);
+    for (int i = 0; i < 14; i++) {
+        int w = i < 13 ? BTN : WIDE_W;
+        image_t tile;
+        int x0 = (i % 5) * 32 % (src->w - w + 1), y0 = (i / 5) * 40 % (src->h - BTN + 1);
+        if (src->w < w || src->h < BTN || image_crop(&tile, src, "", x0, y0, w, BTN) != 0) return -1;
+        size_t cap = fd_png_bound(w, BTN), len = 0;
+        pg->png[i] = malloc(cap);
+        int rc = pg->png[i] ? fd_png_encode_rgba8(&g_enc, tile.rgba, w, BTN, (size_t)w * 4, FD_PNG_SMALL, pg->png[i],
+                                                  cap, &len)
+                            : -1;
+        free(tile.rgba);
+        if (rc != 0) return -1;
+        snprintf(pg->names[i], sizeof(pg->names[i]), "%s_%d.png", tag, i + 1);
+        pg->icons[i] = (fd_devzip_icon_t){ .btn = i, .name = pg->names[i], .label = "", .data = pg->png[i], .len = len };
+    }
+    return 0;
+}
+
+static void page_free(page_t *pg) {
+    for (int i = 0; i < 14; i++) free(pg->png[i]);
+    fd_devzip_free(&pg->zip);
+}
+
+// --- Mesure ---
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Rang le plus proche sur les échantillons triés.
+static double percentile(const double *s, int n, double p) {
+    int k = (int)(p / 100.0 * n + 0.999999) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return s[k];
+}
+
+static int bench_run(bench_case_t *c, int warmup, int reps) {
+    c->samples = malloc(sizeof(double) * (size_t)reps);
+    if (!c->samples) return -1;
+    for (int i = 0; i < warmup + reps; i++) {
+        if (c->prep) c->prep(c);
+        double t0 = now_us();
+        for (int k = 0; k < c->calls; k++) {
+            if (c->run(c) != 0) return -1;
+        }
+        double us = (now_us() - t0) / c->calls;
+        if (i >= warmup) c->samples[i - warmup] = us;
+    }
+    qsort(c->samples, (size_t)reps, sizeof(double), cmp_double);
+    c->median = reps % 2 ? c->samples[reps / 2] : (c->samples[reps / 2 - 1] + c->samples[reps / 2]) / 2.0;
+    c->p90 = percentile(c->samples, reps, 90.0);
+    c->p99 = percentile(c->samples, reps, 99.0);
+    c->min = c->samples[0];
+    c->max = c->samples[reps - 1];
+    c->mean = 0;
+    for (int i = 0; i < reps; i++) c->mean += c->samples[i];
+    c->mean /= reps;
+    return 0;
+}
+
+// Médiane d'un cas dans un JSON écrit par -o (un résultat par ligne), ou -1.
+static double baseline_median(const char *json, const char *kernel, const char *input) {
+    char key[160];
+    snprintf(key, sizeof(key), "\"kernel\": \"%s\", \"input\": \"%s\",", kernel, input);
+    const char *p = json ? strstr(json, key) : NULL;
+    const char *m = p ? strstr(p, "\"median_us\": ") : NULL;
+    const char *eol = p ? strchr(p, '\n') : NULL;
+    if (!m || (eol && m > eol)) return -1;
+    return strtod(m + 13, NULL);
+}
+
+static char *read_text(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    char *buf = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!buf || fseek(f, 0, SEEK_SET) != 0 || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    buf[size] = 0;
+    return buf;
+}
+
+static int write_json(const char *path, const bench_case_t *cases, int n, int warmup, int reps) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\n  \"tool\": \"kernel_bench\",\n  \"unit\": \"us_per_call\",\n  \"warmup\": %d,\n  \"reps\": %d,\n",
+            warmup, reps);
+    fprintf(f, "  \"quant_simd\": %d,\n  \"results\": [\n", FD_QUANT_SIMD);
+    for (int i = 0; i < n; i++) {
+        const bench_case_t *c = &cases[i];
+        fprintf(f,
+                "    {\"kernel\": \"%s\", \"input\": \"%s\", \"w\": %d, \"h\": %d, \"calls\": %d, \"median_us\": %.3f, "
+                "\"p90_us\": %.3f, \"p99_us\": %.3f, \"min_us\": %.3f, \"max_us\": %.3f, \"mean_us\": %.3f, \"note\": \"%s\"}%s\n",
+                c->kernel, c->input, c->w, c->h, c->calls, c->median, c->p90, c->p99, c->min, c->max, c->mean, c->note,
+                i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static bench_case_t *add_case(bench_case_t *cases, int *n, const char *filter, const char *kernel, const image_t *img,
+                              int (*run)(bench_case_t *), void (*prep)(bench_case_t *)) {
+    if (filter && !strstr(kernel, filter)) return NULL;
+    if (*n >= MAX_CASES) return NULL;
+    bench_case_t *c = &cases[(*n)++];
+    memset(c, 0, sizeof(*c));
+    c->kernel = kernel;
+    c->img = img;
+    c->run = run;
+    c->prep = prep;
+    c->calls = 1;
+    if (img) {
+        snprintf(c->input, sizeof(c->input), "%s", img->name);
+        c->w = img->w;
+        c->h = img->h;
+        c->bytes = (size_t)img->w * (size_t)img->h * 4;
+        c->work = malloc(c->bytes);
+        c->dst = malloc(c->bytes);
+        if (!c->work || !c->dst) return NULL;
+        memcpy(c->work, img->rgba, c->bytes);
+    }
+    return c;
+}
+
+int main(int argc, char **argv) {
+    int reps = 50, warmup = 5;
+    const char *filter = NULL, *out_json = NULL, *base_json = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            show_help(stdout, argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_json = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            base_json = argv[++i];
+        } else {
+            show_help(stderr, argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1 || warmup < 0) {
+        show_help(stderr, argv[0]);
+        return 1;
+    }
+
+    char root[PATH_MAX];
+    if (fd_find_project_root(root, sizeof(root)) != 0) {
+        fprintf(stderr, "Racine du projet introuvable (définir PROJECT_ROOT)\n");
+        return 1;
+    }
+    if (fd_quant_init(&g_quant) != 0) return 1;
+    fd_resampler_init(&g_rs);
+    fd_png_enc_init(&g_enc);
+    g_png_cap = fd_png_bound(640, 640);
+    g_png_out = malloc(g_png_cap);
+    if (!g_png_out) return 1;
+
+    // Entrées: icônes 196x196 (synthétique, pregen, tuile de fond d'écran) et pages 640x360.
+    image_t icon, photo, error_icon, wallpaper, photo_tile, wall_tile;
+    if (synth_icon(&icon) != 0 || synth_photo(&photo) != 0 ||
+        image_crop(&photo_tile, &photo, "_tile", 222, 82, BTN, BTN) != 0) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+    if (image_load(&error_icon, root, "assets/pregen/error.png") != 0 ||
+        image_load(&wallpaper, root, "mymedia/wallpapers/pinefluid.png") != 0 ||
+        image_crop(&wall_tile, &wallpaper, "_tile", 222, 82, BTN, BTN) != 0) {
+        fprintf(stderr, "Erreur: échantillons du dépôt illisibles (assets/pregen, mymedia/wallpapers)\n");
+        return 1;
+    }
+    const image_t *icons[] = { &icon, &error_icon, &wall_tile };
+    const image_t *pages[] = { &photo, &wallpaper };
+    const image_t *tiles[] = { &photo_tile, &wall_tile };
+
+    page_t synth_page, real_page;
+    if (page_build(&synth_page, &photo, "synth") != 0 || page_build(&real_page, &wallpaper, "pinefluid") != 0) {
+        fprintf(stderr, "Erreur: encodage des pages de test\n");
+        return 1;
+    }
+    page_t *zpages[] = { &synth_page, &real_page };
+    const char *zpage_names[] = { "synth_page14", "pinefluid_page14" };
+
+    static bench_case_t cases[MAX_CASES];
+    int n = 0;
+    bench_case_t *c;
+    for (size_t i = 0; i < 2; i++) add_case(cases, &n, filter, "quantize_colors", tiles[i], run_quantize, prep_copy);
+    for (size_t i = 0; i < 2; i++) add_case(cases, &n, filter, "apply_dithering", pages[i], run_dither, prep_copy);
+    for (size_t i = 0; i < 2; i++) {
+        if ((c = add_case(cases, &n, filter, "resize_icon", pages[i], run_resize, NULL))) c->w = c->h = 100;
+    }
+    if ((c = add_case(cases, &n, filter, "resize_icon", &error_icon, run_resize, NULL))) c->w = c->h = 100;
+    for (size_t i = 0; i < 2; i++) {
+        if ((c = add_case(cases, &n, filter, "draw_over", tiles[i], run_over, prep_copy))) {
+            c->top = i ? &error_icon : &icon;
+            snprintf(c->input, sizeof(c->input), "%.28s_over_%.28s", c->top->name, c->img->name);
+        }
+    }
+    for (size_t i = 0; i < 3; i++) add_case(cases, &n, filter, "draw_optimize", icons[i], run_optimize, prep_copy);
+    for (size_t i = 0; i < 2; i++) add_case(cases, &n, filter, "blend_overlay", icons[i], run_border, NULL);
+    for (size_t i = 0; i < 2; i++) {
+        if ((c = add_case(cases, &n, filter, "build_zip_from_icons", NULL, run_zip, NULL))) {
+            c->zip = &zpages[i]->zip;
+            c->icons = zpages[i]->icons;
+            c->icon_count = 14;
+            snprintf(c->input, sizeof(c->input), "%s", zpage_names[i]);
+        }
+    }
+    for (size_t i = 0; i < 2; i++) {
+        if ((c = add_case(cases, &n, filter, "has_invalid_bytes", NULL, run_invalid, NULL))) {
+            int pad = 0;
+            size_t patched = 0;
+            c->zip = &zpages[i]->zip;
+            if (fd_devzip_solve(c->zip, zpages[i]->icons, 14, FD_DEVZIP_MAX_PAD, &pad, &patched) != 0) return 1;
+            c->calls = 1000;
+            snprintf(c->input, sizeof(c->input), "%s", zpage_names[i]);
+            snprintf(c->note, sizeof(c->note), "zip=%zu", c->zip->zip_len);
+        }
+    }
+
+    char *base = base_json ? read_text(base_json) : NULL;
+    if (base_json && !base) fprintf(stderr, "Avertissement: référence illisible: %s\n", base_json);
+    printf("%-22s %-34s %9s %10s %10s %10s %10s %8s\n", "noyau", "entrée", "taille", "med_us", "p90_us", "p99_us",
+           "min_us", base ? "vs_ref" : "");
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        c = &cases[i];
+        if (bench_run(c, warmup, reps) != 0) {
+            fprintf(stderr, "Erreur: %s/%s a échoué\n", c->kernel, c->input);
+            failed++;
+            continue;
+        }
+        char size[24] = "";
+        if (c->w > 0) snprintf(size, sizeof(size), "%dx%d", c->w, c->h);
+        char delta[16] = "";
+        double ref = baseline_median(base, c->kernel, c->input);
+        if (ref > 0) snprintf(delta, sizeof(delta), "%+.1f%%", (c->median - ref) * 100.0 / ref);
+        printf("%-22s %-34.34s %9s %10.2f %10.2f %10.2f %10.2f %8s\n", c->kernel, c->input, size, c->median, c->p90,
+               c->p99, c->min, delta);
+    }
+    if (out_json && !failed) {
+        if (write_json(out_json, cases, n, warmup, reps) != 0) {
+            fprintf(stderr, "Erreur: écriture de %s\n", out_json);
+            failed++;
+        } else {
+            printf("%d cas, %d échantillons (+%d de chauffe): %s\n", n, reps, warmup, out_json);
+        }
+    }
+
+    free(base);
+    for (int i = 0; i < n; i++) {
+        free(cases[i].samples);
+        free(cases[i].work);
+        free(cases[i].dst);
+    }
+    page_free(&synth_page);
+    page_free(&real_page);
+    image_t *all[] = { &icon, &photo, &error_icon, &wallpaper, &photo_tile, &wall_tile };
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) free(all[i]->rgba);
+    free(g_png_out);
+    fd_png_enc_free(&g_enc);
+    fd_resampler_free(&g_rs);
+    fd_quant_free(&g_quant);
+    return failed ? 1 : 0;
+}
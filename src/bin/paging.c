@@ -43,6 +43,10 @@
 #include <execinfo.h>
 
 #include "../third_party/jsmn.h"
+#include "../icons/fd_png.h"
+#include "../icons/fd_raster.h"
+#include "../icons/fd_slab.h"
+#include "../icons/fd_tiles.h"
 
 typedef struct {
     char *key;
@@ -180,6 +184,11 @@ typedef struct {
     
     WallpaperCfg wallpaper;
     bool disable_wallpapers;  // Global wallpaper disable setting
+
+    // ram_cache: byte budget of the state dir caches (shm_cache_*)
+    int ram_cache_budget_mb;      // 0 = auto
+    int ram_cache_quota_pct[4];   // icons, wallpaper, compositions, tmp (% of the budget)
+    int ram_cache_low_mem_pct;    // low-memory mode below this MemAvailable / MemTotal
 } Config;
 
 typedef struct {
@@ -456,6 +465,8 @@ static void log_action(const char *fmt, ...) {
 }
 
 static int file_exists(const char *path);
+static double now_sec_monotonic(void);
+static void render_plans_invalidate(void);
 static int send_line_and_read_reply(const char *sock_path, const char *line, char *reply, size_t reply_cap);
 
 static int ulanzi_apply_default_label_style(const Options *opt) {
@@ -1424,6 +1435,12 @@ static void config_init_defaults(Config *cfg) {
     cfg->wallpaper.dithering = true;
     cfg->wallpaper.set = false;
     cfg->disable_wallpapers = false;  // Default: wallpapers enabled
+    cfg->ram_cache_budget_mb = 0;
+    cfg->ram_cache_quota_pct[0] = 25;
+    cfg->ram_cache_quota_pct[1] = 40;
+    cfg->ram_cache_quota_pct[2] = 50;
+    cfg->ram_cache_quota_pct[3] = 10;
+    cfg->ram_cache_low_mem_pct = 10;
 }
 
 static void preset_init_defaults(Preset *p, const char *name) {
@@ -1477,6 +1494,7 @@ static Preset *config_add_preset(Config *cfg, const char *name) {
 }
 
 static void config_free(Config *cfg) {
+    render_plans_invalidate();   // plans point into the presets
     for (size_t i = 0; i < cfg->preset_count; i++) {
         Preset *p = &cfg->presets[i];
         free(p->name);
@@ -1597,6 +1615,24 @@ static int load_config(const char *path, Config *out) {
         if (cs && parse_int_scalar(cs, &v) == 0) cfg.cmd_timeout_ms = (v < 0) ? 0 : v;
     }
 
+    // ram_cache: { budget_mb, icons, wallpaper, compositions, tmp, low_memory_percent }
+    {
+        yaml_node_t *rn = yaml_mapping_get(&doc, root, "ram_cache");
+        if (rn && rn->type == YAML_MAPPING_NODE) {
+            static const char *const quota_keys[4] = { "icons", "wallpaper", "compositions", "tmp" };
+            yaml_node_t *n;
+            int v = 0;
+            n = yaml_mapping_get(&doc, rn, "budget_mb");
+            if (yaml_scalar_cstr(n) && parse_int_scalar(yaml_scalar_cstr(n), &v) == 0) cfg.ram_cache_budget_mb = (v < 0) ? 0 : v;
+            for (int i = 0; i < 4; i++) {
+                n = yaml_mapping_get(&doc, rn, quota_keys[i]);
+                if (yaml_scalar_cstr(n) && parse_int_scalar(yaml_scalar_cstr(n), &v) == 0) cfg.ram_cache_quota_pct[i] = clamp_int(v, 0, 100);
+            }
+            n = yaml_mapping_get(&doc, rn, "low_memory_percent");
+            if (yaml_scalar_cstr(n) && parse_int_scalar(yaml_scalar_cstr(n), &v) == 0) cfg.ram_cache_low_mem_pct = clamp_int(v, 0, 90);
+        }
+    }
+
     // global section
     {
         yaml_node_t *gn = yaml_mapping_get(&doc, root, "global");
@@ -2017,6 +2053,439 @@ static bool is_under_prefix(const char *path, const char *prefix) {
     return strncmp(path, prefix, n) == 0 && (path[n] == 0 || path[n] == '/');
 }
 
+// --- RAM cache manager (state dir, usually /dev/shm) ---
+// The session caches under the state dir (icon_cache, wallpaper/<hash>, wp_comp/<sig>/<pos>) only
+// ever grew. Every file they serve or create is touched here: one in-memory index with its size and
+// last use, a global byte budget and a quota per namespace. Past either, least recently used files
+// are unlinked (all of them are regenerated on the next miss). Files touched while the current page
+// is shown are pinned. tmp/ holds temporaries of one render: files left behind are swept by age.
+// Low-memory mode (MemAvailable under ram_cache.low_memory_percent of MemTotal, or memory pressure
+// from PSI) divides the budget by 4.
+enum { SHM_NS_ICON, SHM_NS_WALLPAPER, SHM_NS_WP_COMP, SHM_NS_TMP, SHM_NS_COUNT };
+
+#define SHM_CACHE_CHECK_SEC 5.0       // meminfo/PSI poll + tmp sweep period
+#define SHM_TMP_MAX_AGE_SEC 600       // a temporary older than this is abandoned
+#define SHM_PSI_LOW_AVG10 10.0        // "some" memory stall percentage that counts as low memory
+
+typedef struct {
+    char *path;
+    int ns;
+    uint64_t bytes;
+    uint64_t last_use;                // g_shm.tick at the last touch
+    uint64_t pin;                     // g_shm.pin_epoch at the last touch
+} ShmEntry;
+
+static struct {
+    pthread_mutex_t mu;
+    ShmEntry *items;
+    size_t count, cap;
+    uint32_t *index;                  // open addressing on fnv1a32(path): item + 1, 0 = free
+    size_t index_cap;
+    uint64_t tick, pin_epoch;
+    char pin_page[256];
+    size_t pin_offset;
+    uint64_t bytes[SHM_NS_COUNT], total;
+    uint64_t budget, quota[SHM_NS_COUNT];
+    uint64_t evictions[SHM_NS_COUNT], evicted_bytes[SHM_NS_COUNT];
+    int low_mem_pct;
+    bool low_mem;
+    double next_check;
+} g_shm = { .mu = PTHREAD_MUTEX_INITIALIZER };
+
+static void shm_index_rebuild(void) {
+    size_t want = 64;
+    while (want < g_shm.count * 2) want *= 2;
+    if (want != g_shm.index_cap) {
+        free(g_shm.index);
+        g_shm.index = calloc(want, sizeof(*g_shm.index));
+        if (!g_shm.index) die_errno("calloc");
+        g_shm.index_cap = want;
+    } else {
+        memset(g_shm.index, 0, want * sizeof(*g_shm.index));
+    }
+    for (size_t i = 0; i < g_shm.count; i++) {
+        size_t k = fnv1a32(g_shm.items[i].path, strlen(g_shm.items[i].path)) & (g_shm.index_cap - 1);
+        while (g_shm.index[k]) k = (k + 1) & (g_shm.index_cap - 1);
+        g_shm.index[k] = (uint32_t)i + 1;
+    }
+}
+
+static ShmEntry *shm_find(const char *path) {
+    if (!g_shm.index_cap) return NULL;
+    size_t k = fnv1a32(path, strlen(path)) & (g_shm.index_cap - 1);
+    for (; g_shm.index[k]; k = (k + 1) & (g_shm.index_cap - 1)) {
+        ShmEntry *e = &g_shm.items[g_shm.index[k] - 1];
+        if (strcmp(e->path, path) == 0) return e;
+    }
+    return NULL;
+}
+
+static void shm_budget_from_config(const Config *cfg) {
+    uint64_t budget = (uint64_t)(cfg->ram_cache_budget_mb > 0 ? cfg->ram_cache_budget_mb : 0) << 20;
+    if (budget == 0) {
+        // auto: 1/16 of the RAM, 16..96 MiB (32 MiB on a 512 MB Pi Zero 2W)
+        long pages = sysconf(_SC_PHYS_PAGES), psz = sysconf(_SC_PAGESIZE);
+        budget = (pages > 0 && psz > 0) ? (uint64_t)pages * (uint64_t)psz / 16u : (32u << 20);
+        if (budget < (16u << 20)) budget = 16u << 20;
+        if (budget > (96u << 20)) budget = 96u << 20;
+    }
+    g_shm.budget = budget;
+    for (int ns = 0; ns < SHM_NS_COUNT; ns++) g_shm.quota[ns] = budget / 100u * (uint64_t)cfg->ram_cache_quota_pct[ns];
+    g_shm.low_mem_pct = cfg->ram_cache_low_mem_pct;
+}
+
+// Evict least recently used, unpinned entries while a namespace is over its quota or the total over
+// the budget (both divided by 4 in low-memory mode). Caller holds mu.
+static void shm_enforce_locked(void) {
+    unsigned div = g_shm.low_mem ? 4u : 1u;
+    if (g_shm.budget == 0) return;
+    bool removed = false;
+    for (;;) {
+        bool over_total = g_shm.total > g_shm.budget / div;
+        size_t victim = SIZE_MAX;
+        for (size_t i = 0; i < g_shm.count; i++) {
+            const ShmEntry *e = &g_shm.items[i];
+            if (e->pin == g_shm.pin_epoch) continue;
+            if (!over_total && g_shm.bytes[e->ns] <= g_shm.quota[e->ns] / div) continue;
+            if (victim == SIZE_MAX || e->last_use < g_shm.items[victim].last_use) victim = i;
+        }
+        if (victim == SIZE_MAX) break;
+        ShmEntry *e = &g_shm.items[victim];
+        (void)unlink(e->path);
+        g_shm.evictions[e->ns]++;
+        g_shm.evicted_bytes[e->ns] += e->bytes;
+        g_shm.bytes[e->ns] -= e->bytes;
+        g_shm.total -= e->bytes;
+        free(e->path);
+        g_shm.items[victim] = g_shm.items[--g_shm.count];
+        removed = true;
+    }
+    if (removed) shm_index_rebuild();
+}
+
+// Record a use of a cache file (hit or freshly written), pinned to the current page.
+static void shm_cache_touch(const char *path, int ns) {
+    if (!path || !path[0] || ns < 0 || ns >= SHM_NS_COUNT) return;
+    pthread_mutex_lock(&g_shm.mu);
+    ShmEntry *e = shm_find(path);
+    if (!e) {
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (g_shm.count == g_shm.cap) {
+                size_t nc = g_shm.cap ? g_shm.cap * 2 : 256;
+                ShmEntry *ni = realloc(g_shm.items, nc * sizeof(*ni));
+                if (!ni) die_errno("realloc");
+                g_shm.items = ni;
+                g_shm.cap = nc;
+            }
+            e = &g_shm.items[g_shm.count++];
+            e->path = xstrdup(path);
+            e->ns = ns;
+            e->bytes = (uint64_t)st.st_size;
+            g_shm.bytes[ns] += e->bytes;
+            g_shm.total += e->bytes;
+            if (g_shm.count * 2 > g_shm.index_cap) {
+                shm_index_rebuild();
+            } else {
+                size_t k = fnv1a32(path, strlen(path)) & (g_shm.index_cap - 1);
+                while (g_shm.index[k]) k = (k + 1) & (g_shm.index_cap - 1);
+                g_shm.index[k] = (uint32_t)g_shm.count;
+            }
+        }
+    }
+    if (e) {
+        e->last_use = ++g_shm.tick;
+        e->pin = g_shm.pin_epoch;
+        shm_enforce_locked();
+    }
+    pthread_mutex_unlock(&g_shm.mu);
+}
+
+// A new page is on screen: what the previous one pinned becomes evictable.
+static void shm_cache_pin_page(const char *page_name, size_t offset) {
+    pthread_mutex_lock(&g_shm.mu);
+    if (strcmp(g_shm.pin_page, page_name) != 0 || g_shm.pin_offset != offset) {
+        snprintf(g_shm.pin_page, sizeof(g_shm.pin_page), "%s", page_name);
+        g_shm.pin_offset = offset;
+        g_shm.pin_epoch++;
+    }
+    pthread_mutex_unlock(&g_shm.mu);
+}
+
+static void shm_scan_dir(const char *dir, int ns, int depth) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char p[PATH_MAX];
+        struct stat st;
+        if (path_snprintf(p, sizeof(p), "%s/%s", dir, ent->d_name) != 0 || lstat(p, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode) && depth > 0) shm_scan_dir(p, ns, depth - 1);
+        else if (S_ISREG(st.st_mode)) shm_cache_touch(p, ns);
+    }
+    closedir(d);
+}
+
+// Startup: apply the budget and index what a previous run left (state dir not wiped outside /dev/shm).
+static void shm_cache_init(const Options *opt, const Config *cfg) {
+    pthread_mutex_lock(&g_shm.mu);
+    shm_budget_from_config(cfg);
+    g_shm.pin_epoch = 1;   // entries scanned below are not pinned by any page
+    pthread_mutex_unlock(&g_shm.mu);
+    char dir[PATH_MAX], sub[PATH_MAX];
+    state_dir(opt, dir, sizeof(dir));
+    static const struct { const char *name; int ns, depth; } subs[] = {
+        { "icon_cache", SHM_NS_ICON, 0 }, { "wallpaper", SHM_NS_WALLPAPER, 1 }, { "wp_comp", SHM_NS_WP_COMP, 2 } };
+    for (size_t i = 0; i < sizeof(subs) / sizeof(subs[0]); i++) {
+        if (path_snprintf(sub, sizeof(sub), "%s/%s", dir, subs[i].name) == 0) shm_scan_dir(sub, subs[i].ns, subs[i].depth);
+    }
+    pthread_mutex_lock(&g_shm.mu);
+    g_shm.pin_epoch++;
+    pthread_mutex_unlock(&g_shm.mu);
+}
+
+static bool shm_low_memory(int low_pct, bool was_low) {
+    long long total = 0, avail = -1;
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (f) {
+        char line[128];
+        while (fgets(line, sizeof(line), f)) {
+            if (strncmp(line, "MemTotal:", 9) == 0) total = atoll(line + 9);
+            else if (strncmp(line, "MemAvailable:", 13) == 0) avail = atoll(line + 13);
+        }
+        fclose(f);
+    }
+    // Hysteresis: leave low-memory mode only with 50% more headroom than it took to enter it.
+    int pct = was_low ? low_pct + low_pct / 2 : low_pct;
+    if (total > 0 && avail >= 0 && avail * 100 < total * pct) return true;
+    f = fopen("/proc/pressure/memory", "r");
+    if (f) {
+        char line[160];
+        double avg10 = 0.0;
+        if (fgets(line, sizeof(line), f) && strncmp(line, "some ", 5) == 0) {
+            const char *a = strstr(line, "avg10=");
+            if (a) avg10 = atof(a + 6);
+        }
+        fclose(f);
+        if (avg10 >= SHM_PSI_LOW_AVG10) return true;
+    }
+    return false;
+}
+
+// tmp/: remove abandoned temporaries; over the tmp quota, the oldest ones older than a minute too.
+static void shm_sweep_tmp(const Options *opt, uint64_t quota) {
+    char dir[PATH_MAX], tmpdir[PATH_MAX];
+    state_dir(opt, dir, sizeof(dir));
+    if (path_snprintf(tmpdir, sizeof(tmpdir), "%s/tmp", dir) != 0) return;
+    DIR *d = opendir(tmpdir);
+    if (!d) return;
+    time_t now = time(NULL);
+    uint64_t total = 0, removed = 0, removed_bytes = 0;
+    char oldest[PATH_MAX] = {0};
+    time_t oldest_t = now;
+    uint64_t oldest_sz = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char p[PATH_MAX];
+        struct stat st;
+        if (path_snprintf(p, sizeof(p), "%s/%s", tmpdir, ent->d_name) != 0 || lstat(p, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (now - st.st_mtime > SHM_TMP_MAX_AGE_SEC && unlink(p) == 0) {
+            removed++;
+            removed_bytes += (uint64_t)st.st_size;
+            continue;
+        }
+        total += (uint64_t)st.st_size;
+        if (now - st.st_mtime > 60 && st.st_mtime < oldest_t) {
+            oldest_t = st.st_mtime;
+            oldest_sz = (uint64_t)st.st_size;
+            snprintf(oldest, sizeof(oldest), "%s", p);
+        }
+    }
+    closedir(d);
+    // One extra file per sweep is enough: tmp/ only grows through failed renders.
+    if (total > quota && oldest[0] && unlink(oldest) == 0) {
+        removed++;
+        removed_bytes += oldest_sz;
+        total -= oldest_sz;
+    }
+    pthread_mutex_lock(&g_shm.mu);
+    g_shm.bytes[SHM_NS_TMP] = total;
+    g_shm.evictions[SHM_NS_TMP] += removed;
+    g_shm.evicted_bytes[SHM_NS_TMP] += removed_bytes;
+    pthread_mutex_unlock(&g_shm.mu);
+}
+
+// Main loop: every SHM_CACHE_CHECK_SEC, refresh the low-memory state, enforce and sweep tmp/.
+static void shm_cache_tick(const Options *opt) {
+    double now = now_sec_monotonic();
+    if (now < g_shm.next_check) return;
+    g_shm.next_check = now + SHM_CACHE_CHECK_SEC;
+    bool low = shm_low_memory(g_shm.low_mem_pct, g_shm.low_mem);
+    pthread_mutex_lock(&g_shm.mu);
+    if (low != g_shm.low_mem) {
+        log_msg("ram cache: %s low-memory mode (%llu KiB cached)", low ? "entering" : "leaving",
+                (unsigned long long)(g_shm.total >> 10));
+    }
+    g_shm.low_mem = low;
+    shm_enforce_locked();
+    uint64_t tmp_quota = g_shm.quota[SHM_NS_TMP] / (low ? 4u : 1u);
+    pthread_mutex_unlock(&g_shm.mu);
+    shm_sweep_tmp(opt, tmp_quota);
+}
+
+// --- Cache statistics (control command cache-stats) ---
+// Hits, misses and time spent producing a miss for each cache layer, plus the time spent in
+// generate_icon_pipeline and its slowest runs. Entries and bytes are read when the command is
+// served: from the RAM cache index for the state dir layers, by walking the disk caches otherwise.
+enum { CST_RENDER, CST_ICON, CST_WALLPAPER, CST_WP_COMP, CST_EXTERNAL, CST_COUNT };
+static const char *const k_cst_names[CST_COUNT] = { "render", "icon_cache", "wallpaper", "wp_comp", "external" };
+static const char *const k_shm_ns_names[SHM_NS_COUNT] = { "icon_cache", "wallpaper", "wp_comp", "tmp" };
+
+#define CST_SLOWEST 8
+
+typedef struct {
+    double ms;
+    char preset[64];
+    char out[160];
+} CstSlow;
+
+static struct {
+    pthread_mutex_t mu;
+    uint64_t hits[CST_COUNT], misses[CST_COUNT];
+    double miss_ms[CST_COUNT];        // time to produce the misses (copy, compose, pipeline...)
+    uint64_t pipe_runs, pipe_failed;
+    double pipe_ms, pipe_max_ms;
+    CstSlow slow[CST_SLOWEST];        // slowest pipeline runs, longest first
+    size_t slow_n;
+} g_cstats = { .mu = PTHREAD_MUTEX_INITIALIZER };
+
+static void cache_stats_hit(int layer) {
+    pthread_mutex_lock(&g_cstats.mu);
+    g_cstats.hits[layer]++;
+    pthread_mutex_unlock(&g_cstats.mu);
+}
+
+// t0: now_ns_monotonic() before the miss was produced.
+static void cache_stats_miss(int layer, int64_t t0) {
+    double ms = (double)(now_ns_monotonic() - t0) / 1e6;
+    pthread_mutex_lock(&g_cstats.mu);
+    g_cstats.misses[layer]++;
+    g_cstats.miss_ms[layer] += ms;
+    pthread_mutex_unlock(&g_cstats.mu);
+}
+
+static void cache_stats_pipeline(const char *preset, const char *out_png, int rc, int64_t t0) {
+    double ms = (double)(now_ns_monotonic() - t0) / 1e6;
+    pthread_mutex_lock(&g_cstats.mu);
+    g_cstats.pipe_runs++;
+    if (rc != 0) g_cstats.pipe_failed++;
+    g_cstats.pipe_ms += ms;
+    if (ms > g_cstats.pipe_max_ms) g_cstats.pipe_max_ms = ms;
+    size_t at = g_cstats.slow_n;
+    while (at > 0 && g_cstats.slow[at - 1].ms < ms) at--;
+    if (at < CST_SLOWEST) {
+        size_t n = g_cstats.slow_n < CST_SLOWEST ? g_cstats.slow_n : CST_SLOWEST - 1;
+        memmove(&g_cstats.slow[at + 1], &g_cstats.slow[at], (n - at) * sizeof(g_cstats.slow[0]));
+        CstSlow *s = &g_cstats.slow[at];
+        s->ms = ms;
+        snprintf(s->preset, sizeof(s->preset), "%s", preset && preset[0] ? preset : "default");
+        // Keep the tail of long paths: page dir and file name are what identify the button.
+        size_t ol = out_png ? strlen(out_png) : 0;
+        snprintf(s->out, sizeof(s->out), "%s", ol >= sizeof(s->out) ? out_png + ol - (sizeof(s->out) - 1) : (out_png ? out_png : ""));
+        if (g_cstats.slow_n < CST_SLOWEST) g_cstats.slow_n++;
+    }
+    pthread_mutex_unlock(&g_cstats.mu);
+}
+
+// Regular files under dir (down to depth levels of subdirs); skip: top-level names left out.
+static void cache_dir_usage(const char *dir, int depth, const char *const *skip, uint64_t *files, uint64_t *bytes) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        bool skipped = false;
+        for (size_t i = 0; skip && skip[i]; i++) {
+            if (strcmp(ent->d_name, skip[i]) == 0) skipped = true;
+        }
+        if (skipped) continue;
+        char p[PATH_MAX];
+        struct stat st;
+        if (path_snprintf(p, sizeof(p), "%s/%s", dir, ent->d_name) != 0 || lstat(p, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode) && depth > 0) {
+            cache_dir_usage(p, depth - 1, NULL, files, bytes);
+        } else if (S_ISREG(st.st_mode)) {
+            (*files)++;
+            *bytes += (uint64_t)st.st_size;
+        }
+    }
+    closedir(d);
+}
+
+// Reply of the cache-stats control command: "ok", one line per layer, the pipeline totals, then
+// one "slow" line per slowest pipeline run.
+static void cache_stats_format(const Options *opt, char *out, size_t cap) {
+    uint64_t entries[CST_COUNT] = {0}, bytes[CST_COUNT] = {0};
+    uint64_t tmp_entries = 0;
+    static const char *const render_skip[] = { "external_icons", "paging", "wallpapers", NULL };
+    cache_dir_usage(opt->cache_root, 2, render_skip, &entries[CST_RENDER], &bytes[CST_RENDER]);
+    char ext_dir[PATH_MAX];
+    if (path_snprintf(ext_dir, sizeof(ext_dir), "%s/external_icons", opt->cache_root) == 0) {
+        cache_dir_usage(ext_dir, 0, NULL, &entries[CST_EXTERNAL], &bytes[CST_EXTERNAL]);
+    }
+
+    static const int ns_layer[SHM_NS_COUNT] = { CST_ICON, CST_WALLPAPER, CST_WP_COMP, -1 };
+    pthread_mutex_lock(&g_shm.mu);
+    for (size_t i = 0; i < g_shm.count; i++) {
+        int l = ns_layer[g_shm.items[i].ns];
+        if (l >= 0) entries[l]++;
+        else tmp_entries++;
+    }
+    for (int ns = 0; ns < SHM_NS_COUNT; ns++) {
+        if (ns_layer[ns] >= 0) bytes[ns_layer[ns]] = g_shm.bytes[ns];
+    }
+    uint64_t ram_total = g_shm.total, ram_budget = g_shm.budget, tmp_bytes = g_shm.bytes[SHM_NS_TMP];
+    uint64_t evictions[SHM_NS_COUNT];
+    memcpy(evictions, g_shm.evictions, sizeof(evictions));
+    bool low = g_shm.low_mem;
+    pthread_mutex_unlock(&g_shm.mu);
+
+    pthread_mutex_lock(&g_cstats.mu);
+    int w = snprintf(out, cap, "ok\n");
+    for (int l = 0; l < CST_COUNT && w > 0 && (size_t)w < cap; l++) {
+        uint64_t lookups = g_cstats.hits[l] + g_cstats.misses[l];
+        w += snprintf(out + w, cap - (size_t)w,
+                      "%s entries=%" PRIu64 " bytes=%" PRIu64 " hits=%" PRIu64 " misses=%" PRIu64
+                      " hit_pct=%.1f miss_avg_ms=%.2f\n",
+                      k_cst_names[l], entries[l], bytes[l], g_cstats.hits[l], g_cstats.misses[l],
+                      lookups ? 100.0 * (double)g_cstats.hits[l] / (double)lookups : 0.0,
+                      g_cstats.misses[l] ? g_cstats.miss_ms[l] / (double)g_cstats.misses[l] : 0.0);
+    }
+    if (w > 0 && (size_t)w < cap) {
+        w += snprintf(out + w, cap - (size_t)w,
+                      "ram total=%" PRIu64 " budget=%" PRIu64 " low_memory=%d tmp_entries=%" PRIu64 " tmp_bytes=%" PRIu64,
+                      ram_total, ram_budget, low ? 1 : 0, tmp_entries, tmp_bytes);
+    }
+    for (int ns = 0; ns < SHM_NS_COUNT && w > 0 && (size_t)w < cap; ns++) {
+        w += snprintf(out + w, cap - (size_t)w, " %s_evictions=%" PRIu64, k_shm_ns_names[ns], evictions[ns]);
+    }
+    if (w > 0 && (size_t)w < cap) {
+        w += snprintf(out + w, cap - (size_t)w,
+                      "\npipeline runs=%" PRIu64 " failed=%" PRIu64 " total_ms=%.1f avg_ms=%.2f max_ms=%.2f\n",
+                      g_cstats.pipe_runs, g_cstats.pipe_failed, g_cstats.pipe_ms,
+                      g_cstats.pipe_runs ? g_cstats.pipe_ms / (double)g_cstats.pipe_runs : 0.0, g_cstats.pipe_max_ms);
+    }
+    for (size_t i = 0; i < g_cstats.slow_n && w > 0 && (size_t)w < cap; i++) {
+        w += snprintf(out + w, cap - (size_t)w, "slow ms=%.2f preset=%s out=%s\n", g_cstats.slow[i].ms,
+                      g_cstats.slow[i].preset, g_cstats.slow[i].out);
+    }
+    pthread_mutex_unlock(&g_cstats.mu);
+    if (w < 0) out[0] = 0;
+    else if ((size_t)w >= cap && cap >= 2) out[cap - 2] = '\n';
+}
+
 static int session_cache_icon(const Options *opt, const char *src_png, char *out_png, size_t out_cap) {
     if (!opt || !src_png || !src_png[0] || !out_png || out_cap == 0) return -1;
     out_png[0] = 0;
@@ -2047,95 +2516,479 @@ static int session_cache_icon(const Options *opt, const char *src_png, char *out
     char dst[PATH_MAX];
     if (path_snprintf(dst, sizeof(dst), "%s/%08x_%s", cdir, (unsigned)h, base) != 0) return -1;
     if (!file_exists(dst)) {
+        int64_t t0 = now_ns_monotonic();
         if (copy_file(src_png, dst) != 0) return -1;
+        cache_stats_miss(CST_ICON, t0);
+    } else {
+        cache_stats_hit(CST_ICON);
     }
+    shm_cache_touch(dst, SHM_NS_ICON);
     snprintf(out_png, out_cap, "%s", dst);
     return 0;
 }
 
-static int wallpaper_render_dir_and_prefix(const char *wallpaper_abs_png,
-                                           char *out_dir, size_t dir_cap,
-                                           char *out_prefix, size_t prefix_cap) {
-    if (!wallpaper_abs_png || !out_dir || !out_prefix || dir_cap == 0 || prefix_cap == 0) return -1;
-    out_dir[0] = 0;
-    out_prefix[0] = 0;
-
-    const char *base = strrchr(wallpaper_abs_png, '/');
-    base = base ? base + 1 : wallpaper_abs_png;
-    size_t bl = strlen(base);
-    if (bl < 4 || strcmp(base + bl - 4, ".png") != 0) return -1;
-    size_t name_len = bl - 4;
-    if (name_len + 1 > prefix_cap) return -1;
-    memcpy(out_prefix, base, name_len);
-    out_prefix[name_len] = 0;
-
-    char dirbuf[PATH_MAX];
-    snprintf(dirbuf, sizeof(dirbuf), "%s", wallpaper_abs_png);
-    char *slash = strrchr(dirbuf, '/');
-    if (slash) *slash = 0;
-    else snprintf(dirbuf, sizeof(dirbuf), ".");
-
-    if (path_snprintf(out_dir, dir_cap, "%s/%s", dirbuf, out_prefix) != 0) return -1;
-    return 0;
-}
+// --- Wallpaper tiles ---
+// A wallpaper is rendered once per content and parameters: the key hashes the file bytes
+// (memoized on dev/inode/size/mtime) with quality, magnify and dithering, so editing the image in
+// place or changing a parameter renders it again. The 14 tiles are stored as one object,
+// <cache_root>/wallpapers/<key>.wpt, and copied tile by tile into the session cache
+// (wallpaper_session_tile). PNG wallpapers are tiled in-process with fd_tiles.h, the pipeline of
+// send_image_page --no-tile-optimize. JPEG/WebP (and interlaced PNG) are still decoded by
+// send_image_page into a temporary folder, then packed into the same object.
+// Object: "FDWPT1\0\0", u32 tile count (14), then a u32 length per tile, then the PNGs back to back.
+#define WP_OBJ_MAGIC "FDWPT1\0\0"
+#define WP_OBJ_HEADER (8 + 4 + 4 * FD_TILES_COUNT)
+#define WP_KEY_LEN 17                 // 16 hex digits + NUL
+#define WP_MEMO 16
+#define WP_INFLIGHT 16
 
-static bool wallpaper_tiles_exist(const char *dir, const char *prefix) {
-    if (!dir || !prefix) return false;
+typedef struct {
     char path[PATH_MAX];
-    for (int i = 1; i <= 14; i++) {
-        snprintf(path, sizeof(path), "%s/%s-%d.png", dir, prefix, i);
-        if (!file_exists(path)) return false;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    uint64_t hash;
+} WallpaperMemo;
+
+static struct {
+    pthread_mutex_t mu;
+    pthread_cond_t cond;
+    WallpaperMemo memo[WP_MEMO];      // content hash per file, round robin
+    size_t memo_next;
+    char inflight[WP_INFLIGHT][WP_KEY_LEN];   // keys being rendered (startup workers or a page render)
+    pthread_t prerender;
+    bool prerender_started;
+} g_wp = { .mu = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+static uint64_t fnv1a64_update(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
     }
-    return true;
+    return h;
 }
 
-static int ensure_wallpaper_rendered(const Options *opt, const WallpaperEff *wp, char *out_dir, size_t dir_cap,
-                                     char *out_prefix, size_t prefix_cap) {
-    if (!opt || !wp || !wp->enabled || !wp->path || !out_dir || !out_prefix) return -1;
+static int file_content_hash(const char *path, uint64_t *out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    uint64_t h = 14695981039346656037ull;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) h = fnv1a64_update(h, buf, n);
+    int rc = ferror(f) ? -1 : 0;
+    fclose(f);
+    *out = h;
+    return rc;
+}
 
-    char abs_png[PATH_MAX];
-    if (resolve_path_root(opt, wp->path, abs_png, sizeof(abs_png)) != 0) return -1;
-    if (!file_exists(abs_png)) return -1;
+// Resolved path and cache key of a wallpaper (no rendering). Returns 0, or -1 if the file is missing.
+static int wallpaper_key(const Options *opt, const WallpaperEff *wp, char *abs_out, size_t abs_cap, char *key, size_t key_cap) {
+    if (!opt || !wp || !wp->enabled || !wp->path || !wp->path[0]) return -1;
+    if (resolve_path_root(opt, wp->path, abs_out, abs_cap) != 0) return -1;
+    struct stat st;
+    if (stat(abs_out, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+
+    uint64_t h = 0;
+    bool found = false;
+    pthread_mutex_lock(&g_wp.mu);
+    for (size_t i = 0; i < WP_MEMO; i++) {
+        const WallpaperMemo *m = &g_wp.memo[i];
+        if (m->path[0] && strcmp(m->path, abs_out) == 0 && m->dev == st.st_dev && m->ino == st.st_ino &&
+            m->size == st.st_size && m->mtime.tv_sec == st.st_mtim.tv_sec && m->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            h = m->hash;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_wp.mu);
+    if (!found) {
+        if (file_content_hash(abs_out, &h) != 0) return -1;
+        pthread_mutex_lock(&g_wp.mu);
+        WallpaperMemo *m = &g_wp.memo[g_wp.memo_next++ % WP_MEMO];
+        snprintf(m->path, sizeof(m->path), "%s", abs_out);
+        m->dev = st.st_dev;
+        m->ino = st.st_ino;
+        m->size = st.st_size;
+        m->mtime = st.st_mtim;
+        m->hash = h;
+        pthread_mutex_unlock(&g_wp.mu);
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "q:%d\nm:%d\nd:%d\n", clamp_int(wp->quality, 10, 100), clamp_int(wp->magnify, 10, 100),
+             wp->dithering ? 1 : 0);
+    h = fnv1a64_update(h, params, strlen(params));
+    snprintf(key, key_cap, "%016" PRIx64, h);
+    return 0;
+}
 
-    if (wallpaper_render_dir_and_prefix(abs_png, out_dir, dir_cap, out_prefix, prefix_cap) != 0) return -1;
-    if (wallpaper_tiles_exist(out_dir, out_prefix)) return 0;
+static void wallpaper_object_path(const Options *opt, const char *key, char *out, size_t cap) {
+    snprintf(out, cap, "%s/wallpapers/%s.wpt", opt->cache_root, key);
+}
 
-    char script[PATH_MAX];
-    snprintf(script, sizeof(script), "%s/bin/render_image_page_wrapper.sh", opt->root_dir);
-    if (access(script, X_OK) != 0) return -1;
+// Write the object through a temporary file and rename (readers never see a partial object).
+static int wallpaper_object_write(const char *obj, uint8_t *const png[FD_TILES_COUNT], const size_t len[FD_TILES_COUNT]) {
+    char tmp[PATH_MAX];
+    if (path_snprintf(tmp, sizeof(tmp), "%s.tmp.%d.%lx", obj, (int)getpid(), (unsigned long)pthread_self()) != 0) return -1;
+    ensure_dir_parent(obj);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    uint8_t hdr[WP_OBJ_HEADER];
+    memcpy(hdr, WP_OBJ_MAGIC, 8);
+    uint32_t v = FD_TILES_COUNT;
+    memcpy(hdr + 8, &v, 4);
+    for (int i = 0; i < FD_TILES_COUNT; i++) {
+        v = (uint32_t)len[i];
+        memcpy(hdr + 12 + 4 * i, &v, 4);
+    }
+    bool ok = fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr);
+    for (int i = 0; ok && i < FD_TILES_COUNT; i++) ok = fwrite(png[i], 1, len[i], f) == len[i];
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp, obj) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
 
-    int q = clamp_int(wp->quality, 10, 100);
-    // magnify is a percentage (10..100)
-    int m = clamp_int(wp->magnify, 10, 100);
-    char qarg[32];
-    char marg[32];
+// Copy tile n (1..14) of an object into dst (temporary file + rename).
+static int wallpaper_object_extract(const char *obj, int n, const char *dst) {
+    FILE *f = fopen(obj, "rb");
+    if (!f) return -1;
+    uint8_t hdr[WP_OBJ_HEADER];
+    uint32_t count = 0;
+    int rc = -1;
+    if (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) && memcmp(hdr, WP_OBJ_MAGIC, 8) == 0 &&
+        (memcpy(&count, hdr + 8, 4), count == FD_TILES_COUNT)) {
+        long off = WP_OBJ_HEADER;
+        uint32_t len = 0;
+        for (int i = 0; i < n; i++) {
+            memcpy(&len, hdr + 12 + 4 * i, 4);
+            if (i + 1 < n) off += (long)len;
+        }
+        uint8_t *buf = len > 0 ? malloc(len) : NULL;
+        char tmp[PATH_MAX];
+        if (buf && fseek(f, off, SEEK_SET) == 0 && fread(buf, 1, len, f) == len &&
+            path_snprintf(tmp, sizeof(tmp), "%s.tmp.%lx", dst, (unsigned long)pthread_self()) == 0) {
+            FILE *o = fopen(tmp, "wb");
+            bool ok = o && fwrite(buf, 1, len, o) == len;
+            if (o && fclose(o) != 0) ok = false;
+            if (ok && rename(tmp, dst) == 0) rc = 0;
+            else unlink(tmp);
+        }
+        free(buf);
+    }
+    fclose(f);
+    return rc;
+}
+
+// In-process tiling (PNG): 16:9 crop, optional Floyd-Steinberg on the 6x6x6 grid, 14 resampled
+// tiles, fast PNG encode. Returns 0, 1 if the file is not a PNG fd_png.h decodes, -1 on error.
+static int wallpaper_tile_png(const char *abs_png, int q, int m, bool dither, int threads, const char *obj) {
+    fd_png_dec_t dec;
+    fd_png_dec_init(&dec);
+    if (fd_png_load(&dec, abs_png) != 0) {
+        fd_png_dec_free(&dec);
+        return 1;
+    }
+    int cx, cy, cw, ch;
+    fd_page_crop_16_9(dec.w, dec.h, &cx, &cy, &cw, &ch);
+    size_t stride = (size_t)dec.w * 4;
+    const uint8_t *base = dec.rgba + (size_t)cy * stride + (size_t)cx * 4;
+    uint8_t *prep = NULL;
+    int rc = -1;
+    if (dither) {
+        prep = malloc((size_t)cw * (size_t)ch * 4);
+        if (!prep) goto out;
+        for (int row = 0; row < ch; row++) memcpy(prep + (size_t)row * cw * 4, base + (size_t)row * stride, (size_t)cw * 4);
+        fd_dither_fs_rgba(prep, cw, ch, (size_t)cw * 4, 6);
+        base = prep;
+        stride = (size_t)cw * 4;
+    }
+
+    fd_tiles_t t;
+    if (fd_tiles_init(&t, threads) != 0) goto out;
+    fd_page_layout_t L;
+    fd_page_layout(cw, ch, m, q, &L);
+    if (fd_tiles_layout(&t, &L) == 0) {
+        fd_tiles_params_t params;
+        fd_tiles_params_default(&params);
+        params.quantize = 0;
+        fd_tiles_run(&t, base, cw, ch, stride, &params);
+        uint8_t *png[FD_TILES_COUNT];
+        size_t len[FD_TILES_COUNT];
+        rc = 0;
+        for (int i = 0; i < FD_TILES_COUNT; i++) {
+            if (t.tiles[i].png_status != 0) rc = -1;
+            png[i] = t.tiles[i].png;
+            len[i] = t.tiles[i].png_len;
+        }
+        if (rc == 0) rc = wallpaper_object_write(obj, png, len);
+    }
+    fd_tiles_destroy(&t);
+out:
+    free(prep);
+    fd_png_dec_free(&dec);
+    return rc;
+}
+
+// Other formats: send_image_page renders into a temporary folder, the tiles are packed into obj.
+static int wallpaper_tile_external(const Options *opt, const char *abs_img, int q, int m, bool dither, const char *key,
+                                   const char *obj) {
+    char bin[PATH_MAX];
+    snprintf(bin, sizeof(bin), "%s/bin/send_image_page", opt->root_dir);
+    if (access(bin, X_OK) != 0) return -1;
+    char sdir[PATH_MAX], tmpdir[PATH_MAX];
+    state_dir(opt, sdir, sizeof(sdir));
+    if (path_snprintf(tmpdir, sizeof(tmpdir), "%s/tmp/wp_%s", sdir, key) != 0) return -1;
+    ensure_dir_parent(tmpdir);
+    char qarg[32], marg[32], karg[PATH_MAX + 8];
     snprintf(qarg, sizeof(qarg), "-q=%d", q);
     snprintf(marg, sizeof(marg), "-m=%d", m);
+    snprintf(karg, sizeof(karg), "-k=%s=t", tmpdir);
+    char *argv[] = { bin, (char *)"--no-send", (char *)"--no-tile-optimize", qarg, marg, karg,
+                     dither ? (char *)"-d" : (char *)abs_img, dither ? (char *)abs_img : NULL, NULL };
+    int rc = run_exec(argv) == 0 ? 0 : -1;
+
+    uint8_t *png[FD_TILES_COUNT] = {0};
+    size_t len[FD_TILES_COUNT] = {0};
+    for (int i = 0; i < FD_TILES_COUNT; i++) {
+        char p[PATH_MAX];
+        if (path_snprintf(p, sizeof(p), "%s/t-%d.png", tmpdir, i + 1) != 0) {
+            rc = -1;
+            continue;
+        }
+        if (rc == 0) {
+            FILE *f = fopen(p, "rb");
+            long sz = -1;
+            if (f && fseek(f, 0, SEEK_END) == 0) sz = ftell(f);
+            png[i] = sz > 0 ? malloc((size_t)sz) : NULL;
+            if (!png[i] || fseek(f, 0, SEEK_SET) != 0 || fread(png[i], 1, (size_t)sz, f) != (size_t)sz) rc = -1;
+            else len[i] = (size_t)sz;
+            if (f) fclose(f);
+        }
+        unlink(p);
+    }
+    rmdir(tmpdir);
+    if (rc == 0) rc = wallpaper_object_write(obj, png, len);
+    for (int i = 0; i < FD_TILES_COUNT; i++) free(png[i]);
+    return rc;
+}
 
-    if (wp->dithering) {
-        char *argv[] = { script, qarg, marg, (char *)"-d", abs_png, NULL };
-        if (run_exec(argv) != 0) return -1;
-    } else {
-        char *argv[] = { script, qarg, marg, abs_png, NULL };
-        if (run_exec(argv) != 0) return -1;
+// Render the object for key unless it exists. Concurrent callers on the same key wait for the
+// first one instead of rendering twice.
+static int wallpaper_render_object(const Options *opt, const WallpaperEff *wp, const char *abs_img, const char *key,
+                                   const char *obj, int threads) {
+    pthread_mutex_lock(&g_wp.mu);
+    int slot = -1;
+    for (;;) {
+        bool busy = false;
+        slot = -1;
+        for (int i = 0; i < WP_INFLIGHT; i++) {
+            if (strcmp(g_wp.inflight[i], key) == 0) busy = true;
+            else if (slot < 0 && !g_wp.inflight[i][0]) slot = i;
+        }
+        if (!busy && (slot >= 0 || file_exists(obj))) break;
+        pthread_cond_wait(&g_wp.cond, &g_wp.mu);
+    }
+    if (file_exists(obj)) {
+        pthread_mutex_unlock(&g_wp.mu);
+        return 0;
+    }
+    snprintf(g_wp.inflight[slot], WP_KEY_LEN, "%s", key);
+    pthread_mutex_unlock(&g_wp.mu);
+
+    int q = clamp_int(wp->quality, 10, 100);
+    int m = clamp_int(wp->magnify, 10, 100);   // percentage
+    double t0 = now_sec_monotonic();
+    int rc = wallpaper_tile_png(abs_img, q, m, wp->dithering, threads, obj);
+    const char *how = "in-process";
+    if (rc == 1) {
+        rc = wallpaper_tile_external(opt, abs_img, q, m, wp->dithering, key, obj);
+        how = "send_image_page";
+    }
+    if (rc == 0) log_msg("wallpaper %s: tiles %s (%s, %.0f ms)", abs_img, key, how, (now_sec_monotonic() - t0) * 1000.0);
+    else log_msg("wallpaper %s: tiling failed (%s)", abs_img, how);
+
+    pthread_mutex_lock(&g_wp.mu);
+    g_wp.inflight[slot][0] = 0;
+    pthread_cond_broadcast(&g_wp.cond);
+    pthread_mutex_unlock(&g_wp.mu);
+    return rc;
+}
+
+// out_obj: tile object, out_key: its key (names the session tiles and signs compositions).
+static int ensure_wallpaper_rendered(const Options *opt, const WallpaperEff *wp, char *out_obj, size_t obj_cap,
+                                     char *out_key, size_t key_cap) {
+    if (!opt || !wp || !wp->enabled || !wp->path || !out_obj || !out_key || key_cap < WP_KEY_LEN) return -1;
+    char abs_img[PATH_MAX];
+    if (wallpaper_key(opt, wp, abs_img, sizeof(abs_img), out_key, key_cap) != 0) return -1;
+    wallpaper_object_path(opt, out_key, out_obj, obj_cap);
+    if (file_exists(out_obj)) return 0;
+    return wallpaper_render_object(opt, wp, abs_img, out_key, out_obj, fd_tiles_online_cpus());
+}
+
+// Composition signature of a wallpaper (0: none or unreadable).
+static uint32_t wallpaper_sig(const Options *opt, const WallpaperEff *wp) {
+    char abs_img[PATH_MAX], key[WP_KEY_LEN];
+    if (!wp || !wp->enabled || wallpaper_key(opt, wp, abs_img, sizeof(abs_img), key, sizeof(key)) != 0) return 0;
+    return fnv1a32(key, strlen(key));
+}
+
+// --- Startup: tile every configured wallpaper in parallel (background, one worker per CPU) ---
+typedef struct {
+    const Options *opt;
+    WallpaperEff wps[64];
+    char *paths[64];
+    size_t count, next;
+    bool truncated;                   // more wallpapers than wps[]: keep[] would be incomplete, no pruning
+    pthread_mutex_t mu;
+    int threads_per_job;
+} WallpaperPrerender;
+
+static void *wallpaper_prerender_worker(void *arg) {
+    WallpaperPrerender *pr = (WallpaperPrerender *)arg;
+    for (;;) {
+        pthread_mutex_lock(&pr->mu);
+        size_t i = pr->next++;
+        pthread_mutex_unlock(&pr->mu);
+        if (i >= pr->count) return NULL;
+        char obj[PATH_MAX], key[WP_KEY_LEN];
+        char abs_img[PATH_MAX];
+        if (wallpaper_key(pr->opt, &pr->wps[i], abs_img, sizeof(abs_img), key, sizeof(key)) != 0) continue;
+        wallpaper_object_path(pr->opt, key, obj, sizeof(obj));
+        if (!file_exists(obj)) (void)wallpaper_render_object(pr->opt, &pr->wps[i], abs_img, key, obj, pr->threads_per_job);
+    }
+}
+
+// Remove tile objects whose key is not in keep[] (wallpaper edited or replaced, parameters
+// changed) and temporary files left by another process. Objects are content-keyed, so without
+// this every edit would leave one behind in <cache_root>/wallpapers.
+static void wallpaper_prune(const Options *opt, char (*keep)[WP_KEY_LEN], size_t keep_n) {
+    char dir[PATH_MAX];
+    if (path_snprintf(dir, sizeof(dir), "%s/wallpapers", opt->cache_root) != 0) return;
+    DIR *d = opendir(dir);
+    if (!d) return;
+    char own_tmp[32];
+    snprintf(own_tmp, sizeof(own_tmp), ".tmp.%d.", (int)getpid());
+    size_t removed = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        if (name[0] == '.') continue;
+        const char *tmp = strstr(name, ".wpt.tmp.");
+        bool drop;
+        if (tmp) {
+            drop = strncmp(tmp + 4, own_tmp, strlen(own_tmp)) != 0;   // ours may still be being written
+        } else {
+            size_t len = strlen(name);
+            if (len != WP_KEY_LEN - 1 + 4 || strcmp(name + WP_KEY_LEN - 1, ".wpt") != 0) continue;
+            drop = true;
+            for (size_t i = 0; i < keep_n && drop; i++) drop = strncmp(name, keep[i], WP_KEY_LEN - 1) != 0;
+        }
+        if (!drop) continue;
+        char path[PATH_MAX];
+        if (path_snprintf(path, sizeof(path), "%s/%s", dir, name) == 0 && unlink(path) == 0) removed++;
+    }
+    closedir(d);
+    if (removed > 0) log_msg("wallpaper: removed %zu unused tile object(s) from %s", removed, dir);
+}
+
+static void *wallpaper_prerender_thread(void *arg) {
+    WallpaperPrerender *pr = (WallpaperPrerender *)arg;
+    int cpus = fd_tiles_online_cpus();
+    int workers = (int)pr->count < cpus ? (int)pr->count : cpus;
+    pr->threads_per_job = cpus / (workers > 0 ? workers : 1);
+    if (pr->threads_per_job < 1) pr->threads_per_job = 1;
+    pthread_t th[FD_TILES_MAX_THREADS];
+    if (workers > FD_TILES_MAX_THREADS) workers = FD_TILES_MAX_THREADS;
+    int started = 0;
+    for (int i = 1; i < workers; i++) {
+        if (pthread_create(&th[started], NULL, wallpaper_prerender_worker, pr) == 0) started++;
+    }
+    wallpaper_prerender_worker(pr);
+    for (int i = 0; i < started; i++) pthread_join(th[i], NULL);
+
+    // Every configured wallpaper has its object now: the others are garbage.
+    char (*keep)[WP_KEY_LEN] = calloc(pr->count, sizeof(*keep));
+    size_t keep_n = 0;
+    for (size_t i = 0; keep && i < pr->count; i++) {
+        char abs_img[PATH_MAX];
+        if (wallpaper_key(pr->opt, &pr->wps[i], abs_img, sizeof(abs_img), keep[keep_n], WP_KEY_LEN) == 0) keep_n++;
+    }
+    if (keep && !pr->truncated) wallpaper_prune(pr->opt, keep, keep_n);
+    free(keep);
+
+    for (size_t i = 0; i < pr->count; i++) free(pr->paths[i]);
+    pthread_mutex_destroy(&pr->mu);
+    free(pr);
+    return NULL;
+}
+
+static void wallpaper_prerender_start(const Options *opt, const Config *cfg) {
+    if (!opt || !cfg) return;
+    if (cfg->disable_wallpapers) {
+        wallpaper_prune(opt, NULL, 0);
+        return;
+    }
+    WallpaperPrerender *pr = calloc(1, sizeof(*pr));
+    if (!pr) return;
+    pr->opt = opt;
+    pthread_mutex_init(&pr->mu, NULL);
+    for (size_t i = 0; i <= cfg->page_count; i++) {
+        WallpaperEff wp = effective_wallpaper(cfg, i < cfg->page_count ? &cfg->pages[i] : NULL);
+        if (!wp.enabled || !wp.path || !wp.path[0]) continue;
+        bool dup = false;
+        for (size_t k = 0; k < pr->count && !dup; k++) {
+            const WallpaperEff *o = &pr->wps[k];
+            dup = strcmp(o->path, wp.path) == 0 && o->quality == wp.quality && o->magnify == wp.magnify &&
+                  o->dithering == wp.dithering;
+        }
+        if (dup) continue;
+        if (pr->count == sizeof(pr->wps) / sizeof(pr->wps[0])) {
+            pr->truncated = true;
+            break;
+        }
+        pr->paths[pr->count] = xstrdup(wp.path);
+        wp.path = pr->paths[pr->count];
+        pr->wps[pr->count++] = wp;
+    }
+    if (pr->count == 0) {
+        wallpaper_prune(opt, NULL, 0);
+        pthread_mutex_destroy(&pr->mu);
+        free(pr);
+        return;
+    }
+    log_msg("wallpaper: tiling %zu wallpaper(s) in background", pr->count);
+    if (pthread_create(&g_wp.prerender, NULL, wallpaper_prerender_thread, pr) != 0) {
+        for (size_t i = 0; i < pr->count; i++) free(pr->paths[i]);
+        pthread_mutex_destroy(&pr->mu);
+        free(pr);
+        return;
     }
+    g_wp.prerender_started = true;
+}
 
-    return wallpaper_tiles_exist(out_dir, out_prefix) ? 0 : -1;
+static void wallpaper_prerender_join(void) {
+    if (g_wp.prerender_started) pthread_join(g_wp.prerender, NULL);
+    g_wp.prerender_started = false;
 }
 
-static int wallpaper_session_tile(const Options *opt, const char *render_dir, const char *prefix,
-                                  const WallpaperEff *wp, int tile_num, char *out_path, size_t out_cap);
+static int wallpaper_session_tile(const Options *opt, const char *wp_obj, const char *wp_key,
+                                  int tile_num, char *out_path, size_t out_cap);
 
-static int wp_compose_cached(const Options *opt, uint32_t wp_sig, const char *render_dir, const char *prefix,
+static int wp_compose_cached(const Options *opt, uint32_t wp_sig, const char *wp_obj, const char *wp_key,
                              const WallpaperEff *wp, int pos, const char *icon_path,
                              char *out_png, size_t out_cap, bool *out_is_tmp) {
     if (out_is_tmp) *out_is_tmp = false;
-    if (!opt || !wp || !wp->enabled || !render_dir || !prefix || !icon_path || !out_png || out_cap == 0) return -1;
+    if (!opt || !wp || !wp->enabled || !wp_obj || !wp_key || !icon_path || !out_png || out_cap == 0) return -1;
     out_png[0] = 0;
     if (pos < 1 || pos > 13) return -1;
 
     char tile[PATH_MAX];
-    if (wallpaper_session_tile(opt, render_dir, prefix, wp, pos, tile, sizeof(tile)) != 0 || tile[0] == 0) return -1;
+    if (wallpaper_session_tile(opt, wp_obj, wp_key, pos, tile, sizeof(tile)) != 0 || tile[0] == 0) return -1;
 
     // Only cache for non-temp, stable icons (already in cache/pregen).
     bool can_cache = true;
@@ -2162,9 +3015,12 @@ static int wp_compose_cached(const Options *opt, uint32_t wp_sig, const char *re
     // different images collapsing into the same entry if the same icon is reused across positions.
     if (path_snprintf(cached, sizeof(cached), "%s/%02d_%s", cache_dir, pos, base) != 0) return -1;
     if (can_cache && file_exists(cached)) {
+        cache_stats_hit(CST_WP_COMP);
+        shm_cache_touch(cached, SHM_NS_WP_COMP);
         snprintf(out_png, out_cap, "%s", cached);
         return 0;
     }
+    int64_t t0 = now_ns_monotonic();
 
     char draw_over_bin[PATH_MAX];
     snprintf(draw_over_bin, sizeof(draw_over_bin), "%s/icons/draw_over", opt->root_dir);
@@ -2182,16 +3038,19 @@ static int wp_compose_cached(const Options *opt, uint32_t wp_sig, const char *re
         unlink(tmp_out);
         return -1;
     }
+    cache_stats_miss(CST_WP_COMP, t0);
 
     if (can_cache) {
         // Best-effort atomic move into cache.
         if (rename(tmp_out, cached) == 0) {
+            shm_cache_touch(cached, SHM_NS_WP_COMP);
             snprintf(out_png, out_cap, "%s", cached);
             return 0;
         }
         // Cross-filesystem fallback.
         if (copy_file(tmp_out, cached) == 0) {
             unlink(tmp_out);
+            shm_cache_touch(cached, SHM_NS_WP_COMP);
             snprintf(out_png, out_cap, "%s", cached);
             return 0;
         }
@@ -2203,42 +3062,31 @@ static int wp_compose_cached(const Options *opt, uint32_t wp_sig, const char *re
     return 0;
 }
 
-static int wallpaper_session_tile(const Options *opt, const char *render_dir, const char *prefix,
-                                  const WallpaperEff *wp, int tile_num, char *out_path, size_t out_cap) {
-    if (!opt || !render_dir || !prefix || !wp || !out_path || out_cap == 0) return -1;
+static int wallpaper_session_tile(const Options *opt, const char *wp_obj, const char *wp_key,
+                                  int tile_num, char *out_path, size_t out_cap) {
+    if (!opt || !wp_obj || !wp_key || !out_path || out_cap == 0) return -1;
     out_path[0] = 0;
     if (tile_num < 1 || tile_num > 14) return -1;
 
-    char src[PATH_MAX];
-    snprintf(src, sizeof(src), "%s/%s-%d.png", render_dir, prefix, tile_num);
-    if (!file_exists(src)) return -1;
-
-    // Session copy dir under state_dir (prefers /dev/shm via state_dir()).
+    // Session copy dir under state_dir (prefers /dev/shm via state_dir()), one folder per key.
     char dir[PATH_MAX];
     state_dir(opt, dir, sizeof(dir));
-    char wdir[PATH_MAX];
-    if (path_snprintf(wdir, sizeof(wdir), "%s/wallpaper", dir) != 0) return -1;
-    ensure_dir(wdir);
-
-    char key[PATH_MAX + 128];
-    snprintf(key, sizeof(key), "dir:%s\nprefix:%s\nq:%d\nm:%d\nd:%d\n",
-             render_dir, prefix, wp->quality, wp->magnify, wp->dithering ? 1 : 0);
-    uint32_t h = fnv1a32(key, strlen(key));
     char sub[PATH_MAX];
-    if (path_snprintf(sub, sizeof(sub), "%s/%08x", wdir, h) != 0) return -1;
+    if (path_snprintf(sub, sizeof(sub), "%s/wallpaper/%s", dir, wp_key) != 0) return -1;
+    ensure_dir_parent(sub);
     ensure_dir(sub);
 
     char dst[PATH_MAX];
-    if (path_snprintf(dst, sizeof(dst), "%s/%s-%d.png", sub, prefix, tile_num) != 0) return -1;
+    if (path_snprintf(dst, sizeof(dst), "%s/%s-%d.png", sub, wp_key, tile_num) != 0) return -1;
     if (!file_exists(dst)) {
-        (void)copy_file(src, dst);
-    }
-    if (file_exists(dst)) {
-        snprintf(out_path, out_cap, "%s", dst);
-        return 0;
+        int64_t t0 = now_ns_monotonic();
+        if (wallpaper_object_extract(wp_obj, tile_num, dst) != 0) return -1;
+        cache_stats_miss(CST_WALLPAPER, t0);
+    } else {
+        cache_stats_hit(CST_WALLPAPER);
     }
-    // Fallback to on-disk render tile
-    snprintf(out_path, out_cap, "%s", src);
+    shm_cache_touch(dst, SHM_NS_WALLPAPER);
+    snprintf(out_path, out_cap, "%s", dst);
     return 0;
 }
 
@@ -3024,147 +3872,298 @@ static int read_line_from_fd(int fd, char *out, size_t out_cap, char *buf, size_
     }
 }
 
-static int generate_icon_pipeline(const Options *opt, const Preset *preset, const Item *it, const char *out_png) {
-    // Base: draw_square, optional borders, optional mdi, optimize, optional text, optimize
+// --- Render plans ---
+// Each preset is compiled once into a plan: clamped geometry, the tool arguments that only depend on the
+// preset, and the base tile (background + border). The base is painted in-process through the
+// anti-aliased border masks (fd_raster.h, same coverage as draw_border), encoded once, and optimized
+// once for icons without an MDI glyph. Rendering an item then only applies its glyph and text to a copy
+// of the base. Plans are dropped, with their files, whenever the configuration is freed (reload); the
+// files live in the state dir (wiped at startup).
+
+#define PLAN_TILE 196
+
+typedef struct {
+    const Preset *preset;            // key: preset owned by the Config (NULL: built-in defaults)
+    bool ok;                         // base painted (colors valid)
+    const char *bg;
+    const char *border_c;
+    const char *ic_color;
+    bool icon_color_transparent;
+    int rad, border_size, bw, pad, inner, bright;
+    int icon_x, icon_y, icon_size;   // MDI placement rectangle (draw_mdi: centered + offset)
+    char mdi_size_arg[32];
+    char mdi_off_arg[64];
+    char mdi_bri_arg[32];
+    const char *tc;
+    bool used_default_font;
+    char tc_arg[64];
+    char ta_arg[64];
+    char tf_arg[PATH_MAX];
+    char ts_arg[64];
+    char to_arg[64];
+    char base_png[PATH_MAX];         // background + border, 8-bit RGBA
+    char base_opt_png[PATH_MAX];     // base after the first draw_optimize pass ("" if it failed)
+} RenderPlan;
+
+static struct {
+    RenderPlan *items;
+    size_t count;
+    size_t cap;
+    unsigned gen;
+} g_plans;
+
+// Also removes the plans' base files: the next generation writes new names, and the RAM cache
+// manager does not account for plans/, so old ones would pile up in the state dir.
+static void render_plans_invalidate(void) {
+    for (size_t i = 0; i < g_plans.count; i++) {
+        const RenderPlan *pl = &g_plans.items[i];
+        if (pl->base_png[0]) unlink(pl->base_png);
+        if (pl->base_opt_png[0]) unlink(pl->base_opt_png);
+    }
+    free(g_plans.items);
+    g_plans.items = NULL;
+    g_plans.count = g_plans.cap = 0;
+    g_plans.gen++;
+}
+
+// 6-digit hex or "transparent" (1); -1 if invalid.
+static int plan_parse_color(const char *s, uint8_t rgb[3]) {
+    if (strcasecmp(s, "transparent") == 0) return 1;
+    if (strlen(s) != 6) return -1;
+    for (int i = 0; i < 3; i++) {
+        int v = 0;
+        for (int k = 0; k < 2; k++) {
+            char c = s[i * 2 + k];
+            int d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (d < 0) return -1;
+            v = v * 16 + d;
+        }
+        rgb[i] = (uint8_t)v;
+    }
+    return 0;
+}
+
+// Paint (or erase, when transparent) a color through a coverage mask: same result as draw_border.
+static void plan_apply_mask(uint8_t *rgba, const uint8_t *mask, const uint8_t rgb[3], bool transparent) {
+    for (size_t i = 0; i < (size_t)PLAN_TILE * PLAN_TILE; i++) {
+        unsigned cov = mask[i];
+        if (cov == 0) continue;
+        uint8_t *px = rgba + i * 4;
+        if (!transparent) {
+            fd_raster_over(px, rgb[0], rgb[1], rgb[2], cov);
+            continue;
+        }
+        px[3] = (uint8_t)((px[3] * (255u - cov) + 127u) / 255u);
+        if (px[3] == 0) px[0] = px[1] = px[2] = 0;
+    }
+}
+
+static int plan_paint_base(const RenderPlan *pl) {
+    uint8_t bg[3] = {0}, border[3] = {0};
+    int bg_t = plan_parse_color(pl->bg, bg);
+    int border_t = plan_parse_color(pl->border_c, border);
+    if (bg_t < 0 || (pl->bw > 0 && border_t < 0)) return -1;
+
+    uint8_t *rgba = calloc((size_t)PLAN_TILE * PLAN_TILE, 4);
+    uint8_t *mask = malloc((size_t)PLAN_TILE * PLAN_TILE);
+    if (!rgba || !mask) {
+        free(rgba);
+        free(mask);
+        return -1;
+    }
+    if (pl->bw > 0) {
+        // Transparent tile, outer rounded square in the border color, inner one in the background color.
+        fd_rrect_t outer = fd_rrect_centered(PLAN_TILE, PLAN_TILE, pl->border_size, pl->border_size, (pl->border_size * pl->rad) / 100);
+        fd_raster_mask_rrect(mask, PLAN_TILE, PLAN_TILE, &outer);
+        plan_apply_mask(rgba, mask, border, border_t == 1);
+        fd_rrect_t inner = fd_rrect_centered(PLAN_TILE, PLAN_TILE, pl->inner, pl->inner, (pl->inner * pl->rad) / 100);
+        fd_raster_mask_rrect(mask, PLAN_TILE, PLAN_TILE, &inner);
+        plan_apply_mask(rgba, mask, bg, bg_t == 1);
+    } else if (bg_t == 0) {
+        const uint8_t c[4] = { bg[0], bg[1], bg[2], 255 };
+        uint32_t px;
+        memcpy(&px, c, 4);
+        fd_raster_fill_u32(rgba, PLAN_TILE * PLAN_TILE, px);
+    }
+    free(mask);
+
+    fd_png_enc_t enc;
+    fd_png_enc_init(&enc);
+    ensure_dir_parent(pl->base_png);
+    int rc = fd_png_save_rgba(&enc, pl->base_png, rgba, PLAN_TILE, PLAN_TILE, (size_t)PLAN_TILE * 4, FD_PNG_FAST);
+    fd_png_enc_free(&enc);
+    free(rgba);
+    return rc;
+}
+
+static void plan_palette_key(const RenderPlan *pl, bool mdi, char *out, size_t cap) {
+    // Icons of one preset share their 4-color palette (draw_optimize palette cache): the key holds
+    // every color the pipeline paints with.
+    snprintf(out, cap, "--palette-key=icon:%s:%s:%d:%s:%d:%s", pl->bg, pl->border_c, pl->bw, mdi ? pl->ic_color : "-",
+             pl->bright, (mdi && pl->icon_color_transparent) ? "t" : "o");
+}
+
+static void plan_compile(const Options *opt, const Preset *preset, RenderPlan *pl, size_t slot) {
+    memset(pl, 0, sizeof(*pl));
+    pl->preset = preset;
+    pl->bg = (preset && preset->icon_background_color && preset->icon_background_color[0]) ? preset->icon_background_color : "transparent";
+    pl->border_c = (preset && preset->icon_border_color && preset->icon_border_color[0]) ? preset->icon_border_color : "FFFFFF";
+    pl->ic_color = (preset && preset->icon_color && preset->icon_color[0]) ? preset->icon_color : "FFFFFF";
+    pl->icon_color_transparent = strcasecmp(pl->ic_color, "transparent") == 0;
+    pl->rad = preset ? clamp_int(preset->icon_border_radius, 0, 50) : 0;
+    pl->border_size = preset ? clamp_int(preset->icon_border_size, 98, 196) : 196;
+    pl->bw = preset ? clamp_int(preset->icon_border_width, 0, 98) : 0;
+    pl->pad = preset ? clamp_int(preset->icon_padding, 0, 98) : 0;
+    pl->inner = clamp_int(pl->border_size - 2 * pl->bw, 1, 196);
+    pl->bright = preset ? clamp_int(preset->icon_brightness, 1, 99) : 99;
+
+    int off_x = preset ? preset->icon_offset_x : 0;
+    int off_y = preset ? preset->icon_offset_y : 0;
+    int max_allowed = clamp_int(196 - 2 * (pl->bw + pl->pad), 1, 196);
+    int icon_size = preset ? preset->icon_size : 128;
+    if (icon_size <= 0) icon_size = max_allowed;
+    icon_size = clamp_int(icon_size, 1, 196);
+    if (icon_size > max_allowed) icon_size = max_allowed;
+    pl->icon_size = icon_size;
+    pl->icon_x = (PLAN_TILE - icon_size) / 2 + off_x;
+    pl->icon_y = (PLAN_TILE - icon_size) / 2 + off_y;
+    snprintf(pl->mdi_size_arg, sizeof(pl->mdi_size_arg), "--size=%d", icon_size);
+    snprintf(pl->mdi_off_arg, sizeof(pl->mdi_off_arg), "--offset=%d,%d", off_x, off_y);
+    snprintf(pl->mdi_bri_arg, sizeof(pl->mdi_bri_arg), "--brightness=%d", pl->bright);
+
+    pl->tc = (preset && preset->text_color && preset->text_color[0]) ? preset->text_color : "FFFFFF";
+    const char *ta = (preset && preset->text_align && preset->text_align[0]) ? preset->text_align : "center";
+    const char *tf = (preset && preset->text_font && preset->text_font[0]) ? preset->text_font : "Roboto";
+    pl->used_default_font = !(preset && preset->text_font && preset->text_font[0]);
+    int ts = preset ? clamp_int(preset->text_size, 1, 64) : 40;
+    snprintf(pl->tc_arg, sizeof(pl->tc_arg), "--text_color=%s", pl->tc);
+    snprintf(pl->ta_arg, sizeof(pl->ta_arg), "--text_align=%s", ta);
+    snprintf(pl->tf_arg, sizeof(pl->tf_arg), "--text_font=%s", tf);
+    snprintf(pl->ts_arg, sizeof(pl->ts_arg), "--text_size=%d", ts);
+    snprintf(pl->to_arg, sizeof(pl->to_arg), "--text_offset=%d,%d", preset ? preset->text_offset_x : 0,
+             preset ? preset->text_offset_y : 0);
+
+    char dir[PATH_MAX];
+    state_dir(opt, dir, sizeof(dir));
+    if (path_snprintf(pl->base_png, sizeof(pl->base_png), "%s/plans/%u-%zu.png", dir, g_plans.gen, slot) != 0) return;
+    if (plan_paint_base(pl) != 0) {
+        log_render("plan %s: invalid background/border color", preset && preset->name ? preset->name : "(default)");
+        return;
+    }
+    pl->ok = true;
+
+    // First optimize pass of icons without an MDI glyph: item independent, done once here.
+    char draw_opt_bin[PATH_MAX];
+    char pal_key[256];
+    snprintf(draw_opt_bin, sizeof(draw_opt_bin), "%s/icons/draw_optimize", opt->root_dir);
+    plan_palette_key(pl, false, pal_key, sizeof(pal_key));
+    if (path_snprintf(pl->base_opt_png, sizeof(pl->base_opt_png), "%s/plans/%u-%zu-opt.png", dir, g_plans.gen, slot) != 0 ||
+        copy_file(pl->base_png, pl->base_opt_png) != 0) {
+        pl->base_opt_png[0] = 0;
+        return;
+    }
+    char *argv[] = { draw_opt_bin, (char *)"-c", (char *)"4", pal_key, pl->base_opt_png, NULL };
+    if (run_exec(argv) != 0) {
+        unlink(pl->base_opt_png);
+        pl->base_opt_png[0] = 0;
+    }
+    log_render("plan %s: border %d/%d r%d, icon %dx%d at %d,%d", preset && preset->name ? preset->name : "(default)",
+               pl->bw, pl->border_size, pl->rad, icon_size, icon_size, pl->icon_x, pl->icon_y);
+}
+
+// Plan of a preset, compiled on first use.
+static const RenderPlan *render_plan_get(const Options *opt, const Preset *preset) {
+    for (size_t i = 0; i < g_plans.count; i++) {
+        if (g_plans.items[i].preset == preset) return &g_plans.items[i];
+    }
+    if (g_plans.count == g_plans.cap) {
+        g_plans.cap = g_plans.cap ? g_plans.cap * 2 : 8;
+        g_plans.items = xrealloc(g_plans.items, g_plans.cap * sizeof(RenderPlan));
+    }
+    RenderPlan *pl = &g_plans.items[g_plans.count];
+    plan_compile(opt, preset, pl, g_plans.count);
+    g_plans.count++;
+    return pl;
+}
+
+static int generate_icon_pipeline_run(const Options *opt, const Preset *preset, const Item *it, const char *out_png) {
+    // Base from the preset plan (background + borders), optional mdi, optimize, optional text, optimize
     if (!it) return -1;
     ensure_dir_parent(out_png);
-    char draw_square_bin[PATH_MAX];
-    char draw_border_bin[PATH_MAX];
     char draw_mdi_bin[PATH_MAX];
     char draw_text_bin[PATH_MAX];
     char draw_opt_bin[PATH_MAX];
-    snprintf(draw_square_bin, sizeof(draw_square_bin), "%s/icons/draw_square", opt->root_dir);
-    snprintf(draw_border_bin, sizeof(draw_border_bin), "%s/icons/draw_border", opt->root_dir);
     snprintf(draw_mdi_bin, sizeof(draw_mdi_bin), "%s/icons/draw_mdi", opt->root_dir);
     snprintf(draw_text_bin, sizeof(draw_text_bin), "%s/icons/draw_text", opt->root_dir);
     snprintf(draw_opt_bin, sizeof(draw_opt_bin), "%s/icons/draw_optimize", opt->root_dir);
-    if (access(draw_square_bin, X_OK) != 0) return -1;
     if (access(draw_text_bin, X_OK) != 0) return -1;
     if (access(draw_opt_bin, X_OK) != 0) return -1;
 
-    const char *bg = (preset && preset->icon_background_color && preset->icon_background_color[0]) ? preset->icon_background_color : "transparent";
-    const char *border_c = (preset && preset->icon_border_color && preset->icon_border_color[0]) ? preset->icon_border_color : "FFFFFF";
-    const char *ic_color = (preset && preset->icon_color && preset->icon_color[0]) ? preset->icon_color : "FFFFFF";
-    bool icon_color_transparent = (ic_color && strcasecmp(ic_color, "transparent") == 0);
-    int rad = preset ? clamp_int(preset->icon_border_radius, 0, 50) : 0;
-    int border_size = preset ? clamp_int(preset->icon_border_size, 98, 196) : 196;
-    int bw = preset ? clamp_int(preset->icon_border_width, 0, 98) : 0;
-    int pad = preset ? clamp_int(preset->icon_padding, 0, 98) : 0;
-    int off_x = preset ? preset->icon_offset_x : 0;
-    int off_y = preset ? preset->icon_offset_y : 0;
-    int bright = preset ? clamp_int(preset->icon_brightness, 1, 99) : 99;
+    const RenderPlan *pl = render_plan_get(opt, preset);
+    if (!pl->ok) return -1;
+    bool mdi = it->icon && strncmp(it->icon, "mdi:", 4) == 0;
 
     // Pipeline:
-    //   draw_square
-    //   draw_border (outer + inner) if border_width > 0
+    //   plan base (background + border), already optimized when there is no MDI glyph
     //   draw_mdi (optional)
     //   draw_optimize (mandatory)
     //   draw_text (optional)
     //   draw_optimize (optional)
-
-    char sq_size[32];
-    snprintf(sq_size, sizeof(sq_size), "--size=196");
-
-    // If border is enabled, start from transparent square; borders will define outer + inner fill.
-    const char *sq_color = (bw > 0) ? "transparent" : bg;
-    {
-        char *argv[] = { draw_square_bin, (char *)sq_color, sq_size, (char *)out_png, NULL };
-        if (run_exec(argv) != 0) return -1;
-    }
-
-    if (bw > 0) {
-        if (access(draw_border_bin, X_OK) != 0) return -1;
-        char size_outer[32];
-        char rad_arg[32];
-        snprintf(size_outer, sizeof(size_outer), "--size=%d", border_size);
-        snprintf(rad_arg, sizeof(rad_arg), "--radius=%d", rad);
-        char *argv_outer[] = { draw_border_bin, (char *)border_c, size_outer, rad_arg, (char *)out_png, NULL };
-        if (run_exec(argv_outer) != 0) return -1;
-
-        int inner = border_size - 2 * bw;
-        inner = clamp_int(inner, 1, 196);
-        char size_inner[32];
-        snprintf(size_inner, sizeof(size_inner), "--size=%d", inner);
-        char *argv_inner[] = { draw_border_bin, (char *)bg, size_inner, rad_arg, (char *)out_png, NULL };
-        if (run_exec(argv_inner) != 0) return -1;
-    }
+    bool optimized = !mdi && pl->base_opt_png[0];
+    if (copy_file(optimized ? pl->base_opt_png : pl->base_png, out_png) != 0) return -1;
 
     // draw_mdi (optional)
-    bool mdi_transparent = false;
-    if (it->icon && strncmp(it->icon, "mdi:", 4) == 0) {
+    if (mdi) {
         if (access(draw_mdi_bin, X_OK) != 0) return -1;
         if (ensure_mdi_svg(opt, it->icon) != 0) return -1;
-        mdi_transparent = icon_color_transparent;
-        int max_allowed = 196 - 2 * (bw + pad);
-        max_allowed = clamp_int(max_allowed, 1, 196);
-        int icon_size = preset ? preset->icon_size : 128;
-        if (icon_size <= 0) icon_size = max_allowed;
-        icon_size = clamp_int(icon_size, 1, 196);
-        if (icon_size > max_allowed) icon_size = max_allowed;
-        char size_arg[32];
-        snprintf(size_arg, sizeof(size_arg), "--size=%d", icon_size);
-        char off_arg[64];
-        snprintf(off_arg, sizeof(off_arg), "--offset=%d,%d", off_x, off_y);
-        char bri_arg[32];
-        snprintf(bri_arg, sizeof(bri_arg), "--brightness=%d", bright);
-        char *argv[] = { draw_mdi_bin, (char *)it->icon, (char *)ic_color, size_arg, off_arg, bri_arg, (char *)out_png, NULL };
+        char *argv[] = { draw_mdi_bin, (char *)it->icon, (char *)pl->ic_color, (char *)pl->mdi_size_arg,
+                         (char *)pl->mdi_off_arg, (char *)pl->mdi_bri_arg, (char *)out_png, NULL };
         if (run_exec(argv) != 0) return -1;
     }
 
     // draw_optimize (mandatory)
     // For transparent MDI mode, skip this first optimize pass for now.
     // (We still optimize after draw_text if text is present.)
-    if (!mdi_transparent) {
-        char *argv[] = { draw_opt_bin, (char *)"-c", (char *)"4", (char *)out_png, NULL };
+    char pal_key[256];
+    plan_palette_key(pl, mdi, pal_key, sizeof(pal_key));
+    if (!optimized && !(mdi && pl->icon_color_transparent)) {
+        char *argv[] = { draw_opt_bin, (char *)"-c", (char *)"4", pal_key, (char *)out_png, NULL };
         if (run_exec(argv) != 0) return -1;
     }
 
     // draw_text (optional)
     if (it->text && it->text[0]) {
-        const char *tc = (preset && preset->text_color && preset->text_color[0]) ? preset->text_color : "FFFFFF";
-        const char *ta = (preset && preset->text_align && preset->text_align[0]) ? preset->text_align : "center";
-        const char *tf = (preset && preset->text_font && preset->text_font[0]) ? preset->text_font : "Roboto";
-        bool used_default_font = !(preset && preset->text_font && preset->text_font[0]);
-        int ts = preset ? clamp_int(preset->text_size, 1, 64) : 40;
-        int tox = preset ? preset->text_offset_x : 0;
-        int toy = preset ? preset->text_offset_y : 0;
-
         char text_arg[768];
         snprintf(text_arg, sizeof(text_arg), "--text=%s", it->text);
-        char tc_arg[64];
-        snprintf(tc_arg, sizeof(tc_arg), "--text_color=%s", tc);
-        char ta_arg[64];
-        snprintf(ta_arg, sizeof(ta_arg), "--text_align=%s", ta);
-        char ts_arg[64];
-        snprintf(ts_arg, sizeof(ts_arg), "--text_size=%d", ts);
-        char to_arg[64];
-        snprintf(to_arg, sizeof(to_arg), "--text_offset=%d,%d", tox, toy);
-
-        int rc = 0;
-        if (tf && tf[0]) {
-            char tf_arg[PATH_MAX];
-            snprintf(tf_arg, sizeof(tf_arg), "--text_font=%s", tf);
-            char *argv[] = { draw_text_bin, text_arg, tc_arg, ta_arg, tf_arg, ts_arg, to_arg, (char *)out_png, NULL };
-            rc = run_exec(argv);
-            if (rc != 0 && used_default_font) {
-                // If "Roboto" isn't available, fall back to the draw_text default font behavior.
-                char *argv2[] = { draw_text_bin, text_arg, tc_arg, ta_arg, ts_arg, to_arg, (char *)out_png, NULL };
-                rc = run_exec(argv2);
-            }
-        } else {
-            char *argv[] = { draw_text_bin, text_arg, tc_arg, ta_arg, ts_arg, to_arg, (char *)out_png, NULL };
-            rc = run_exec(argv);
+        char *argv[] = { draw_text_bin, text_arg, (char *)pl->tc_arg, (char *)pl->ta_arg, (char *)pl->tf_arg,
+                         (char *)pl->ts_arg, (char *)pl->to_arg, (char *)out_png, NULL };
+        int rc = run_exec(argv);
+        if (rc != 0 && pl->used_default_font) {
+            // If "Roboto" isn't available, fall back to the draw_text default font behavior.
+            char *argv2[] = { draw_text_bin, text_arg, (char *)pl->tc_arg, (char *)pl->ta_arg, (char *)pl->ts_arg,
+                              (char *)pl->to_arg, (char *)out_png, NULL };
+            rc = run_exec(argv2);
         }
         if (rc != 0) return -1;
 
         // Second optimize pass (after draw_text).
-        char *argv2[] = { draw_opt_bin, (char *)"-c", (char *)"4", (char *)out_png, NULL };
+        size_t kl = strlen(pal_key);
+        snprintf(pal_key + kl, sizeof(pal_key) - kl, ":text:%s", pl->tc);
+        char *argv2[] = { draw_opt_bin, (char *)"-c", (char *)"4", pal_key, (char *)out_png, NULL };
         if (run_exec(argv2) != 0) return -1;
     }
 
     return 0;
 }
 
+// Timed for cache-stats (pipeline totals and slowest runs).
+static int generate_icon_pipeline(const Options *opt, const Preset *preset, const Item *it, const char *out_png) {
+    int64_t t0 = now_ns_monotonic();
+    int rc = generate_icon_pipeline_run(opt, preset, it, out_png);
+    cache_stats_pipeline(it ? it->preset : NULL, out_png, rc, t0);
+    return rc;
+}
+
 static int render_value_text_on_base_tmp(const Options *opt, const Preset *preset, const char *page_name, int pos,
                                       const char *base_png, const char *text, char *out_tmp_png, size_t out_cap) {
     if (!opt || !page_name || !base_png || !text || !out_tmp_png || out_cap == 0) return -1;
@@ -3193,41 +4192,9 @@ static int render_value_text_on_base_tmp(const Options *opt, const Preset *prese
     if (!base_is_1x1) {
         if (copy_file(base_png, outpng) != 0) return -1;
     } else {
-        char draw_square_bin[PATH_MAX];
-        char draw_border_bin[PATH_MAX];
-        snprintf(draw_square_bin, sizeof(draw_square_bin), "%s/icons/draw_square", opt->root_dir);
-        snprintf(draw_border_bin, sizeof(draw_border_bin), "%s/icons/draw_border", opt->root_dir);
-        if (access(draw_square_bin, X_OK) != 0) return -1;
-
-        const char *bg = (preset && preset->icon_background_color && preset->icon_background_color[0]) ? preset->icon_background_color : "transparent";
-        int bwid = preset ? clamp_int(preset->icon_border_width, 0, 98) : 0;
-        int rad = preset ? clamp_int(preset->icon_border_radius, 0, 50) : 0;
-        int border_size = preset ? clamp_int(preset->icon_border_size, 98, 196) : 196;
-        const char *border_c = (preset && preset->icon_border_color && preset->icon_border_color[0]) ? preset->icon_border_color : "FFFFFF";
-
-        // Same rule as icon pipeline: if border is enabled, start from transparent square; borders define the fill.
-        const char *sq_color = (bwid > 0) ? "transparent" : bg;
-        char size_arg[32];
-        snprintf(size_arg, sizeof(size_arg), "--size=196");
-        char *argv_sq[] = { draw_square_bin, (char *)sq_color, size_arg, outpng, NULL };
-        if (run_exec(argv_sq) != 0) { unlink(outpng); return -1; }
-
-        if (bwid > 0) {
-            if (access(draw_border_bin, X_OK) != 0) { unlink(outpng); return -1; }
-            char size_outer[32];
-            char rad_arg[32];
-            snprintf(size_outer, sizeof(size_outer), "--size=%d", border_size);
-            snprintf(rad_arg, sizeof(rad_arg), "--radius=%d", rad);
-            char *argv_outer[] = { draw_border_bin, (char *)border_c, size_outer, rad_arg, outpng, NULL };
-            if (run_exec(argv_outer) != 0) { unlink(outpng); return -1; }
-
-            int inner = border_size - 2 * bwid;
-            inner = clamp_int(inner, 1, 196);
-            char size_inner[32];
-            snprintf(size_inner, sizeof(size_inner), "--size=%d", inner);
-            char *argv_inner[] = { draw_border_bin, (char *)bg, size_inner, rad_arg, outpng, NULL };
-            if (run_exec(argv_inner) != 0) { unlink(outpng); return -1; }
-        }
+        // Same base as the icon pipeline (preset plan: background + borders).
+        const RenderPlan *pl = render_plan_get(opt, preset);
+        if (!pl->ok || copy_file(pl->base_png, outpng) != 0) { unlink(outpng); return -1; }
     }
 
     char draw_text_bin[PATH_MAX];
@@ -3467,14 +4434,17 @@ static bool resolve_external_icon_session(const Options *opt, const char *spec,
 
     // If session copy exists and is valid, use it.
     if (file_exists(sess) && validate_external_png_final(sess) == 0) {
+        cache_stats_hit(CST_EXTERNAL);
         snprintf(out_path, out_cap, "%s", sess);
         return true;
     }
 
     // If disk cache exists and is valid, copy into session and use it.
+    int64_t t0 = now_ns_monotonic();
     if (file_exists(disk) && validate_external_png_final(disk) == 0) {
         (void)copy_file(disk, sess);
         if (file_exists(sess) && validate_external_png_final(sess) == 0) {
+            cache_stats_miss(CST_EXTERNAL, t0);
             snprintf(out_path, out_cap, "%s", sess);
             return true;
         }
@@ -3600,6 +4570,7 @@ static bool resolve_external_icon_session(const Options *opt, const char *spec,
     if (file_exists(disk) && validate_external_png_final(disk) == 0) {
         (void)copy_file(disk, sess);
         if (file_exists(sess) && validate_external_png_final(sess) == 0) {
+            cache_stats_miss(CST_EXTERNAL, t0);
             snprintf(out_path, out_cap, "%s", sess);
             return true;
         }
@@ -3669,8 +4640,12 @@ static bool cached_or_generated_into_state(const Options *opt, const Config *cfg
     if (suf[0]) snprintf(out_path, out_cap, "%s/%s/%d-%08x-%s.png", opt->cache_root, page, btn, file_h, suf);
     else snprintf(out_path, out_cap, "%s/%s/%d-%08x.png", opt->cache_root, page, btn, file_h);
 
-    if (file_exists(out_path)) return true;
+    if (file_exists(out_path)) {
+        cache_stats_hit(CST_RENDER);
+        return true;
+    }
 
+    int64_t t0 = now_ns_monotonic();
     ensure_dir_parent(out_path);
     Item tmp = *it;
     tmp.icon = (char *)ic;
@@ -3679,6 +4654,7 @@ static bool cached_or_generated_into_state(const Options *opt, const Config *cfg
     if (generate_icon_pipeline(opt, preset, &tmp, out_path) != 0) {
         (void)copy_file(opt->error_icon, out_path);
     }
+    cache_stats_miss(CST_RENDER, t0);
     return true;
 }
 
@@ -3970,14 +4946,14 @@ static void page_tag_for_cache_dir(const char *page_name, char *out, size_t cap)
 static bool nav_wallpaper_composed_cached(const Options *opt, const Config *cfg, const char *page_name,
                                          const char *nav_name, const char *mdi_icon, int pos,
                                          uint32_t wp_sig, const WallpaperEff *wp,
-                                         const char *wp_render_dir, const char *wp_prefix,
+                                         const char *wp_obj, const char *wp_key,
                                          char *out_png, size_t out_cap, bool *out_is_tmp) {
     if (out_is_tmp) *out_is_tmp = false;
     if (!opt || !cfg || !page_name || !nav_name || !mdi_icon || !out_png || out_cap == 0) return false;
     out_png[0] = 0;
     if (pos < 1 || pos > 13) return false;
     if (!wp || !wp->enabled) return false;
-    if (!wp_render_dir || !wp_prefix || !wp_render_dir[0] || !wp_prefix[0]) return false;
+    if (!wp_obj || !wp_key || !wp_obj[0] || !wp_key[0]) return false;
 
     // Disk cache (persistent): .cache/nav/<page>/<wp_sig>/<nav>_<pos>.png
     char page_tag[96];
@@ -4028,7 +5004,7 @@ static bool nav_wallpaper_composed_cached(const Options *opt, const Config *cfg,
 
     // Compose tile(+icon) into a tmp RAM file, then persist both disk+RAM.
     char tile[PATH_MAX];
-    if (wallpaper_session_tile(opt, wp_render_dir, wp_prefix, wp, pos, tile, sizeof(tile)) != 0 || !tile[0]) return false;
+    if (wallpaper_session_tile(opt, wp_obj, wp_key, pos, tile, sizeof(tile)) != 0 || !tile[0]) return false;
 
     char draw_over_bin[PATH_MAX];
     snprintf(draw_over_bin, sizeof(draw_over_bin), "%s/icons/draw_over", opt->root_dir);
@@ -4125,6 +5101,164 @@ static void appendf_dyn(char **buf, size_t *len, size_t *cap, const char *fmt, .
     *len += (size_t)need;
 }
 
+// --- Icon slab shared with ulanzi_d200_daemon (src/icons/fd_slab.h) ---
+// Icons are copied once into a slot of a memfd the daemon maps (slab-attach), and set-buttons /
+// set-partial lines name them as slab references: the daemon builds the ZIP from the mapping without
+// opening any file. A slot remembers which file it holds, so a page shown again costs no read at all.
+typedef struct {
+    char path[PATH_MAX];
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    uint32_t gen, len;   // gen 0: empty
+    uint64_t last_use;   // batch (command) that last named the slot
+} SlabSlot;
+
+static struct {
+    pthread_mutex_t mu;
+    fd_slab_t slab;
+    SlabSlot slot[FD_SLAB_SLOTS];
+    bool created, attached;
+    double retry_at;
+    uint64_t batch;
+} g_icon_slab = { .mu = PTHREAD_MUTEX_INITIALIZER };
+
+// Create the slab and hand it to the daemon (again after a daemon restart). Caller holds mu.
+static bool icon_slab_ready(const Options *opt) {
+    if (g_icon_slab.attached) return true;
+    double now = now_sec_monotonic();
+    if (now < g_icon_slab.retry_at) return false;
+    g_icon_slab.retry_at = now + 30.0;   // old daemon (unknown command) or no memfd: paths only for a while
+    if (!g_icon_slab.created) {
+        if (fd_slab_create(&g_icon_slab.slab, FD_SLAB_SLOTS, FD_SLAB_SLOT_SIZE) != 0) return false;
+        g_icon_slab.created = true;
+    }
+    int fd = unix_connect(opt->ulanzi_sock);
+    if (fd < 0) return false;
+    char reply[64] = {0};
+    ssize_t r = -1;
+    if (fd_slab_send_fd(fd, "slab-attach\n", 12, g_icon_slab.slab.fd) == 0) r = read(fd, reply, sizeof(reply) - 1);
+    close(fd);
+    if (r <= 0) return false;
+    reply[r] = 0;
+    trim(reply);
+    if (strncmp(reply, "ok", 2) != 0) return false;
+    log_msg("slab attached: %s", reply);
+    g_icon_slab.attached = true;
+    g_icon_slab.retry_at = 0.0;
+    return true;
+}
+
+// Slab reference for an icon file: the slot already holding it, else the least recently used slot
+// not named by the current batch gets a copy. Returns false to keep the path (too big, I/O error).
+static bool icon_slab_ref(const char *path, char *out, size_t out_cap) {
+    char base[PATH_MAX];
+    struct stat st;
+    if (!path_basename(path, base, sizeof(base))) return false;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (uint64_t)st.st_size > g_icon_slab.slab.slot_size)
+        return false;
+
+    SlabSlot *hit = NULL;
+    SlabSlot *victim = NULL;
+    for (int i = 0; i < FD_SLAB_SLOTS; i++) {
+        SlabSlot *sl = &g_icon_slab.slot[i];
+        if (sl->gen && sl->dev == st.st_dev && sl->ino == st.st_ino && sl->size == st.st_size &&
+            sl->mtime.tv_sec == st.st_mtim.tv_sec && sl->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+            strcmp(sl->path, path) == 0) {
+            hit = sl;
+            break;
+        }
+        if (sl->last_use == g_icon_slab.batch) continue;   // named earlier on this line
+        if (!victim || sl->last_use < victim->last_use) victim = sl;
+    }
+    if (!hit) {
+        if (!victim) return false;
+        uint32_t idx = (uint32_t)(victim - g_icon_slab.slot);
+        victim->gen = 0;
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        uint8_t *dst = fd_slab_begin(&g_icon_slab.slab, idx);
+        size_t got = 0;
+        while (dst && got < (size_t)st.st_size) {
+            ssize_t r = read(fd, dst + got, (size_t)st.st_size - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            got += (size_t)r;
+        }
+        close(fd);
+        uint32_t gen = fd_slab_commit(&g_icon_slab.slab, idx, got == (size_t)st.st_size ? (uint32_t)got : 0);
+        if (gen == 0) return false;
+        snprintf(victim->path, sizeof(victim->path), "%s", path);
+        victim->dev = st.st_dev;
+        victim->ino = st.st_ino;
+        victim->size = st.st_size;
+        victim->mtime = st.st_mtim;
+        victim->gen = gen;
+        victim->len = (uint32_t)got;
+        hit = victim;
+    }
+    hit->last_use = g_icon_slab.batch;
+    int n = snprintf(out, out_cap, "slab:%08x:%u:%u:%u:%s", g_icon_slab.slab.id, (unsigned)(hit - g_icon_slab.slot),
+                     hit->gen, hit->len, base);
+    return n > 0 && (size_t)n < out_cap;
+}
+
+// Upload lane for ulanzi_d200_daemon (--lane=): what follows a tap (page change, state feedback) is
+// interactive; polls, HA pushes and periodic refreshes are background and yield the USB pipe to taps.
+#define ULANZI_INTERACTIVE_MS 2000
+static const char *ulanzi_lane(bool page) {
+    int64_t now = now_ns_monotonic();
+    if (g_last_action_ns <= 0 || now - g_last_action_ns >= (int64_t)ULANZI_INTERACTIVE_MS * 1000000LL) return "bg";
+    return page ? "nav" : "state";
+}
+
+// send_line_and_read_reply for set-buttons-explicit(-14) / set-partial-explicit lines: --button-N
+// paths are swapped for slab references when the daemon has the slab; on "err slab" (daemon
+// restarted, slot gone) the original line is sent instead.
+static int send_icons_line_and_read_reply(const Options *opt, const char *cmd, char *reply, size_t reply_cap) {
+    pthread_mutex_lock(&g_icon_slab.mu);   // slots stay untouched until the daemon has answered
+    char *slab_cmd = NULL;
+    size_t w = 0, cap = 0;
+    int refs = 0;
+    if (icon_slab_ready(opt)) {
+        g_icon_slab.batch++;
+        const char *p = cmd;
+        while (*p) {
+            const char *tok = p;
+            while (*p && *p != ' ') p++;
+            size_t tl = (size_t)(p - tok);
+            const char *eq = memchr(tok, '=', tl);
+            char path[PATH_MAX];
+            char ref[PATH_MAX + 64];
+            if (strncmp(tok, "--button-", 9) == 0 && eq && (size_t)(p - eq - 1) < sizeof(path)) {
+                snprintf(path, sizeof(path), "%.*s", (int)(p - eq - 1), eq + 1);
+                if (icon_slab_ref(path, ref, sizeof(ref))) {
+                    appendf_dyn(&slab_cmd, &w, &cap, "%.*s%s", (int)(eq + 1 - tok), tok, ref);
+                    refs++;
+                    tok = NULL;
+                }
+            }
+            if (tok) appendf_dyn(&slab_cmd, &w, &cap, "%.*s", (int)tl, tok);
+            for (; *p == ' '; p++) appendf_dyn(&slab_cmd, &w, &cap, " ");
+        }
+    }
+    int rc;
+    if (refs > 0) {
+        rc = send_line_and_read_reply(opt->ulanzi_sock, slab_cmd, reply, reply_cap);
+        if (rc == -1 && strncmp(reply, "err slab", 8) == 0) {
+            g_icon_slab.attached = false;
+            rc = send_line_and_read_reply(opt->ulanzi_sock, cmd, reply, reply_cap);
+        }
+    } else {
+        rc = send_line_and_read_reply(opt->ulanzi_sock, cmd, reply, reply_cap);
+    }
+    pthread_mutex_unlock(&g_icon_slab.mu);
+    free(slab_cmd);
+    return rc;
+}
+
 static void render_and_send(const Options *opt, const Config *cfg, const char *page_name, size_t offset,
                             const HaStateMap *ha_map, char *blank_png, char *last_sig, size_t last_sig_cap) {
     const Page *p = config_get_page((Config *)cfg, page_name);
@@ -4132,6 +5266,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
         log_msg("unknown page '%s' (render skipped)", page_name);
         return;
     }
+    shm_cache_pin_page(page_name, offset);
 
     bool show_back = strcmp(page_name, "$root") != 0;
     int back_pos = cfg->pos_back;
@@ -4147,12 +5282,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
     bool show_next = sheet.show_next;
 
     WallpaperEff sig_wp = effective_wallpaper(cfg, p);
-    uint32_t wp_sig = 0;
-    if (sig_wp.enabled && sig_wp.path && sig_wp.path[0]) {
-        char wkey[1024];
-        snprintf(wkey, sizeof(wkey), "path:%s\nq:%d\nm:%d\nd:%d\n", sig_wp.path, sig_wp.quality, sig_wp.magnify, sig_wp.dithering ? 1 : 0);
-        wp_sig = fnv1a32(wkey, strlen(wkey));
-    }
+    uint32_t wp_sig = wallpaper_sig(opt, &sig_wp);
 
     char sig[256];
     snprintf(sig, sizeof(sig), "%s|%zu|%zu|%d|%d|%d|%d|%d|%08x", page_name, offset, item_slots,
@@ -4193,14 +5323,14 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
     // to allow dynamic text updates (HA value) without re-running draw_over every time.
     WallpaperEff wp = effective_wallpaper(cfg, p);
     bool wp_active = false;
-    char wp_render_dir[PATH_MAX] = {0};
-    char wp_prefix[PATH_MAX] = {0};
+    char wp_obj[PATH_MAX] = {0};
+    char wp_key[WP_KEY_LEN] = {0};
     char wp_tile14[PATH_MAX] = {0};
     bool have_draw_over = false;
     if (wp.enabled && wp.path && wp.path[0]) {
-        if (ensure_wallpaper_rendered(opt, &wp, wp_render_dir, sizeof(wp_render_dir), wp_prefix, sizeof(wp_prefix)) == 0) {
+        if (ensure_wallpaper_rendered(opt, &wp, wp_obj, sizeof(wp_obj), wp_key, sizeof(wp_key)) == 0) {
             wp_active = true;
-            (void)wallpaper_session_tile(opt, wp_render_dir, wp_prefix, &wp, 14, wp_tile14, sizeof(wp_tile14));
+            (void)wallpaper_session_tile(opt, wp_obj, wp_key, 14, wp_tile14, sizeof(wp_tile14));
             char draw_over_bin[PATH_MAX];
             snprintf(draw_over_bin, sizeof(draw_over_bin), "%s/icons/draw_over", opt->root_dir);
             have_draw_over = (access(draw_over_bin, X_OK) == 0);
@@ -4328,7 +5458,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
                     bool cleanup_text_base = false;
                     if (wp_active && have_draw_over) {
                         // Compose tile+base icon once (cached), then draw_text on top for dynamic updates.
-                        if (wp_compose_cached(opt, wp_sig, wp_render_dir, wp_prefix, &wp, pos, base_png,
+                        if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, base_png,
                                               composed_base, sizeof(composed_base), &composed_is_tmp) == 0 &&
                             composed_base[0]) {
                             text_base = composed_base;
@@ -4380,7 +5510,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
                     bool composed_is_tmp = false;
                     bool cleanup_text_base = false;
                     if (wp_active && have_draw_over) {
-                        if (wp_compose_cached(opt, wp_sig, wp_render_dir, wp_prefix, &wp, pos, text_base,
+                        if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, text_base,
                                               composed_base, sizeof(composed_base), &composed_is_tmp) == 0 &&
                             composed_base[0]) {
                             text_base = composed_base;
@@ -4419,7 +5549,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
         char tmp[PATH_MAX];
         if (wp_active && wp_sig != 0 &&
             nav_wallpaper_composed_cached(opt, cfg, page_name, "page_back", "mdi:arrow-left", back_pos,
-                                          wp_sig, &wp, wp_render_dir, wp_prefix,
+                                          wp_sig, &wp, wp_obj, wp_key,
                                           tmp, sizeof(tmp), &cleanup_tmp[back_pos])) {
             snprintf(btn_path[back_pos], sizeof(btn_path[back_pos]), "%s", tmp);
             btn_set[back_pos] = true;
@@ -4433,7 +5563,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
         char tmp[PATH_MAX];
         if (wp_active && wp_sig != 0 &&
             nav_wallpaper_composed_cached(opt, cfg, page_name, "page_prev", "mdi:chevron-left", prev_pos,
-                                          wp_sig, &wp, wp_render_dir, wp_prefix,
+                                          wp_sig, &wp, wp_obj, wp_key,
                                           tmp, sizeof(tmp), &cleanup_tmp[prev_pos])) {
             snprintf(btn_path[prev_pos], sizeof(btn_path[prev_pos]), "%s", tmp);
             btn_set[prev_pos] = true;
@@ -4447,7 +5577,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
         char tmp[PATH_MAX];
         if (wp_active && wp_sig != 0 &&
             nav_wallpaper_composed_cached(opt, cfg, page_name, "page_next", "mdi:chevron-right", next_pos,
-                                          wp_sig, &wp, wp_render_dir, wp_prefix,
+                                          wp_sig, &wp, wp_obj, wp_key,
                                           tmp, sizeof(tmp), &cleanup_tmp[next_pos])) {
             snprintf(btn_path[next_pos], sizeof(btn_path[next_pos]), "%s", tmp);
             btn_set[next_pos] = true;
@@ -4475,7 +5605,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
             // Blank => wallpaper tile only.
             if (strcmp(btn_path[pos], blank_png) == 0) {
                 char tile[PATH_MAX];
-                if (wallpaper_session_tile(opt, wp_render_dir, wp_prefix, &wp, pos, tile, sizeof(tile)) == 0 && tile[0]) {
+                if (wallpaper_session_tile(opt, wp_obj, wp_key, pos, tile, sizeof(tile)) == 0 && tile[0]) {
                     snprintf(btn_path[pos], sizeof(btn_path[pos]), "%s", tile);
                     btn_set[pos] = true;
                 }
@@ -4490,7 +5620,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
 
             char composed[PATH_MAX];
             bool composed_is_tmp = false;
-            if (wp_compose_cached(opt, wp_sig, wp_render_dir, wp_prefix, &wp, pos, icon_top,
+            if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, icon_top,
                                   composed, sizeof(composed), &composed_is_tmp) == 0 &&
                 composed[0]) {
                 if (icon_top_is_tmp) unlink(icon_top);
@@ -4521,7 +5651,8 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
 	    char *cmd = NULL;
 	    size_t w = 0;
 	    size_t cap = 0;
-    appendf_dyn(&cmd, &w, &cap, "%s", wp_active ? "set-buttons-explicit-14" : "set-buttons-explicit");
+    appendf_dyn(&cmd, &w, &cap, "%s --lane=%s", wp_active ? "set-buttons-explicit-14" : "set-buttons-explicit",
+                ulanzi_lane(true));
     for (int pos = 1; pos <= 13; pos++) {
         if (!btn_set[pos]) snprintf(btn_path[pos], sizeof(btn_path[pos]), "%s", blank_png);
         appendf_dyn(&cmd, &w, &cap, " --button-%d=%s", pos, btn_path[pos]);
@@ -4536,7 +5667,7 @@ static void render_and_send(const Options *opt, const Config *cfg, const char *p
     if (w > 8000) log_msg("send cmd_len=%zu (was previously truncated at 8192)", w);
 
     char reply[64] = {0};
-    int sr = send_line_and_read_reply(opt->ulanzi_sock, cmd, reply, sizeof(reply));
+    int sr = send_icons_line_and_read_reply(opt, cmd, reply, sizeof(reply));
     if (sr != 0) {
         free(cmd);
         for (int pos = 1; pos <= 13; pos++) {
@@ -4942,11 +6073,12 @@ static void ulanzi_send_partial(const Options *opt, int pos, const char *png_pat
     }
 
     char cmd[PATH_MAX + 256];
-    if (label[0]) snprintf(cmd, sizeof(cmd), "set-partial-explicit --button-%d=%s --label-%d=%s", pos, send_png, pos, label);
-    else snprintf(cmd, sizeof(cmd), "set-partial-explicit --button-%d=%s", pos, send_png);
+    const char *lane = ulanzi_lane(false);
+    if (label[0]) snprintf(cmd, sizeof(cmd), "set-partial-explicit --lane=%s --button-%d=%s --label-%d=%s", lane, pos, send_png, pos, label);
+    else snprintf(cmd, sizeof(cmd), "set-partial-explicit --lane=%s --button-%d=%s", lane, pos, send_png);
 
     char reply[128] = {0};
-    if (send_line_and_read_reply(opt->ulanzi_sock, cmd, reply, sizeof(reply)) != 0) {
+    if (send_icons_line_and_read_reply(opt, cmd, reply, sizeof(reply)) != 0) {
         log_msg("partial send failed (pos=%d)", pos);
         return;
     }
@@ -4963,9 +6095,9 @@ static void ulanzi_send_partial_wallpaper(const Options *opt, const Config *cfg,
         return;
     }
 
-    char render_dir[PATH_MAX];
-    char prefix[PATH_MAX];
-    if (ensure_wallpaper_rendered(opt, &wp, render_dir, sizeof(render_dir), prefix, sizeof(prefix)) != 0) {
+    char wp_obj[PATH_MAX];
+    char wp_key[WP_KEY_LEN];
+    if (ensure_wallpaper_rendered(opt, &wp, wp_obj, sizeof(wp_obj), wp_key, sizeof(wp_key)) != 0) {
         ulanzi_send_partial(opt, pos, png_path, label_src);
         return;
     }
@@ -4973,7 +6105,7 @@ static void ulanzi_send_partial_wallpaper(const Options *opt, const Config *cfg,
     // Blank => wallpaper tile only.
     if (blank_png && strcmp(png_path, blank_png) == 0) {
         char tile[PATH_MAX];
-        if (wallpaper_session_tile(opt, render_dir, prefix, &wp, pos, tile, sizeof(tile)) == 0 && tile[0]) {
+        if (wallpaper_session_tile(opt, wp_obj, wp_key, pos, tile, sizeof(tile)) == 0 && tile[0]) {
             ulanzi_send_partial(opt, pos, tile, label_src);
             return;
         }
@@ -4982,16 +6114,11 @@ static void ulanzi_send_partial_wallpaper(const Options *opt, const Config *cfg,
     }
 
     // Signature for caching composed images.
-    uint32_t wp_sig = 0;
-    if (wp.path && wp.path[0]) {
-        char wkey[1024];
-        snprintf(wkey, sizeof(wkey), "path:%s\nq:%d\nm:%d\nd:%d\n", wp.path, wp.quality, wp.magnify, wp.dithering ? 1 : 0);
-        wp_sig = fnv1a32(wkey, strlen(wkey));
-    }
+    uint32_t wp_sig = fnv1a32(wp_key, strlen(wp_key));
 
     char composed[PATH_MAX];
     bool composed_is_tmp = false;
-    if (wp_compose_cached(opt, wp_sig, render_dir, prefix, &wp, pos, png_path, composed, sizeof(composed), &composed_is_tmp) == 0 &&
+    if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, png_path, composed, sizeof(composed), &composed_is_tmp) == 0 &&
         composed[0]) {
         ulanzi_send_partial(opt, pos, composed, label_src);
         if (composed_is_tmp) unlink(composed);
@@ -5085,20 +6212,17 @@ static void ha_partial_update_visible(const Options *opt, const Config *cfg, con
                         const Page *page = config_get_page((Config *)cfg, page_name);
                         WallpaperEff wp = effective_wallpaper(cfg, page);
                         if (wp.enabled && wp.path && wp.path[0]) {
-                            char render_dir[PATH_MAX];
-                            char prefix[PATH_MAX];
+                            char wp_obj[PATH_MAX];
+                            char wp_key[WP_KEY_LEN];
                             char draw_over_bin[PATH_MAX];
                             snprintf(draw_over_bin, sizeof(draw_over_bin), "%s/icons/draw_over", opt->root_dir);
                             if (access(draw_over_bin, X_OK) == 0 &&
-                                ensure_wallpaper_rendered(opt, &wp, render_dir, sizeof(render_dir), prefix, sizeof(prefix)) == 0) {
-                                uint32_t wp_sig = 0;
-                                char wkey[1024];
-                                snprintf(wkey, sizeof(wkey), "path:%s\nq:%d\nm:%d\nd:%d\n", wp.path, wp.quality, wp.magnify, wp.dithering ? 1 : 0);
-                                wp_sig = fnv1a32(wkey, strlen(wkey));
+                                ensure_wallpaper_rendered(opt, &wp, wp_obj, sizeof(wp_obj), wp_key, sizeof(wp_key)) == 0) {
+                                uint32_t wp_sig = fnv1a32(wp_key, strlen(wp_key));
 
                                 char composed_base[PATH_MAX] = {0};
                                 bool composed_tmp = false;
-                                if (wp_compose_cached(opt, wp_sig, render_dir, prefix, &wp, pos, base_png,
+                                if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, base_png,
                                                       composed_base, sizeof(composed_base), &composed_tmp) == 0 &&
                                     composed_base[0]) {
                                     char tmp_out[PATH_MAX];
@@ -5160,16 +6284,14 @@ static void cmd_apply_updates_current_page(const Options *opt, const Config *cfg
     // Wallpaper context (optional)
     WallpaperEff wp = effective_wallpaper(cfg, p);
     bool wp_active = false;
-    char wp_render_dir[PATH_MAX] = {0};
-    char wp_prefix[PATH_MAX] = {0};
+    char wp_obj[PATH_MAX] = {0};
+    char wp_key[WP_KEY_LEN] = {0};
     bool have_draw_over = false;
     uint32_t wp_sig = 0;
     if (wp.enabled && wp.path && wp.path[0]) {
-        if (ensure_wallpaper_rendered(opt, &wp, wp_render_dir, sizeof(wp_render_dir), wp_prefix, sizeof(wp_prefix)) == 0) {
+        if (ensure_wallpaper_rendered(opt, &wp, wp_obj, sizeof(wp_obj), wp_key, sizeof(wp_key)) == 0) {
             wp_active = true;
-            char wkey[1024];
-            snprintf(wkey, sizeof(wkey), "path:%s\nq:%d\nm:%d\nd:%d\n", wp.path, wp.quality, wp.magnify, wp.dithering ? 1 : 0);
-            wp_sig = fnv1a32(wkey, strlen(wkey));
+            wp_sig = fnv1a32(wp_key, strlen(wp_key));
             char draw_over_bin[PATH_MAX];
             snprintf(draw_over_bin, sizeof(draw_over_bin), "%s/icons/draw_over", opt->root_dir);
             have_draw_over = (access(draw_over_bin, X_OK) == 0);
@@ -5289,7 +6411,7 @@ static void cmd_apply_updates_current_page(const Options *opt, const Config *cfg
                 if (wp_active && have_draw_over) {
                     char composed_base[PATH_MAX] = {0};
                     bool composed_tmp = false;
-                    if (wp_compose_cached(opt, wp_sig, wp_render_dir, wp_prefix, &wp, pos, base_png,
+                    if (wp_compose_cached(opt, wp_sig, wp_obj, wp_key, &wp, pos, base_png,
                                           composed_base, sizeof(composed_base), &composed_tmp) == 0 &&
                         composed_base[0]) {
                         char tmp_out[PATH_MAX];
@@ -5688,14 +6810,14 @@ static void handle_button_event(const Options *opt,
     // Action debounce: ignore rapid successive TAPs (avoid queuing renders).
     if (is_tap) {
         int ms = g_ulanzi_send_debounce_ms;
+        int64_t now = now_ns_monotonic();
         if (ms > 0) {
-            int64_t now = now_ns_monotonic();
             int64_t min_gap = (int64_t)ms * 1000000LL;
             if (g_last_action_ns > 0 && (now - g_last_action_ns) < min_gap) {
                 return;
             }
-            g_last_action_ns = now;
         }
+        g_last_action_ns = now; // also ranks the uploads that follow (ulanzi_lane)
     }
 
     const Page *p = config_get_page(cfg, cur_page);
@@ -5951,6 +7073,8 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    shm_cache_init(&opt, &cfg);
+
     (void)ulanzi_apply_default_label_style(&opt);
     
     if (dump_config) {
@@ -5982,6 +7106,9 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    // Tile the configured wallpapers in the background (pages render them on demand if not done yet).
+    wallpaper_prerender_start(&opt, &cfg);
+
     // Use a stable pre-generated empty icon when a button is undefined/empty.
     // If it's missing, create it once.
     char blank_png[PATH_MAX];
@@ -6133,6 +7260,8 @@ int main(int argc, char **argv) {
             prev_device_ready = g_ulanzi_device_ready;
         }
 
+        shm_cache_tick(&opt);
+
         // Idle brightness management (does not depend on control_enabled).
         {
             double now = now_sec_monotonic();
@@ -6205,6 +7334,10 @@ int main(int argc, char **argv) {
                             resp = "ok\n";
                         }
                     }
+                } else if (strcmp(cmdline, "cache-stats") == 0) {
+                    static char stats_reply[4096];
+                    cache_stats_format(&opt, stats_reply, sizeof(stats_reply));
+                    resp = stats_reply;
                 } else if (strcmp(cmdline, "load-last-page") == 0) {
                     char lp[256] = {0};
                     size_t lo = 0;
@@ -6422,14 +7555,14 @@ int main(int argc, char **argv) {
                 // Action debounce: ignore rapid successive TAPs (avoid queuing renders).
                 if (is_tap) {
                     int ms = g_ulanzi_send_debounce_ms;
+                    int64_t now = now_ns_monotonic();
                     if (ms > 0) {
-                        int64_t now = now_ns_monotonic();
                         int64_t min_gap = (int64_t)ms * 1000000LL;
                         if (g_last_action_ns > 0 && (now - g_last_action_ns) < min_gap) {
                             continue;
                         }
-                        g_last_action_ns = now;
                     }
+                    g_last_action_ns = now; // also ranks the uploads that follow (ulanzi_lane)
                 }
 
                 const Page *p = config_get_page(&cfg, cur_page);
@@ -6588,6 +7721,7 @@ parse_done:
         cmd_engine_free(g_cmd_engine);
         g_cmd_engine = NULL;
     }
+    wallpaper_prerender_join();
     config_free(&cfg);
     free(opt.config_path);
     free(opt.ulanzi_sock);
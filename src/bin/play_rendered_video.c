@@ -0,0 +1,499 @@
+// Lecteur de vidéo rendue (remplace play_rendered_video.sh)
+//
+// La cadence est tenue par le démon (video-play): échéances absolues, mesure du temps d'upload
+// et saut des frames en retard. Ce programme prépare le conteneur .d2v si besoin (dossier de
+// frames b<N>_<i>.png), lance la lecture et expose le socket de contrôle historique.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+#include "../icons/fd_devzip.h"
+#include "../icons/fd_d2v.h"
+
+#define DAEMON_SOCK_PATH "/tmp/ulanzi_device.sock"
+#define CONTROL_SOCK_PATH "/tmp/play_rendered_video_control.sock"
+#define SEEK_STEP 75            // back / forward (frames)
+#define STATUS_INTERVAL_MS 250
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void show_help(FILE *out, const char *prog) {
+    fprintf(out, "Usage: %s [options] <folder|video.d2v>\n", prog);
+    fprintf(out, "       %s --control <commande> [arg]\n\n", prog);
+    fprintf(out, "Joue une vidéo rendue (send_video_page_wrapper -o / --pack) via le démon.\n\n");
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -d, --delay=MS     Délai entre chaque frame en millisecondes (défaut: fps du conteneur, sinon 33)\n");
+    fprintf(out, "      --fps=F        Cadence en images/seconde (prioritaire sur --delay)\n");
+    fprintf(out, "  -l, --loop         Lecture en boucle\n");
+    fprintf(out, "      --delta        Dossier: n'envoyer que les tuiles modifiées (0x000d), octets PNG identiques = inchangée\n");
+    fprintf(out, "      --keyframe=N   Avec --delta: page complète toutes les N frames (défaut: 30)\n");
+    fprintf(out, "  -c, --cache        Ignoré (le conteneur est toujours lu depuis la RAM)\n");
+    fprintf(out, "  -h, --help         Afficher cette aide\n\n");
+    fprintf(out, "Un dossier <folder> est converti en conteneur dans /dev/shm (ou <folder>.d2v est utilisé s'il existe).\n\n");
+    fprintf(out, "Socket de contrôle: %s (une commande par ligne, une réponse)\n", CONTROL_SOCK_PATH);
+    fprintf(out, "  play | pause | stop | back | forward | status\n");
+    fprintf(out, "  seek N|+N|-N       Aller à la frame N (ou relatif)\n");
+    fprintf(out, "  rate X             Vitesse de lecture (0.05 à 16)\n");
+    fprintf(out, "  stats              Compteurs bruts du démon (fps obtenus, frames sautées, temps d'upload)\n");
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_reply(int fd, char *buf, size_t cap) {
+    size_t n = 0;
+    while (n + 1 < cap) {
+        ssize_t r = read(fd, buf + n, 1);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        if (buf[n] == '\n') break;
+        n++;
+    }
+    buf[n] = '\0';
+    return n > 0 ? 0 : -1;
+}
+
+static int unix_connect(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    return fd;
+}
+
+// Une commande, une ligne de réponse
+static int request(const char *path, const char *cmd, char *reply, size_t cap) {
+    int fd = unix_connect(path);
+    if (fd < 0) return -1;
+    int rc = -1;
+    if (write_all(fd, cmd, strlen(cmd)) == 0 && write_all(fd, "\n", 1) == 0) {
+        rc = read_reply(fd, reply, cap);
+    }
+    close(fd);
+    return rc;
+}
+
+// Valeur d'un champ "key=value" d'une réponse video-stats
+static double stat_field(const char *reply, const char *key) {
+    size_t kl = strlen(key);
+    for (const char *p = reply; (p = strstr(p, key)) != NULL; p += kl) {
+        if ((p == reply || p[-1] == ' ') && p[kl] == '=') return atof(p + kl + 1);
+    }
+    return 0.0;
+}
+
+// --- Conversion d'un dossier de frames en conteneur .d2v ---
+
+typedef struct {
+    char **names;            // triés par numéro de frame
+    size_t count;
+} frame_list_t;
+
+static int frame_number(const char *name, int btn, long *out) {
+    char prefix[16];
+    int pl = snprintf(prefix, sizeof(prefix), "b%d_", btn);
+    if (strncmp(name, prefix, (size_t)pl) != 0) return -1;
+    char *end = NULL;
+    long n = strtol(name + pl, &end, 10);
+    if (end == name + pl || strcmp(end, ".png") != 0 || n < 0) return -1;
+    *out = n;
+    return 0;
+}
+
+static int g_sort_btn;
+
+static int cmp_frames(const void *a, const void *b) {
+    long na = 0, nb = 0;
+    frame_number(*(char *const *)a, g_sort_btn, &na);
+    frame_number(*(char *const *)b, g_sort_btn, &nb);
+    return (na > nb) - (na < nb);
+}
+
+static int list_frames(const char *folder, int btn, frame_list_t *fl) {
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/%d", folder, btn);
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+    size_t cap = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        long n;
+        if (frame_number(e->d_name, btn, &n) != 0) continue;
+        if (fl->count == cap) {
+            cap = cap ? cap * 2 : 256;
+            char **p = realloc(fl->names, cap * sizeof(*p));
+            if (!p) { closedir(d); return -1; }
+            fl->names = p;
+        }
+        fl->names[fl->count++] = strdup(e->d_name);
+    }
+    closedir(d);
+    g_sort_btn = btn;
+    if (fl->count > 0) qsort(fl->names, fl->count, sizeof(*fl->names), cmp_frames);
+    return 0;
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    uint8_t *buf = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long n = ftell(f);
+        if (n > 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = malloc((size_t)n)) != NULL) {
+            if (fread(buf, 1, (size_t)n, f) != (size_t)n) { free(buf); buf = NULL; }
+            else *len = (size_t)n;
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+// keyframe < 0: toutes les tuiles à chaque frame; sinon delta (page complète toutes les keyframe frames)
+static int pack_folder(const char *folder, const char *out, uint32_t fps_num, uint32_t fps_den, int keyframe) {
+    frame_list_t lists[14];
+    memset(lists, 0, sizeof(lists));
+    uint8_t *last[14] = {0};     // dernière tuile envoyée (delta)
+    size_t last_len[14] = {0};
+    int since_full = -1;
+    size_t frames = 0;
+    int rc = -1;
+    for (int b = 0; b < 14; b++) {
+        if (list_frames(folder, b + 1, &lists[b]) != 0 || lists[b].count == 0) {
+            fprintf(stderr, "Erreur: aucune frame dans %s/%d\n", folder, b + 1);
+            goto done;
+        }
+        if (b == 0 || lists[b].count < frames) frames = lists[b].count;
+    }
+
+    fd_d2v_writer_t w;
+    if (fd_d2v_open(&w, out, fps_num, fps_den) != 0) {
+        fprintf(stderr, "Erreur: impossible de créer %s: %s\n", out, strerror(errno));
+        goto done;
+    }
+    fd_devzip_t z;
+    fd_devzip_init(&z);
+    int ok = 1;
+    for (size_t i = 0; i < frames && ok && !stop_requested; i++) {
+        fd_devzip_icon_t icons[14];
+        uint8_t *data[14] = {0};
+        for (int b = 0; b < 14; b++) {
+            char path[4096 + 64];
+            snprintf(path, sizeof(path), "%s/%d/%s", folder, b + 1, lists[b].names[i]);
+            icons[b].btn = b;
+            icons[b].name = lists[b].names[i];
+            icons[b].label = "";
+            data[b] = read_file(path, &icons[b].len);
+            icons[b].data = data[b];
+            if (!data[b]) {
+                fprintf(stderr, "\nErreur: lecture de %s\n", path);
+                ok = 0;
+            }
+        }
+        // Rendu déterministe: une zone fixe de la vidéo donne exactement les mêmes octets PNG
+        int full = keyframe < 0 || since_full < 0 || (keyframe > 0 && since_full >= keyframe - 1);
+        fd_devzip_icon_t changed[14];
+        int count = 0;
+        for (int b = 0; b < 14 && ok; b++) {
+            if (full || icons[b].len != last_len[b] || memcmp(icons[b].data, last[b], icons[b].len) != 0) {
+                changed[count++] = icons[b];
+            }
+        }
+        if (count == 14) full = 1;
+        int pad = 0;
+        size_t patched = 0;
+        if (ok && count == 0) {
+            if (fd_d2v_append(&w, NULL, 0, 0) != 0) ok = 0;
+        } else if (ok && (fd_devzip_solve(&z, changed, count, FD_DEVZIP_MAX_PAD, &pad, &patched) != 0 ||
+                          fd_devzip_packetize(&z, full ? FD_DEVZIP_CMD_FULL : FD_DEVZIP_CMD_PARTIAL) != 0 ||
+                          fd_d2v_append(&w, z.pkt, z.pkt_len, full ? FD_D2V_FRAME_FULL : 0) != 0)) {
+            ok = 0;
+        }
+        if (!ok) fprintf(stderr, "\nErreur: écriture de la frame %zu\n", i);
+        since_full = full ? 0 : since_full + 1;
+        for (int b = 0; b < 14; b++) {
+            if (keyframe >= 0 && data[b]) {
+                free(last[b]);
+                last[b] = data[b]; // garde la tuile pour la comparaison suivante
+                last_len[b] = icons[b].len;
+            } else {
+                free(data[b]);
+            }
+        }
+        if ((i + 1) % 50 == 0 || i + 1 == frames) {
+            printf("\rPréparation: %zu/%zu frames", i + 1, frames);
+            fflush(stdout);
+        }
+    }
+    printf("\n");
+    fd_devzip_free(&z);
+    ok = ok && !stop_requested;
+    if (fd_d2v_finish(&w, ok) == 0 && ok) rc = 0;
+
+done:
+    for (int b = 0; b < 14; b++) {
+        free(last[b]);
+        for (size_t i = 0; i < lists[b].count; i++) free(lists[b].names[i]);
+        free(lists[b].names);
+    }
+    return rc;
+}
+
+// --- Socket de contrôle ---
+
+static int control_listen(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, CONTROL_SOCK_PATH, sizeof(addr.sun_path) - 1);
+    unlink(CONTROL_SOCK_PATH);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Traduit une commande du socket de contrôle en commande video-* du démon. 1: arrêt demandé.
+static int handle_control(int cfd) {
+    char line[256], cmd[128], reply[256], out[320];
+    struct pollfd pfd = { .fd = cfd, .events = POLLIN };
+    if (poll(&pfd, 1, 1000) <= 0 || read_reply(cfd, line, sizeof(line)) != 0) return 0;
+    char *arg = strchr(line, ' ');
+    if (arg) *arg++ = '\0';
+    int quit = 0;
+    out[0] = '\0';
+
+    if (strcmp(line, "play") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-resume");
+    } else if (strcmp(line, "pause") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-pause");
+    } else if (strcmp(line, "stop") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-stop");
+        quit = 1;
+    } else if (strcmp(line, "back") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-seek -%d", SEEK_STEP);
+    } else if (strcmp(line, "forward") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-seek +%d", SEEK_STEP);
+    } else if (strcmp(line, "seek") == 0 && arg) {
+        snprintf(cmd, sizeof(cmd), "video-seek %.64s", arg);
+    } else if (strcmp(line, "rate") == 0 && arg) {
+        snprintf(cmd, sizeof(cmd), "video-rate %.64s", arg);
+    } else if (strcmp(line, "stats") == 0 || strcmp(line, "status") == 0) {
+        snprintf(cmd, sizeof(cmd), "video-stats");
+    } else {
+        snprintf(out, sizeof(out), "Commande inconnue: %.64s (play, pause, stop, back, forward, status, seek, rate, stats)\n", line);
+        write_all(cfd, out, strlen(out));
+        return 0;
+    }
+
+    if (request(DAEMON_SOCK_PATH, cmd, reply, sizeof(reply)) != 0) {
+        snprintf(out, sizeof(out), "err daemon\n");
+    } else if (strcmp(line, "status") == 0 && strncmp(reply, "ok state=stopped", 16) != 0) {
+        const char *st = strstr(reply, "state=paused") ? "Pause" : "Lecture";
+        snprintf(out, sizeof(out), "État: %s | Frame: %.0f/%.0f | %.1f fps (cible %.1f x%.2f) | sautées: %.0f | upload: %.1f ms\n",
+                 st, stat_field(reply, "frame"), stat_field(reply, "frames"), stat_field(reply, "achieved"),
+                 stat_field(reply, "fps"), stat_field(reply, "rate"), stat_field(reply, "dropped"),
+                 stat_field(reply, "upload_ms"));
+    } else {
+        snprintf(out, sizeof(out), "%s\n", reply);
+    }
+    write_all(cfd, out, strlen(out));
+    return quit;
+}
+
+static int control_client(int argc, char **argv) {
+    if (argc < 1) {
+        fprintf(stderr, "Commandes: play, pause, stop, back, forward, status, seek N, rate X, stats\n");
+        return 1;
+    }
+    char cmd[256], reply[320];
+    snprintf(cmd, sizeof(cmd), "%s%s%s", argv[0], argc > 1 ? " " : "", argc > 1 ? argv[1] : "");
+    if (request(CONTROL_SOCK_PATH, cmd, reply, sizeof(reply)) != 0) {
+        fprintf(stderr, "Erreur: impossible d'envoyer la commande '%s' (%s)\n", cmd, CONTROL_SOCK_PATH);
+        return 1;
+    }
+    printf("%s\n", reply);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *prog = basename(argv[0]);
+    if (strcmp(prog, "play_rendered_video_control") == 0) return control_client(argc - 1, argv + 1);
+    if (argc > 1 && strcmp(argv[1], "--control") == 0) return control_client(argc - 2, argv + 2);
+
+    const char *input = NULL;
+    double fps = 0.0;
+    int loop = 0;
+    int delta = 0, keyframe = 30;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strncmp(a, "-d=", 3) == 0 || strncmp(a, "--delay=", 8) == 0 ||
+            ((strcmp(a, "-d") == 0 || strcmp(a, "--delay") == 0) && i + 1 < argc)) {
+            const char *v = strchr(a, '=') ? strchr(a, '=') + 1 : argv[++i];
+            int ms = atoi(v);
+            if (ms < 1) {
+                fprintf(stderr, "Erreur: le délai doit être un entier positif\n");
+                return 1;
+            }
+            if (fps <= 0.0) fps = 1000.0 / ms;
+        } else if (strncmp(a, "--fps=", 6) == 0) {
+            fps = atof(a + 6);
+        } else if (strcmp(a, "--delta") == 0) {
+            delta = 1;
+        } else if (strncmp(a, "--keyframe=", 11) == 0) {
+            keyframe = atoi(a + 11);
+            if (keyframe < 0) {
+                fprintf(stderr, "Erreur: keyframe doit être positif ou nul\n");
+                return 1;
+            }
+        } else if (strcmp(a, "-l") == 0 || strcmp(a, "--loop") == 0) {
+            loop = 1;
+        } else if (strcmp(a, "-c") == 0 || strcmp(a, "--cache") == 0) {
+            // compatibilité: le conteneur est mappé en RAM par le démon
+        } else if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+            show_help(stdout, prog);
+            return 0;
+        } else if (a[0] == '-') {
+            fprintf(stderr, "Erreur: option inconnue %s\n", a);
+            show_help(stderr, prog);
+            return 1;
+        } else if (!input) {
+            input = a;
+        } else {
+            fprintf(stderr, "Erreur: une seule vidéo doit être spécifiée\n");
+            return 1;
+        }
+    }
+    if (!input) {
+        fprintf(stderr, "Erreur: dossier ou fichier .d2v requis\n");
+        show_help(stderr, prog);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    char reply[256];
+    if (request(DAEMON_SOCK_PATH, "ping", reply, sizeof(reply)) != 0) {
+        fprintf(stderr, "Erreur: impossible de se connecter au démon (%s)\n", DAEMON_SOCK_PATH);
+        return 1;
+    }
+
+    // Conteneur à lire: fichier donné, <folder>.d2v du rendu --pack, sinon conversion temporaire
+    char path[4096 + 16];
+    char tmp_path[128] = "";
+    struct stat st;
+    if (stat(input, &st) != 0) {
+        fprintf(stderr, "Erreur: %s n'existe pas\n", input);
+        return 1;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        size_t n = strlen(input);
+        while (n > 1 && input[n - 1] == '/') n--;
+        snprintf(path, sizeof(path), "%.*s.d2v", (int)n, input);
+        if (stat(path, &st) != 0) {
+            snprintf(tmp_path, sizeof(tmp_path), "/dev/shm/play_rendered_video_%d.d2v", (int)getpid());
+            // fps du dossier inconnue: 33ms par défaut comme l'ancien script
+            uint32_t num = fps > 0.0 ? (uint32_t)(fps * 1000.0 + 0.5) : 1000000;
+            uint32_t den = fps > 0.0 ? 1000 : 33000;
+            if (pack_folder(input, tmp_path, num, den, delta ? keyframe : -1) != 0) return 1;
+            snprintf(path, sizeof(path), "%s", tmp_path);
+        }
+    } else {
+        snprintf(path, sizeof(path), "%s", input);
+    }
+    // Le démon découpe la commande sur les espaces: un chemin qui en contient serait coupé
+    if (strpbrk(path, " \t\r\n")) {
+        fprintf(stderr, "Erreur: chemin .d2v avec espaces non supporté: %s\n", path);
+        return 1;
+    }
+
+    char cmd[4096 + 64];
+    int n = snprintf(cmd, sizeof(cmd), "video-play %s", path);
+    if (fps > 0.0) n += snprintf(cmd + n, sizeof(cmd) - (size_t)n, " --fps=%.3f", fps);
+    if (loop) snprintf(cmd + n, sizeof(cmd) - (size_t)n, " --loop");
+    int rc = request(DAEMON_SOCK_PATH, cmd, reply, sizeof(reply));
+    // Le démon garde le fichier mappé: la copie temporaire peut disparaître dès maintenant
+    if (tmp_path[0]) unlink(tmp_path);
+    if (rc != 0 || strncmp(reply, "ok", 2) != 0) {
+        fprintf(stderr, "Erreur: lecture refusée par le démon (%s)\n", rc == 0 ? reply : "pas de réponse");
+        return 1;
+    }
+    printf("Lecture: %s (%s)\n", path, reply + 3);
+
+    int lfd = control_listen();
+    if (lfd < 0) fprintf(stderr, "Avertissement: socket de contrôle indisponible (%s)\n", CONTROL_SOCK_PATH);
+    else printf("Socket de contrôle: %s\n", CONTROL_SOCK_PATH);
+    printf("Commandes: play, pause, stop, back, forward, status, seek N, rate X, stats\n");
+
+    int quit = 0;
+    int lost = 0;
+    while (!stop_requested && !quit) {
+        struct pollfd pfd = { .fd = lfd, .events = POLLIN };
+        if (poll(&pfd, lfd >= 0 ? 1 : 0, STATUS_INTERVAL_MS) > 0 && (pfd.revents & POLLIN)) {
+            int cfd = accept(lfd, NULL, NULL);
+            if (cfd >= 0) {
+                quit = handle_control(cfd);
+                close(cfd);
+            }
+        }
+        if (quit) break;
+        if (request(DAEMON_SOCK_PATH, "video-stats", reply, sizeof(reply)) != 0) {
+            fprintf(stderr, "\nErreur: démon injoignable\n");
+            lost = 1;
+            break;
+        }
+        if (strncmp(reply, "ok state=stopped", 16) == 0) {
+            printf("\nFin de la vidéo\n");
+            break;
+        }
+        printf("\rFrame: %.0f/%.0f | %5.1f fps | sautées: %.0f | upload: %5.1f ms%s   ",
+               stat_field(reply, "frame"), stat_field(reply, "frames"), stat_field(reply, "achieved"),
+               stat_field(reply, "dropped"), stat_field(reply, "upload_ms"),
+               strstr(reply, "state=paused") ? " [pause]" : "");
+        fflush(stdout);
+    }
+    if (stop_requested || quit) {
+        request(DAEMON_SOCK_PATH, "video-stop", reply, sizeof(reply));
+        printf("\nLecture arrêtée\n");
+    }
+    if (lfd >= 0) {
+        close(lfd);
+        unlink(CONTROL_SOCK_PATH);
+    }
+    return lost ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+// Banc d'essai du codec PNG partagé (src/icons/fd_png.h) sur de vraies icônes.
+//
+// Pour chaque fichier: temps moyen de décodage (unfilter vectoriel puis scalaire) et
+// d'encodage, en mode tuiles (fd_png_encode_rgba, FD_PNG_FAST) et en mode outils draw_*
+// (fd_png_encode_rgba8, FD_PNG_SMALL), avec la taille produite. Décodeur et encodeur sont
+// réutilisés d'une itération à l'autre, comme dans les outils.
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../icons/fd_png.h"
+
+typedef struct {
+    double dec, dec_scalar, enc_fast, enc_tool;   // µs par image
+    size_t in_len, out_fast, out_tool;
+    int w, h;
+} bench_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void show_help(FILE *out, const char *prog) {
+    fprintf(out, "Usage: %s [-n N] <fichier.png|dossier>...\n\n", prog);
+    fprintf(out, "Mesure décodage + encodage par icône avec le codec partagé (fd_png.h).\n\n");
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -n N    itérations par fichier (défaut 50)\n");
+    fprintf(out, "  -h      cette aide\n");
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    uint8_t *buf = size > 0 ? malloc((size_t)size) : NULL;
+    if (!buf || fseek(f, 0, SEEK_SET) != 0 || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+static int bench_file(const char *path, int iters, fd_png_dec_t *dec, fd_png_enc_t *enc, bench_t *b) {
+    memset(b, 0, sizeof(*b));
+    uint8_t *data = read_file(path, &b->in_len);
+    if (!data) return -1;
+    if (fd_png_decode(dec, data, b->in_len) != 0) {
+        free(data);
+        return -1;
+    }
+    b->w = dec->w;
+    b->h = dec->h;
+    size_t px = (size_t)dec->w * (size_t)dec->h * 4;
+    uint8_t *rgba = malloc(px);
+    size_t cap = fd_png_bound(dec->w, dec->h);
+    uint8_t *out = malloc(cap);
+    if (!rgba || !out) {
+        free(rgba);
+        free(out);
+        free(data);
+        return -1;
+    }
+    memcpy(rgba, dec->rgba, px);
+
+    int rc = 0;
+    for (int scalar = 0; scalar < 2 && rc == 0; scalar++) {
+        dec->scalar = scalar;
+        double t0 = now_sec();
+        for (int i = 0; i < iters && rc == 0; i++) rc = fd_png_decode(dec, data, b->in_len);
+        double us = (now_sec() - t0) * 1e6 / iters;
+        if (scalar) b->dec_scalar = us;
+        else b->dec = us;
+        if (rc == 0 && memcmp(dec->rgba, rgba, px) != 0) rc = -1;
+    }
+    dec->scalar = 0;
+
+    double t0 = now_sec();
+    for (int i = 0; i < iters && rc == 0; i++) {
+        rc = fd_png_encode_rgba(enc, rgba, b->w, b->h, (size_t)b->w * 4, FD_PNG_FAST, out, cap, &b->out_fast);
+    }
+    b->enc_fast = (now_sec() - t0) * 1e6 / iters;
+
+    t0 = now_sec();
+    for (int i = 0; i < iters && rc == 0; i++) {
+        rc = fd_png_encode_rgba8(enc, rgba, b->w, b->h, (size_t)b->w * 4, FD_PNG_SMALL, out, cap, &b->out_tool);
+    }
+    b->enc_tool = (now_sec() - t0) * 1e6 / iters;
+
+    // Contrôle: la sortie outils se relit à l'identique
+    if (rc == 0 && (fd_png_decode(dec, out, b->out_tool) != 0 || memcmp(dec->rgba, rgba, px) != 0)) rc = -1;
+
+    free(out);
+    free(rgba);
+    free(data);
+    return rc;
+}
+
+static int has_png_ext(const char *name) {
+    size_t n = strlen(name);
+    return n > 4 && strcmp(name + n - 4, ".png") == 0;
+}
+
+typedef struct {
+    int files, failed;
+    double dec, dec_scalar, enc_fast, enc_tool;
+    size_t in_len, out_fast, out_tool;
+} totals_t;
+
+static void run_one(const char *path, int iters, fd_png_dec_t *dec, fd_png_enc_t *enc, totals_t *t) {
+    bench_t b;
+    if (bench_file(path, iters, dec, enc, &b) != 0) {
+        fprintf(stderr, "Erreur: %s: lecture/décodage impossible\n", path);
+        t->failed++;
+        return;
+    }
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    printf("%-32.32s %4dx%-4d %7zu %8.1f %8.1f %8.1f %8.1f %7zu %7zu\n", name, b.w, b.h, b.in_len, b.dec,
+           b.dec_scalar, b.enc_fast, b.enc_tool, b.out_fast, b.out_tool);
+    t->files++;
+    t->dec += b.dec;
+    t->dec_scalar += b.dec_scalar;
+    t->enc_fast += b.enc_fast;
+    t->enc_tool += b.enc_tool;
+    t->in_len += b.in_len;
+    t->out_fast += b.out_fast;
+    t->out_tool += b.out_tool;
+}
+
+int main(int argc, char **argv) {
+    int iters = 50;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (strcmp(argv[first], "-h") == 0 || strcmp(argv[first], "--help") == 0) {
+            show_help(stdout, argv[0]);
+            return 0;
+        } else if (strcmp(argv[first], "-n") == 0 && first + 1 < argc) {
+            iters = atoi(argv[++first]);
+        } else {
+            show_help(stderr, argv[0]);
+            return 1;
+        }
+    }
+    if (first >= argc || iters < 1) {
+        show_help(stderr, argv[0]);
+        return 1;
+    }
+
+    fd_png_dec_t dec;
+    fd_png_enc_t enc;
+    fd_png_dec_init(&dec);
+    fd_png_enc_init(&enc);
+    totals_t t;
+    memset(&t, 0, sizeof(t));
+
+    printf("%-32s %9s %7s %8s %8s %8s %8s %7s %7s\n", "icone", "taille", "octets", "dec_us", "dec_sc", "enc_fast",
+           "enc_tool", "o_fast", "o_tool");
+    for (int i = first; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            struct dirent **list = NULL;
+            int n = scandir(argv[i], &list, NULL, alphasort);
+            for (int k = 0; k < n; k++) {
+                if (has_png_ext(list[k]->d_name)) {
+                    char path[4096];
+                    snprintf(path, sizeof(path), "%s/%s", argv[i], list[k]->d_name);
+                    run_one(path, iters, &dec, &enc, &t);
+                }
+                free(list[k]);
+            }
+            free(list);
+        } else {
+            run_one(argv[i], iters, &dec, &enc, &t);
+        }
+    }
+    if (t.files > 0) {
+        printf("%-32s %9s %7zu %8.1f %8.1f %8.1f %8.1f %7zu %7zu\n", "moyenne", "", t.in_len / t.files,
+               t.dec / t.files, t.dec_scalar / t.files, t.enc_fast / t.files, t.enc_tool / t.files,
+               t.out_fast / t.files, t.out_tool / t.files);
+        printf("%d fichiers, décodage+encodage outil: %.1f us/icone\n", t.files, (t.dec + t.enc_tool) / t.files);
+    }
+    fd_png_dec_free(&dec);
+    fd_png_enc_free(&enc);
+    return t.failed ? 1 : 0;
+}
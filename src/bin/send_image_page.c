@@ -11,13 +11,22 @@
 #include <sys/un.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <signal.h>
 #include <time.h>
 #include <limits.h>
 #include <math.h>
 #include <png.h>
 #include <zlib.h>
 #include <pthread.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+#ifdef HAVE_WEBP
+#include <webp/decode.h>
+#endif
+#include "../icons/fd_tiles.h"
 #define SOCK_PATH "/tmp/ulanzi_device.sock"
+#define SENDER_SOCK_PATH "/tmp/goofydeck_image_sender.sock"
 
 // Silence intentional unused warnings for static helpers kept for future refactors.
 #if defined(__GNUC__) || defined(__clang__)
@@ -58,24 +67,211 @@ static int read_png_rgba(const char *path, uint8_t **out, int *w, int *h) {
     return 0;
 }
 
-static int write_png_rgba(const char *path, const uint8_t *data, int w, int h) {
-    FILE *fp=fopen(path,"wb"); if(!fp) return -1;
+// --- JPEG / WebP (décodage réduit) ---
+// Le rendu n'a besoin que de ~1280x720 (référence du layout: tuiles 196 px). On laisse le
+// décodeur réduire lui-même (IDCT 1/2, 1/4, 1/8 pour le JPEG, scaler intégré pour le WebP)
+// tant que l'image décodée reste >= min_w x min_h: une photo 4000x3000 s'arrête à 1/2 et se
+// décode en 2000x1500 (1/4 donnerait 1000x750 < 1280x720) au lieu de 12 Mpx. min_w/min_h = 0: pleine résolution.
+#define DECODE_MIN_W 1280
+#define DECODE_MIN_H 720
+
+struct jpeg_err_jmp {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jmp;
+};
+
+static void jpeg_error_exit_jmp(j_common_ptr cinfo) {
+    struct jpeg_err_jmp *e = (struct jpeg_err_jmp *)cinfo->err;
+    longjmp(e->jmp, 1);
+}
+
+static void jpeg_output_message_quiet(j_common_ptr cinfo) {
+    (void)cinfo;  // avertissements libjpeg (données corrompues) ignorés, l'erreur fatale suffit
+}
+
+static int read_jpeg_rgba(const char *path, int min_w, int min_h, uint8_t **out, int *w, int *h) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_err_jmp jerr;
+    uint8_t *volatile data = NULL;
+    cinfo.err = jpeg_std_error(&jerr.mgr);
+    jerr.mgr.error_exit = jpeg_error_exit_jmp;
+    jerr.mgr.output_message = jpeg_output_message_quiet;
+    if (setjmp(jerr.jmp)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(data);
+        fclose(fp);
+        return -1;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, fp);
+    jpeg_read_header(&cinfo, TRUE);
+
+    // Plus grande réduction DCT qui garde au moins min_w x min_h
+    int denom = 1;
+    if (min_w > 0 && min_h > 0) {
+        while (denom < 8 &&
+               (int)(cinfo.image_width / (unsigned)(denom * 2)) >= min_w &&
+               (int)(cinfo.image_height / (unsigned)(denom * 2)) >= min_h) {
+            denom *= 2;
+        }
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = (unsigned)denom;
+    cinfo.dct_method = JDCT_ISLOW;
+#ifdef JCS_EXTENSIONS
+    int direct_rgba = cinfo.jpeg_color_space != JCS_CMYK && cinfo.jpeg_color_space != JCS_YCCK;
+    cinfo.out_color_space = direct_rgba ? JCS_EXT_RGBA : JCS_RGB;
+#else
+    int direct_rgba = 0;
+    cinfo.out_color_space = JCS_RGB;
+#endif
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
+        cinfo.out_color_space = JCS_CMYK;
+    }
+    jpeg_start_decompress(&cinfo);
+
+    const int width = (int)cinfo.output_width;
+    const int height = (int)cinfo.output_height;
+    const int comps = cinfo.output_components;
+    data = malloc((size_t)width * (size_t)height * 4);
+    JSAMPARRAY tmp = NULL;
+    if (!direct_rgba) {
+        tmp = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, (JDIMENSION)(width * comps), 1);
+    }
+    if (!data) longjmp(jerr.jmp, 1);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        uint8_t *dst = data + (size_t)cinfo.output_scanline * (size_t)width * 4;
+        if (direct_rgba) {
+            JSAMPROW row = dst;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+            continue;
+        }
+        jpeg_read_scanlines(&cinfo, tmp, 1);
+        const uint8_t *s = tmp[0];
+        for (int x = 0; x < width; x++, s += comps, dst += 4) {
+            if (comps == 4) {
+                // CMYK Adobe (inversé): R = C*K/255
+                dst[0] = (uint8_t)((s[0] * s[3] + 127) / 255);
+                dst[1] = (uint8_t)((s[1] * s[3] + 127) / 255);
+                dst[2] = (uint8_t)((s[2] * s[3] + 127) / 255);
+            } else if (comps == 3) {
+                dst[0] = s[0]; dst[1] = s[1]; dst[2] = s[2];
+            } else {
+                dst[0] = dst[1] = dst[2] = s[0];
+            }
+            dst[3] = 0xFF;
+        }
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    fclose(fp);
+    *out = data; *w = width; *h = height;
+    return 0;
+}
+
+#ifdef HAVE_WEBP
+static int read_webp_rgba(const char *path, int min_w, int min_h, uint8_t **out, int *w, int *h) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return -1; }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    int rc = -1;
+    WebPDecoderConfig cfg;
+    if (!WebPInitDecoderConfig(&cfg)) {
+        // ABI libwebp incompatible: cfg n'est pas initialisée, ne pas passer par WebPFreeDecBuffer
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    if (WebPGetFeatures(map, (size_t)st.st_size, &cfg.input) != VP8_STATUS_OK) goto done;
+    int width = cfg.input.width, height = cfg.input.height;
+    if (min_w > 0 && min_h > 0 && width > min_w && height > min_h) {
+        // Réduction uniforme jusqu'au minimum demandé (le scaler WebP travaille pendant le décodage)
+        double s = fmax((double)min_w / width, (double)min_h / height);
+        width = (int)ceil(width * s);
+        height = (int)ceil(height * s);
+        cfg.options.use_scaling = 1;
+        cfg.options.scaled_width = width;
+        cfg.options.scaled_height = height;
+    }
+    uint8_t *data = malloc((size_t)width * (size_t)height * 4);
+    if (!data) goto done;
+    cfg.output.colorspace = MODE_RGBA;
+    cfg.output.is_external_memory = 1;
+    cfg.output.u.RGBA.rgba = data;
+    cfg.output.u.RGBA.stride = width * 4;
+    cfg.output.u.RGBA.size = (size_t)width * (size_t)height * 4;
+    if (WebPDecode(map, (size_t)st.st_size, &cfg) != VP8_STATUS_OK) { free(data); goto done; }
+    *out = data; *w = width; *h = height;
+    rc = 0;
+done:
+    WebPFreeDecBuffer(&cfg.output);
+    munmap(map, (size_t)st.st_size);
+    return rc;
+}
+#endif
+
+// Choix du décodeur selon la signature du fichier (pas l'extension)
+static int read_image_rgba(const char *path, int min_w, int min_h, uint8_t **out, int *w, int *h) {
+    uint8_t sig[12] = {0};
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    size_t n = fread(sig, 1, sizeof(sig), fp);
+    fclose(fp);
+    if (n >= 3 && sig[0] == 0xFF && sig[1] == 0xD8 && sig[2] == 0xFF) {
+        return read_jpeg_rgba(path, min_w, min_h, out, w, h);
+    }
+    if (n >= 12 && memcmp(sig, "RIFF", 4) == 0 && memcmp(sig + 8, "WEBP", 4) == 0) {
+#ifdef HAVE_WEBP
+        return read_webp_rgba(path, min_w, min_h, out, w, h);
+#else
+        fprintf(stderr, "Erreur: support WebP non compilé (libwebp absente)\n");
+        return -1;
+#endif
+    }
+    return read_png_rgba(path, out, w, h);
+}
+
+// Encodeur libpng en mémoire (ancien chemin des tuiles), gardé comme référence pour --bench-png
+typedef struct {
+    uint8_t *data;
+    size_t len, cap;
+} png_mem_t;
+
+static void png_mem_write(png_structp png, png_bytep buf, png_size_t n) {
+    png_mem_t *m = (png_mem_t *)png_get_io_ptr(png);
+    if (m->len + n > m->cap) png_error(png, "overflow");
+    memcpy(m->data + m->len, buf, n);
+    m->len += n;
+}
+
+static void png_mem_flush(png_structp png) { (void)png; }
+
+static int encode_png_libpng(const uint8_t *data, int w, int h, uint8_t *out, size_t cap, size_t *out_len) {
+    png_mem_t m = { out, 0, cap };
     png_structp png=png_create_write_struct(PNG_LIBPNG_VER_STRING,NULL,NULL,NULL);
-    if(!png){fclose(fp);return -1;}
+    if(!png) return -1;
     png_infop info=png_create_info_struct(png);
-    if(!info){png_destroy_write_struct(&png,NULL);fclose(fp);return -1;}
-    if(setjmp(png_jmpbuf(png))){png_destroy_write_struct(&png,&info);fclose(fp);return -1;}
-    png_init_io(png,fp);
+    if(!info){png_destroy_write_struct(&png,NULL);return -1;}
+    png_bytep *rows=malloc(sizeof(png_bytep)*h);
+    if(!rows){png_destroy_write_struct(&png,&info);return -1;}
+    if(setjmp(png_jmpbuf(png))){free(rows);png_destroy_write_struct(&png,&info);return -1;}
+    png_set_write_fn(png, &m, png_mem_write, png_mem_flush);
     png_set_compression_level(png, Z_BEST_SPEED);
     png_set_filter(png, 0, PNG_ALL_FILTERS);
     png_set_IHDR(png,info,w,h,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_BASE,PNG_FILTER_TYPE_BASE);
-    png_bytep *rows=malloc(sizeof(png_bytep)*h); if(!rows){png_destroy_write_struct(&png,&info);fclose(fp);return -1;}
     for(int y=0;y<h;y++) rows[y]=(png_bytep)(data + (size_t)y*w*4);
     png_set_rows(png,info,rows);
     png_write_png(png,info,PNG_TRANSFORM_IDENTITY,NULL);
     free(rows);
     png_destroy_write_struct(&png,&info);
-    fclose(fp);
+    *out_len = m.len;
     return 0;
 }
 
@@ -91,70 +287,7 @@ static uint8_t *crop_rgba(const uint8_t *src, int sw, int sh, int x0, int y0, in
 }
 
 static uint8_t *resize_rgba(const uint8_t *src, int sw, int sh, int dw, int dh) {
-    uint8_t *dst = malloc((size_t)dw*dh*4);
-    if (!dst) return NULL;
-    
-    double sx = (double)sw / dw;
-    double sy = (double)sh / dh;
-    
-    for (int y=0;y<dh;y++) {
-        for (int x=0;x<dw;x++) {
-            double src_x = x * sx;
-            double src_y = y * sy;
-            int x0 = (int)src_x;
-            int y0 = (int)src_y;
-            int x1 = (x0 + 1 < sw) ? x0 + 1 : x0;
-            int y1 = (y0 + 1 < sh) ? y0 + 1 : y0;
-            
-            double fx = src_x - x0;
-            double fy = src_y - y0;
-            
-            for (int c=0;c<4;c++) {
-                uint8_t p00 = src[((size_t)y0*sw + x0)*4 + c];
-                uint8_t p01 = src[((size_t)y0*sw + x1)*4 + c];
-                uint8_t p10 = src[((size_t)y1*sw + x0)*4 + c];
-                uint8_t p11 = src[((size_t)y1*sw + x1)*4 + c];
-                
-                double val = p00*(1-fx)*(1-fy) + p01*fx*(1-fy) + p10*(1-fx)*fy + p11*fx*fy;
-                dst[((size_t)y*dw + x)*4 + c] = (uint8_t)(val + 0.5);
-            }
-        }
-    }
-    return dst;
-}
-
-static uint8_t *ensure_16_9_crop(const uint8_t *src, int sw, int sh, int *out_w, int *out_h) {
-    double aspect = (double)sw / sh;
-    double target_aspect = 16.0 / 9.0;
-    
-    uint8_t *cropped = NULL;
-    int crop_w = sw, crop_h = sh;
-    
-    if (fabs(aspect - target_aspect) < 0.01) {
-        // Already 16:9, just copy
-        uint8_t *copy = malloc((size_t)sw*sh*4);
-        if (copy) memcpy(copy, src, (size_t)sw*sh*4);
-        cropped = copy;
-        crop_w = sw;
-        crop_h = sh;
-    } else if (aspect > target_aspect) {
-        // Too wide, crop sides
-        crop_w = (int)(sh * target_aspect);
-        int crop_x = (sw - crop_w) / 2;
-        cropped = crop_rgba(src, sw, sh, crop_x, 0, crop_w, sh);
-    } else {
-        // Too tall, crop top/bottom
-        crop_h = (int)(sw / target_aspect);
-        int crop_y = (sh - crop_h) / 2;
-        cropped = crop_rgba(src, sw, sh, 0, crop_y, sw, crop_h);
-    }
-    
-    if (cropped) {
-        *out_w = crop_w;
-        *out_h = crop_h;
-    }
-    
-    return cropped;
+    return fd_resample_rgba_alloc(src, sw, sh, dw, dh, FD_FILTER_TRIANGLE, 0);
 }
 
 static FD_UNUSED uint8_t *ensure_16_9_then_resize(const uint8_t *src, int sw, int sh, int *out_w, int *out_h) {
@@ -274,7 +407,7 @@ static void unique_tag(char *out, size_t cap) {
 // Structure for processing options
 typedef struct {
     int optimize_input;  // Optimize input image (dithering before quantization)
-    int dither;         // Enable Floyd-Steinberg dithering
+    int dither;         // FD_DITHER_*: 1 = Floyd-Steinberg (-d), bayer/bluenoise = ordered, per tile
     int compress;         // Enable PNG compression
     int colors;           // Number of colors for quantization (8 or 16)
     int tile_optimize;    // Tile optimization (default: true)
@@ -284,6 +417,12 @@ typedef struct {
     int magnify_percent;   // Magnification percentage (100=normal, 200=2x, default: 100)
     char *keep_folder;     // Folder to copy icons to (-k/--keep-icons, NULL = disabled)
     char *filename_prefix; // Prefix for filenames (NULL = "icon")
+    int kmeans_iters;     // k-means refinement passes after median-cut (0 = off)
+    int bench_quantize;   // Benchmark legacy vs median-cut quantizer and exit
+    int bench_png;        // Benchmark libpng vs fd_png tile encoding and exit
+    int filter;           // Resampling filter (FD_FILTER_*, default: triangle)
+    int gamma;            // Gamma-correct resampling (linear light)
+    int full_decode;      // JPEG/WebP: decode at full resolution (no decode-time downscaling)
 } process_options_t;
 
 // Function declarations
@@ -292,99 +431,6 @@ static void optimize_input_image(uint8_t *img, int w, int h);
 static void apply_dithering(uint8_t *img, int w, int h);
 static int write_png_8bit(const char *path, const uint8_t *data, int w, int h);
 
-// Function to copy generated icons to a folder
-static void copy_icons_to_folder(const uint8_t *tiles[14], const int tile_w[14], const int tile_h[14], const char *folder, const char *filename_prefix) {
-    if (!folder) return;
-    
-    // Créer le dossier s'il n'existe pas
-    char mkdir_cmd[PATH_MAX];
-    snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p \"%s\"", folder);
-    system(mkdir_cmd);
-    
-    // Déterminer le préfixe de nom de fichier
-    const char *prefix = filename_prefix ? filename_prefix : "icon";
-    
-    // Copy each icon
-    for (int i = 0; i < 14; i++) {
-        char filename[PATH_MAX];
-        snprintf(filename, sizeof(filename), "%s/%s-%d.png", folder, prefix, i + 1);
-        write_png_rgba(filename, tiles[i], tile_w[i], tile_h[i]);
-    }
-}
-
-// Structure for parallel PNG writing tasks (file mode)
-typedef struct {
-    const uint8_t *rgba_data;
-    int w, h;
-    char filepath[PATH_MAX];
-    int tile_id;
-    int status; // 0 = pending, 1 = completed, -1 = error
-} png_write_task_t;
-
-// Structure for PNG writing thread pool
-typedef struct {
-    png_write_task_t *tasks;
-    int task_count;
-    int next_task;
-    int completed_tasks;
-    int total_tasks;
-    pthread_t *threads;
-    int thread_count;
-    pthread_mutex_t work_mutex;
-    pthread_cond_t work_cond;
-    pthread_cond_t done_cond;
-    int shutdown;
-} png_write_pool_t;
-
-// Function to resize an icon
-static uint8_t* resize_icon(const uint8_t *src, int src_w, int src_h, int dst_w, int dst_h) {
-    if (src_w == dst_w && src_h == dst_h) {
-        uint8_t *copy = malloc((size_t)dst_w * dst_h * 4);
-        if (copy) memcpy(copy, src, (size_t)dst_w * dst_h * 4);
-        return copy;
-    }
-    
-    uint8_t *dst = malloc((size_t)dst_w * dst_h * 4);
-    if (!dst) return NULL;
-    
-    // Simple bilinear resizing
-    for (int y = 0; y < dst_h; y++) {
-        for (int x = 0; x < dst_w; x++) {
-            float src_x = (float)x * src_w / dst_w;
-            float src_y = (float)y * src_h / dst_h;
-            
-            int x0 = (int)src_x;
-            int y0 = (int)src_y;
-            int x1 = x0 + 1;
-            int y1 = y0 + 1;
-            
-            if (x1 >= src_w) x1 = src_w - 1;
-            if (y1 >= src_h) y1 = src_h - 1;
-            
-            float fx = src_x - x0;
-            float fy = src_y - y0;
-            
-            for (int c = 0; c < 4; c++) {
-                uint8_t p00 = src[(y0 * src_w + x0) * 4 + c];
-                uint8_t p01 = src[(y0 * src_w + x1) * 4 + c];
-                uint8_t p10 = src[(y1 * src_w + x0) * 4 + c];
-                uint8_t p11 = src[(y1 * src_w + x1) * 4 + c];
-                
-                uint8_t val = (uint8_t)(
-                    p00 * (1 - fx) * (1 - fy) +
-                    p01 * fx * (1 - fy) +
-                    p10 * (1 - fx) * fy +
-                    p11 * fx * fy
-                );
-                
-                dst[(y * dst_w + x) * 4 + c] = val;
-            }
-        }
-    }
-    
-    return dst;
-}
-
 // PNG writing in 8-bit format with 256 color palette
 static FD_UNUSED int write_png_8bit(const char *path, const uint8_t *data, int w, int h) {
     FILE *fp = fopen(path, "wb"); 
@@ -476,169 +522,23 @@ static FD_UNUSED int write_png_8bit(const char *path, const uint8_t *data, int w
     return 0;
 }
 
-// Fonction worker pour l'écriture PNG
-static void* png_write_worker_thread(void *arg) {
-    png_write_pool_t *pool = (png_write_pool_t*)arg;
-    
-    while (!pool->shutdown) {
-        pthread_mutex_lock(&pool->work_mutex);
-        
-        // Attendre une tâche
-        while (pool->next_task >= pool->total_tasks && !pool->shutdown) {
-            pthread_cond_wait(&pool->work_cond, &pool->work_mutex);
-        }
-        
-        if (pool->shutdown) {
-            pthread_mutex_unlock(&pool->work_mutex);
-            break;
-        }
-        
-        // Prendre une tâche
-        int task_id = pool->next_task++;
-        pthread_mutex_unlock(&pool->work_mutex);
-        
-        // Exécuter l'écriture PNG (utiliser write_png_rgba comme le mode fichiers original)
-        png_write_task_t *task = &pool->tasks[task_id];
-        task->status = write_png_rgba(task->filepath, task->rgba_data, task->w, task->h);
-        
-        // Signaler la completion
-        pthread_mutex_lock(&pool->work_mutex);
-        pool->completed_tasks++;
-        if (pool->completed_tasks == pool->total_tasks) {
-            pthread_cond_signal(&pool->done_cond);
-        }
-        pthread_mutex_unlock(&pool->work_mutex);
-    }
-    
-    return NULL;
-}
-
-// Initialiser le thread pool d'écriture PNG
-static int png_write_pool_init(png_write_pool_t *pool, int thread_count) {
-    pool->tasks = NULL;
-    pool->task_count = 0;
-    pool->next_task = 0;
-    pool->completed_tasks = 0;
-    pool->total_tasks = 0;
-    pool->thread_count = thread_count;
-    pool->shutdown = 0;
-    
-    pool->threads = malloc(sizeof(pthread_t) * thread_count);
-    if (!pool->threads) return -1;
-    
-    if (pthread_mutex_init(&pool->work_mutex, NULL) != 0) {
-        free(pool->threads);
-        return -1;
-    }
-    
-    if (pthread_cond_init(&pool->work_cond, NULL) != 0) {
-        pthread_mutex_destroy(&pool->work_mutex);
-        free(pool->threads);
-        return -1;
-    }
-    
-    if (pthread_cond_init(&pool->done_cond, NULL) != 0) {
-        pthread_cond_destroy(&pool->work_cond);
-        pthread_mutex_destroy(&pool->work_mutex);
-        free(pool->threads);
-        return -1;
-    }
-    
-    // Créer les threads
-    for (int i = 0; i < thread_count; i++) {
-        if (pthread_create(&pool->threads[i], NULL, png_write_worker_thread, pool) != 0) {
-            pool->shutdown = 1;
-            pthread_cond_broadcast(&pool->work_cond);
-            for (int j = 0; j < i; j++) {
-                pthread_join(pool->threads[j], NULL);
-            }
-            pthread_cond_destroy(&pool->done_cond);
-            pthread_cond_destroy(&pool->work_cond);
-            pthread_mutex_destroy(&pool->work_mutex);
-            free(pool->threads);
-            return -1;
-        }
-    }
-    
-    return 0;
-}
-
-// Exécuter les tâches d'écriture en parallèle
-static int png_write_pool_execute(png_write_pool_t *pool, png_write_task_t *tasks, int task_count) {
-    pool->tasks = tasks;
-    pool->task_count = task_count;
-    pool->next_task = 0;
-    pool->completed_tasks = 0;
-    pool->total_tasks = task_count;
-    
-    // Réveiller les threads
-    pthread_mutex_lock(&pool->work_mutex);
-    pthread_cond_broadcast(&pool->work_cond);
-    pthread_mutex_unlock(&pool->work_mutex);
-    
-    // Attendre la completion
-    pthread_mutex_lock(&pool->work_mutex);
-    while (pool->completed_tasks < task_count) {
-        pthread_cond_wait(&pool->done_cond, &pool->work_mutex);
-    }
-    pthread_mutex_unlock(&pool->work_mutex);
-    
-    return 0;
-}
+// --- Moteur de tuiles: voir src/icons/fd_tiles.h (crop + resize + quantization + PNG fusionnés,
+// pool de threads et arenas persistants, partagé avec send_video_page_wrapper) ---
 
-// Détruire le thread pool d'écriture PNG
-static void png_write_pool_destroy(png_write_pool_t *pool) {
-    pool->shutdown = 1;
-    pthread_cond_broadcast(&pool->work_cond);
-    
-    for (int i = 0; i < pool->thread_count; i++) {
-        pthread_join(pool->threads[i], NULL);
-    }
-    
-    pthread_cond_destroy(&pool->done_cond);
-    pthread_cond_destroy(&pool->work_cond);
-    pthread_mutex_destroy(&pool->work_mutex);
-    free(pool->threads);
+static void tiles_params_from_options(const process_options_t *opts, fd_tiles_params_t *p) {
+    fd_tiles_params_default(p);
+    p->quantize = opts->tile_optimize;
+    p->colors = opts->colors;
+    p->kmeans_iters = opts->kmeans_iters;
+    p->filter = opts->filter;
+    p->rs_flags = opts->gamma ? FD_RS_GAMMA : 0;
+    p->dither = opts->dither;
+    p->png_effort = opts->compress ? FD_PNG_SMALL : FD_PNG_FAST;
 }
 
-// Fonction de dithering Floyd-Steinberg pour réduire les bandes de couleurs
+// Dithering Floyd-Steinberg sur la grille 6x6x6 (src/icons/fd_dither.h)
 static void apply_dithering(uint8_t *img, int w, int h) {
-    // Matrice de Floyd-Steinberg pour répartir l'erreur de quantification
-    // Les coefficients sont: 7/16 droite, 3/16 bas-gauche, 5/16 bas, 1/16 bas-droite
-    const int step = 255 / 5; // Pour quantification 6x6x6
-    
-    for (int y = 0; y < h; y++) {
-        for (int x = 0; x < w; x++) {
-            uint8_t *pixel = img + (y * w + x) * 4;
-            
-            // Pour chaque canal RGB
-            for (int c = 0; c < 3; c++) {
-                int old_val = pixel[c];
-                // Quantifier selon la grille 6x6x6 (pas noir/blanc !)
-                int new_val = (old_val / step) * step;
-                int error = old_val - new_val;
-                pixel[c] = new_val;
-                
-                // Propager l'erreur aux pixels voisins
-                if (x + 1 < w) {
-                    uint8_t *right = img + (y * w + (x + 1)) * 4;
-                    right[c] = (uint8_t)fmax(0, fmin(255, right[c] + error * 7 / 16));
-                }
-                if (y + 1 < h) {
-                    if (x > 0) {
-                        uint8_t *bottom_left = img + ((y + 1) * w + (x - 1)) * 4;
-                        bottom_left[c] = (uint8_t)fmax(0, fmin(255, bottom_left[c] + error * 3 / 16));
-                    }
-                    uint8_t *bottom = img + ((y + 1) * w + x) * 4;
-                    bottom[c] = (uint8_t)fmax(0, fmin(255, bottom[c] + error * 5 / 16));
-                    if (x + 1 < w) {
-                        uint8_t *bottom_right = img + ((y + 1) * w + (x + 1)) * 4;
-                        bottom_right[c] = (uint8_t)fmax(0, fmin(255, bottom_right[c] + error / 16));
-                    }
-                }
-            }
-        }
-    }
+    fd_dither_fs_rgba(img, w, h, (size_t)w * 4, 6);
 }
 
 // Optimisation de l'image input: juste conversion en PNG-8
@@ -648,27 +548,13 @@ static void optimize_input_image(uint8_t *img, int w, int h) {
     quantize_to_256_colors(img, w, h);
 }
 
-// Quantification à 256 couleurs (palette 6x6x6)
+// Quantification à 256 couleurs (palette 6x6x6, pas de détection de gris)
 static void quantize_to_256_colors(uint8_t *img, int w, int h) {
-    // Palette 6x6x6 = 216 couleurs (pas de détection de gris)
-    const int levels = 6;
-    const int step = 255 / (levels - 1);
-    
-    for (int i = 0; i < w * h; i++) {
-        uint8_t *p = img + i * 4;
-        uint8_t r = p[0], g = p[1], b = p[2];
-        
-        // TOUTES les couleurs passent par la grille 6x6x6
-        // Pas de détection de gris pour éviter les problèmes
-        p[0] = (r / step) * step;  // Rouge : 0-5
-        p[1] = (g / step) * step;  // Vert : 0-5  
-        p[2] = (b / step) * step;  // Bleu : 0-5
-        // Alpha reste inchangé
-    }
+    fd_dither_posterize_rgba(img, w, h, (size_t)w * 4, 6);
 }
 
-// Version modifiée de quantize8 pour supporter différents nombres de couleurs
-static void quantize_colors(uint8_t *img, int w, int h, int colors) {
+// Ancien quantizer (top-K des buckets + recherche brute force), gardé pour --bench-quantize
+static void quantize_colors_legacy(uint8_t *img, int w, int h, int colors) {
     const int buckets = 32768; // 5 bits per channel
     uint32_t *count = calloc(buckets, sizeof(uint32_t));
     uint64_t *sr = calloc(buckets, sizeof(uint64_t));
@@ -761,6 +647,108 @@ static void quantize_colors(uint8_t *img, int w, int h, int colors) {
     free(count); free(sr); free(sg); free(sb); free(count_copy);
 }
 
+// Quantization des tuiles: median-cut + colormap inverse (voir src/icons/fd_quant.h)
+static void quantize_colors(fd_quant_t *q, uint8_t *img, int w, int h, int colors, int kmeans_iters) {
+    fd_quant_rgba(q, img, w, h, colors, kmeans_iters);
+}
+
+static double bench_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+// Compare l'ancien quantizer et le nouveau sur les 14 tuiles de la page (temps + PSNR)
+static int bench_quantize(const uint8_t *src, int sw, int sh, const int x[5], const int y[3], int btn, int gap,
+                          int kmeans_iters) {
+    const int reps = 5;
+    const int color_set[4] = {8, 16, 32, 64};
+    fd_quant_t q;
+    if (fd_quant_init(&q) != 0) return -1;
+
+    uint8_t *orig[14];
+    int tw[14], th[14];
+    for (int i = 0; i < 14; i++) {
+        int r2 = (i < 10) ? i / 5 : 2;
+        int c = (i < 10) ? i % 5 : (i - 10);
+        tw[i] = (i < 13) ? btn : btn + gap + btn;
+        th[i] = btn;
+        orig[i] = (i < 13) ? crop_rgba(src, sw, sh, x[c], y[r2], btn, btn)
+                           : crop_rgba(src, sw, sh, x[3], y[2], tw[i], btn);
+    }
+    uint8_t *work = malloc((size_t)(btn + gap + btn) * (size_t)btn * 4);
+    if (!work) { fd_quant_free(&q); for (int i = 0; i < 14; i++) free(orig[i]); return -1; }
+
+    printf("quantize bench: 14 tiles, btn=%d, reps=%d, kmeans=%d, simd=%d\n", btn, reps, kmeans_iters, FD_QUANT_SIMD);
+    for (int ci = 0; ci < 4; ci++) {
+        int colors = color_set[ci];
+        double t_old = 0, t_new = 0, p_old = 0, p_new = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < 14; i++) {
+                size_t bytes = (size_t)tw[i] * (size_t)th[i] * 4;
+                double t = 0;
+                for (int r = 0; r < reps; r++) {
+                    memcpy(work, orig[i], bytes);
+                    double t0 = bench_now_ms();
+                    if (pass == 0) quantize_colors_legacy(work, tw[i], th[i], colors);
+                    else quantize_colors(&q, work, tw[i], th[i], colors, kmeans_iters);
+                    t += bench_now_ms() - t0;
+                }
+                double psnr = fd_quant_psnr(orig[i], work, tw[i], th[i]);
+                if (pass == 0) { t_old += t / reps; p_old += psnr / 14.0; }
+                else { t_new += t / reps; p_new += psnr / 14.0; }
+            }
+        }
+        printf("  colors=%2d  legacy: %8.3f ms/page  %6.2f dB   median-cut: %8.3f ms/page  %6.2f dB  (x%.1f)\n",
+               colors, t_old, p_old, t_new, p_new, t_new > 0 ? t_old / t_new : 0.0);
+    }
+
+    free(work);
+    for (int i = 0; i < 14; i++) free(orig[i]);
+    fd_quant_free(&q);
+    return 0;
+}
+
+// Compare libpng (ancien chemin: RGBA, Z_BEST_SPEED, tous filtres) et fd_png sur les 14 tuiles
+// déjà rendues par le moteur: octets envoyés, paquets HID de 1024 octets, temps d'encodage.
+static int bench_png(const fd_tiles_t *e) {
+    const int reps = 20;
+    size_t cap = 0;
+    for (int i = 0; i < 14; i++) if (e->tiles[i].png_cap > cap) cap = e->tiles[i].png_cap;
+    uint8_t *buf = malloc(cap);
+    if (!buf) return -1;
+    fd_png_enc_t enc;
+    fd_png_enc_init(&enc);
+
+    const char *names[3] = { "libpng", "fd_png fast", "fd_png small (-z)" };
+    printf("png bench: 14 tiles %dx%d (+1 x %dx%d), reps=%d\n", e->tiles[0].dw, e->tiles[0].dh,
+           e->tiles[13].dw, e->tiles[13].dh, reps);
+    int rc = 0;
+    for (int m = 0; m < 3 && rc == 0; m++) {
+        size_t bytes = 0, packets = 0;
+        double t = 0;
+        for (int i = 0; i < 14 && rc == 0; i++) {
+            const fd_tile_t *j = &e->tiles[i];
+            size_t len = 0;
+            double t0 = bench_now_ms();
+            for (int r = 0; r < reps && rc == 0; r++) {
+                if (m == 0) rc = encode_png_libpng(j->out, j->dw, j->dh, buf, cap, &len);
+                else rc = fd_png_encode_rgba(&enc, j->out, j->dw, j->dh, (size_t)j->dw * 4,
+                                             m == 1 ? FD_PNG_FAST : FD_PNG_SMALL, buf, cap, &len);
+            }
+            t += (bench_now_ms() - t0) / reps;
+            bytes += len;
+            packets += (len + 1023) / 1024;
+        }
+        if (rc == 0) {
+            printf("  %-18s %8zu bytes  %4zu packets  %7.3f ms/page\n", names[m], bytes, packets, t);
+        }
+    }
+    fd_png_enc_free(&enc);
+    free(buf);
+    return rc;
+}
+
 // Version modifiée de write_png_rgba avec support de compression
 static FD_UNUSED int write_png_rgba_compressed(const char *path, const uint8_t *data, int w, int h, int compress_level) {
     FILE *fp = fopen(path, "wb"); 
@@ -815,20 +803,31 @@ static FD_UNUSED int write_png_rgba_compressed(const char *path, const uint8_t *
 
 // Fonction pour afficher l'aide
 static void show_help(const char *prog_name) {
-    printf("Usage: %s [OPTIONS] <image.png>\n", prog_name);
+    printf("Usage: %s [OPTIONS] <image.png|.jpg|.webp>\n", prog_name);
     printf("\nOptions:\n");
     printf("  -o, --optimize-input    Optimiser l'image input (contraste, netteté)\n");
     printf("  -d, --dither          Appliquer dithering Floyd-Steinberg\n");
-    printf("  -z, --compress        Activer compression PNG\n");
+    printf("  --dither=MODE         none, fs, bayer ou bluenoise (ordonné: par tuile, parallèle, stable en vidéo)\n");
+    printf("  -z, --compress        Compression PNG maximale (deflate niveau 9, plus lent)\n");
     printf("  -c, --colors=N        Nombre de couleurs (8, 16, 32 ou 64, défaut: 8)\n");
     printf("  -q, --quality=PCT    Qualité des icônes en pourcentage (10-100, défaut: 100)\n");
     printf("  -m, --magnify=PCT   Magnification des icônes en pourcentage (50-300, défaut: 100)\n");
     printf("  -k, --keep-icons=F[=P]   Copier les icônes générées dans le dossier F [avec préfixe P]\n");
     printf("  --no-tile-optimize    Désactiver optimisation des tuiles\n");
+    printf("  --filter=F            Filtre de redimensionnement: box, triangle, lanczos (défaut: triangle)\n");
+    printf("  --gamma               Redimensionner en lumière linéaire (sRGB)\n");
+    printf("  --full-decode         JPEG/WebP: décoder en pleine résolution (défaut: réduit au décodage, >= %dx%d)\n",
+           DECODE_MIN_W, DECODE_MIN_H);
+    printf("  --kmeans=N            Passes k-means après le median-cut (0-16, défaut: 0)\n");
+    printf("  --bench-quantize      Comparer ancien/nouveau quantizer sur les tuiles (temps, PSNR) puis quitter\n");
+    printf("  --bench-png           Comparer libpng et fd_png sur les tuiles (octets, paquets HID, temps) puis quitter\n");
     printf("  --no-send              Ne pas envoyer au démon (render uniquement)\n");
+    printf("  --serve[=SOCK]        Mode service: jobs reçus sur un socket Unix (défaut: %s)\n", SENDER_SOCK_PATH);
+    printf("                        commandes: ping | render [options] <image> | render-rgba W H [options] (+memfd) | quit\n");
     printf("  -h, --help            Afficher cette aide\n");
     printf("\nExemples:\n");
     printf("  %s image.png                           # Comportement par défaut\n", prog_name);
+    printf("  %s photo.jpg                           # JPEG réduit au décodage (IDCT 1/2..1/8)\n", prog_name);
     printf("  %s -q=50 image.png                    # Icônes à 50%% de la taille\n", prog_name);
     printf("  %s -m=150 image.png                   # Icônes 1.5x plus grandes\n", prog_name);
     printf("  %s -z -c=16 image.png                  # Compression + 16 couleurs\n", prog_name);
@@ -840,127 +839,518 @@ static void show_help(const char *prog_name) {
     printf("  %s --optimize-input --dither --compress --colors=32 image.png\n", prog_name);
 }
 
-// Fonction pour copier les icônes depuis des fichiers temporaires déjà redimensionnés
-static void copy_icons_from_files(const png_write_task_t *write_tasks, int count, const char *folder, const char *filename_prefix) {
+// Créer un dossier et ses parents (équivalent mkdir -p, sans passer par un shell)
+static int mkdir_p(const char *path) {
+    char tmp[PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s", path);
+    if (n <= 0 || (size_t)n >= sizeof(tmp)) return -1;
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+// Écrit un buffer en un seul write() (fichiers de tuiles sur tmpfs)
+static int write_file(const char *path, const uint8_t *data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int rc = 0;
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -1;
+            break;
+        }
+        off += (size_t)n;
+    }
+    if (close(fd) != 0) rc = -1;
+    return rc;
+}
+
+// Écrire les icônes (PNG déjà encodés en mémoire) dans le dossier -k
+static void save_icons_to_folder(const fd_tiles_t *e, const char *folder, const char *filename_prefix) {
     if (!folder) return;
     
     // Créer le dossier s'il n'existe pas
-    char mkdir_cmd[PATH_MAX];
-    snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p \"%s\"", folder);
-    system(mkdir_cmd);
+    if (mkdir_p(folder) != 0) {
+        fprintf(stderr, "Erreur: impossible de créer %s: %s\n", folder, strerror(errno));
+        return;
+    }
     
     // Déterminer le préfixe de nom de fichier
     const char *prefix = filename_prefix ? filename_prefix : "icon";
     
-    // Copier chaque fichier temporaire vers le dossier de destination
-    for (int i = 0; i < count; i++) {
-        if (write_tasks[i].status != 0) continue;
+    for (int i = 0; i < 14; i++) {
+        const fd_tile_t *j = &e->tiles[i];
+        if (j->png_status != 0) continue;
         
         char dst_filename[PATH_MAX];
         snprintf(dst_filename, sizeof(dst_filename), "%s/%s-%d.png", folder, prefix, i + 1);
-        
-        // Copier le fichier temporaire vers la destination
-        char cp_cmd[PATH_MAX * 2];
-        snprintf(cp_cmd, sizeof(cp_cmd), "cp \"%s\" \"%s\"", write_tasks[i].filepath, dst_filename);
-        system(cp_cmd);
+        if (write_file(dst_filename, j->png, j->png_len) != 0) {
+            fprintf(stderr, "Erreur: écriture de %s a échoué\n", dst_filename);
+        }
     }
 }
 
+static void default_options(process_options_t *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->colors = 8;            // Défaut: 8 couleurs
+    opts->tile_optimize = 1;     // Défaut: optimisation tuiles activée
+    opts->quality_percent = 100; // Défaut: pas de redimensionnement
+    opts->magnify_percent = 100; // Défaut: pas de magnification
+    opts->filter = FD_FILTER_TRIANGLE;
+}
+
+static void free_options(process_options_t *opts) {
+    free(opts->keep_folder);
+    free(opts->filename_prefix);
+    opts->keep_folder = NULL;
+    opts->filename_prefix = NULL;
+}
+
+static void set_keep_folder(process_options_t *opts, const char *arg) {
+    // Format: folder ou folder=prefix
+    free_options(opts);
+    const char *equals = strchr(arg, '=');
+    if (equals) {
+        opts->keep_folder = strndup(arg, (size_t)(equals - arg));
+        opts->filename_prefix = strdup(equals + 1);
+    } else {
+        opts->keep_folder = strdup(arg);
+        opts->filename_prefix = NULL;  // Utilisera "icon" par défaut
+    }
+}
+
+// Options de rendu communes à la ligne de commande et aux jobs du mode service.
+// Retourne 1 si l'option est reconnue, 0 sinon, -1 si la valeur est invalide (err rempli).
+static int parse_option(process_options_t *opts, const char *arg, char *err, size_t err_cap) {
+    if (strcmp(arg, "--no-send") == 0) {
+        opts->no_send = 1;
+    } else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--optimize-input") == 0) {
+        opts->optimize_input = 1;
+    } else if (strcmp(arg, "-d") == 0 || strcmp(arg, "--dither") == 0) {
+        opts->dither = FD_DITHER_FS;
+    } else if (strncmp(arg, "--dither=", 9) == 0) {
+        opts->dither = fd_dither_from_name(arg + 9);
+        if (opts->dither < 0) {
+            snprintf(err, err_cap, "dithering inconnu (none, fs, bayer ou bluenoise)");
+            return -1;
+        }
+    } else if (strcmp(arg, "-z") == 0 || strcmp(arg, "--compress") == 0) {
+        opts->compress = 1;
+    } else if (strncmp(arg, "-c=", 3) == 0 || strncmp(arg, "--colors=", 9) == 0) {
+        opts->colors = atoi(strchr(arg, '=') + 1);
+        if (opts->colors != 8 && opts->colors != 16 && opts->colors != 32 && opts->colors != 64) {
+            snprintf(err, err_cap, "nombre de couleurs doit être 8, 16, 32 ou 64");
+            return -1;
+        }
+    } else if (strcmp(arg, "--no-tile-optimize") == 0) {
+        opts->tile_optimize = 0;
+    } else if (strncmp(arg, "--kmeans=", 9) == 0) {
+        opts->kmeans_iters = atoi(arg + 9);
+        if (opts->kmeans_iters < 0 || opts->kmeans_iters > 16) {
+            snprintf(err, err_cap, "--kmeans doit être entre 0 et 16");
+            return -1;
+        }
+    } else if (strncmp(arg, "-q=", 3) == 0 || strncmp(arg, "--quality=", 10) == 0) {
+        opts->quality_percent = atoi(strchr(arg, '=') + 1);
+        if (opts->quality_percent < 10 || opts->quality_percent > 100) {
+            snprintf(err, err_cap, "pourcentage de qualité doit être entre 10 et 100");
+            return -1;
+        }
+    } else if (strncmp(arg, "-m=", 3) == 0 || strncmp(arg, "--magnify=", 10) == 0) {
+        opts->magnify_percent = atoi(strchr(arg, '=') + 1);
+        if (opts->magnify_percent < 50 || opts->magnify_percent > 300) {
+            snprintf(err, err_cap, "pourcentage de magnification doit être entre 50 et 300");
+            return -1;
+        }
+    } else if (strncmp(arg, "--filter=", 9) == 0) {
+        opts->filter = fd_filter_from_name(arg + 9);
+        if (opts->filter < 0) {
+            snprintf(err, err_cap, "filtre inconnu (box, triangle ou lanczos)");
+            return -1;
+        }
+    } else if (strcmp(arg, "--gamma") == 0) {
+        opts->gamma = 1;
+    } else if (strcmp(arg, "--full-decode") == 0) {
+        opts->full_decode = 1;
+    } else if (strncmp(arg, "-k=", 3) == 0) {
+        set_keep_folder(opts, arg + 3);
+    } else if (strncmp(arg, "--keep-icons=", 13) == 0) {
+        set_keep_folder(opts, arg + 13);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Géométrie de la page (14 boutons: 5x3 + 1 bouton large en bas), voir fd_page_layout()
+static void compute_layout(int sw, int sh, const process_options_t *opts, fd_page_layout_t *L) {
+    fd_page_layout(sw, sh, opts->magnify_percent, opts->quality_percent, L);
+}
+
+// Durées par étape (ms)
+typedef struct {
+    double read_ms;
+    double prep_ms;
+    double tiles_ms;
+    double write_ms;
+    double send_ms;
+    double total_ms;
+} stage_times_t;
+
+// État gardé entre les images: pools de threads, arena des tuiles, dossier de travail.
+typedef struct {
+    fd_tiles_t engine;
+    char workdir[PATH_MAX];   // sous /dev/shm, réutilisé d'un job à l'autre
+    uint8_t *prep;            // copie de travail (16:9) quand dither/optimize modifient l'image
+    size_t prep_cap;
+    unsigned long seq;
+} sender_ctx_t;
+
+static int sender_ctx_init(sender_ctx_t *ctx, const char *workdir) {
+    memset(ctx, 0, sizeof(*ctx));
+    snprintf(ctx->workdir, sizeof(ctx->workdir), "%s", workdir);
+    if (fd_tiles_init(&ctx->engine, fd_tiles_online_cpus()) != 0) return -1;
+    return 0;
+}
+
+static void sender_ctx_destroy(sender_ctx_t *ctx) {
+    fd_tiles_destroy(&ctx->engine);
+    free(ctx->prep);
+    ctx->prep = NULL;
+    ctx->prep_cap = 0;
+}
+
+// Traite une image RGBA (stride en octets): crop 16:9, tuiles, PNG, envoi au démon.
+// L'image source n'est jamais modifiée.
+static int process_image(sender_ctx_t *ctx, const process_options_t *opts,
+                         const uint8_t *src, int sw, int sh, size_t stride,
+                         stage_times_t *t, char *err, size_t err_cap) {
+    double t0 = bench_now_ms();
+    int cx, cy, cw, ch;
+    fd_page_crop_16_9(sw, sh, &cx, &cy, &cw, &ch);
+    const uint8_t *base = src + (size_t)cy * stride + (size_t)cx * 4;
+    size_t base_stride = stride;
+
+    // Dithering / optimisation input travaillent en place: copie de travail réutilisée
+    if (opts->dither == FD_DITHER_FS || opts->optimize_input) {
+        size_t need = (size_t)cw * (size_t)ch * 4;
+        if (need > ctx->prep_cap) {
+            uint8_t *p = realloc(ctx->prep, need);
+            if (!p) { snprintf(err, err_cap, "out_of_memory"); return -1; }
+            ctx->prep = p;
+            ctx->prep_cap = need;
+        }
+        for (int row = 0; row < ch; row++) {
+            memcpy(ctx->prep + (size_t)row * cw * 4, base + (size_t)row * stride, (size_t)cw * 4);
+        }
+        if (opts->dither == FD_DITHER_FS) apply_dithering(ctx->prep, cw, ch);
+        if (opts->optimize_input) optimize_input_image(ctx->prep, cw, ch);
+        base = ctx->prep;
+        base_stride = (size_t)cw * 4;
+    }
+    double t1 = bench_now_ms();
+
+    fd_page_layout_t L;
+    compute_layout(cw, ch, opts, &L);
+    if (fd_tiles_layout(&ctx->engine, &L) != 0) {
+        snprintf(err, err_cap, "out_of_memory");
+        return -1;
+    }
+    fd_tiles_params_t params;
+    tiles_params_from_options(opts, &params);
+    fd_tiles_run(&ctx->engine, base, cw, ch, base_stride, &params);
+    double t2 = bench_now_ms();
+
+    char tag[32];
+    unique_tag(tag, sizeof(tag));
+    ctx->seq++;
+    char paths[14][PATH_MAX];
+    int ok[14];
+    for (int i = 0; i < 14; i++) {
+        const fd_tile_t *j = &ctx->engine.tiles[i];
+        int n = snprintf(paths[i], sizeof(paths[i]), "%s/b%d_%s_%lu.png", ctx->workdir, i + 1, tag, ctx->seq);
+        if (n < 0 || (size_t)n >= sizeof(paths[i])) {
+            snprintf(err, err_cap, "path_too_long");
+            return -1;
+        }
+        ok[i] = j->png_status == 0 && write_file(paths[i], j->png, j->png_len) == 0;
+    }
+    
+    // Écrire les icônes dans le dossier spécifié si demandé
+    save_icons_to_folder(&ctx->engine, opts->keep_folder, opts->filename_prefix);
+    double t3 = bench_now_ms();
+    
+    // Préparer la commande pour le daemon
+    int rc = 0;
+    if (!opts->no_send) {
+        char sendline[8192];
+        size_t len = 0;
+        strcpy(sendline, "set-buttons-explicit-14");
+        len = strlen(sendline);
+        for (int i = 0; i < 14; i++) {
+            if (!ok[i]) {
+                fprintf(stderr, "Erreur: écriture tuile %d a échoué\n", i + 1);
+                continue;
+            }
+            int m = snprintf(sendline + len, sizeof(sendline) - len, " --button-%d=%s", i + 1, paths[i]);
+            if (m < 0 || (size_t)m >= sizeof(sendline) - len) { 
+                fprintf(stderr, "Erreur: commande trop longue\n"); 
+                break; 
+            }
+            len += (size_t)m;
+        }
+        if (send_cmd(sendline) != 0) {
+            snprintf(err, err_cap, "send_failed");
+            rc = -1;
+        }
+    }
+    double t4 = bench_now_ms();
+
+    // Le démon a lu les fichiers avant de répondre: on peut les supprimer
+    for (int i = 0; i < 14; i++) if (ok[i]) unlink(paths[i]);
+
+    if (t) {
+        t->prep_ms = t1 - t0;
+        t->tiles_ms = t2 - t1;
+        t->write_ms = t3 - t2;
+        t->send_ms = t4 - t3;
+    }
+    return rc;
+}
+
+// --- Mode service ---
+// Un client par connexion, une commande par ligne:
+//   ping
+//   render [options] <image.png>
+//   render-rgba <W> <H> [options]      (+ memfd de W*H*4 octets RGBA passé en SCM_RIGHTS)
+//   quit
+// Réponse: "ok read=.. prep=.. tiles=.. write=.. send=.. total=.." (ms) ou "err <raison>".
+// Les options du job partent des options données au lancement du service.
+// Les clients sont servis un par un: une ligne qui n'arrive pas complète en SERVE_RECV_TIMEOUT_MS
+// fait abandonner la connexion (un client muet ne bloque pas les autres).
+#define SERVE_RECV_TIMEOUT_MS 2000
+
+static volatile sig_atomic_t g_serve_stop = 0;
+
+static void serve_signal_handler(int sig) {
+    (void)sig;
+    g_serve_stop = 1;
+}
+
+static ssize_t recv_line_fd(int cfd, char *line, size_t cap, int *out_fd) {
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { .iov_base = line, .iov_len = cap - 1 };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    *out_fd = -1;
+    ssize_t n = recvmsg(cfd, &msg, 0);
+    if (n <= 0) return n;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+            memcpy(out_fd, CMSG_DATA(c), sizeof(int));
+        }
+    }
+    // Compléter la ligne si elle arrive en plusieurs morceaux
+    size_t len = (size_t)n;
+    while (len < cap - 1 && !memchr(line, '\n', len)) {
+        ssize_t m = read(cfd, line + len, cap - 1 - len);
+        if (m < 0) return -1;   // délai dépassé (SO_RCVTIMEO) ou erreur: ligne incomplète
+        if (m == 0) break;
+        len += (size_t)m;
+    }
+    line[len] = '\0';
+    char *nl = strpbrk(line, "\r\n");
+    if (nl) *nl = '\0';
+    return (ssize_t)len;
+}
+
+static void serve_job(sender_ctx_t *ctx, const process_options_t *defaults, int cfd, char *line, int job_fd) {
+    char err[128] = "bad_command";
+    char reply[256];
+    process_options_t opts = *defaults;
+    opts.keep_folder = defaults->keep_folder ? strdup(defaults->keep_folder) : NULL;
+    opts.filename_prefix = defaults->filename_prefix ? strdup(defaults->filename_prefix) : NULL;
+    stage_times_t t;
+    memset(&t, 0, sizeof(t));
+    double t0 = bench_now_ms();
+    int rc = -1;
+
+    int is_rgba = strncmp(line, "render-rgba ", 12) == 0;
+    char *p = line + (is_rgba ? 12 : 7);
+    int w = 0, h = 0;
+    if (is_rgba) {
+        char *end = NULL;
+        w = (int)strtol(p, &end, 10);
+        h = (int)strtol(end, &end, 10);
+        p = end;
+        if (w <= 0 || h <= 0 || w > 16384 || h > 16384) { snprintf(err, sizeof(err), "bad_size"); goto reply; }
+        if (job_fd < 0) { snprintf(err, sizeof(err), "missing_memfd"); goto reply; }
+    }
+
+    // Options puis (pour render) le chemin: tout le reste de la ligne, espaces compris
+    const char *path = NULL;
+    while (*p) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        if (*p != '-') { path = p; break; }
+        char *tok = p;
+        while (*p && *p != ' ') p++;
+        if (*p) *p++ = '\0';
+        int r = parse_option(&opts, tok, err, sizeof(err));
+        if (r == 0) { snprintf(err, sizeof(err), "unknown_option %.64s", tok); goto reply; }
+        if (r < 0) goto reply;
+    }
+
+    if (is_rgba) {
+        size_t bytes = (size_t)w * (size_t)h * 4;
+        // Un memfd plus court que W*H*4 ferait SIGBUS dans process_image (et tuerait le service)
+        struct stat st;
+        if (fstat(job_fd, &st) != 0 || st.st_size < 0 || (size_t)st.st_size < bytes) {
+            snprintf(err, sizeof(err), "short_memfd");
+            goto reply;
+        }
+        void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, job_fd, 0);
+        if (map == MAP_FAILED) { snprintf(err, sizeof(err), "mmap_failed"); goto reply; }
+        rc = process_image(ctx, &opts, map, w, h, (size_t)w * 4, &t, err, sizeof(err));
+        munmap(map, bytes);
+    } else {
+        if (!path) { snprintf(err, sizeof(err), "missing_path"); goto reply; }
+        uint8_t *img = NULL;
+        int iw = 0, ih = 0;
+        double r0 = bench_now_ms();
+        int mw = opts.full_decode ? 0 : DECODE_MIN_W, mh = opts.full_decode ? 0 : DECODE_MIN_H;
+        if (read_image_rgba(path, mw, mh, &img, &iw, &ih) != 0) { snprintf(err, sizeof(err), "read_failed"); goto reply; }
+        t.read_ms = bench_now_ms() - r0;
+        rc = process_image(ctx, &opts, img, iw, ih, (size_t)iw * 4, &t, err, sizeof(err));
+        free(img);
+    }
+
+reply:
+    t.total_ms = bench_now_ms() - t0;
+    if (rc == 0) {
+        snprintf(reply, sizeof(reply), "ok read=%.2f prep=%.2f tiles=%.2f write=%.2f send=%.2f total=%.2f\n",
+                 t.read_ms, t.prep_ms, t.tiles_ms, t.write_ms, t.send_ms, t.total_ms);
+    } else {
+        snprintf(reply, sizeof(reply), "err %s\n", err);
+    }
+    (void)write(cfd, reply, strlen(reply));
+    free_options(&opts);
+}
+
+static int serve(const char *sock_path, const process_options_t *defaults) {
+    char workdir[PATH_MAX];
+    snprintf(workdir, sizeof(workdir), "/dev/shm/d200_sender_%d", (int)getpid());
+    if (mkdir(workdir, 0700) != 0 && errno != EEXIST) {
+        snprintf(workdir, sizeof(workdir), "/tmp/d200_sender_%d", (int)getpid());
+        if (mkdir(workdir, 0700) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Erreur: impossible de créer le dossier de travail\n");
+            return 1;
+        }
+    }
+
+    sender_ctx_t ctx;
+    if (sender_ctx_init(&ctx, workdir) != 0) {
+        fprintf(stderr, "Erreur: initialisation des pools impossible\n");
+        rmdir(workdir);
+        return 1;
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+    unlink(sock_path);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 8) != 0) {
+        fprintf(stderr, "Erreur: impossible d'écouter sur %s: %s\n", sock_path, strerror(errno));
+        if (lfd >= 0) close(lfd);
+        sender_ctx_destroy(&ctx);
+        rmdir(workdir);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = serve_signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "send_image_page: service prêt sur %s\n", sock_path);
+    while (!g_serve_stop) {
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        struct timeval tv = { .tv_sec = SERVE_RECV_TIMEOUT_MS / 1000, .tv_usec = (SERVE_RECV_TIMEOUT_MS % 1000) * 1000 };
+        (void)setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char line[8192];
+        int job_fd = -1;
+        if (recv_line_fd(cfd, line, sizeof(line), &job_fd) > 0) {
+            if (strcmp(line, "ping") == 0) {
+                (void)write(cfd, "ok\n", 3);
+            } else if (strcmp(line, "quit") == 0) {
+                (void)write(cfd, "ok\n", 3);
+                g_serve_stop = 1;
+            } else if (strncmp(line, "render ", 7) == 0 || strncmp(line, "render-rgba ", 12) == 0) {
+                serve_job(&ctx, defaults, cfd, line, job_fd);
+            } else {
+                (void)write(cfd, "err unknown_command\n", 20);
+            }
+        }
+        if (job_fd >= 0) close(job_fd);
+        close(cfd);
+    }
+
+    close(lfd);
+    unlink(sock_path);
+    sender_ctx_destroy(&ctx);
+    rmdir(workdir);
+    return 0;
+}
+
 int main(int argc, char **argv) {
     // Initialiser les options par défaut
-	process_options_t opts = {
-		.optimize_input = 0,
-		.dither = 0,
-		.compress = 0,
-		.colors = 8,  // Défaut: 8 couleurs
-		.tile_optimize = 1,  // Défaut: optimisation tuiles activée
-		.no_send = 0,
-		.icon_size = 0,  // Calculé dynamiquement
-		.quality_percent = 100,  // Défaut: pas de redimensionnement
-		.magnify_percent = 100,  // Défaut: pas de magnification
-		.keep_folder = NULL,   // Défaut: pas de copie des icônes
-        .filename_prefix = NULL  // Défaut: préfixe "icon"
-    };
+    process_options_t opts;
+    default_options(&opts);
     
     const char *img_path = NULL;
+    const char *serve_sock = NULL;
+    char err[128] = "";
     
     // Parser les arguments de la ligne de commande
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+        int r = parse_option(&opts, argv[i], err, sizeof(err));
+        if (r < 0) {
+            fprintf(stderr, "Erreur: %s\n", err);
+            return 1;
+        } else if (r > 0) {
+            continue;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             show_help(argv[0]);
             return 0;
-        } else if (strcmp(argv[i], "--no-send") == 0) {
-            opts.no_send = 1;
-        } else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--optimize-input") == 0) {
-            opts.optimize_input = 1;
-        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--dither") == 0) {
-            opts.dither = 1;
-        } else if (strcmp(argv[i], "-z") == 0 || strcmp(argv[i], "--compress") == 0) {
-            opts.compress = 1;
-        } else if (strncmp(argv[i], "-c=", 3) == 0) {
-            opts.colors = atoi(argv[i] + 3);
-            if (opts.colors != 8 && opts.colors != 16 && opts.colors != 32 && opts.colors != 64) {
-                fprintf(stderr, "Erreur: nombre de couleurs doit être 8, 16, 32 ou 64\n");
-                return 1;
-            }
-        } else if (strncmp(argv[i], "--colors=", 9) == 0) {
-            opts.colors = atoi(argv[i] + 9);
-            if (opts.colors != 8 && opts.colors != 16 && opts.colors != 32 && opts.colors != 64) {
-                fprintf(stderr, "Erreur: nombre de couleurs doit être 8, 16, 32 ou 64\n");
-                return 1;
-            }
-		} else if (strcmp(argv[i], "--no-tile-optimize") == 0) {
-			opts.tile_optimize = 0;
-		} else if (strncmp(argv[i], "-q=", 3) == 0) {
-			opts.quality_percent = atoi(argv[i] + 3);
-			if (opts.quality_percent < 10 || opts.quality_percent > 100) {
-				fprintf(stderr, "Erreur: pourcentage de qualité doit être entre 10 et 100\n");
-                return 1;
-            }
-        } else if (strncmp(argv[i], "--quality=", 10) == 0) {
-            opts.quality_percent = atoi(argv[i] + 10);
-            if (opts.quality_percent < 10 || opts.quality_percent > 100) {
-                fprintf(stderr, "Erreur: pourcentage de qualité doit être entre 10 et 100\n");
-                return 1;
-            }
-        } else if (strncmp(argv[i], "-m=", 3) == 0) {
-            opts.magnify_percent = atoi(argv[i] + 3);
-            if (opts.magnify_percent < 50 || opts.magnify_percent > 300) {
-                fprintf(stderr, "Erreur: pourcentage de magnification doit être entre 50 et 300\n");
-                return 1;
-            }
-        } else if (strncmp(argv[i], "--magnify=", 10) == 0) {
-            opts.magnify_percent = atoi(argv[i] + 10);
-            if (opts.magnify_percent < 50 || opts.magnify_percent > 300) {
-                fprintf(stderr, "Erreur: pourcentage de magnification doit être entre 50 et 300\n");
-                return 1;
-            }
-        } else if (strncmp(argv[i], "-k=", 3) == 0) {
-            char *arg = argv[i] + 3;
-            char *equals = strchr(arg, '=');
-            if (equals) {
-                // Format: -k=folder=prefix
-                *equals = '\0';  // Séparer folder et prefix
-                opts.keep_folder = strdup(arg);
-                opts.filename_prefix = strdup(equals + 1);
-            } else {
-                // Format: -k=folder
-                opts.keep_folder = strdup(arg);
-                opts.filename_prefix = NULL;  // Utilisera "icon" par défaut
-            }
-        } else if (strncmp(argv[i], "--keep-icons=", 13) == 0) {
-            char *arg = argv[i] + 13;
-            char *equals = strchr(arg, '=');
-            if (equals) {
-                // Format: --keep-icons=folder=prefix
-                *equals = '\0';  // Séparer folder et prefix
-                opts.keep_folder = strdup(arg);
-                opts.filename_prefix = strdup(equals + 1);
-            } else {
-                // Format: --keep-icons=folder
-                opts.keep_folder = strdup(arg);
-                opts.filename_prefix = NULL;  // Utilisera "icon" par défaut
-            }
+        } else if (strcmp(argv[i], "--bench-quantize") == 0) {
+            opts.bench_quantize = 1;
+        } else if (strcmp(argv[i], "--bench-png") == 0) {
+            opts.bench_png = 1;
+        } else if (strcmp(argv[i], "--serve") == 0) {
+            serve_sock = SENDER_SOCK_PATH;
+        } else if (strncmp(argv[i], "--serve=", 8) == 0) {
+            serve_sock = argv[i] + 8;
         } else if (argv[i][0] != '-') {
             if (img_path == NULL) {
                 img_path = argv[i];
@@ -973,6 +1363,12 @@ int main(int argc, char **argv) {
             return 1;
         }
     }
+
+    if (serve_sock) {
+        int rc = serve(serve_sock, &opts);
+        free_options(&opts);
+        return rc;
+    }
     
     // Vérifier qu'une image a été spécifiée
     if (img_path == NULL) {
@@ -982,281 +1378,62 @@ int main(int argc, char **argv) {
     }
     
     // Nettoyer les anciens fichiers temporaires au démarrage
-    // printf("Nettoyage des anciens fichiers temporaires...\n");
     system("find /dev/shm -name 'd200_tiles*' -type d -exec rm -rf {} + 2>/dev/null || true");
     // Ne pas supprimer les frame_*.png car ils peuvent être utilisés par send_video_page_wrapper
     
-    // printf("Traitement de: %s\n", img_path);
-    // printf("Options: optimisation_input=%d, dither=%d, compress=%d, couleurs=%d, tile_optimize=%d, quality_percent=%d, magnify_percent=%d, keep_folder=%s\n",
-    //     opts.optimize_input, opts.dither, opts.compress, opts.colors, opts.tile_optimize, opts.quality_percent, opts.magnify_percent, opts.keep_folder ? opts.keep_folder : "NULL");
-    
     // Lire l'image source
     uint8_t *src = NULL;
     int sw = 0, sh = 0;
-    if (read_png_rgba(img_path, &src, &sw, &sh) != 0) { 
+    int min_w = opts.full_decode ? 0 : DECODE_MIN_W, min_h = opts.full_decode ? 0 : DECODE_MIN_H;
+    if (read_image_rgba(img_path, min_w, min_h, &src, &sw, &sh) != 0) { 
         fprintf(stderr, "Erreur: impossible de lire %s\n", img_path); 
+        free_options(&opts);
         return 1; 
     }
-    
-    // Étape 1: Crop intelligent pour ratio 16:9 (PAS de redimensionnement)
-    uint8_t *processed_src = NULL;
-    int crop_w, crop_h;
-    
-    // Vérifier si déjà 16:9
-    double aspect = (double)sw / sh;
-    double target_aspect = 16.0 / 9.0;
-    
-    if (fabs(aspect - target_aspect) < 0.01) {
-        // Déjà 16:9, utiliser l'image telle quelle
-        processed_src = src;
-        crop_w = sw;
-        crop_h = sh;
-        // printf("Image déjà en 16:9: %dx%d\n", sw, sh);
-    } else {
-        // Crop intelligent vers 16:9
-        processed_src = ensure_16_9_crop(src, sw, sh, &crop_w, &crop_h);
+
+    if (opts.bench_quantize) {
+        int cx, cy, cw, ch;
+        fd_page_crop_16_9(sw, sh, &cx, &cy, &cw, &ch);
+        uint8_t *cropped = crop_rgba(src, sw, sh, cx, cy, cw, ch);
+        fd_page_layout_t L;
+        compute_layout(cw, ch, &opts, &L);
+        int rc = cropped ? bench_quantize(cropped, cw, ch, L.x, L.y, L.btn, L.gap, opts.kmeans_iters) : -1;
+        free(cropped);
         free(src);
-        if (!processed_src) {
-            fprintf(stderr, "Erreur: impossible de croper l'image vers 16:9\n");
-            return 1;
-        }
-        // printf("Image cropée vers 16:9: %dx%d\n", crop_w, crop_h);
+        free_options(&opts);
+        return rc == 0 ? 0 : 1;
     }
-    
-    // Mettre à jour les dimensions pour la suite
-    sw = crop_w;
-    sh = crop_h;
-    // printf("Image traitée: %dx%d pixels\n", sw, sh);
-    
-    // Étape 2: Appliquer dithering si demandé (sur l'image originale)
-    if (opts.dither) {
-        // printf("Application du dithering Floyd-Steinberg sur image %dx%d...\n", sw, sh);
-        apply_dithering(processed_src, sw, sh);
-        // printf("Dithering appliqué.\n");
+
+    char tmpdir[] = "/dev/shm/d200_tilesXXXXXX";
+    if (!mkdtemp(tmpdir)) { 
+        fprintf(stderr, "Error: mkdtemp failed\n"); 
+        free(src); 
+        free_options(&opts);
+        return 1; 
     }
-    
-    // Étape 3: Optimiser l'image input si demandé (conversion en 256 couleurs)
-    if (opts.optimize_input) {
-        // printf("Optimisation de l'image input (conversion 256 couleurs)...\n");
-        optimize_input_image(processed_src, sw, sh);
+
+    sender_ctx_t ctx;
+    if (sender_ctx_init(&ctx, tmpdir) != 0) {
+        fprintf(stderr, "Error: failed to initialize thread pools\n");
+        rmdir(tmpdir);
+        free(src);
+        free_options(&opts);
+        return 1;
     }
     
-    // Configuration des tuiles (14 boutons: 5x3 + 1 bouton large en bas)
-    // Calcul dynamique basé sur la résolution de l'image
-    // Référence: 1280x720 → icones 196x196, gap 50
-    double scale_factor = (double)sw / 1280.0;
-    
-    // Taille de base des icônes (calculée dynamiquement)
-    int base_icon_size = (int)(196 * scale_factor);
-    int base_gap = (int)(50 * scale_factor);
-    
-    // Appliquer le pourcentage de magnification
-    int btn = (base_icon_size * opts.magnify_percent) / 100;
-    int gap = (base_gap * opts.magnify_percent) / 100;
-    
-    // Éviter les valeurs trop petites
-    if (btn < 8) btn = 8;
-    if (gap < 1) gap = 1;
-    
-    // Calculer la taille finale avec qualité
-    int final_btn = (btn * opts.quality_percent) / 100;
-    if (final_btn < 4) final_btn = 4;  // Minimum 4x4 pixels
-    
-    // printf("Image: %dx%d, scale=%.2f, base_icon=%d, final_icon=%d, gap=%d\n", 
-    //        sw, sh, scale_factor, base_icon_size, final_btn, gap);
-    
-    int margin_x = (sw - (btn * 5 + gap * 4)) / 2;
-    int margin_y = (sh - (btn * 3 + gap * 2)) / 2;
+    if (opts.bench_png) opts.no_send = 1;
+    int rc = process_image(&ctx, &opts, src, sw, sh, (size_t)sw * 4, NULL, err, sizeof(err));
+    if (rc == 0 && opts.bench_png) {
+        rc = bench_png(&ctx.engine);
+        if (rc != 0) snprintf(err, sizeof(err), "échec du bench PNG (mémoire ou encodage)");
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Erreur: %s\n", strcmp(err, "send_failed") == 0 ? "échec de l'envoi de la commande" : err);
+    }
     
-    // printf("Génération des icônes: taille=%dx%d, gap=%d\n", btn, btn, gap);
-    // if (opts.quality_percent < 100) {
-    //     printf("Qualité: %d%% -> taille finale: %dx%d\n", opts.quality_percent, final_btn, final_btn);
-    // }
-    int x[5]; 
-    for (int c = 0; c < 5; c++) x[c] = margin_x + c * (btn + gap);
-    int y[3]; 
-    for (int r = 0; r < 3; r++) y[r] = margin_y + r * (btn + gap);
-
-    // File mode: create temporary directory and write files in parallel
-    // printf("File mode: creating tiles on disk (threads enabled)...\n");
-        
-        char tag[32];
-        unique_tag(tag, sizeof(tag));
-        char tmpdir[] = "/dev/shm/d200_tilesXXXXXX";
-        if (!mkdtemp(tmpdir)) {
-            strcpy(tmpdir, "/dev/shm/d200_tilesXXXXXX");
-            if (!mkdtemp(tmpdir)) { 
-                fprintf(stderr, "Error: mkdtemp failed\n"); 
-                free(processed_src); 
-                return 1; 
-            }
-        }
-        // printf("Temporary directory: %s\n", tmpdir);
-        
-        // Initialize thread pool for parallel PNG writing
-        png_write_pool_t write_pool;
-        if (png_write_pool_init(&write_pool, 4) != 0) {
-            fprintf(stderr, "Error: failed to initialize thread pool\n");
-            free(processed_src);
-            return 1;
-        }
-        
-        // Prepare PNG writing tasks for the 14 tiles
-        png_write_task_t write_tasks[14];
-        const uint8_t *tiles_data[14];
-        int tiles_w[14], tiles_h[14];
-        
-        // Process first 13 buttons (5x3 grid)
-        // printf("Preparing tiles for buttons 1-13...\n");
-        for (int i = 0; i < 13; i++) {
-            int r2 = (i < 10) ? i / 5 : 2;
-            int c = (i < 10) ? i % 5 : (i - 10);
-            
-            // Extraire la tuile avec la taille de base
-            uint8_t *tile = crop_rgba(processed_src, sw, sh, x[c], y[r2], btn, btn);
-            
-            // Optimiser la tuile si demandé
-            if (opts.tile_optimize) {
-                // printf("Optimisation tuile %d...\n", i + 1);
-                quantize_colors(tile, btn, btn, opts.colors);
-            }
-            
-            // Redimensionner avec qualité si nécessaire
-            if (opts.quality_percent < 100) {
-                uint8_t *resized = resize_icon(tile, btn, btn, final_btn, final_btn);
-                free(tile);
-                tile = resized;
-                tiles_data[i] = tile;
-                tiles_w[i] = final_btn;
-                tiles_h[i] = final_btn;
-                write_tasks[i].rgba_data = tile;
-                write_tasks[i].w = final_btn;
-                write_tasks[i].h = final_btn;
-            } else {
-                tiles_data[i] = tile;
-                tiles_w[i] = btn;
-                tiles_h[i] = btn;
-                write_tasks[i].rgba_data = tile;
-                write_tasks[i].w = btn;
-                write_tasks[i].h = btn;
-            }
-            
-            write_tasks[i].tile_id = i;
-            write_tasks[i].status = 0;
-            snprintf(write_tasks[i].filepath, sizeof(write_tasks[i].filepath), 
-                    "%s/b%d_%s.png", tmpdir, i + 1, tag);
-        }
-        
-        // Traiter le 14ème bouton (bouton large en bas)
-        // printf("Préparation de la tuile pour le bouton 14...\n");
-        int b14w = btn + gap + btn;  // Largeur: btn + gap + btn
-        uint8_t *tile14 = crop_rgba(processed_src, sw, sh, x[3], y[2], b14w, btn);
-        
-        if (opts.tile_optimize) {
-            // printf("Optimisation tuile 14...\n");
-            quantize_colors(tile14, b14w, btn, opts.colors);
-        }
-        
-        // Redimensionner avec qualité si nécessaire
-        if (opts.quality_percent < 100) {
-            int new_b14w = final_btn + gap + final_btn; // (final_btn + gap + final_btn)
-            uint8_t *resized = resize_icon(tile14, b14w, btn, new_b14w, final_btn);
-            free(tile14);
-            tile14 = resized;
-            tiles_data[13] = tile14;
-            tiles_w[13] = new_b14w;
-            tiles_h[13] = final_btn;
-            write_tasks[13].rgba_data = tile14;
-            write_tasks[13].w = new_b14w;
-            write_tasks[13].h = final_btn;
-        } else {
-            tiles_data[13] = tile14;
-            tiles_w[13] = b14w;
-            tiles_h[13] = btn;
-            write_tasks[13].rgba_data = tile14;
-            write_tasks[13].w = b14w;
-            write_tasks[13].h = btn;
-        }
-        
-        write_tasks[13].tile_id = 13;
-        write_tasks[13].status = 0;
-        snprintf(write_tasks[13].filepath, sizeof(write_tasks[13].filepath), 
-                "%s/b14_%s.png", tmpdir, tag);
-        
-        // Exécuter toutes les écritures PNG en parallèle
-        // printf("Écriture PNG en parallèle avec %d threads...\n", write_pool.thread_count);
-        if (png_write_pool_execute(&write_pool, write_tasks, 14) != 0) {
-            fprintf(stderr, "Erreur: échec de l'écriture parallèle\n");
-            png_write_pool_destroy(&write_pool);
-            for (int i = 0; i < 14; i++) {
-                free((void*)tiles_data[i]);
-            }
-            free(processed_src);
-            return 1;
-        }
-        
-        // Copier les icônes dans le dossier spécifié si demandé
-        // Si quality est activé, copier les fichiers redimensionnés, sinon copier depuis tiles_data
-        if (opts.quality_percent < 100) {
-            // Mode qualité: copier les fichiers temporaires déjà redimensionnés
-            copy_icons_from_files(write_tasks, 14, opts.keep_folder, opts.filename_prefix);
-        } else {
-            // Mode normal: copier depuis les données en mémoire
-            copy_icons_to_folder(tiles_data, tiles_w, tiles_h, opts.keep_folder, opts.filename_prefix);
-        }
-        
-        // Préparer la commande pour le daemon
-        char sendline[8192];
-        size_t len = 0;
-        strcpy(sendline, "set-buttons-explicit-14");
-        len = strlen(sendline);
-        char pathbuf[PATH_MAX];
-        
-        // Ajouter tous les fichiers à la commande
-        for (int i = 0; i < 14; i++) {
-            if (write_tasks[i].status != 0) {
-                fprintf(stderr, "Erreur: écriture tuile %d a échoué\n", i + 1);
-                continue;
-            }
-            
-            // Ajouter à la commande
-            int m = snprintf(sendline + len, sizeof(sendline) - len, " --button-%d=%s", i + 1, write_tasks[i].filepath);
-            if (m < 0 || (size_t)m >= sizeof(sendline) - len) { 
-                fprintf(stderr, "Erreur: commande trop longue\n"); 
-                break; 
-            }
-            len += (size_t)m;
-        }
-        
-        // Envoyer la commande au daemon
-        // printf("Envoi de la commande au daemon...\n");
-        // printf("Commande: %s\n", sendline);
-        if (!opts.no_send) {
-            if (send_cmd(sendline) != 0) {
-                fprintf(stderr, "Erreur: échec de l'envoi de la commande\n");
-            } else {
-                // printf("Commande envoyée avec succès!\n");
-            }
-        }
-        
-        // Nettoyer
-        png_write_pool_destroy(&write_pool);
-        for (int i = 0; i < 14; i++) {
-            free((void*)tiles_data[i]);
-        }
-        
-        // Nettoyer les anciens fichiers temporaires dans /dev/shm/
-        // printf("Nettoyage des anciens fichiers temporaires...\n");
-        system("find /dev/shm -name 'd200_tiles*' -type d -exec rm -rf {} + 2>/dev/null || true");
-        // Ne pas supprimer les frame_*.png car ils peuvent être utilisés par send_video_page_wrapper
-        
-        // Nettoyer le répertoire temporaire
-        snprintf(pathbuf, sizeof(pathbuf), "rm -rf \"%s\"", tmpdir);
-        system(pathbuf);
-        // printf("Nettoyage terminé.\n");
-
-    free(processed_src);
-    if (opts.keep_folder) free(opts.keep_folder);
-    if (opts.filename_prefix) free(opts.filename_prefix);
-    return 0;
+    sender_ctx_destroy(&ctx);
+    rmdir(tmpdir);
+    free(src);
+    free_options(&opts);
+    return (rc != 0 && strcmp(err, "send_failed") != 0) ? 1 : 0;
 }
@@ -16,8 +16,6 @@
 #include <math.h>
 #include <stdarg.h>
 #include <libgen.h>
-#include <png.h>
-#include <zlib.h>
 #include <pthread.h>
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
@@ -27,9 +25,17 @@
 
 #include <signal.h>
 #include <stdatomic.h>
+#include <semaphore.h>
 // #include <zip.h>  // Pas disponible, utilisation de la commande système
 #include <dirent.h>  // Pour readdir/opendir
 
+#include "../icons/fd_tiles.h"
+#include "../icons/fd_devzip.h"
+#include "../icons/fd_d2v.h"
+#include "../icons/fd_delta.h"
+
+#define DAEMON_SOCK_PATH "/tmp/ulanzi_device.sock"
+
 // Variables globales pour la gestion du signal
 static volatile sig_atomic_t stop_requested = 0;
 
@@ -37,11 +43,16 @@ static void show_help(FILE *out, const char *prog) {
     fprintf(out, "Usage: %s [OPTIONS] <video_file>\n", prog);
     fprintf(out, "\nOptions:\n");
     fprintf(out, "  --max-frames=N          Max frames to process (0 = no limit)\n");
-    fprintf(out, "  -m, --magnify=PCT       Forwarded to send_image_page (10-100, default: disabled)\n");
-    fprintf(out, "  -q, --quality=PCT       Forwarded to send_image_page (10-100, default: disabled)\n");
-    fprintf(out, "  -d, --dither            Enable Floyd-Steinberg dithering (forwarded to convert_video.sh and send_image_page)\n");
-    fprintf(out, "  -s, --sleep=MS          Delay between frames in milliseconds (>=1, default: 0.1ms)\n");
+    fprintf(out, "  -m, --magnify=PCT       Tile magnification, as send_image_page -m (10-100, default: disabled)\n");
+    fprintf(out, "  -q, --quality=PCT       Tile size, as send_image_page -q (10-100, default: disabled)\n");
+    fprintf(out, "  -d, --dither            Enable Floyd-Steinberg dithering (also forwarded to convert_video.sh)\n");
+    fprintf(out, "  -s, --sleep=MS          Delay between frames in milliseconds (>=1, default: none)\n");
     fprintf(out, "  -r, --render            Render mode: write per-frame icons into folders (no playback)\n");
+    fprintf(out, "      --pack              Render into a single <video_name>.d2v file (ready-to-send uploads,\n");
+    fprintf(out, "                          played by the daemon: video-play <file.d2v>)\n");
+    fprintf(out, "      --delta[=T]         Send only the tiles that changed since the last upload (0x000d partial\n");
+    fprintf(out, "                          updates; playback and --pack). T = mean abs diff threshold, 0-255 (default: 3)\n");
+    fprintf(out, "      --keyframe=N        With --delta: full page every N frames (default: 30, 0 = first frame only)\n");
     fprintf(out, "  -c, --convert=OPTS      Convert before processing (calls bin/convert_video.sh OPTS <video_file>)\n");
     fprintf(out, "  -h, --help              Show this help\n");
 
@@ -52,11 +63,21 @@ static void show_help(FILE *out, const char *prog) {
     fprintf(out, "  %s -q=64 video.mp4\n", prog);
     fprintf(out, "  %s -d -m=128 -q=64 --max-frames=10 video.mp4\n", prog);
     fprintf(out, "  %s -r --max-frames=120 video.mp4\n", prog);
+    fprintf(out, "  %s --pack video.mp4\n", prog);
+    fprintf(out, "  %s --pack --delta=4 --keyframe=50 video.mp4\n", prog);
     fprintf(out, "  %s --convert=\"--size=360\" video.mp4\n", prog);
 
+    fprintf(out, "\nPlayback:\n");
+    fprintf(out, "  Decoding, tiling (same output as send_image_page -o --no-tile-optimize) and sending\n");
+    fprintf(out, "  run as pipelined threads; pages are streamed over one daemon session (stream-begin),\n");
+    fprintf(out, "  or sent with set-buttons-explicit-14 if the daemon does not support it.\n");
+    fprintf(out, "  The codec decodes with frame/slice threads; time spent in each stage (and waiting on\n");
+    fprintf(out, "  the others) is printed at the end, with the stage that limits the frame rate.\n");
+
     fprintf(out, "\nRender mode (-r/--render):\n");
     fprintf(out, "  Writes a folder tree next to the input video: <video_name>/<button_number>/\n");
     fprintf(out, "  Filenames include the button prefix: b<btn>_<frame> (e.g. b1_000.png)\n");
+    fprintf(out, "  With --pack: <video_name>.d2v next to the input video instead of the folder tree\n");
 }
 
 static void die_snprintf(const char *label) {
@@ -92,6 +113,28 @@ static char *asprintf_alloc(const char *label, const char *fmt, ...) {
     return buf;
 }
 
+static int write_all(int fd, const uint8_t *data, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, data + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+// Écrit un buffer en un seul write() (tuiles sur tmpfs)
+static int write_file(const char *path, const uint8_t *data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    int rc = write_all(fd, data, len);
+    if (close(fd) != 0) rc = -1;
+    return rc;
+}
+
 // Gestionnaire de signal pour CTRL+C et SIGTERM
 static void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
@@ -100,18 +143,112 @@ static void signal_handler(int sig) {
     }
 }
 
+// Nombre de chiffres des numéros de frame pour une vidéo de total_frames frames
+static int frame_name_width(int total_frames) {
+    if (total_frames < 10) return 1;
+    if (total_frames < 100) return 2;
+    if (total_frames < 1000) return 3;
+    return 4;
+}
+
 // Fonction pour générer le préfixe de frame avec zéros padding et préfixe de bouton
-static void format_frame_prefix(char *prefix, int frame_num, int total_frames, int button_num) {
+static void format_frame_prefix(char *prefix, int frame_num, int width, int button_num) {
     // Ajouter le préfixe de bouton b1-b14
-    if (total_frames < 10) {
-        snprintf(prefix, 32, "b%d_%d", button_num, frame_num);
-    } else if (total_frames < 100) {
-        snprintf(prefix, 32, "b%d_%02d", button_num, frame_num);
-    } else if (total_frames < 1000) {
-        snprintf(prefix, 32, "b%d_%03d", button_num, frame_num);
-    } else {
-        snprintf(prefix, 32, "b%d_%04d", button_num, frame_num);
+    snprintf(prefix, 32, "b%d_%0*d", button_num, width, frame_num);
+}
+
+// Nombre de frames annoncé par le conteneur (0 = inconnu): nb_frames, sinon durée x fps.
+// Estimation seulement: les noms sont corrigés après le rendu si elle était fausse.
+static int estimate_frame_count(const AVFormatContext *fmt_ctx, const AVStream *st) {
+    if (st->nb_frames > 0 && st->nb_frames < INT_MAX) return (int)st->nb_frames;
+    AVRational fps = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+    if (fps.num <= 0 || fps.den <= 0) return 0;
+    double seconds = 0.0;
+    if (st->duration != AV_NOPTS_VALUE && st->duration > 0) {
+        seconds = (double)st->duration * av_q2d(st->time_base);
+    } else if (fmt_ctx->duration != AV_NOPTS_VALUE && fmt_ctx->duration > 0) {
+        seconds = (double)fmt_ctx->duration / AV_TIME_BASE;
     }
+    double frames = seconds * av_q2d(fps) + 0.5;
+    if (frames < 1.0 || frames >= INT_MAX) return 0;
+    return (int)frames;
+}
+
+// Renomme b<btn>_<n> de la largeur used vers la largeur final dans chaque dossier de bouton.
+// Les deux jeux de noms ne peuvent pas se recouvrir (largeurs différentes), l'ordre est libre.
+static int fix_frame_names(const char *video_dir, int frame_count, int used_width, int final_width) {
+    if (used_width == final_width) return 0;
+    int rc = 0;
+    for (int button = 1; button <= 14; button++) {
+        for (int i = 0; i < frame_count; i++) {
+            char from_prefix[32], to_prefix[32];
+            char from[PATH_MAX], to[PATH_MAX];
+            format_frame_prefix(from_prefix, i, used_width, button);
+            format_frame_prefix(to_prefix, i, final_width, button);
+            snprintf_checked(from, sizeof(from), "fix_from", "%s/%d/%s.png", video_dir, button, from_prefix);
+            snprintf_checked(to, sizeof(to), "fix_to", "%s/%d/%s.png", video_dir, button, to_prefix);
+            if (rename(from, to) != 0 && errno != ENOENT) rc = -1;
+        }
+    }
+    return rc;
+}
+
+// Copie récursive src -> dst (dst créé au besoin, fichiers existants écrasés)
+static int copy_tree(const char *src, const char *dst) {
+    if (mkdir(dst, 0755) != 0 && errno != EEXIST) return -1;
+    DIR *d = opendir(src);
+    if (!d) return -1;
+    int rc = 0;
+    struct dirent *de;
+    char buf[65536];
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        char from[PATH_MAX], to[PATH_MAX];
+        snprintf_checked(from, sizeof(from), "copy_from", "%s/%s", src, de->d_name);
+        snprintf_checked(to, sizeof(to), "copy_to", "%s/%s", dst, de->d_name);
+        struct stat st;
+        if (lstat(from, &st) != 0) { rc = -1; continue; }
+        if (S_ISDIR(st.st_mode)) {
+            if (copy_tree(from, to) != 0) rc = -1;
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)) continue;
+        int in = open(from, O_RDONLY);
+        if (in < 0) { rc = -1; continue; }
+        int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0) { close(in); rc = -1; continue; }
+        ssize_t n;
+        while ((n = read(in, buf, sizeof(buf))) > 0 || (n < 0 && errno == EINTR)) {
+            if (n > 0 && write_all(out, (const uint8_t *)buf, (size_t)n) != 0) { rc = -1; break; }
+        }
+        if (n < 0) rc = -1;
+        close(in);
+        if (close(out) != 0) rc = -1;
+    }
+    closedir(d);
+    return rc;
+}
+
+// Équivalent de rm -rf
+static int remove_tree(const char *path) {
+    DIR *d = opendir(path);
+    if (!d) return unlink(path) == 0 || errno == ENOENT ? 0 : -1;
+    int rc = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        char child[PATH_MAX];
+        snprintf_checked(child, sizeof(child), "remove_path", "%s/%s", path, de->d_name);
+        struct stat st;
+        if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (remove_tree(child) != 0) rc = -1;
+        } else if (unlink(child) != 0 && errno != ENOENT) {
+            rc = -1;
+        }
+    }
+    closedir(d);
+    if (rmdir(path) != 0 && errno != ENOENT) rc = -1;
+    return rc;
 }
 
 // Options de traitement
@@ -120,100 +257,595 @@ typedef struct {
     int magnify_size;     // Taille de magnification (-m/--magnify, 0 = désactivé)
     int quality_size;     // Taille de qualité (-q/--quality, 0 = pas de redimensionnement)
     int render_mode;      // Mode render (-r/--render, 0 = désactivé)
+    int pack_mode;        // Mode render vers un seul fichier .d2v (--pack)
     int dither_mode;     // Mode dithering (-d/--dither, 0 = désactivé)
     int sleep_delay;      // Délai entre frames (-s/--sleep, 0 = pas de délai)
+    int delta_threshold;  // --delta[=T]: seuil de changement des tuiles (-1 = désactivé)
+    int keyframe;         // --keyframe=N: page complète toutes les N frames en mode delta
     char *convert_opts;   // Options de conversion (-c/--convert, NULL = désactivé)
 } process_options_t;
 
-// Fonction pour écrire une frame en PNG
-static int write_frame_png(const char *path, const uint8_t *rgba_data, int w, int h) {
-    FILE *fp = fopen(path, "wb");
-    if (!fp) return -1;
-    
-    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png) { fclose(fp); return -1; }
-    
-    png_infop info = png_create_info_struct(png);
-    if (!info) { png_destroy_write_struct(&png, NULL); fclose(fp); return -1; }
-    
-    if (setjmp(png_jmpbuf(png))) { png_destroy_write_struct(&png, &info); fclose(fp); return -1; }
-    
-    png_init_io(png, fp);
-    png_set_compression_level(png, Z_BEST_SPEED);
-    png_set_filter(png, 0, PNG_ALL_FILTERS);
-    png_set_IHDR(png, info, w, h, 8, PNG_COLOR_TYPE_RGBA,
-               PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-    
-    png_bytep *rows = malloc(sizeof(png_bytep) * h);
-    if (!rows) { png_destroy_write_struct(&png, &info); fclose(fp); return -1; }
-    
-    for (int y = 0; y < h; y++) {
-        rows[y] = (png_bytep)(rgba_data + (size_t)y * w * 4);
+// --- Décodage: AVFrame -> sws_scale (contexte réutilisé) -> RGBA ---
+typedef struct {
+    AVFormatContext *fmt_ctx;
+    AVCodecContext *codec_ctx;
+    AVFrame *frame;
+    AVPacket *pkt;
+    int stream_idx;
+    int eof;                  // plus de paquets: vidange du décodeur
+    struct SwsContext *sws;
+    double scale_time;        // secondes passées dans sws_scale (statistiques)
+} video_decoder_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Frame suivante, convertie directement dans dst (stride en octets). dst == NULL: décode sans
+// convertir (comptage). Retour: 1 = frame, 0 = fin de vidéo / arrêt, -1 = erreur.
+static int decoder_next(video_decoder_t *d, uint8_t *dst, int dst_w, int dst_h, int dst_stride) {
+    for (;;) {
+        if (stop_requested) return 0;
+        int ret = avcodec_receive_frame(d->codec_ctx, d->frame);
+        if (ret == 0) {
+            if (!dst) return 1;
+            d->sws = sws_getCachedContext(d->sws, d->frame->width, d->frame->height,
+                                          (enum AVPixelFormat)d->frame->format,
+                                          dst_w, dst_h, AV_PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
+            if (!d->sws) return -1;
+            uint8_t *dst_planes[4] = { dst, NULL, NULL, NULL };
+            int dst_strides[4] = { dst_stride, 0, 0, 0 };
+            double t0 = now_sec();
+            sws_scale(d->sws, (const uint8_t * const *)d->frame->data, d->frame->linesize,
+                      0, d->frame->height, dst_planes, dst_strides);
+            d->scale_time += now_sec() - t0;
+            return 1;
+        }
+        if (ret == AVERROR_EOF) return 0;
+        if (ret != AVERROR(EAGAIN)) return -1;
+        if (d->eof) return 0;
+
+        // Le décodeur attend des données
+        ret = av_read_frame(d->fmt_ctx, d->pkt);
+        if (ret < 0) {
+            d->eof = 1;
+            avcodec_send_packet(d->codec_ctx, NULL);
+            continue;
+        }
+        if (d->pkt->stream_index == d->stream_idx) {
+            avcodec_send_packet(d->codec_ctx, d->pkt);
+        }
+        av_packet_unref(d->pkt);
+    }
+}
+
+// --- Files bornées entre les étapes ---
+// Chaque étape prend un buffer libre, le remplit et le passe à la suivante, qui le rend une
+// fois consommé: mémoire fixe (PIPE_DEPTH frames en vol), pas d'allocation par frame.
+// Chaque file a un seul producteur et un seul consommateur: anneau sans verrou (indices
+// atomiques), les sémaphores (futex) ne servent qu'à dormir quand l'anneau est vide ou plein.
+#define PIPE_DEPTH 3
+#define FRAME_ALIGN 64        // lignes RGBA alignées (sws_scale, SIMD)
+
+typedef struct {
+    void *items[PIPE_DEPTH];
+    atomic_uint head;         // consommateur
+    atomic_uint tail;         // producteur
+    atomic_int closed;
+    sem_t filled;             // éléments disponibles (+1 jeton à la fermeture)
+    sem_t space;              // places libres (+1 jeton à la fermeture)
+    double wait;              // secondes bloquées dans bq_pop (statistiques, côté consommateur)
+} bqueue_t;
+
+static void bq_init(bqueue_t *q) {
+    memset(q, 0, sizeof(*q));
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->closed, 0);
+    sem_init(&q->filled, 0, 0);
+    sem_init(&q->space, 0, PIPE_DEPTH);
+}
+
+static void bq_destroy(bqueue_t *q) {
+    sem_destroy(&q->space);
+    sem_destroy(&q->filled);
+}
+
+static int bq_sem_wait(sem_t *sem) {
+    if (sem_trywait(sem) == 0) return 0;
+    while (sem_wait(sem) != 0) {
+        if (errno != EINTR) return -1;
     }
-    
-    png_set_rows(png, info, rows);
-    png_write_png(png, info, PNG_TRANSFORM_IDENTITY, NULL);
-    
-    free(rows);
-    png_destroy_write_struct(&png, &info);
-    fclose(fp);
     return 0;
 }
 
-// Fonction pour extraire une frame de la vidéo
-static uint8_t* extract_frame(AVFormatContext *fmt_ctx, AVCodecContext *codec_ctx, 
-                           AVFrame *frame, AVPacket *pkt, int stream_idx, 
-                           int target_w, int target_h) {
-    while (av_read_frame(fmt_ctx, pkt) >= 0) {
-        // Vérifier le signal pendant la lecture des packets
-        if (stop_requested) {
-            av_packet_unref(pkt);
-            return NULL;
+static void bq_push(bqueue_t *q, void *item) {
+    if (bq_sem_wait(&q->space) != 0) return;
+    if (atomic_load_explicit(&q->closed, memory_order_acquire)) {
+        sem_post(&q->space); // réveil de fermeture: le laisser aux appels suivants
+        return;
+    }
+    unsigned t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    q->items[t % PIPE_DEPTH] = item;
+    atomic_store_explicit(&q->tail, t + 1, memory_order_release);
+    sem_post(&q->filled);
+}
+
+// NULL: file fermée et vide
+static void *bq_pop(bqueue_t *q) {
+    if (sem_trywait(&q->filled) != 0) {
+        double t0 = now_sec();
+        if (bq_sem_wait(&q->filled) != 0) return NULL;
+        q->wait += now_sec() - t0;
+    }
+    unsigned h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (h == atomic_load_explicit(&q->tail, memory_order_acquire)) {
+        sem_post(&q->filled); // fermée et vide
+        return NULL;
+    }
+    void *item = q->items[h % PIPE_DEPTH];
+    atomic_store_explicit(&q->head, h + 1, memory_order_release);
+    sem_post(&q->space);
+    return item;
+}
+
+static void bq_close(bqueue_t *q) {
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+    sem_post(&q->filled);
+    sem_post(&q->space);
+}
+
+typedef struct {
+    uint8_t *rgba;            // h lignes de pl->stride octets, alignées sur FRAME_ALIGN
+    int index;
+} frame_slot_t;
+
+// Page prête à envoyer, déjà au format du flux démon (voir stream-begin dans ulanzi_d200_daemon.c):
+// "D2FR" u16 cmd u16 masque, puis pour chaque bouton du masque: u32 taille + PNG.
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    size_t png_off[14];       // 0 = tuile absente
+    size_t png_len[14];
+    uint16_t mask;            // tuiles rendues
+    uint8_t sig[14][FD_DELTA_SIG]; // --delta: signature de chaque tuile (fd_delta.h)
+    int index;
+} payload_t;
+
+typedef struct {
+    const process_options_t *opts;
+    video_decoder_t *dec;
+    int w, h;                 // taille de décodage (codec)
+    int stride;               // octets par ligne des frames (w*4 arrondi à FRAME_ALIGN)
+    int total_frames;         // mode render: nombre annoncé par le conteneur (0 = inconnu)
+    int name_width;           // mode render: chiffres des numéros de frame utilisés pendant le rendu
+    const char *tmpdir;
+    const char *video_dir;    // mode render
+    fd_d2v_writer_t *pack;    // mode --pack
+    fd_devzip_t devzip;       // mode --pack: ZIP + paquets HID de la page (réutilisés)
+    int use_delta;            // --delta en lecture ou --pack (pas pour l'arborescence -r)
+    fd_delta_t delta;         // dernières tuiles envoyées
+    payload_t sub;            // --delta: page partielle au format du flux
+
+    frame_slot_t frames[PIPE_DEPTH];
+    payload_t payloads[PIPE_DEPTH];
+    bqueue_t free_frames, ready_frames;
+    bqueue_t free_payloads, ready_payloads;
+
+    fd_tiles_t engine;
+    int frames_sent;
+    int frames_seen;          // plus grand index reçu + 1
+    int send_errors;
+
+    // Temps passé dans chaque étape (secondes, chacune écrite par son seul thread)
+    double t_decode, t_tiles, t_send;
+    double t_start, t_end;
+} pipeline_t;
+
+static void *decode_thread(void *arg) {
+    pipeline_t *pl = (pipeline_t *)arg;
+    int count = 0;
+    while (!stop_requested) {
+        if (pl->opts->max_frames > 0 && count >= pl->opts->max_frames) break;
+        frame_slot_t *f = bq_pop(&pl->free_frames);
+        if (!f) break;
+        double t0 = now_sec();
+        int r = decoder_next(pl->dec, f->rgba, pl->w, pl->h, pl->stride);
+        pl->t_decode += now_sec() - t0;
+        if (r != 1) {
+            if (r < 0) fprintf(stderr, "Frame %d: erreur de décodage\n", count + 1);
+            break;
         }
-        
-        if (pkt->stream_index == stream_idx) {
-            int ret = avcodec_send_packet(codec_ctx, pkt);
-            if (ret < 0) {
-                av_packet_unref(pkt);
-                continue;
+        f->index = count++;
+        bq_push(&pl->ready_frames, f);
+    }
+    bq_close(&pl->ready_frames);
+    return NULL;
+}
+
+static int payload_put(payload_t *p, const void *data, size_t len) {
+    if (p->len + len > p->cap) {
+        size_t cap = p->cap ? p->cap : 65536;
+        while (cap < p->len + len) cap *= 2;
+        uint8_t *n = realloc(p->data, cap);
+        if (!n) return -1;
+        p->data = n;
+        p->cap = cap;
+    }
+    memcpy(p->data + p->len, data, len);
+    p->len += len;
+    return 0;
+}
+
+static int payload_put_le(payload_t *p, uint32_t v, int bytes) {
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return payload_put(p, b, (size_t)bytes);
+}
+
+// Équivalent en mémoire de "send_image_page -o --no-tile-optimize [-d] [-m=] [-q=] frame.png"
+static int render_page(pipeline_t *pl, uint8_t *rgba, payload_t *p) {
+    const process_options_t *opts = pl->opts;
+    int cx, cy, cw, ch;
+    fd_page_crop_16_9(pl->w, pl->h, &cx, &cy, &cw, &ch);
+    size_t stride = (size_t)pl->stride;
+    uint8_t *base = rgba + (size_t)cy * stride + (size_t)cx * 4;
+
+    // La frame nous appartient: dithering et grille 6x6x6 en place, sans copie
+    if (opts->dither_mode) fd_dither_fs_rgba(base, cw, ch, stride, 6);
+    fd_dither_posterize_rgba(base, cw, ch, stride, 6);
+
+    fd_page_layout_t L;
+    fd_page_layout(cw, ch, opts->magnify_size > 0 ? opts->magnify_size : 100,
+                   opts->quality_size > 0 ? opts->quality_size : 100, &L);
+    if (fd_tiles_layout(&pl->engine, &L) != 0) return -1;
+    fd_tiles_params_t params;
+    fd_tiles_params_default(&params);
+    params.quantize = 0;
+    fd_tiles_run(&pl->engine, base, cw, ch, stride, &params);
+
+    uint16_t mask = 0;
+    for (int i = 0; i < 14; i++) {
+        if (pl->engine.tiles[i].png_status == 0) mask |= (uint16_t)(1u << i);
+    }
+    if (!mask) return -1;
+    p->mask = mask;
+    if (pl->use_delta) {
+        for (int i = 0; i < 14; i++) {
+            const fd_tile_t *t = &pl->engine.tiles[i];
+            if (mask & (1u << i)) fd_delta_signature(t->out, t->dw, t->dh, (size_t)t->dw * 4, p->sig[i]);
+        }
+    }
+    p->len = 0;
+    if (payload_put(p, "D2FR", 4) != 0 || payload_put_le(p, 0x0001, 2) != 0 || payload_put_le(p, mask, 2) != 0) return -1;
+    for (int i = 0; i < 14; i++) {
+        const fd_tile_t *t = &pl->engine.tiles[i];
+        p->png_off[i] = 0;
+        p->png_len[i] = 0;
+        if (!(mask & (1u << i))) {
+            fprintf(stderr, "Erreur: encodage tuile %d a échoué\n", i + 1);
+            continue;
+        }
+        if (payload_put_le(p, (uint32_t)t->png_len, 4) != 0) return -1;
+        p->png_off[i] = p->len;
+        p->png_len[i] = t->png_len;
+        if (payload_put(p, t->png, t->png_len) != 0) return -1;
+    }
+    return 0;
+}
+
+static void *tiles_thread(void *arg) {
+    pipeline_t *pl = (pipeline_t *)arg;
+    frame_slot_t *f;
+    while ((f = bq_pop(&pl->ready_frames)) != NULL) {
+        payload_t *p = bq_pop(&pl->free_payloads);
+        if (!p) break;
+        p->index = f->index;
+        double t0 = now_sec();
+        int rc = render_page(pl, f->rgba, p);
+        pl->t_tiles += now_sec() - t0;
+        if (rc != 0) {
+            fprintf(stderr, "Frame %d: erreur lors du rendu des tuiles\n", f->index + 1);
+            p->len = 0;
+        }
+        bq_push(&pl->free_frames, f);
+        bq_push(&pl->ready_payloads, p);
+    }
+    bq_close(&pl->ready_payloads);
+    // Débloque le décodeur s'il attend un buffer libre
+    bq_close(&pl->free_frames);
+    return NULL;
+}
+
+// --- Envoi ---
+// Lit une ligne de réponse du démon ("ok", "err ...")
+static int read_reply(int fd, char *buf, size_t cap) {
+    size_t n = 0;
+    while (n + 1 < cap) {
+        ssize_t r = read(fd, buf + n, 1);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        if (buf[n] == '\n') break;
+        n++;
+    }
+    buf[n] = '\0';
+    return n > 0 ? 0 : -1;
+}
+
+static int daemon_connect(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, DAEMON_SOCK_PATH, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    return fd;
+}
+
+// Session de flux persistante; -1 si le démon ne connaît pas stream-begin (ancienne version)
+static int stream_begin(void) {
+    int fd = daemon_connect();
+    if (fd < 0) return -1;
+    char reply[64];
+    if (write_all(fd, (const uint8_t *)"stream-begin\n", 13) != 0 ||
+        read_reply(fd, reply, sizeof(reply)) != 0 || strcmp(reply, "ok") != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Repli sans session: tuiles dans tmpdir + set-buttons-explicit-14
+static int send_page_files(pipeline_t *pl, const payload_t *p) {
+    char line[8192];
+    int len = snprintf_checked(line, sizeof(line), "sendline", "set-buttons-explicit-14");
+    char paths[14][PATH_MAX];
+    int ok[14] = {0};
+    for (int i = 0; i < 14; i++) {
+        if (!p->png_off[i]) continue;
+        snprintf_checked(paths[i], sizeof(paths[i]), "tile_path", "%s/b%d_%06d.png", pl->tmpdir, i + 1, p->index);
+        if (write_file(paths[i], p->data + p->png_off[i], p->png_len[i]) != 0) continue;
+        ok[i] = 1;
+        len += snprintf_checked(line + len, sizeof(line) - (size_t)len, "sendline", " --button-%d=%s", i + 1, paths[i]);
+    }
+    int rc = -1;
+    int fd = daemon_connect();
+    if (fd >= 0) {
+        char reply[64];
+        line[len++] = '\n';
+        if (write_all(fd, (const uint8_t *)line, (size_t)len) == 0 &&
+            read_reply(fd, reply, sizeof(reply)) == 0 && strcmp(reply, "ok") == 0) rc = 0;
+        close(fd);
+    }
+    for (int i = 0; i < 14; i++) if (ok[i]) unlink(paths[i]);
+    return rc;
+}
+
+// Mode render: <video_dir>/<bouton>/b<bouton>_<frame>.png
+static int save_page(pipeline_t *pl, const payload_t *p) {
+    int rc = 0;
+    for (int i = 0; i < 14; i++) {
+        if (!p->png_off[i]) { rc = -1; continue; }
+        char prefix[32];
+        char path[PATH_MAX];
+        format_frame_prefix(prefix, p->index, pl->name_width, i + 1);
+        snprintf_checked(path, sizeof(path), "dst_icon", "%s/%d/%s.png", pl->video_dir, i + 1, prefix);
+        if (write_file(path, p->data + p->png_off[i], p->png_len[i]) != 0) rc = -1;
+    }
+    return rc;
+}
+
+// Mode --pack: upload de la page (ZIP résolu + paquets HID) ajouté au conteneur.
+// --delta: seulement les tuiles de `mask` en 0x000d, frame vide si rien n'a changé.
+static int pack_page(pipeline_t *pl, const payload_t *p, uint16_t mask, int full) {
+    if (!mask) return fd_d2v_append(pl->pack, NULL, 0, 0);
+    fd_devzip_icon_t icons[14];
+    char names[14][32];
+    int count = 0;
+    for (int i = 0; i < 14; i++) {
+        if (!p->png_off[i] || !(mask & (1u << i))) continue;
+        snprintf(names[count], sizeof(names[count]), "b%d_%d.png", i + 1, p->index);
+        icons[count].btn = i;
+        icons[count].name = names[count];
+        icons[count].label = "";
+        icons[count].data = p->data + p->png_off[i];
+        icons[count].len = p->png_len[i];
+        count++;
+    }
+    int pad = 0;
+    size_t patched = 0;
+    if (fd_devzip_solve(&pl->devzip, icons, count, FD_DEVZIP_MAX_PAD, &pad, &patched) != 0 ||
+        fd_devzip_packetize(&pl->devzip, full ? FD_DEVZIP_CMD_FULL : FD_DEVZIP_CMD_PARTIAL) != 0) {
+        return -1;
+    }
+    return fd_d2v_append(pl->pack, pl->devzip.pkt, pl->devzip.pkt_len, full ? FD_D2V_FRAME_FULL : 0);
+}
+
+// --delta: page du flux réduite aux tuiles de `mask` (0x000d si partielle)
+static int build_sub_frame(pipeline_t *pl, const payload_t *p, uint16_t mask, int full) {
+    payload_t *s = &pl->sub;
+    s->len = 0;
+    if (payload_put(s, "D2FR", 4) != 0 || payload_put_le(s, full ? 0x0001 : 0x000d, 2) != 0 ||
+        payload_put_le(s, mask, 2) != 0) return -1;
+    for (int i = 0; i < 14; i++) {
+        if (!(mask & (1u << i))) continue;
+        if (payload_put_le(s, (uint32_t)p->png_len[i], 4) != 0 ||
+            payload_put(s, p->data + p->png_off[i], p->png_len[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+static void *send_thread(void *arg) {
+    pipeline_t *pl = (pipeline_t *)arg;
+    const process_options_t *opts = pl->opts;
+    int stream_fd = -1;
+    int use_stream = !opts->render_mode;
+    struct timeval start_time, current_time;
+    gettimeofday(&start_time, NULL);
+
+    payload_t *p;
+    while ((p = bq_pop(&pl->ready_payloads)) != NULL) {
+        int rc = -1;
+        uint16_t mask = p->mask;
+        int full = 1;
+        double t0 = now_sec();
+        if (p->len == 0 || stop_requested) {
+            // frame en erreur, ou arrêt demandé: on vide la file sans envoyer
+        } else if (opts->pack_mode) {
+            if (pl->use_delta) mask = fd_delta_select(&pl->delta, (const uint8_t (*)[FD_DELTA_SIG])p->sig, p->mask, &full);
+            rc = pack_page(pl, p, mask, full);
+            if (rc != 0) fprintf(stderr, "Frame %d: erreur lors de l'écriture du conteneur\n", p->index + 1);
+        } else if (opts->render_mode) {
+            rc = save_page(pl, p);
+            if (rc != 0) fprintf(stderr, "Frame %d: erreur lors de l'écriture des icônes\n", p->index + 1);
+        } else {
+            if (use_stream && stream_fd < 0) {
+                stream_fd = stream_begin();
+                if (stream_fd < 0) use_stream = 0;
             }
-            
-            ret = avcodec_receive_frame(codec_ctx, frame);
-            if (ret == 0) {
-                // Convertir en RGBA
-                struct SwsContext *sws_ctx = sws_getContext(
-                    frame->width, frame->height, codec_ctx->pix_fmt,
-                    target_w, target_h, AV_PIX_FMT_RGBA,
-                    SWS_BILINEAR, NULL, NULL, NULL);
-                
-                if (!sws_ctx) {
-                    av_packet_unref(pkt);
-                    return NULL;
+            if (stream_fd >= 0) {
+                const uint8_t *data = p->data;
+                size_t len = p->len;
+                if (pl->use_delta) {
+                    mask = fd_delta_select(&pl->delta, (const uint8_t (*)[FD_DELTA_SIG])p->sig, p->mask, &full);
+                    if (mask && (mask != p->mask || !full)) {
+                        if (build_sub_frame(pl, p, mask, full) != 0) {
+                            len = 0;
+                        } else {
+                            data = pl->sub.data;
+                            len = pl->sub.len;
+                        }
+                    }
                 }
-                
-                uint8_t *rgba_data = malloc((size_t)target_w * target_h * 4);
-                if (!rgba_data) {
-                    sws_freeContext(sws_ctx);
-                    av_packet_unref(pkt);
-                    return NULL;
+                char reply[64];
+                if (mask == 0) {
+                    rc = 0; // page inchangée: rien à envoyer
+                } else if (len == 0) {
+                    rc = -1;
+                } else if (write_all(stream_fd, data, len) == 0 && read_reply(stream_fd, reply, sizeof(reply)) == 0) {
+                    rc = strcmp(reply, "ok") == 0 ? 0 : -1;
+                } else {
+                    // Démon redémarré: nouvelle session (et page complète) à la frame suivante
+                    close(stream_fd);
+                    stream_fd = -1;
+                    fd_delta_reset(&pl->delta);
                 }
-                
-                uint8_t *dst_planes[4] = { rgba_data, NULL, NULL, NULL };
-                int dst_strides[4] = { target_w * 4, 0, 0, 0 };
-                
-                sws_scale(sws_ctx, (const uint8_t* const*)frame->data, frame->linesize,
-                         0, frame->height, dst_planes, dst_strides);
-                
-                sws_freeContext(sws_ctx);
-                av_packet_unref(pkt);
-                return rgba_data;
+            } else {
+                rc = send_page_files(pl, p);
             }
+            if (rc != 0) pl->send_errors++;
+        }
+        if (rc == 0 && pl->use_delta) {
+            fd_delta_commit(&pl->delta, (const uint8_t (*)[FD_DELTA_SIG])p->sig, mask, full);
+        }
+        int index = p->index;
+        if (index + 1 > pl->frames_seen) pl->frames_seen = index + 1;
+        pl->t_send += now_sec() - t0;
+        bq_push(&pl->free_payloads, p);
+        if (rc != 0) continue;
+        pl->frames_sent++;
+
+        if (opts->render_mode) {
+            gettimeofday(&current_time, NULL);
+            int elapsed_seconds = current_time.tv_sec - start_time.tv_sec;
+            int hours = elapsed_seconds / 3600;
+            int minutes = (elapsed_seconds % 3600) / 60;
+            int seconds = elapsed_seconds % 60;
+
+            if (pl->total_frames > 0) {
+                printf("\rframe rendered: [%03d/%d] elapsed time: %02d:%02d:%02d",
+                       index + 1, pl->total_frames, hours, minutes, seconds);
+            } else {
+                printf("\rframe rendered: [%03d] elapsed time: %02d:%02d:%02d",
+                       index + 1, hours, minutes, seconds);
+            }
+            fflush(stdout);
+        } else if (opts->sleep_delay > 0) {
+            // Délai entre frames si spécifié
+            struct timespec ts = { opts->sleep_delay / 1000, (long)(opts->sleep_delay % 1000) * 1000000L };
+            nanosleep(&ts, NULL);
         }
-        av_packet_unref(pkt);
     }
+    if (stream_fd >= 0) close(stream_fd);
+    fd_devzip_free(&pl->devzip);
+    free(pl->sub.data);
+    pl->sub.data = NULL;
+    bq_close(&pl->free_payloads);
     return NULL;
 }
 
+// Temps moyen par frame de chaque étape; le débit est fixé par la plus lente
+static void pipeline_print_timings(const pipeline_t *pl) {
+    int n = pl->frames_seen;
+    if (n <= 0 || pl->t_end <= pl->t_start) return;
+    double scale = pl->dec->scale_time;  // inclus dans t_decode (même thread)
+    double busy[3] = { pl->t_decode, pl->t_tiles, pl->t_send };
+    const char *names[3] = { "décodage", "tuiles", "envoi" };
+    int slow = 0;
+    for (int i = 1; i < 3; i++) if (busy[i] > busy[slow]) slow = i;
+    printf("Étapes (ms/frame): décodage %.2f (dont conversion RGBA %.2f), tuiles %.2f, envoi %.2f\n",
+           1000.0 * busy[0] / n, 1000.0 * scale / n, 1000.0 * busy[1] / n, 1000.0 * busy[2] / n);
+    printf("Attentes (ms/frame): décodage bloqué %.2f, tuiles sans frame %.2f, tuiles bloquées %.2f, envoi sans page %.2f\n",
+           1000.0 * pl->free_frames.wait / n, 1000.0 * pl->ready_frames.wait / n,
+           1000.0 * pl->free_payloads.wait / n, 1000.0 * pl->ready_payloads.wait / n);
+    printf("Débit: %.1f frames/s (étape la plus lente: %s)\n", n / (pl->t_end - pl->t_start), names[slow]);
+}
+
+static int pipeline_run(pipeline_t *pl) {
+    pl->stride = (pl->w * 4 + FRAME_ALIGN - 1) / FRAME_ALIGN * FRAME_ALIGN;
+    size_t frame_bytes = (size_t)pl->stride * (size_t)pl->h;
+    bq_init(&pl->free_frames);
+    bq_init(&pl->ready_frames);
+    bq_init(&pl->free_payloads);
+    bq_init(&pl->ready_payloads);
+    int rc = -1;
+    if (fd_tiles_init(&pl->engine, fd_tiles_online_cpus()) != 0) goto out;
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        void *buf = NULL;
+        if (posix_memalign(&buf, FRAME_ALIGN, frame_bytes) != 0) goto out_engine;
+        pl->frames[i].rgba = buf;
+        bq_push(&pl->free_frames, &pl->frames[i]);
+        bq_push(&pl->free_payloads, &pl->payloads[i]);
+    }
+
+    // Démarrage de l'aval vers l'amont: chaque étape a son consommateur avant de produire
+    pthread_t th_decode, th_tiles, th_send;
+    pl->t_start = now_sec();
+    if (pthread_create(&th_send, NULL, send_thread, pl) != 0) goto out_engine;
+    if (pthread_create(&th_tiles, NULL, tiles_thread, pl) != 0) {
+        bq_close(&pl->ready_payloads);
+        pthread_join(th_send, NULL);
+        goto out_engine;
+    }
+    if (pthread_create(&th_decode, NULL, decode_thread, pl) != 0) {
+        bq_close(&pl->ready_frames);
+        pthread_join(th_tiles, NULL);
+        pthread_join(th_send, NULL);
+        goto out_engine;
+    }
+    pthread_join(th_decode, NULL);
+    pthread_join(th_tiles, NULL);
+    pthread_join(th_send, NULL);
+    pl->t_end = now_sec();
+    rc = 0;
+
+out_engine:
+    fd_tiles_destroy(&pl->engine);
+out:
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+        free(pl->frames[i].rgba);
+        free(pl->payloads[i].data);
+    }
+    bq_destroy(&pl->ready_payloads);
+    bq_destroy(&pl->free_payloads);
+    bq_destroy(&pl->ready_frames);
+    bq_destroy(&pl->free_frames);
+    return rc;
+}
+
 // Fonction principale
 int main(int argc, char **argv) {
     // Initialiser les options par défaut
@@ -224,6 +856,8 @@ int main(int argc, char **argv) {
         .render_mode = 0,    // Défaut: mode render désactivé
         .dither_mode = 0,    // Défaut: dithering désactivé
         .sleep_delay = 0,    // Défaut: pas de délai
+        .delta_threshold = -1, // Défaut: toutes les tuiles à chaque frame
+        .keyframe = 30,
         .convert_opts = NULL  // Défaut: pas de conversion
     };
     
@@ -286,6 +920,23 @@ int main(int argc, char **argv) {
             }
         } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--render") == 0) {
             opts.render_mode = 1;
+        } else if (strcmp(argv[i], "--pack") == 0) {
+            opts.render_mode = 1;
+            opts.pack_mode = 1;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            opts.delta_threshold = 3;
+        } else if (strncmp(argv[i], "--delta=", 8) == 0) {
+            opts.delta_threshold = atoi(argv[i] + 8);
+            if (opts.delta_threshold < 0 || opts.delta_threshold > 255) {
+                fprintf(stderr, "Erreur: le seuil delta doit être entre 0 et 255\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--keyframe=", 11) == 0) {
+            opts.keyframe = atoi(argv[i] + 11);
+            if (opts.keyframe < 0) {
+                fprintf(stderr, "Erreur: keyframe doit être positif ou nul\n");
+                return 1;
+            }
         } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--dither") == 0) {
             opts.dither_mode = 1;
         } else if (strncmp(argv[i], "--", 2) == 0) {
@@ -309,11 +960,6 @@ int main(int argc, char **argv) {
         return 1;
     }
     
-    // Construire le chemin absolu vers send_image_page
-    char send_image_page_path[PATH_MAX];
-    snprintf_checked(send_image_page_path, sizeof(send_image_page_path), "send_image_page_path",
-                     "%s/bin/send_image_page", cwd);
-    
     if (!video_path) {
         fprintf(stderr, "Erreur: fichier vidéo requis\n\n");
         show_help(stderr, argv[0]);
@@ -440,6 +1086,10 @@ int main(int argc, char **argv) {
         return 1;
     }
     
+    // Décodage multithread (frames et/ou slices selon le codec), nombre de threads automatique
+    codec_ctx->thread_count = 0;
+    codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     if (avcodec_open2(codec_ctx, codec, NULL) < 0) {
         fprintf(stderr, "Erreur: impossible d'ouvrir le codec\n");
         avcodec_free_context(&codec_ctx);
@@ -448,7 +1098,12 @@ int main(int argc, char **argv) {
     }
     
     printf("Traitement de la vidéo: %s\n", video_path);
-    printf("Résolution: %dx%d -> 1280x720\n", codec_ctx->width, codec_ctx->height);
+    {
+        // Décodage à la taille native, recadrage 16:9 transmis au moteur de tuiles
+        int cx, cy, cw, ch;
+        fd_page_crop_16_9(codec_ctx->width, codec_ctx->height, &cx, &cy, &cw, &ch);
+        printf("Résolution: %dx%d (recadrage 16:9: %dx%d)\n", codec_ctx->width, codec_ctx->height, cw, ch);
+    }
     if (opts.max_frames > 0) {
         printf("Frames maximum: %d\n", opts.max_frames);
     }
@@ -535,7 +1190,11 @@ int main(int argc, char **argv) {
             return 1;
         }
         // printf("Répertoire de render temporaire: %s\n", video_dir);
-        printf("Dossier final sera créé dans: %s\n", final_video_dir);
+        if (opts.pack_mode) {
+            printf("Conteneur final: %s.d2v\n", final_video_dir);
+        } else {
+            printf("Dossier final sera créé dans: %s\n", final_video_dir);
+        }
     }
     
     // printf("Répertoire temporaire: %s\n", tmpdir);
@@ -545,230 +1204,83 @@ int main(int argc, char **argv) {
     signal(SIGTERM, signal_handler);
     
     // Variables pour le traitement
-    AVFrame *frame = av_frame_alloc();
-    AVPacket *pkt = av_packet_alloc();
-    int frame_count = 0;
+    video_decoder_t dec;
+    memset(&dec, 0, sizeof(dec));
+    dec.fmt_ctx = fmt_ctx;
+    dec.codec_ctx = codec_ctx;
+    dec.frame = av_frame_alloc();
+    dec.pkt = av_packet_alloc();
+    dec.stream_idx = video_stream_idx;
     
-    // En mode render, on doit d'abord compter toutes les frames
+    // En mode render, le nombre de frames fixe le padding des noms: pris dans les métadonnées
+    // du conteneur (pas de passe de comptage), corrigé en fin de rendu si besoin.
     int total_frames = 0;
+    int name_width = 1;
     if (opts.render_mode) {
-        printf("Calcul du nombre total de frames...\n");
-        
-        // Réinitialiser la lecture de la vidéo
-        av_seek_frame(fmt_ctx, video_stream_idx, 0, AVSEEK_FLAG_BACKWARD);
-        avcodec_flush_buffers(codec_ctx);
-        
-        // Compter les frames
-        while (!stop_requested) {
-            uint8_t *rgba_data = extract_frame(fmt_ctx, codec_ctx, frame, pkt, 
-                                           video_stream_idx, codec_ctx->width, codec_ctx->height);
-            if (!rgba_data) break;
-            
-            free(rgba_data);
-            total_frames++;
-            
-            if (opts.max_frames > 0 && total_frames >= opts.max_frames) break;
-        }
-        
-        printf("Nombre total de frames: %d\n", total_frames);
-        
-        // Réinitialiser à nouveau pour le traitement
-        av_seek_frame(fmt_ctx, video_stream_idx, 0, AVSEEK_FLAG_BACKWARD);
-        avcodec_flush_buffers(codec_ctx);
-    }
-    
-    // Boucle de traitement des frames
-    struct timeval start_time, current_time;
-    gettimeofday(&start_time, NULL);
-    
-    while (1) {
-        // Vérifier si CTRL+C a été pressé (vérification plus fréquente)
-        if (stop_requested) {
-            printf("Arrêt demandé par l'utilisateur.\n");
-            break;
+        total_frames = estimate_frame_count(fmt_ctx, fmt_ctx->streams[video_stream_idx]);
+        if (opts.max_frames > 0 && (total_frames == 0 || total_frames > opts.max_frames)) {
+            total_frames = opts.max_frames;
         }
-        
-        if (opts.max_frames > 0 && frame_count >= opts.max_frames) {
-            break;
-        }
-        
-        uint8_t *rgba_data = extract_frame(fmt_ctx, codec_ctx, frame, pkt, 
-                                       video_stream_idx, codec_ctx->width, codec_ctx->height);
-        if (!rgba_data) {
-            break;
-        }
-        
-        // Vérifier à nouveau le signal après extraction (car FFmpeg peut bloquer)
-        if (stop_requested) {
-            free(rgba_data);
-            printf("Arrêt demandé pendant l'extraction.\n");
-            break;
+        if (total_frames > 0) {
+            printf("Nombre total de frames (estimé): %d\n", total_frames);
+        } else {
+            printf("Nombre total de frames inconnu, noms corrigés en fin de rendu\n");
         }
-        
-        // Créer le fichier PNG pour cette frame
-        char frame_png[PATH_MAX];
-        snprintf_checked(frame_png, sizeof(frame_png), "frame_png", "%s/frame_%06d.png", tmpdir, frame_count);
-        
-        if (write_frame_png(frame_png, rgba_data, codec_ctx->width, codec_ctx->height) == 0) {
-            // printf("Frame %d: %s (%dx%d)\n", frame_count + 1, frame_png, codec_ctx->width, codec_ctx->height);
-            
-            // Vérifier le signal AVANT d'exécuter la commande
-            if (stop_requested) {
-                printf("Arrêt demandé avant l'exécution de la commande.\n");
-                unlink(frame_png);
-                free(rgba_data);
-                break;
-            }
-            
-            // Construire et exécuter la commande send_image_page
-            char cmd[8192];
-            int cmd_len = 0;
-            
-            // Base de la commande
-            cmd_len += snprintf_checked(cmd + cmd_len, sizeof(cmd) - (size_t)cmd_len, "cmd_base",
-                                        "%s -o --no-tile-optimize", send_image_page_path);
-            
-            // Ajouter l'option dithering si spécifiée
-            if (opts.dither_mode) {
-                cmd_len += snprintf_checked(cmd + cmd_len, sizeof(cmd) - (size_t)cmd_len, "cmd_dither", " -d");
-            }
-            
-            // Ajouter l'option magnify si spécifiée
-            if (opts.magnify_size > 0) {
-                cmd_len += snprintf_checked(cmd + cmd_len, sizeof(cmd) - (size_t)cmd_len, "cmd_magnify",
-                                            " -m=%d", opts.magnify_size);
-            }
-            
-            // Ajouter l'option quality si spécifiée
-            if (opts.quality_size > 0) {
-                cmd_len += snprintf_checked(cmd + cmd_len, sizeof(cmd) - (size_t)cmd_len, "cmd_quality",
-                                            " -q=%d", opts.quality_size);
-            }
-            
-            // Ajouter le fichier image avec chemin absolu
-            char abs_frame_png[PATH_MAX];
-            if (realpath(frame_png, abs_frame_png) == NULL) {
-                strcpy(abs_frame_png, frame_png);  // Fallback au chemin relatif
-            }
-            cmd_len += snprintf_checked(cmd + cmd_len, sizeof(cmd) - (size_t)cmd_len, "cmd_frame",
-                                        " \"%s\"", abs_frame_png);
-            
-            // En mode render, ajouter l'option -k pour copier les icônes
-            if (opts.render_mode) {
-                // Créer un dossier temporaire pour cette frame
-                char frame_temp_dir[PATH_MAX];
-                snprintf_checked(frame_temp_dir, sizeof(frame_temp_dir), "frame_temp_dir", "%s/frame_%03d", video_dir, frame_count);
-                char mkdir_cmd[PATH_MAX];
-                snprintf_checked(mkdir_cmd, sizeof(mkdir_cmd), "mkdir_cmd", "mkdir -p \"%s\"", frame_temp_dir);
-                (void)system(mkdir_cmd);
-                
-                // Construire la commande send_image_page avec -k pour cette frame
-                char render_cmd[8192];
-                int render_cmd_len = 0;
-                
-                render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                   "render_base", "%s -o --no-tile-optimize", send_image_page_path);
-                
-                // Ajouter l'option dithering si spécifiée
-                if (opts.dither_mode) {
-                    render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                       "render_dither", " -d");
-                }
-                
-                if (opts.magnify_size > 0) {
-                    render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                       "render_magnify", " -m=%d", opts.magnify_size);
-                }
-                
-                if (opts.quality_size > 0) {
-                    render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                       "render_quality", " -q=%d", opts.quality_size);
-                }
-                
-                // Ajouter l'option -k avec le dossier temporaire de cette frame
-                render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                   "render_k", " -k=\"%s\"=\"%s\"", frame_temp_dir, "icon");
-                
-                // Ajouter le fichier image avec chemin absolu
-                char abs_frame_png[PATH_MAX];
-                if (realpath(frame_png, abs_frame_png) == NULL) {
-                    strcpy(abs_frame_png, frame_png);  // Fallback au chemin relatif
-                }
-                render_cmd_len += snprintf_checked(render_cmd + render_cmd_len, sizeof(render_cmd) - (size_t)render_cmd_len,
-                                                   "render_frame", " \"%s\"", abs_frame_png);
-                
-                // Exécuter la commande pour cette frame
-                int render_result = system(render_cmd);
-                
-                 if (render_result == 0) {
-                    // Déplacer les icônes dans les bons dossiers de boutons
-                    for (int button = 1; button <= 14; button++) {
-                        char button_dir[PATH_MAX];
-                        snprintf_checked(button_dir, sizeof(button_dir), "button_dir", "%s/%d", video_dir, button);
-                        
-                        // Créer le dossier du bouton s'il n'existe pas
-                        char mkdir_button_cmd[PATH_MAX];
-                        snprintf_checked(mkdir_button_cmd, sizeof(mkdir_button_cmd), "mkdir_button_cmd", "mkdir -p \"%s\"", button_dir);
-                        (void)system(mkdir_button_cmd);
-                        
-                        // Déplacer l'icône du bouton correspondant
-                        char src_icon[PATH_MAX];
-                        char dst_icon[PATH_MAX];
-                        snprintf_checked(src_icon, sizeof(src_icon), "src_icon", "%s/icon-%d.png", frame_temp_dir, button);
-                        
-                        // Utiliser le nouveau format avec préfixe de bouton
-                        char button_frame_prefix[32];
-                        format_frame_prefix(button_frame_prefix, frame_count, total_frames, button);
-                        snprintf_checked(dst_icon, sizeof(dst_icon), "dst_icon", "%s/%s.png", button_dir, button_frame_prefix);
-                        
-                        rename(src_icon, dst_icon);
-                    }
-                    
-                    // Supprimer le dossier temporaire de cette frame
-                    char rmdir_cmd[PATH_MAX];
-                    snprintf_checked(rmdir_cmd, sizeof(rmdir_cmd), "rmdir_cmd", "rm -rf \"%s\"", frame_temp_dir);
-                    (void)system(rmdir_cmd);
-                } else {
-                    fprintf(stderr, "Frame %d: erreur lors du render (code: %d)\n", 
-                            frame_count + 1, render_result);
-                }
-            } else {
-                // Mode normal: exécuter la commande standard
-                (void)system(cmd);
-            }
-            
-            // Supprimer le fichier PNG immédiatement
-            unlink(frame_png);
-            // printf("Frame %d: fichier supprimé\n", frame_count + 1);
-            
-            // Délai entre frames si spécifié
-            if (opts.sleep_delay > 0) {
-                struct timespec ts = {0, opts.sleep_delay * 1000000}; // Convertir ms en nanosecondes
-                nanosleep(&ts, NULL);
-            } else {
-                // Petit délai par défaut pour éviter la surcharge
-                struct timespec ts = {0, 100000}; // 100µs en nanosecondes
-                nanosleep(&ts, NULL);
+        name_width = frame_name_width(total_frames > 0 ? total_frames : 1000);
+
+        // Un dossier par bouton
+        for (int button = 1; button <= 14 && !opts.pack_mode; button++) {
+            char button_dir[PATH_MAX];
+            snprintf_checked(button_dir, sizeof(button_dir), "button_dir", "%s/%d", video_dir, button);
+            if (mkdir(button_dir, 0755) != 0 && errno != EEXIST) {
+                fprintf(stderr, "Erreur: impossible de créer le répertoire %s\n", button_dir);
             }
-        } else {
-            fprintf(stderr, "Frame %d: erreur lors de la création du PNG\n", frame_count + 1);
         }
-        
-        free(rgba_data);
-        frame_count++;
-        
-        // Affichage progressif en mode render
-        if (opts.render_mode) {
-            gettimeofday(&current_time, NULL);
-            int elapsed_seconds = current_time.tv_sec - start_time.tv_sec;
-            int hours = elapsed_seconds / 3600;
-            int minutes = (elapsed_seconds % 3600) / 60;
-            int seconds = elapsed_seconds % 60;
-            
-            printf("\rframe rendered: [%03d/%d] elapsed time: %02d:%02d:%02d", 
-                   frame_count, total_frames, hours, minutes, seconds);
-            fflush(stdout);
+    }
+    
+    // Pipeline décodage -> tuiles -> envoi (un thread par étape)
+    pipeline_t pl;
+    memset(&pl, 0, sizeof(pl));
+    pl.opts = &opts;
+    pl.use_delta = opts.delta_threshold >= 0 && (!opts.render_mode || opts.pack_mode);
+    if (pl.use_delta) fd_delta_init(&pl.delta, opts.delta_threshold, opts.keyframe);
+    pl.dec = &dec;
+    pl.w = codec_ctx->width;
+    pl.h = codec_ctx->height;
+    pl.total_frames = total_frames;
+    pl.name_width = name_width;
+    pl.tmpdir = tmpdir;
+    pl.video_dir = video_dir;
+
+    // --pack: écrit directement à côté de la vidéo (<nom>.d2v.tmp renommé à la fin)
+    fd_d2v_writer_t pack;
+    char pack_path[PATH_MAX];
+    if (opts.pack_mode) {
+        const AVStream *st = fmt_ctx->streams[video_stream_idx];
+        AVRational fps = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+        if (fps.num <= 0 || fps.den <= 0) fps = (AVRational){ 30, 1 };
+        snprintf_checked(pack_path, sizeof(pack_path), "pack_path", "%s.d2v", final_video_dir);
+        if (fd_d2v_open(&pack, pack_path, (uint32_t)fps.num, (uint32_t)fps.den) != 0) {
+            fprintf(stderr, "Erreur: impossible de créer %s: %s\n", pack_path, strerror(errno));
+            av_frame_free(&dec.frame);
+            av_packet_free(&dec.pkt);
+            avcodec_free_context(&codec_ctx);
+            avformat_close_input(&fmt_ctx);
+            remove_tree(tmpdir);
+            return 1;
         }
+        pl.pack = &pack;
+    }
+
+    if (pipeline_run(&pl) != 0) {
+        fprintf(stderr, "Erreur: impossible de démarrer le pipeline vidéo\n");
+    }
+    int frame_count = pl.frames_sent;
+    if (pl.send_errors > 0) {
+        fprintf(stderr, "Envoi: %d frame(s) en erreur\n", pl.send_errors);
+    }
+    if (stop_requested) {
+        printf("Arrêt demandé par l'utilisateur.\n");
     }
     
     if (opts.render_mode) {
@@ -776,45 +1288,68 @@ int main(int argc, char **argv) {
     }
     
     printf("Terminé: %d frames traitées\n", frame_count);
+    pipeline_print_timings(&pl);
+    if (pl.use_delta && pl.delta.tiles_total > 0) {
+        printf("Delta: %llu/%llu tuiles envoyées (%.1f%%), frames complètes %llu, partielles %llu, inchangées %llu\n",
+               (unsigned long long)pl.delta.tiles_sent, (unsigned long long)pl.delta.tiles_total,
+               100.0 * (double)pl.delta.tiles_sent / (double)pl.delta.tiles_total,
+               (unsigned long long)pl.delta.frames_full, (unsigned long long)pl.delta.frames_partial,
+               (unsigned long long)pl.delta.frames_held);
+    }
     
     if (stop_requested) {
         printf("Arrêt propre après interruption CTRL+C.\n");
     }
     
-    // En mode render, copier le dossier final
-    if (opts.render_mode && !stop_requested) {
+    if (opts.pack_mode) {
+        if (fd_d2v_finish(&pack, !stop_requested) == 0) {
+            if (!stop_requested) printf("Conteneur créé avec succès: %s (%d frames)\n", pack_path, frame_count);
+        } else {
+            fprintf(stderr, "Erreur lors de l'écriture du conteneur %s\n", pack_path);
+        }
+    }
+
+    // En mode render, corriger le padding des noms puis déplacer le dossier final
+    if (opts.render_mode && !opts.pack_mode && !stop_requested) {
+        int final_width = frame_name_width(pl.frames_seen);
+        if (final_width != name_width) {
+            printf("Nombre réel de frames: %d, renommage des icônes...\n", pl.frames_seen);
+            if (fix_frame_names(video_dir, pl.frames_seen, name_width, final_width) != 0) {
+                fprintf(stderr, "Erreur: renommage des icônes incomplet\n");
+            }
+        }
+
         printf("Copie du dossier final...\n");
         
         printf("video_dir: %s\n", video_dir);
         printf("final_video_dir: %s\n", final_video_dir);
         
-        // Créer la commande de copie récursive silencieuse avec progression sur une ligne
-        char *cp_cmd = asprintf_alloc("cp_cmd", "cp -r \"%s\" \"%s\" 2>/dev/null", video_dir, final_video_dir);
-        
         printf("Copie des fichiers...");
         fflush(stdout);
         
-        int cp_result = system(cp_cmd);
-        free(cp_cmd);
+        // Même système de fichiers: simple rename, sinon copie (/dev/shm -> disque)
+        int cp_result = 0;
+        if (rename(video_dir, final_video_dir) != 0) {
+            cp_result = copy_tree(video_dir, final_video_dir);
+        }
         
         printf(" Terminé!                \n"); // Espaces pour effacer la ligne
         if (cp_result == 0) {
             printf("Dossier créé avec succès: %s\n", final_video_dir);
         } else {
-            fprintf(stderr, "Erreur lors de la copie du dossier (code: %d)\n", cp_result);
+            fprintf(stderr, "Erreur lors de la copie du dossier %s\n", final_video_dir);
         }
     }
     
     // Nettoyer
-    av_frame_free(&frame);
-    av_packet_free(&pkt);
+    sws_freeContext(dec.sws);
+    av_frame_free(&dec.frame);
+    av_packet_free(&dec.pkt);
     avcodec_free_context(&codec_ctx);
     avformat_close_input(&fmt_ctx);
     
     // Supprimer le répertoire temporaire
-    char *cleanup_cmd = asprintf_alloc("cleanup_cmd", "rm -rf \"%s\"", tmpdir);
-    (void)system(cleanup_cmd);
-    free(cleanup_cmd);
+    remove_tree(tmpdir);
     
     return 0;
 }
@@ -0,0 +1,689 @@
+// draw_batch: run many draw_* jobs in one process, each on an in-memory image encoded once.
+// Usage: draw_batch [-j N] [-v] [jobs.txt|-]
+//
+// Job list (stdin when no file or "-"), one job per line:
+//   <output.png> <op> [args...] [; <op> [args...]]...
+// Ops take the same arguments as the matching tool, minus the filename:
+//   square <hexcolor|transparent> [--size=N<=196]                 new square canvas (draw_square)
+//   rectangle <hexcolor|transparent> [--size=H<=196]              new wide canvas (draw_rectangle)
+//   load <file.png>                                               start from an existing PNG
+//   border <hexcolor|transparent> [--size=N] [--radius=R]         rounded square (draw_border)
+//   border_rectangle <hexcolor|transparent> [--size=H] [--radius=R]  wide counterpart (draw_border_rectangle)
+//   over <top.png>                                                top resized onto the image (draw_over)
+//   optimize [-c=N|-c N] [--palette-key=KEY]                      <= N colors, as draw_optimize; indexed
+//                                                                 output when it is the last op
+//   <name> [args...]                                              any other icons/draw_<name> tool (text,
+//       mdi, normalize, ...): the image is written to a temporary PNG, the tool runs on it, the result is
+//       read back. Needed for the tools that depend on external renderers (ImageMagick, cairo).
+// Words may be quoted ('...' or "..." with \ escapes), ';' separates ops, lines starting with '#' are
+// comments. Relative paths resolve against the project root, as in the single tools. Outputs are
+// written to a temporary file then renamed, so a reader never sees a partial PNG.
+//
+// Jobs run on a pool of threads (-j, DRAW_BATCH_THREADS, default online CPUs), each with its own
+// codec state. Errors go to stderr prefixed with the job line; the exit status is 1 if any job failed.
+// -v prints one line per job (ops, bytes, ms) and a summary.
+
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "fd_optimize.h"
+#include "fd_path.h"
+#include "fd_png.h"
+#include "fd_raster.h"
+#include "fd_resample.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define MAX_SIZE 196
+#define REF_W 442   // button 14: (196 + 196 + 50) x 196
+#define REF_H 196
+#define DEFAULT_COLORS 64
+#define MAX_THREADS 64
+
+extern char **environ;
+
+typedef struct {
+    int argc;
+    char **argv;
+} Op;
+
+typedef struct {
+    int line;
+    char *out;          // as written in the job list
+    Op *ops;
+    int n_ops;
+    char **words;       // storage of every word of the line
+    int n_words;
+} Job;
+
+typedef struct {
+    Job *jobs;
+    int n_jobs;
+    atomic_int next;
+    atomic_int failed;
+    const char *root;   // NULL when the project root could not be located
+    int verbose;
+} Batch;
+
+// Per-thread working state: reused from one job to the next.
+typedef struct {
+    fd_png_dec_t dec;
+    fd_png_enc_t enc;
+    uint8_t *rgba;
+    int w, h;
+    size_t cap;
+    uint8_t *idx;
+    size_t idx_cap;
+    uint8_t pal[256][4];
+    int pal_n;
+    int indexed;        // idx/pal hold the image (last op was optimize)
+} Worker;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int hexbyte(char h, char l) {
+    int v = 0;
+    if (h >= '0' && h <= '9') v = (h - '0') << 4;
+    else if (h >= 'A' && h <= 'F') v = (h - 'A' + 10) << 4;
+    else if (h >= 'a' && h <= 'f') v = (h - 'a' + 10) << 4;
+    else return -1;
+    if (l >= '0' && l <= '9') v |= (l - '0');
+    else if (l >= 'A' && l <= 'F') v |= (l - 'A' + 10);
+    else if (l >= 'a' && l <= 'f') v |= (l - 'a' + 10);
+    else return -1;
+    return v;
+}
+
+static int parse_color(const char *s, uint8_t *r, uint8_t *g, uint8_t *b, int *is_transparent) {
+    if (strcasecmp(s, "transparent") == 0) {
+        *r = *g = *b = 0;
+        *is_transparent = 1;
+        return 0;
+    }
+    *is_transparent = 0;
+    if (strlen(s) != 6) return -1;
+    int r8 = hexbyte(s[0], s[1]);
+    int g8 = hexbyte(s[2], s[3]);
+    int b8 = hexbyte(s[4], s[5]);
+    if (r8 < 0 || g8 < 0 || b8 < 0) return -1;
+    *r = (uint8_t)r8;
+    *g = (uint8_t)g8;
+    *b = (uint8_t)b8;
+    return 0;
+}
+
+static int clamp_int(int v, int lo, int hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+static int wide_w_from_h(int h) { return (h * REF_W + REF_H / 2) / REF_H; }
+
+// --- job list ---
+
+// Split one line into words; a ';' outside quotes is returned as its own word.
+static int split_words(const char *line, char ***out) {
+    int n = 0, cap = 8;
+    char **words = malloc((size_t)cap * sizeof(char *));
+    char *buf = malloc(strlen(line) + 1);
+    if (!words || !buf) {
+        free(words);
+        free(buf);
+        return -1;
+    }
+    const char *p = line;
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+        if (!*p) break;
+        size_t len = 0;
+        if (*p == ';') {
+            buf[len++] = *p++;
+        } else {
+            char quote = 0;
+            while (*p) {
+                char c = *p;
+                if (quote) {
+                    if (c == quote) quote = 0;
+                    else if (c == '\\' && quote == '"' && p[1]) buf[len++] = *++p;
+                    else buf[len++] = c;
+                } else if (c == '\'' || c == '"') {
+                    quote = c;
+                } else if (c == '\\' && p[1]) {
+                    buf[len++] = *++p;
+                } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ';') {
+                    break;
+                } else {
+                    buf[len++] = c;
+                }
+                p++;
+            }
+            if (quote) {
+                free(buf);
+                for (int i = 0; i < n; i++) free(words[i]);
+                free(words);
+                return -2;
+            }
+        }
+        if (n == cap) {
+            cap *= 2;
+            char **nw = realloc(words, (size_t)cap * sizeof(char *));
+            if (!nw) break;
+            words = nw;
+        }
+        words[n] = malloc(len + 1);
+        if (!words[n]) break;
+        memcpy(words[n], buf, len);
+        words[n][len] = '\0';
+        n++;
+    }
+    free(buf);
+    *out = words;
+    return n;
+}
+
+static void job_free(Job *j) {
+    for (int i = 0; i < j->n_words; i++) free(j->words[i]);
+    free(j->words);
+    for (int i = 0; i < j->n_ops; i++) free(j->ops[i].argv);
+    free(j->ops);
+}
+
+// Parse one job line. Returns 1 for a job, 0 for a blank/comment line, -1 on error.
+static int parse_job(const char *line, int line_no, Job *j) {
+    memset(j, 0, sizeof(*j));
+    j->line = line_no;
+    const char *p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p || *p == '#' || *p == '\n' || *p == '\r') return 0;
+    int n = split_words(line, &j->words);
+    if (n == -2) {
+        fprintf(stderr, "draw_batch: line %d: unterminated quote\n", line_no);
+        return -1;
+    }
+    if (n < 0) return -1;
+    j->n_words = n;
+    if (n < 2 || strcmp(j->words[0], ";") == 0) {
+        fprintf(stderr, "draw_batch: line %d: expected <output.png> <op> [args...]\n", line_no);
+        return -1;
+    }
+    j->out = j->words[0];
+    j->ops = calloc((size_t)n, sizeof(Op));
+    if (!j->ops) return -1;
+    for (int i = 1; i < n;) {
+        if (strcmp(j->words[i], ";") == 0) {
+            i++;
+            continue;
+        }
+        int end = i;
+        while (end < n && strcmp(j->words[end], ";") != 0) end++;
+        Op *op = &j->ops[j->n_ops++];
+        op->argc = end - i;
+        op->argv = malloc((size_t)(op->argc + 1) * sizeof(char *));
+        if (!op->argv) return -1;
+        for (int k = 0; k < op->argc; k++) op->argv[k] = j->words[i + k];
+        op->argv[op->argc] = NULL;
+        i = end;
+    }
+    if (j->n_ops == 0) {
+        fprintf(stderr, "draw_batch: line %d: no operation\n", line_no);
+        return -1;
+    }
+    return 1;
+}
+
+static char *read_all(FILE *f) {
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+    if (!buf) return NULL;
+    size_t n;
+    while ((n = fread(buf + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (cap - len < 2) {
+            char *nb = realloc(buf, cap * 2);
+            if (!nb) {
+                free(buf);
+                return NULL;
+            }
+            buf = nb;
+            cap *= 2;
+        }
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+// --- image ops ---
+
+static int worker_canvas(Worker *wk, int w, int h) {
+    size_t need = (size_t)w * (size_t)h * 4;
+    if (need > wk->cap) {
+        uint8_t *p = realloc(wk->rgba, need);
+        if (!p) return -1;
+        wk->rgba = p;
+        wk->cap = need;
+    }
+    wk->w = w;
+    wk->h = h;
+    wk->indexed = 0;
+    return 0;
+}
+
+static int resolve(const Batch *b, const char *in, char *out, size_t cap) {
+    if (in[0] != '/' && !b->root) return -1;
+    return fd_resolve_root_relative(b->root, in, out, cap);
+}
+
+static int worker_load(Worker *wk, const char *path) {
+    if (fd_png_load(&wk->dec, path) != 0) return -1;
+    if (worker_canvas(wk, wk->dec.w, wk->dec.h) != 0) return -1;
+    memcpy(wk->rgba, wk->dec.rgba, (size_t)wk->w * (size_t)wk->h * 4);
+    return 0;
+}
+
+// Indexed image back to RGBA, when more ops follow an optimize.
+static void worker_expand(Worker *wk) {
+    if (!wk->indexed) return;
+    size_t pixels = (size_t)wk->w * (size_t)wk->h;
+    for (size_t i = 0; i < pixels; i++) memcpy(wk->rgba + i * 4, wk->pal[wk->idx[i]], 4);
+    wk->indexed = 0;
+}
+
+static int op_fill(Worker *wk, const Op *op, int wide, char *err, size_t errsz) {
+    if (op->argc < 2) {
+        snprintf(err, errsz, "%s: color required", op->argv[0]);
+        return -1;
+    }
+    int size = MAX_SIZE;
+    for (int i = 2; i < op->argc; i++) {
+        if (strncmp(op->argv[i], "--size=", 7) == 0) size = atoi(op->argv[i] + 7);
+    }
+    uint8_t r, g, b;
+    int transparent;
+    if (parse_color(op->argv[1], &r, &g, &b, &transparent) != 0) {
+        snprintf(err, errsz, "invalid color: %s", op->argv[1]);
+        return -1;
+    }
+    size = clamp_int(size, 1, MAX_SIZE);
+    int w = wide ? clamp_int(wide_w_from_h(size), 1, REF_W) : size;
+    if (worker_canvas(wk, w, size) != 0) {
+        snprintf(err, errsz, "out of memory");
+        return -1;
+    }
+    const uint8_t c[4] = { r, g, b, (uint8_t)(transparent ? 0 : 255) };
+    uint32_t px;
+    memcpy(&px, c, 4);
+    fd_raster_fill_u32(wk->rgba, w * size, px);
+    return 0;
+}
+
+static int op_border(Worker *wk, const Op *op, int wide, char *err, size_t errsz) {
+    if (!wk->rgba || wk->w == 0) {
+        snprintf(err, errsz, "%s: no image (start with square, rectangle or load)", op->argv[0]);
+        return -1;
+    }
+    if (op->argc < 2) {
+        snprintf(err, errsz, "%s: color required", op->argv[0]);
+        return -1;
+    }
+    int size = MAX_SIZE;
+    int radius = wide ? 12 : 0;
+    for (int i = 2; i < op->argc; i++) {
+        if (strncmp(op->argv[i], "--size=", 7) == 0) size = atoi(op->argv[i] + 7);
+        else if (strncmp(op->argv[i], "--radius=", 9) == 0) radius = atoi(op->argv[i] + 9);
+    }
+    uint8_t r, g, b;
+    int transparent;
+    if (parse_color(op->argv[1], &r, &g, &b, &transparent) != 0) {
+        snprintf(err, errsz, "invalid color: %s", op->argv[1]);
+        return -1;
+    }
+    size = clamp_int(size, 1, MAX_SIZE);
+    radius = clamp_int(radius, 0, 50);
+    int rect_w = size, rect_h = size;
+    if (wide) {
+        rect_w = clamp_int(wide_w_from_h(size), 1, wk->w);
+        rect_h = clamp_int(size, 1, wk->h);
+    } else if (wk->w != wk->h || wk->w > MAX_SIZE) {
+        snprintf(err, errsz, "border: unsupported dimensions %dx%d", wk->w, wk->h);
+        return -1;
+    }
+    worker_expand(wk);
+    fd_rrect_t rr = fd_rrect_centered(wk->w, wk->h, rect_w, rect_h, (rect_h * radius) / 100);
+    if (transparent) fd_raster_clear_rrect(wk->rgba, wk->w, wk->h, 4 * (size_t)wk->w, &rr);
+    else fd_raster_fill_rrect(wk->rgba, wk->w, wk->h, 4 * (size_t)wk->w, &rr, r, g, b);
+    return 0;
+}
+
+static int op_over(const Batch *bt, Worker *wk, const Op *op, char *err, size_t errsz) {
+    if (!wk->rgba || wk->w == 0) {
+        snprintf(err, errsz, "over: no image (start with square, rectangle or load)");
+        return -1;
+    }
+    char path[PATH_MAX];
+    if (op->argc < 2 || resolve(bt, op->argv[1], path, sizeof(path)) != 0) {
+        snprintf(err, errsz, "over: top image path required");
+        return -1;
+    }
+    if (fd_png_load(&wk->dec, path) != 0) {
+        snprintf(err, errsz, "failed to read top PNG: %s", path);
+        return -1;
+    }
+    uint8_t *top = fd_resample_rgba_alloc(wk->dec.rgba, wk->dec.w, wk->dec.h, wk->w, wk->h, FD_FILTER_TRIANGLE, 0);
+    if (!top) {
+        snprintf(err, errsz, "out of memory");
+        return -1;
+    }
+    worker_expand(wk);
+    fd_raster_over_image(wk->rgba, top, (size_t)wk->w * (size_t)wk->h);
+    free(top);
+    return 0;
+}
+
+static int op_optimize(Worker *wk, const Op *op, char *err, size_t errsz) {
+    if (!wk->rgba || wk->w == 0) {
+        snprintf(err, errsz, "optimize: no image (start with square, rectangle or load)");
+        return -1;
+    }
+    int colors = DEFAULT_COLORS;
+    const char *key = NULL;
+    for (int i = 1; i < op->argc; i++) {
+        const char *a = op->argv[i];
+        if ((strcmp(a, "-c") == 0 || strcmp(a, "--color") == 0) && i + 1 < op->argc) colors = atoi(op->argv[++i]);
+        else if (strncmp(a, "-c=", 3) == 0) colors = atoi(a + 3);
+        else if (strncmp(a, "--color=", 8) == 0) colors = atoi(a + 8);
+        else if (strncmp(a, "--palette-key=", 14) == 0) key = a + 14;
+    }
+    worker_expand(wk);
+    size_t pixels = (size_t)wk->w * (size_t)wk->h;
+    if (pixels > wk->idx_cap) {
+        uint8_t *p = realloc(wk->idx, pixels);
+        if (!p) {
+            snprintf(err, errsz, "out of memory");
+            return -1;
+        }
+        wk->idx = p;
+        wk->idx_cap = pixels;
+    }
+    if (fd_opt_quantize(wk->rgba, wk->w, wk->h, colors, key, wk->pal, &wk->pal_n, wk->idx, NULL) != 0) {
+        snprintf(err, errsz, "optimize: quantization failed");
+        return -1;
+    }
+    wk->indexed = 1;
+    return 0;
+}
+
+// Encode the current image to path (indexed after optimize, 8-bit RGBA otherwise).
+static int worker_save(Worker *wk, const char *path, int effort, size_t *len) {
+    size_t cap = fd_png_bound(wk->w, wk->h);
+    uint8_t *out = malloc(cap);
+    if (!out) return -1;
+    int rc;
+    if (wk->indexed) {
+        rc = fd_png_encode_indexed_z(&wk->enc, wk->idx, wk->w, wk->h, (size_t)wk->w, (const uint8_t (*)[4])wk->pal,
+                                     wk->pal_n, Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY, FD_PNG_FILTER_NONE, out,
+                                     cap, len);
+    } else {
+        rc = fd_png_encode_rgba8(&wk->enc, wk->rgba, wk->w, wk->h, (size_t)wk->w * 4, effort, out, cap, len);
+    }
+    if (rc == 0) rc = fd_png_write_file(path, out, *len);
+    free(out);
+    return rc;
+}
+
+// Any other draw_<name> tool: write the image, run the tool on it, read it back.
+static int op_external(const Batch *bt, Worker *wk, const Op *op, const char *tmp, char *err, size_t errsz) {
+    const char *name = op->argv[0];
+    for (const char *c = name; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') || *c == '_')) {
+            snprintf(err, errsz, "unknown op: %s", name);
+            return -1;
+        }
+    }
+    if (!bt->root) {
+        snprintf(err, errsz, "%s: could not locate project root (set PROJECT_ROOT)", name);
+        return -1;
+    }
+    char tool[PATH_MAX];
+    fd_snprintf_checked(tool, sizeof(tool), "tool", "%s/icons/draw_%s", bt->root, name);
+    if (access(tool, X_OK) != 0) {
+        snprintf(err, errsz, "unknown op: %s (no icons/draw_%s)", name, name);
+        return -1;
+    }
+    size_t len = 0;
+    if (wk->rgba && wk->w > 0 && worker_save(wk, tmp, FD_PNG_FAST, &len) != 0) {
+        snprintf(err, errsz, "%s: failed to write %s", name, tmp);
+        return -1;
+    }
+
+    char **argv = malloc((size_t)(op->argc + 2) * sizeof(char *));
+    if (!argv) {
+        snprintf(err, errsz, "out of memory");
+        return -1;
+    }
+    argv[0] = tool;
+    for (int i = 1; i < op->argc; i++) argv[i] = op->argv[i];
+    argv[op->argc] = (char *)tmp;
+    argv[op->argc + 1] = NULL;
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);   // "Updated ..." lines
+    pid_t pid;
+    int rc = posix_spawn(&pid, tool, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    free(argv);
+    if (rc != 0) {
+        snprintf(err, errsz, "%s: spawn failed: %s", name, strerror(rc));
+        return -1;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        snprintf(err, errsz, "draw_%s failed (status %d)", name, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return -1;
+    }
+    if (worker_load(wk, tmp) != 0) {
+        snprintf(err, errsz, "%s: failed to read back %s", name, tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_job(const Batch *bt, Worker *wk, const Job *j, int job_no) {
+    char err[PATH_MAX + 128] = "";
+    char out[PATH_MAX], tmp[PATH_MAX + 64];
+    double t0 = now_ms();
+    if (resolve(bt, j->out, out, sizeof(out)) != 0) {
+        fprintf(stderr, "draw_batch: line %d: could not resolve %s (set PROJECT_ROOT)\n", j->line, j->out);
+        return -1;
+    }
+    if (fd_mkdir_p_parent(out) != 0) {
+        fprintf(stderr, "draw_batch: line %d: mkdir for %s: %s\n", j->line, out, strerror(errno));
+        return -1;
+    }
+    // .png suffix kept: some tools check the extension
+    fd_snprintf_checked(tmp, sizeof(tmp), "tmp", "%s.%d.%d.tmp.png", out, (int)getpid(), job_no);
+    wk->w = wk->h = 0;
+    wk->indexed = 0;
+
+    int rc = 0;
+    for (int i = 0; i < j->n_ops && rc == 0; i++) {
+        const Op *op = &j->ops[i];
+        const char *name = op->argv[0];
+        if (strcmp(name, "square") == 0) rc = op_fill(wk, op, 0, err, sizeof(err));
+        else if (strcmp(name, "rectangle") == 0) rc = op_fill(wk, op, 1, err, sizeof(err));
+        else if (strcmp(name, "border") == 0) rc = op_border(wk, op, 0, err, sizeof(err));
+        else if (strcmp(name, "border_rectangle") == 0) rc = op_border(wk, op, 1, err, sizeof(err));
+        else if (strcmp(name, "over") == 0 || strcmp(name, "over_rectangle") == 0) rc = op_over(bt, wk, op, err, sizeof(err));
+        else if (strcmp(name, "optimize") == 0 || strcmp(name, "optimize_rectangle") == 0) rc = op_optimize(wk, op, err, sizeof(err));
+        else if (strcmp(name, "load") == 0) {
+            char path[PATH_MAX];
+            if (op->argc < 2 || resolve(bt, op->argv[1], path, sizeof(path)) != 0 || worker_load(wk, path) != 0) {
+                snprintf(err, sizeof(err), "load: failed to read %s", op->argc > 1 ? op->argv[1] : "(none)");
+                rc = -1;
+            }
+        } else {
+            rc = op_external(bt, wk, op, tmp, err, sizeof(err));
+        }
+    }
+    size_t len = 0;
+    if (rc == 0 && wk->w == 0) {
+        snprintf(err, sizeof(err), "no image produced");
+        rc = -1;
+    }
+    if (rc == 0 && (worker_save(wk, tmp, FD_PNG_SMALL, &len) != 0 || rename(tmp, out) != 0)) {
+        snprintf(err, sizeof(err), "failed to write %s", out);
+        rc = -1;
+    }
+    if (rc != 0) {
+        unlink(tmp);
+        fprintf(stderr, "draw_batch: line %d: %s\n", j->line, err);
+        return -1;
+    }
+    if (bt->verbose) {
+        fprintf(stderr, "draw_batch: line %d: %s (%dx%d, %d ops, %zu bytes%s) %.2f ms\n", j->line, out, wk->w, wk->h,
+                j->n_ops, len, wk->indexed ? ", indexed" : "", now_ms() - t0);
+    }
+    return 0;
+}
+
+static void *batch_worker(void *arg) {
+    Batch *bt = (Batch *)arg;
+    Worker wk;
+    memset(&wk, 0, sizeof(wk));
+    fd_png_dec_init(&wk.dec);
+    fd_png_enc_init(&wk.enc);
+    for (;;) {
+        int i = atomic_fetch_add(&bt->next, 1);
+        if (i >= bt->n_jobs) break;
+        if (run_job(bt, &wk, &bt->jobs[i], i) != 0) atomic_fetch_add(&bt->failed, 1);
+    }
+    fd_png_dec_free(&wk.dec);
+    fd_png_enc_free(&wk.enc);
+    free(wk.rgba);
+    free(wk.idx);
+    return NULL;
+}
+
+static void show_help(FILE *out, const char *prog) {
+    fprintf(out, "Usage: %s [-j N] [-v] [jobs.txt|-]\n\n", prog);
+    fprintf(out, "One job per line: <output.png> <op> [args...] [; <op> [args...]]...\n");
+    fprintf(out, "Ops: square, rectangle, load, border, border_rectangle, over, optimize,\n");
+    fprintf(out, "     or any other icons/draw_<name> tool (run on a temporary PNG).\n\n");
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -j N    worker threads (default DRAW_BATCH_THREADS or online CPUs)\n");
+    fprintf(out, "  -v      one line per job and a summary on stderr\n");
+    fprintf(out, "  -h      this help\n");
+}
+
+int main(int argc, char **argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *thr_env = getenv("DRAW_BATCH_THREADS");
+    if (thr_env && thr_env[0]) threads = atol(thr_env);
+    int verbose = 0;
+    const char *list = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            show_help(stdout, argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2]) {
+            threads = atol(argv[i] + 2);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (!list) {
+            list = argv[i];
+        } else {
+            show_help(stderr, argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *f = (!list || strcmp(list, "-") == 0) ? stdin : fopen(list, "r");
+    if (!f) {
+        fprintf(stderr, "draw_batch: %s: %s\n", list, strerror(errno));
+        return 1;
+    }
+    char *text = read_all(f);
+    if (f != stdin) fclose(f);
+    if (!text) {
+        fprintf(stderr, "draw_batch: out of memory\n");
+        return 1;
+    }
+
+    Batch bt;
+    memset(&bt, 0, sizeof(bt));
+    bt.verbose = verbose;
+    int cap = 64, bad = 0;
+    bt.jobs = malloc((size_t)cap * sizeof(Job));
+    int line_no = 0;
+    for (char *line = text; line && bt.jobs;) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        line_no++;
+        if (bt.n_jobs == cap) {
+            Job *nj = realloc(bt.jobs, (size_t)cap * 2 * sizeof(Job));
+            if (!nj) break;
+            bt.jobs = nj;
+            cap *= 2;
+        }
+        int r = parse_job(line, line_no, &bt.jobs[bt.n_jobs]);
+        if (r > 0) bt.n_jobs++;
+        else {
+            job_free(&bt.jobs[bt.n_jobs]);
+            if (r < 0) bad++;
+        }
+        line = nl ? nl + 1 : NULL;
+    }
+    free(text);
+    if (!bt.jobs) {
+        fprintf(stderr, "draw_batch: out of memory\n");
+        return 1;
+    }
+
+    char root[PATH_MAX];
+    if (fd_find_project_root(root, sizeof(root)) == 0) bt.root = root;
+
+    if (threads > bt.n_jobs) threads = bt.n_jobs;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads < 1) threads = 1;
+    double t0 = now_ms();
+    pthread_t tids[MAX_THREADS];
+    int started[MAX_THREADS] = {0};
+    for (long t = 1; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, batch_worker, &bt) == 0) started[t] = 1;
+    }
+    batch_worker(&bt);
+    for (long t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+    }
+    int failed = atomic_load(&bt.failed) + bad;
+    if (verbose) {
+        fprintf(stderr, "draw_batch: %d jobs, %d failed, %ld threads, %.2f ms\n", bt.n_jobs + bad, failed, threads,
+                now_ms() - t0);
+    }
+    for (int i = 0; i < bt.n_jobs; i++) job_free(&bt.jobs[i]);
+    free(bt.jobs);
+    return failed ? 1 : 0;
+}
@@ -10,12 +10,12 @@
 #include <cairo/cairo.h>
 #include <librsvg-2.0/librsvg/rsvg.h>
 #include <errno.h>
-#include <zlib.h>
 #include <cairo.h>
 #include <librsvg/rsvg.h>
 #include <stdarg.h>
 
 #include "fd_path.h"
+#include "fd_png.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -35,81 +35,6 @@ static void snprintf_checked(char *dst, size_t cap, const char *label, const cha
     if (n < 0 || (size_t)n >= cap) die_snprintf(label);
 }
 
-// Silence intentional unused warnings for static helpers kept for future refactors.
-#if defined(__GNUC__) || defined(__clang__)
-#define FD_UNUSED __attribute__((unused))
-#else
-#define FD_UNUSED
-#endif
-
-// CRC helpers
-static uint32_t crc_table[256];
-static int crc_ready = 0;
-static void crc_init(void) {
-    for (uint32_t n = 0; n < 256; n++) {
-        uint32_t c = n;
-        for (int k = 0; k < 8; k++) {
-            c = (c & 1) ? 0xedb88320U ^ (c >> 1) : (c >> 1);
-        }
-        crc_table[n] = c;
-    }
-    crc_ready = 1;
-}
-static uint32_t crc_update(uint32_t c, const unsigned char *buf, size_t len) {
-    if (!crc_ready) crc_init();
-    for (size_t i = 0; i < len; i++) {
-        c = crc_table[(c ^ buf[i]) & 0xff] ^ (c >> 8);
-    }
-    return c;
-}
-static uint32_t crc_calc(const unsigned char *buf, size_t len) {
-    return crc_update(0xffffffffL, buf, len) ^ 0xffffffffL;
-}
-
-static void write_be32(FILE *f, uint32_t v) {
-    unsigned char b[4] = { (v>>24)&0xff, (v>>16)&0xff, (v>>8)&0xff, v&0xff };
-    fwrite(b,1,4,f);
-}
-
-static int write_chunk(FILE *f, const char *type, const unsigned char *data, size_t len) {
-    write_be32(f, (uint32_t)len);
-    fwrite(type,1,4,f);
-    if (len>0) fwrite(data,1,len,f);
-    size_t crc_len = len + 4;
-    unsigned char *buf = malloc(crc_len);
-    if (!buf) return -1;
-    memcpy(buf, type, 4);
-    if (len>0) memcpy(buf+4, data, len);
-    uint32_t c = crc_calc(buf, crc_len);
-    free(buf);
-    write_be32(f, c);
-    return 0;
-}
-
-static FD_UNUSED int save_png_raw(const char *path, const unsigned char *raw, uint32_t width, uint32_t height) {
-    FILE *f = fopen(path, "wb");
-    if (!f) { perror("write png"); return -1; }
-    const unsigned char sig[8] = {137,80,78,71,13,10,26,10};
-    fwrite(sig,1,8,f);
-    unsigned char ihdr[13];
-    ihdr[0]=(width>>24)&0xff; ihdr[1]=(width>>16)&0xff; ihdr[2]=(width>>8)&0xff; ihdr[3]=width&0xff;
-    ihdr[4]=(height>>24)&0xff; ihdr[5]=(height>>16)&0xff; ihdr[6]=(height>>8)&0xff; ihdr[7]=height&0xff;
-    ihdr[8]=8; ihdr[9]=6; ihdr[10]=0; ihdr[11]=0; ihdr[12]=0;
-    write_chunk(f, "IHDR", ihdr, 13);
-
-    size_t raw_len = (1 + 4*width) * height;
-    uLongf comp_bound = compressBound(raw_len);
-    unsigned char *zbuf = malloc(comp_bound);
-    if (!zbuf) { fclose(f); return -1; }
-    int zres = compress2(zbuf, &comp_bound, raw, raw_len, Z_BEST_COMPRESSION);
-    if (zres != Z_OK) { free(zbuf); fclose(f); return -1; }
-    write_chunk(f, "IDAT", zbuf, comp_bound);
-    write_chunk(f, "IEND", NULL, 0);
-    free(zbuf);
-    fclose(f);
-    return 0;
-}
-
 // static const char *base_name(const char *path) {
 //     const char *slash = strrchr(path, '/');
 //     return slash ? slash + 1 : path;
@@ -146,6 +71,70 @@ static int parse_color(const char *s, uint8_t *r, uint8_t *g, uint8_t *b, int *i
     return 0;
 }
 
+// PNG <-> cairo ARGB32 (premultiplied, native-endian words) through the shared codec (fd_png.h).
+static cairo_surface_t *load_png_surface(const char *path) {
+    fd_png_dec_t dec;
+    fd_png_dec_init(&dec);
+    if (fd_png_load(&dec, path) != 0) {
+        fd_png_dec_free(&dec);
+        return NULL;
+    }
+    cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, dec.w, dec.h);
+    if (cairo_surface_status(surf) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(surf);
+        fd_png_dec_free(&dec);
+        return NULL;
+    }
+    cairo_surface_flush(surf);
+    unsigned char *data = cairo_image_surface_get_data(surf);
+    int stride = cairo_image_surface_get_stride(surf);
+    for (int y = 0; y < dec.h; y++) {
+        uint32_t *row = (uint32_t *)(data + (size_t)y * (size_t)stride);
+        const uint8_t *s = dec.rgba + (size_t)y * (size_t)dec.w * 4;
+        for (int x = 0; x < dec.w; x++, s += 4) {
+            uint32_t a = s[3];
+            uint32_t r = (s[0] * a + 127) / 255, g = (s[1] * a + 127) / 255, b = (s[2] * a + 127) / 255;
+            row[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+    cairo_surface_mark_dirty(surf);
+    fd_png_dec_free(&dec);
+    return surf;
+}
+
+static int save_png_surface(cairo_surface_t *surf, const char *path) {
+    cairo_surface_flush(surf);
+    int w = cairo_image_surface_get_width(surf);
+    int h = cairo_image_surface_get_height(surf);
+    int stride = cairo_image_surface_get_stride(surf);
+    const unsigned char *data = cairo_image_surface_get_data(surf);
+    if (!data || w <= 0 || h <= 0) return -1;
+    uint8_t *rgba = malloc((size_t)w * (size_t)h * 4);
+    if (!rgba) return -1;
+    for (int y = 0; y < h; y++) {
+        const uint32_t *row = (const uint32_t *)(data + (size_t)y * (size_t)stride);
+        uint8_t *o = rgba + (size_t)y * (size_t)w * 4;
+        for (int x = 0; x < w; x++, o += 4) {
+            uint32_t px = row[x], a = px >> 24;
+            if (a == 0) {
+                o[0] = o[1] = o[2] = o[3] = 0;
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = (((px >> (16 - 8 * c)) & 0xff) * 255 + a / 2) / a;
+                o[c] = (uint8_t)(v > 255 ? 255 : v);
+            }
+            o[3] = (uint8_t)a;
+        }
+    }
+    fd_png_enc_t enc;
+    fd_png_enc_init(&enc);
+    int rc = fd_png_save_rgba(&enc, path, rgba, w, h, (size_t)w * 4, FD_PNG_SMALL);
+    fd_png_enc_free(&enc);
+    free(rgba);
+    return rc;
+}
+
 static void colorize_surface(cairo_surface_t *surf, uint8_t r, uint8_t g, uint8_t b, int is_transparent) {
     unsigned char *data = cairo_image_surface_get_data(surf);
     int stride = cairo_image_surface_get_stride(surf);
@@ -305,8 +294,8 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    cairo_surface_t *target = cairo_image_surface_create_from_png(png_path);
-    if (cairo_surface_status(target) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_t *target = load_png_surface(png_path);
+    if (!target) {
         // create blank 196x196 transparent if missing
         target = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 196, 196);
         // Initialize as transparent
@@ -367,11 +356,11 @@ int main(int argc, char **argv) {
     cairo_paint(ct);
     cairo_destroy(ct);
 
-    // Write via cairo (handles premultiplied format)
-    cairo_surface_flush(target);
-    cairo_surface_write_to_png(target, png_path);
+    // Write through fd_png.h (un-premultiplies)
+    int rc = save_png_surface(target, png_path);
+    if (rc != 0) fprintf(stderr, "Failed to write %s\n", png_path);
 
     cairo_surface_destroy(overlay);
     cairo_surface_destroy(target);
-    return 0;
+    return rc == 0 ? 0 : 1;
 }
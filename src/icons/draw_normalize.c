@@ -14,6 +14,8 @@
 #include <string.h>
 #include <zlib.h>
 
+#include "fd_resample.h"
+
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
@@ -28,6 +30,10 @@ static int g_normalize_fs_dither_enable = 1;
 // Per-channel quantization bits for dithering (2..8). 6 is a decent default.
 static int g_normalize_fs_dither_bits = 3;
 
+// Quick knobs: resampling filter (FD_FILTER_BOX / TRIANGLE / LANCZOS3) and gamma-correct resize.
+static int g_normalize_filter = FD_FILTER_TRIANGLE;
+static int g_normalize_gamma = 0;
+
 static void die_errno(const char *msg) {
     fprintf(stderr, "Error: %s: %s\n", msg, strerror(errno));
     exit(1);
@@ -176,35 +182,14 @@ static void crop_center_square(const uint8_t *src, int sw, int sh, uint8_t **out
 }
 
 static void resize_bilinear_rgba(const uint8_t *src, int sw, int sh, uint8_t **out, int *out_w, int *out_h, int dw, int dh) {
-    uint8_t *dst = xcalloc((size_t)dw * (size_t)dh, 4);
-    for (int y = 0; y < dh; y++) {
-        float gy = (dh == 1) ? 0.0f : ((float)y * (float)(sh - 1)) / (float)(dh - 1);
-        int y0 = (int)gy;
-        int y1 = (y0 + 1 < sh) ? (y0 + 1) : y0;
-        float fy = gy - (float)y0;
-        for (int x = 0; x < dw; x++) {
-            float gx = (dw == 1) ? 0.0f : ((float)x * (float)(sw - 1)) / (float)(dw - 1);
-            int x0 = (int)gx;
-            int x1 = (x0 + 1 < sw) ? (x0 + 1) : x0;
-            float fx = gx - (float)x0;
-
-            const uint8_t *p00 = src + ((size_t)y0 * (size_t)sw + (size_t)x0) * 4;
-            const uint8_t *p10 = src + ((size_t)y0 * (size_t)sw + (size_t)x1) * 4;
-            const uint8_t *p01 = src + ((size_t)y1 * (size_t)sw + (size_t)x0) * 4;
-            const uint8_t *p11 = src + ((size_t)y1 * (size_t)sw + (size_t)x1) * 4;
-
-            float w00 = (1.0f - fx) * (1.0f - fy);
-            float w10 = fx * (1.0f - fy);
-            float w01 = (1.0f - fx) * fy;
-            float w11 = fx * fy;
-
-            uint8_t *d = dst + ((size_t)y * (size_t)dw + (size_t)x) * 4;
-            for (int c = 0; c < 4; c++) {
-                float v = w00 * (float)p00[c] + w10 * (float)p10[c] + w01 * (float)p01[c] + w11 * (float)p11[c];
-                d[c] = clamp_u8((int)(v + 0.5f));
-            }
-        }
+    uint8_t *dst = xmalloc((size_t)dw * (size_t)dh * 4);
+    fd_resampler_t rs;
+    fd_resampler_init(&rs);
+    if (fd_resample_rgba(&rs, src, sw, sh, (size_t)sw * 4, dst, dw, dh, (size_t)dw * 4,
+                         g_normalize_filter, g_normalize_gamma ? FD_RS_GAMMA : 0) != 0) {
+        die_errno("resample");
     }
+    fd_resampler_free(&rs);
     *out = dst;
     *out_w = dw;
     *out_h = dh;
@@ -0,0 +1,205 @@
+// Pre-rendered video container (.d2v): one file holding, for each frame, the ready-to-send
+// HID packets of the page upload (fd_devzip.h), so playback is mmap + USB writes only.
+//
+// Layout (little-endian):
+//   header  64 bytes  "D2VP" u32 version u32 frame_count u32 fps_num u32 fps_den
+//                     u32 packet_size u64 index_offset, zero-filled to 64
+//   frames            frame i = packets[i] * packet_size bytes, packet 0 starts with 7c 7c <cmd> <len>
+//                     (0x0001 full page, 0x000d partial update of the changed tiles); packets[i] == 0:
+//                     page unchanged, nothing to send for that frame (--delta)
+//   index   16 bytes per frame: u64 offset u32 packets u32 flags (FD_D2V_FRAME_*)
+//
+// The writer appends frames as they are rendered (frame count unknown up front), writes the
+// index last and renames <path>.tmp to <path>, so a player never maps a half-written file.
+
+#ifndef FD_D2V_H
+#define FD_D2V_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_D2V_MAGIC "D2VP"
+#define FD_D2V_VERSION 1
+#define FD_D2V_HEADER_SIZE 64
+#define FD_D2V_INDEX_ENTRY 16
+#define FD_D2V_PACKET 1024
+
+enum {
+    FD_D2V_FRAME_FULL = 1    // 0x0001 full page (otherwise 0x000d partial update)
+};
+
+typedef struct {
+    uint32_t frame_count;
+    uint32_t fps_num, fps_den;
+    uint32_t packet_size;
+    uint64_t index_offset;
+} fd_d2v_info_t;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t packets;
+    uint32_t flags;
+} fd_d2v_frame_t;
+
+static inline uint32_t fd_d2v_rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t fd_d2v_rd64(const uint8_t *p) {
+    return (uint64_t)fd_d2v_rd32(p) | ((uint64_t)fd_d2v_rd32(p + 4) << 32);
+}
+
+static inline void fd_d2v_wr32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void fd_d2v_wr64(uint8_t *p, uint64_t v) {
+    fd_d2v_wr32(p, (uint32_t)v);
+    fd_d2v_wr32(p + 4, (uint32_t)(v >> 32));
+}
+
+// --- Reader (file mapped in memory) ---
+
+// Validates the header and that the index and every frame lie inside the file.
+static FD_UNUSED int fd_d2v_parse(const uint8_t *map, size_t len, fd_d2v_info_t *info) {
+    if (len < FD_D2V_HEADER_SIZE || memcmp(map, FD_D2V_MAGIC, 4) != 0) return -1;
+    if (fd_d2v_rd32(map + 4) != FD_D2V_VERSION) return -1;
+    info->frame_count = fd_d2v_rd32(map + 8);
+    info->fps_num = fd_d2v_rd32(map + 12);
+    info->fps_den = fd_d2v_rd32(map + 16);
+    info->packet_size = fd_d2v_rd32(map + 20);
+    info->index_offset = fd_d2v_rd64(map + 24);
+    if (info->packet_size != FD_D2V_PACKET || info->frame_count == 0) return -1;
+    if (info->index_offset < FD_D2V_HEADER_SIZE || info->index_offset > len) return -1;
+    if ((uint64_t)info->frame_count * FD_D2V_INDEX_ENTRY > len - info->index_offset) return -1;
+    for (uint32_t i = 0; i < info->frame_count; i++) {
+        const uint8_t *e = map + info->index_offset + (uint64_t)i * FD_D2V_INDEX_ENTRY;
+        uint64_t off = fd_d2v_rd64(e);
+        uint64_t size = (uint64_t)fd_d2v_rd32(e + 8) * info->packet_size;
+        if (off < FD_D2V_HEADER_SIZE || off > info->index_offset || size > info->index_offset - off) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static FD_UNUSED void fd_d2v_frame(const uint8_t *map, const fd_d2v_info_t *info, uint32_t i, fd_d2v_frame_t *f) {
+    const uint8_t *e = map + info->index_offset + (uint64_t)i * FD_D2V_INDEX_ENTRY;
+    f->offset = fd_d2v_rd64(e);
+    f->packets = fd_d2v_rd32(e + 8);
+    f->flags = fd_d2v_rd32(e + 12);
+}
+
+// --- Writer ---
+
+typedef struct {
+    int fd;
+    char path[4096];
+    char tmp_path[4096 + 8];
+    uint64_t pos;
+    uint8_t *index;          // FD_D2V_INDEX_ENTRY bytes per frame
+    size_t index_cap;
+    uint32_t count;
+    uint32_t fps_num, fps_den;
+} fd_d2v_writer_t;
+
+static int fd_d2v_write_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static FD_UNUSED int fd_d2v_open(fd_d2v_writer_t *w, const char *path, uint32_t fps_num, uint32_t fps_den) {
+    memset(w, 0, sizeof(*w));
+    int n = snprintf(w->path, sizeof(w->path), "%s", path);
+    if (n < 0 || (size_t)n >= sizeof(w->path)) return -1;
+    snprintf(w->tmp_path, sizeof(w->tmp_path), "%s.tmp", path);
+    w->fps_num = fps_num;
+    w->fps_den = fps_den ? fps_den : 1;
+    w->fd = open(w->tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) return -1;
+    uint8_t hdr[FD_D2V_HEADER_SIZE];
+    memset(hdr, 0, sizeof(hdr)); // real header written by fd_d2v_finish
+    if (fd_d2v_write_all(w->fd, hdr, sizeof(hdr)) != 0) {
+        close(w->fd);
+        unlink(w->tmp_path);
+        return -1;
+    }
+    w->pos = FD_D2V_HEADER_SIZE;
+    return 0;
+}
+
+// packets: n * FD_D2V_PACKET bytes (n may be 0: frame held)
+static FD_UNUSED int fd_d2v_append(fd_d2v_writer_t *w, const uint8_t *packets, size_t len, uint32_t flags) {
+    if (len % FD_D2V_PACKET != 0) return -1;
+    size_t need = ((size_t)w->count + 1) * FD_D2V_INDEX_ENTRY;
+    if (need > w->index_cap) {
+        size_t cap = w->index_cap ? w->index_cap * 2 : 1024 * FD_D2V_INDEX_ENTRY;
+        uint8_t *p = realloc(w->index, cap);
+        if (!p) return -1;
+        w->index = p;
+        w->index_cap = cap;
+    }
+    if (len > 0 && fd_d2v_write_all(w->fd, packets, len) != 0) return -1;
+    uint8_t *e = w->index + (size_t)w->count * FD_D2V_INDEX_ENTRY;
+    fd_d2v_wr64(e, w->pos);
+    fd_d2v_wr32(e + 8, (uint32_t)(len / FD_D2V_PACKET));
+    fd_d2v_wr32(e + 12, flags);
+    w->pos += len;
+    w->count++;
+    return 0;
+}
+
+// keep == 0: drop the partial file (interrupted render)
+static FD_UNUSED int fd_d2v_finish(fd_d2v_writer_t *w, int keep) {
+    int rc = 0;
+    if (keep && w->count > 0) {
+        uint8_t hdr[FD_D2V_HEADER_SIZE];
+        memset(hdr, 0, sizeof(hdr));
+        memcpy(hdr, FD_D2V_MAGIC, 4);
+        fd_d2v_wr32(hdr + 4, FD_D2V_VERSION);
+        fd_d2v_wr32(hdr + 8, w->count);
+        fd_d2v_wr32(hdr + 12, w->fps_num);
+        fd_d2v_wr32(hdr + 16, w->fps_den);
+        fd_d2v_wr32(hdr + 20, FD_D2V_PACKET);
+        fd_d2v_wr64(hdr + 24, w->pos);
+        if (fd_d2v_write_all(w->fd, w->index, (size_t)w->count * FD_D2V_INDEX_ENTRY) != 0 ||
+            pwrite(w->fd, hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+            rc = -1;
+        }
+    } else {
+        rc = -1;
+    }
+    if (close(w->fd) != 0) rc = -1;
+    if (rc == 0 && rename(w->tmp_path, w->path) != 0) rc = -1;
+    if (rc != 0) unlink(w->tmp_path);
+    free(w->index);
+    w->index = NULL;
+    w->fd = -1;
+    return keep ? rc : 0;
+}
+
+#endif
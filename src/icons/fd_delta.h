@@ -0,0 +1,133 @@
+// Temporal tile deltas for video pages: decide which of the 14 tiles changed enough since the
+// last one actually sent to be worth uploading again (0x000d partial update), with a forced
+// full page (0x0001) every `keyframe` frames so any tile left slightly stale is repaired.
+//
+// Each tile is summarised by a FD_DELTA_GRID x FD_DELTA_GRID grid of RGB block means. A tile
+// counts as changed when the mean abs difference of the grids exceeds `threshold` (0..255 per
+// channel), or when one block moves by more than 4x that (small object on a still background).
+//
+// Usage:
+//   fd_delta_t d;
+//   fd_delta_init(&d, 3, 30);
+//   per frame: fd_delta_signature() for each tile, then
+//   mask = fd_delta_select(&d, sigs, avail, &full); send mask; fd_delta_commit(&d, sigs, mask, full);
+
+#ifndef FD_DELTA_H
+#define FD_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_DELTA_TILES 14
+#define FD_DELTA_GRID 8
+#define FD_DELTA_SIG (FD_DELTA_GRID * FD_DELTA_GRID * 3)
+#define FD_DELTA_ALL ((uint16_t)((1u << FD_DELTA_TILES) - 1))
+
+typedef struct {
+    int threshold;           // mean abs diff per channel (0 = any change)
+    int keyframe;            // full page every N frames (0 = only the first one)
+    int since_full;          // frames since the last full page, -1: none sent yet
+    uint16_t have;           // tiles with a reference signature
+    uint8_t ref[FD_DELTA_TILES][FD_DELTA_SIG];
+
+    // counters
+    uint64_t frames_full, frames_partial, frames_held;
+    uint64_t tiles_sent, tiles_total;
+} fd_delta_t;
+
+static FD_UNUSED void fd_delta_init(fd_delta_t *d, int threshold, int keyframe) {
+    memset(d, 0, sizeof(*d));
+    d->threshold = threshold < 0 ? 0 : threshold;
+    d->keyframe = keyframe < 0 ? 0 : keyframe;
+    d->since_full = -1;
+}
+
+// Next frame is sent in full (e.g. the receiver was restarted).
+static FD_UNUSED void fd_delta_reset(fd_delta_t *d) {
+    d->since_full = -1;
+    d->have = 0;
+}
+
+// Block means of an RGBA tile (alpha ignored).
+static FD_UNUSED void fd_delta_signature(const uint8_t *rgba, int w, int h, size_t stride, uint8_t *sig) {
+    for (int by = 0; by < FD_DELTA_GRID; by++) {
+        int y0 = by * h / FD_DELTA_GRID, y1 = (by + 1) * h / FD_DELTA_GRID;
+        for (int bx = 0; bx < FD_DELTA_GRID; bx++) {
+            int x0 = bx * w / FD_DELTA_GRID, x1 = (bx + 1) * w / FD_DELTA_GRID;
+            uint32_t s[3] = {0, 0, 0};
+            uint32_t n = 0;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t *p = rgba + (size_t)y * stride + (size_t)x0 * 4;
+                for (int x = x0; x < x1; x++, p += 4) {
+                    s[0] += p[0];
+                    s[1] += p[1];
+                    s[2] += p[2];
+                }
+                n += (uint32_t)(x1 - x0);
+            }
+            uint8_t *o = sig + (by * FD_DELTA_GRID + bx) * 3;
+            for (int c = 0; c < 3; c++) o[c] = (uint8_t)(n ? (s[c] + n / 2) / n : 0);
+        }
+    }
+}
+
+static FD_UNUSED int fd_delta_changed(const fd_delta_t *d, const uint8_t *a, const uint8_t *b) {
+    uint32_t sum = 0;
+    int block_limit = 4 * d->threshold * 3;
+    for (int i = 0; i < FD_DELTA_SIG; i += 3) {
+        int bsum = 0;
+        for (int c = 0; c < 3; c++) bsum += a[i + c] > b[i + c] ? a[i + c] - b[i + c] : b[i + c] - a[i + c];
+        if (bsum > block_limit) return 1;
+        sum += (uint32_t)bsum;
+    }
+    return sum > (uint32_t)d->threshold * FD_DELTA_SIG;
+}
+
+// Tiles to send this frame among `avail` (tiles rendered successfully); *full: send as 0x0001.
+// A zero mask means nothing changed: the frame can be skipped entirely.
+static FD_UNUSED uint16_t fd_delta_select(const fd_delta_t *d, const uint8_t (*sig)[FD_DELTA_SIG], uint16_t avail,
+                                          int *full) {
+    *full = d->since_full < 0 || (d->keyframe > 0 && d->since_full >= d->keyframe - 1);
+    if (*full) return avail;
+    uint16_t mask = 0;
+    for (int i = 0; i < FD_DELTA_TILES; i++) {
+        if (!(avail & (1u << i))) continue;
+        if (!(d->have & (1u << i)) || fd_delta_changed(d, sig[i], d->ref[i])) mask |= (uint16_t)(1u << i);
+    }
+    // Everything changed anyway: a full page restarts the keyframe interval for free.
+    if (mask == FD_DELTA_ALL) *full = 1;
+    return mask;
+}
+
+// Record what was actually sent: references move only for uploaded tiles, so slow drifts
+// accumulate until they cross the threshold.
+static FD_UNUSED void fd_delta_commit(fd_delta_t *d, const uint8_t (*sig)[FD_DELTA_SIG], uint16_t mask, int full) {
+    for (int i = 0; i < FD_DELTA_TILES; i++) {
+        if (!(mask & (1u << i))) continue;
+        memcpy(d->ref[i], sig[i], FD_DELTA_SIG);
+        d->have |= (uint16_t)(1u << i);
+        d->tiles_sent++;
+    }
+    d->tiles_total += FD_DELTA_TILES;
+    if (full) {
+        d->since_full = 0;
+        d->frames_full++;
+    } else {
+        d->since_full++;
+        if (mask) d->frames_partial++;
+        else d->frames_held++;
+    }
+}
+
+#endif
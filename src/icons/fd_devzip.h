@@ -0,0 +1,280 @@
+// Device upload builder: the exact bytes ulanzi_d200_daemon writes to the HID link for a page.
+//
+// A page upload is a store-only ZIP (optional dummy.txt, manifest.json, icons/<name>...) cut into
+// 1024-byte packets; the first packet carries an 8-byte header (7c 7c, command, total length).
+// The device rejects a packet whose first payload byte (ZIP offsets 1016 + k*1024) is 0x00 or
+// 0x7c, so dummy.txt is grown one byte at a time until no such byte remains (force-patched
+// after max_pad tries). ulanzi_d200_daemon builds every upload with it (build_zip_from_icons), so
+// tools can pre-build the same uploads offline (render once, replay as raw packets).
+//
+// Usage:
+//   fd_devzip_icon_t icons[14] = { { .btn = 0, .name = "b1_0.png", .label = "", .data = png, .len = n }, ... };
+//   fd_devzip_t z; fd_devzip_init(&z);
+//   fd_devzip_solve(&z, icons, 14, FD_DEVZIP_MAX_PAD, &pad, &patched);      // z.zip / z.zip_len
+//   fd_devzip_packetize(&z, FD_DEVZIP_CMD_FULL);                            // z.pkt / z.pkt_len
+//   fd_devzip_free(&z);
+
+#ifndef FD_DEVZIP_H
+#define FD_DEVZIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_DEVZIP_PACKET 1024
+#define FD_DEVZIP_HEADER 8
+#define FD_DEVZIP_MAX_PAD 1024      // MAX_PADDING_RETRIES in ulanzi_d200_daemon.c
+#define FD_DEVZIP_CMD_FULL 0x0001
+#define FD_DEVZIP_CMD_PARTIAL 0x000d
+
+typedef struct {
+    int btn;                 // 0-based button index (13 = wide button 14)
+    const char *name;        // file name inside icons/
+    const char *label;       // NULL or "" for none
+    const uint8_t *data;     // PNG bytes
+    size_t len;
+} fd_devzip_icon_t;
+
+typedef struct {
+    uint8_t *zip;            // solved ZIP
+    size_t zip_len;
+    size_t zip_cap;
+    uint8_t *pkt;            // packetized upload (multiple of FD_DEVZIP_PACKET)
+    size_t pkt_len;
+    size_t pkt_cap;
+    char *manifest;
+    size_t manifest_len;
+    size_t manifest_cap;
+    uint32_t *crc;           // per icon
+    size_t crc_cap;
+} fd_devzip_t;
+
+static FD_UNUSED void fd_devzip_init(fd_devzip_t *z) {
+    memset(z, 0, sizeof(*z));
+}
+
+static FD_UNUSED void fd_devzip_free(fd_devzip_t *z) {
+    free(z->zip);
+    free(z->pkt);
+    free(z->manifest);
+    free(z->crc);
+    memset(z, 0, sizeof(*z));
+}
+
+static int fd_devzip_reserve(uint8_t **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 0;
+    size_t nc = *cap ? *cap : 4096;
+    while (nc < need) nc *= 2;
+    uint8_t *p = realloc(*buf, nc);
+    if (!p) return -1;
+    *buf = p;
+    *cap = nc;
+    return 0;
+}
+
+static inline uint8_t *fd_devzip_le16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t *fd_devzip_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static int fd_devzip_append(fd_devzip_t *z, const char *s, size_t n) {
+    if (fd_devzip_reserve((uint8_t **)&z->manifest, &z->manifest_cap, z->manifest_len + n + 1) != 0) return -1;
+    memcpy(z->manifest + z->manifest_len, s, n);
+    z->manifest_len += n;
+    z->manifest[z->manifest_len] = '\0';
+    return 0;
+}
+
+// {"col_row":{"State":0,"ViewParam":[{"Icon":"icons/<name>","Text":"<label>"}]},...}
+// (double quotes are dropped from labels, as in the daemon)
+static int fd_devzip_manifest(fd_devzip_t *z, const fd_devzip_icon_t *icons, int count) {
+    char tmp[512];
+    z->manifest_len = 0;
+    if (fd_devzip_append(z, "{", 1) != 0) return -1;
+    for (int i = 0; i < count; i++) {
+        int n = snprintf(tmp, sizeof(tmp), "%s\"%d_%d\":{\"State\":0,\"ViewParam\":[{\"Icon\":\"icons/%s\",\"Text\":\"",
+                         i > 0 ? "," : "", icons[i].btn % 5, icons[i].btn / 5, icons[i].name);
+        if (n < 0 || (size_t)n >= sizeof(tmp)) return -1;
+        if (fd_devzip_append(z, tmp, (size_t)n) != 0) return -1;
+        for (const char *l = icons[i].label ? icons[i].label : ""; *l; l++) {
+            if (*l != '"' && fd_devzip_append(z, l, 1) != 0) return -1;
+        }
+        if (fd_devzip_append(z, "\"}]}", 4) != 0) return -1;
+    }
+    return fd_devzip_append(z, "}", 1);
+}
+
+static uint8_t *fd_devzip_local(uint8_t *p, const char *name, size_t name_len, const uint8_t *data, size_t len,
+                                uint32_t crc) {
+    p = fd_devzip_le32(p, 0x04034b50);
+    p = fd_devzip_le16(p, 20);    // version needed
+    p = fd_devzip_le16(p, 0);     // flags
+    p = fd_devzip_le16(p, 0);     // method: store
+    p = fd_devzip_le16(p, 0);     // mtime
+    p = fd_devzip_le16(p, 0);     // mdate
+    p = fd_devzip_le32(p, crc);
+    p = fd_devzip_le32(p, (uint32_t)len);
+    p = fd_devzip_le32(p, (uint32_t)len);
+    p = fd_devzip_le16(p, (uint32_t)name_len);
+    p = fd_devzip_le16(p, 0);     // extra len
+    memcpy(p, name, name_len);
+    p += name_len;
+    if (len) memcpy(p, data, len);
+    return p + len;
+}
+
+static uint8_t *fd_devzip_central(uint8_t *p, const char *name, size_t name_len, size_t len, uint32_t crc,
+                                  uint32_t offset) {
+    p = fd_devzip_le32(p, 0x02014b50);
+    p = fd_devzip_le16(p, 20);    // version made by
+    p = fd_devzip_le16(p, 20);    // version needed
+    p = fd_devzip_le16(p, 0);     // flags
+    p = fd_devzip_le16(p, 0);     // method
+    p = fd_devzip_le16(p, 0);     // mtime
+    p = fd_devzip_le16(p, 0);     // mdate
+    p = fd_devzip_le32(p, crc);
+    p = fd_devzip_le32(p, (uint32_t)len);
+    p = fd_devzip_le32(p, (uint32_t)len);
+    p = fd_devzip_le16(p, (uint32_t)name_len);
+    p = fd_devzip_le16(p, 0);     // extra len
+    p = fd_devzip_le16(p, 0);     // comment len
+    p = fd_devzip_le16(p, 0);     // disk start
+    p = fd_devzip_le16(p, 0);     // int attrs
+    p = fd_devzip_le32(p, 0);     // ext attrs
+    p = fd_devzip_le32(p, offset);
+    memcpy(p, name, name_len);
+    return p + name_len;
+}
+
+// One ZIP with a dummy.txt of dummy_len bytes (0 = no dummy entry). Manifest and CRCs must be ready.
+static int fd_devzip_emit(fd_devzip_t *z, const fd_devzip_icon_t *icons, int count, size_t dummy_len) {
+    enum { LOCAL = 30, CENTRAL = 46, EOCD = 22 };
+    char names[14][280];
+    size_t name_lens[14];
+    size_t need = 0;
+    for (int i = 0; i < count; i++) {
+        int n = snprintf(names[i], sizeof(names[i]), "icons/%s", icons[i].name);
+        if (n < 0 || (size_t)n >= sizeof(names[i])) return -1;
+        name_lens[i] = (size_t)n;
+        need += LOCAL + CENTRAL + 2 * name_lens[i] + icons[i].len;
+    }
+    need += 2 * (LOCAL + CENTRAL) + 2 * 9 + dummy_len + 2 * 13 + z->manifest_len + EOCD;
+    if (fd_devzip_reserve(&z->zip, &z->zip_cap, need) != 0) return -1;
+
+    uint8_t *p = z->zip;
+    uint32_t off_dummy = 0, off_manifest, off_icons[14];
+    uint32_t crc_dummy = 0;
+    if (dummy_len > 0) {
+        uint8_t dummy[FD_DEVZIP_MAX_PAD];
+        if (dummy_len > sizeof(dummy)) return -1;
+        memset(dummy, 0x01, dummy_len); // avoid 0x00/0x7c
+        crc_dummy = (uint32_t)crc32(crc32(0L, Z_NULL, 0), dummy, (uInt)dummy_len);
+        p = fd_devzip_local(p, "dummy.txt", 9, dummy, dummy_len, crc_dummy);
+    }
+    uint32_t crc_manifest = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)z->manifest, (uInt)z->manifest_len);
+    off_manifest = (uint32_t)(p - z->zip);
+    p = fd_devzip_local(p, "manifest.json", 13, (const uint8_t *)z->manifest, z->manifest_len, crc_manifest);
+    for (int i = 0; i < count; i++) {
+        off_icons[i] = (uint32_t)(p - z->zip);
+        p = fd_devzip_local(p, names[i], name_lens[i], icons[i].data, icons[i].len, z->crc[i]);
+    }
+
+    uint32_t central_offset = (uint32_t)(p - z->zip);
+    int entries = count + 1;
+    if (dummy_len > 0) {
+        p = fd_devzip_central(p, "dummy.txt", 9, dummy_len, crc_dummy, off_dummy);
+        entries++;
+    }
+    p = fd_devzip_central(p, "manifest.json", 13, z->manifest_len, crc_manifest, off_manifest);
+    for (int i = 0; i < count; i++) {
+        p = fd_devzip_central(p, names[i], name_lens[i], icons[i].len, z->crc[i], off_icons[i]);
+    }
+    uint32_t central_size = (uint32_t)(p - z->zip) - central_offset;
+    p = fd_devzip_le32(p, 0x06054b50);
+    p = fd_devzip_le16(p, 0);     // disk
+    p = fd_devzip_le16(p, 0);     // start disk
+    p = fd_devzip_le16(p, (uint32_t)entries);
+    p = fd_devzip_le16(p, (uint32_t)entries);
+    p = fd_devzip_le32(p, central_size);
+    p = fd_devzip_le32(p, central_offset);
+    p = fd_devzip_le16(p, 0);     // comment len
+    z->zip_len = (size_t)(p - z->zip);
+    return 0;
+}
+
+// First offset of each continuation packet: the byte the device checks.
+static FD_UNUSED int fd_devzip_bad_bytes(const uint8_t *buf, size_t len) {
+    for (size_t i = FD_DEVZIP_PACKET - FD_DEVZIP_HEADER; i < len; i += FD_DEVZIP_PACKET) {
+        if (buf[i] == 0x00 || buf[i] == 0x7c) return 1;
+    }
+    return 0;
+}
+
+static size_t fd_devzip_patch(uint8_t *buf, size_t len) {
+    size_t patched = 0;
+    for (size_t i = FD_DEVZIP_PACKET - FD_DEVZIP_HEADER; i < len; i += FD_DEVZIP_PACKET) {
+        if (buf[i] == 0x00 || buf[i] == 0x7c) { buf[i] = 0x11; patched++; }
+    }
+    return patched;
+}
+
+// Build the page ZIP, growing dummy.txt until no packet starts with 0x00/0x7c.
+static FD_UNUSED int fd_devzip_solve(fd_devzip_t *z, const fd_devzip_icon_t *icons, int count, int max_pad,
+                                     int *pad_used, size_t *patched) {
+    if (count <= 0 || count > 14) return -1;
+    if (max_pad > FD_DEVZIP_MAX_PAD) max_pad = FD_DEVZIP_MAX_PAD;
+    if (fd_devzip_manifest(z, icons, count) != 0) return -1;
+    if (fd_devzip_reserve((uint8_t **)&z->crc, &z->crc_cap, (size_t)count * sizeof(uint32_t)) != 0) return -1;
+    for (int i = 0; i < count; i++) {
+        z->crc[i] = (uint32_t)crc32(crc32(0L, Z_NULL, 0), icons[i].data, (uInt)icons[i].len);
+    }
+    *patched = 0;
+    for (int pad = 0; pad <= max_pad; pad++) {
+        if (fd_devzip_emit(z, icons, count, (size_t)pad) != 0) return -1;
+        if (!fd_devzip_bad_bytes(z->zip, z->zip_len)) {
+            *pad_used = pad;
+            return 0;
+        }
+    }
+    *pad_used = max_pad;
+    *patched = fd_devzip_patch(z->zip, z->zip_len);
+    return 0;
+}
+
+static FD_UNUSED size_t fd_devzip_packet_count(size_t zip_len) {
+    return (zip_len + FD_DEVZIP_HEADER + FD_DEVZIP_PACKET - 1) / FD_DEVZIP_PACKET;
+}
+
+// Cut z->zip into the HID packets sent by send_zip_buffer_cmd (zero-filled tail).
+static FD_UNUSED int fd_devzip_packetize(fd_devzip_t *z, uint16_t cmd) {
+    size_t n = fd_devzip_packet_count(z->zip_len) * FD_DEVZIP_PACKET;
+    if (fd_devzip_reserve(&z->pkt, &z->pkt_cap, n) != 0) return -1;
+    memset(z->pkt, 0, n);
+    z->pkt[0] = 0x7c;
+    z->pkt[1] = 0x7c;
+    z->pkt[2] = (uint8_t)(cmd >> 8);
+    z->pkt[3] = (uint8_t)cmd;
+    fd_devzip_le32(z->pkt + 4, (uint32_t)z->zip_len);
+    memcpy(z->pkt + FD_DEVZIP_HEADER, z->zip, z->zip_len);
+    z->pkt_len = n;
+    return 0;
+}
+
+#endif
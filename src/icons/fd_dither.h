@@ -0,0 +1,251 @@
+// Ordered dithering (Bayer 8x8 and 32x32 blue noise) onto a uniform per-channel grid.
+//
+// Each pixel only depends on its own value and its position in the threshold matrix:
+// no error propagation, so tiles/rows can be processed in any order or in parallel, and a
+// static area of a video stays identical from one frame to the next (better for deltas/zip).
+// The inner loop is table lookups only (no branches, no floating point).
+//
+// Usage:
+//   fd_dither_t d;
+//   fd_dither_init(&d, FD_DITHER_BAYER, 6);          // 6 levels per channel = 6x6x6 grid
+//   fd_dither_ordered_rgba(&d, img, w, h, w * 4, 0, 0);
+
+#ifndef FD_DITHER_H
+#define FD_DITHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+enum {
+    FD_DITHER_NONE = 0,
+    FD_DITHER_FS = 1,        // Floyd–Steinberg (error diffusion over the whole image, fd_dither_fs_rgba)
+    FD_DITHER_BAYER = 2,
+    FD_DITHER_BLUENOISE = 3
+};
+
+#define FD_DITHER_LUT_BIAS 128
+
+typedef struct {
+    const uint8_t *m;        // size x size thresholds (0..255)
+    int size;                // power of two
+    int8_t off[256];         // threshold -> signed offset in [-step/2, step/2)
+    uint8_t lut[256 + 2 * FD_DITHER_LUT_BIAS]; // biased value -> grid value
+} fd_dither_t;
+
+static const uint8_t fd_bayer8_idx[64] = {
+     0, 32,  8, 40,  2, 34, 10, 42,
+    48, 16, 56, 24, 50, 18, 58, 26,
+    12, 44,  4, 36, 14, 46,  6, 38,
+    60, 28, 52, 20, 62, 30, 54, 22,
+     3, 35, 11, 43,  1, 33,  9, 41,
+    51, 19, 59, 27, 49, 17, 57, 25,
+    15, 47,  7, 39, 13, 45,  5, 37,
+    63, 31, 55, 23, 61, 29, 53, 21
+};
+
+static uint8_t fd_bayer8[64];
+static uint8_t fd_bluenoise32[32 * 32];
+// Built once per process under pthread_once: tile workers may init concurrently.
+static pthread_once_t fd_bayer8_once = PTHREAD_ONCE_INIT;
+static pthread_once_t fd_bluenoise32_once = PTHREAD_ONCE_INIT;
+
+static void fd_dither_fill_bayer8(void) {
+    for (int i = 0; i < 64; i++) fd_bayer8[i] = (uint8_t)(fd_bayer8_idx[i] * 4 + 2);
+}
+
+// Void-and-cluster (Ulichney) on a 32x32 torus. Deterministic, ~1M ops, done once per process.
+static void fd_dither_gen_bluenoise(void) {
+    enum { N = 32, NN = N * N };
+    static float kern[NN];
+    static float energy[NN];
+    static uint8_t bits[NN];
+    static uint8_t proto[NN];
+    static uint16_t rank[NN];
+    const float sigma2 = 2.0f * 1.5f * 1.5f;
+
+    for (int dy = 0; dy < N; dy++) {
+        for (int dx = 0; dx < N; dx++) {
+            int ddx = dx > N / 2 ? N - dx : dx;
+            int ddy = dy > N / 2 ? N - dy : dy;
+            kern[dy * N + dx] = expf(-(float)(ddx * ddx + ddy * ddy) / sigma2);
+        }
+    }
+
+#define FD_BN_TOGGLE(idx, sign) do {                                            \
+        int px_ = (idx) % N, py_ = (idx) / N;                                   \
+        for (int y_ = 0; y_ < N; y_++) {                                        \
+            const float *kr_ = kern + ((y_ - py_ + N) % N) * N;                 \
+            float *er_ = energy + y_ * N;                                       \
+            for (int x_ = 0; x_ < N; x_++) er_[x_] += (sign) * kr_[(x_ - px_ + N) % N]; \
+        }                                                                       \
+    } while (0)
+
+    // Initial pattern: ~10% minority pixels from a fixed LCG, then relaxed.
+    uint32_t seed = 0x2545F491u;
+    int ones = 0;
+    memset(bits, 0, sizeof(bits));
+    memset(energy, 0, sizeof(energy));
+    while (ones < NN / 10) {
+        seed = seed * 1664525u + 1013904223u;
+        int idx = (int)((seed >> 8) % NN);
+        if (bits[idx]) continue;
+        bits[idx] = 1;
+        ones++;
+        FD_BN_TOGGLE(idx, 1.0f);
+    }
+    for (int iter = 0; iter < NN; iter++) {
+        int cl = -1, vo = -1;
+        for (int i = 0; i < NN; i++) if (bits[i] && (cl < 0 || energy[i] > energy[cl])) cl = i;
+        bits[cl] = 0;
+        FD_BN_TOGGLE(cl, -1.0f);
+        for (int i = 0; i < NN; i++) if (!bits[i] && (vo < 0 || energy[i] < energy[vo])) vo = i;
+        bits[vo] = 1;
+        FD_BN_TOGGLE(vo, 1.0f);
+        if (vo == cl) break;
+    }
+    memcpy(proto, bits, sizeof(bits));
+    float saved[NN];
+    memcpy(saved, energy, sizeof(energy));
+
+    // Phase 1: remove tightest clusters, ranks ones-1 .. 0.
+    for (int r = ones - 1; r >= 0; r--) {
+        int cl = -1;
+        for (int i = 0; i < NN; i++) if (bits[i] && (cl < 0 || energy[i] > energy[cl])) cl = i;
+        bits[cl] = 0;
+        FD_BN_TOGGLE(cl, -1.0f);
+        rank[cl] = (uint16_t)r;
+    }
+    // Phase 2/3: fill largest voids, ranks ones .. NN-1.
+    memcpy(bits, proto, sizeof(bits));
+    memcpy(energy, saved, sizeof(energy));
+    for (int r = ones; r < NN; r++) {
+        int vo = -1;
+        for (int i = 0; i < NN; i++) if (!bits[i] && (vo < 0 || energy[i] < energy[vo])) vo = i;
+        bits[vo] = 1;
+        FD_BN_TOGGLE(vo, 1.0f);
+        rank[vo] = (uint16_t)r;
+    }
+#undef FD_BN_TOGGLE
+
+    for (int i = 0; i < NN; i++) fd_bluenoise32[i] = (uint8_t)((rank[i] * 256) / NN);
+}
+
+// levels: values per channel (2..256), e.g. 6 for the 6x6x6 grid used by send_image_page.
+static FD_UNUSED int fd_dither_init(fd_dither_t *d, int kind, int levels) {
+    memset(d, 0, sizeof(*d));
+    if (levels < 2) levels = 2;
+    if (levels > 256) levels = 256;
+    if (kind == FD_DITHER_BLUENOISE) {
+        pthread_once(&fd_bluenoise32_once, fd_dither_gen_bluenoise);
+        d->m = fd_bluenoise32;
+        d->size = 32;
+    } else if (kind == FD_DITHER_BAYER) {
+        pthread_once(&fd_bayer8_once, fd_dither_fill_bayer8);
+        d->m = fd_bayer8;
+        d->size = 8;
+    } else {
+        return -1;
+    }
+
+    const int step = 255 / (levels - 1);
+    for (int t = 0; t < 256; t++) {
+        d->off[t] = (int8_t)(((2 * t + 1) * step) / 512 - step / 2);
+    }
+    for (int i = 0; i < (int)sizeof(d->lut); i++) {
+        int v = i - FD_DITHER_LUT_BIAS;
+        if (v < 0) v = 0;
+        if (v > 255) v = 255;
+        int level = (v + step / 2) / step;
+        if (level > levels - 1) level = levels - 1;
+        int q = level * step;
+        d->lut[i] = (uint8_t)(q > 255 ? 255 : q);
+    }
+    return 0;
+}
+
+// Dither RGB in place (alpha untouched). (ox, oy) is the matrix phase of pixel (0, 0).
+static FD_UNUSED void fd_dither_ordered_rgba(const fd_dither_t *d, uint8_t *img, int w, int h, size_t stride,
+                                             int ox, int oy) {
+    if (!d->m) return;
+    const int mask = d->size - 1;
+    const uint8_t *lut = d->lut + FD_DITHER_LUT_BIAS;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *mrow = d->m + (size_t)((y + oy) & mask) * (size_t)d->size;
+        uint8_t *p = img + (size_t)y * stride;
+        for (int x = 0; x < w; x++, p += 4) {
+            int o = d->off[mrow[(x + ox) & mask]];
+            p[0] = lut[p[0] + o];
+            p[1] = lut[p[1] + o];
+            p[2] = lut[p[2] + o];
+        }
+    }
+}
+
+// Snap RGB to a uniform grid of `levels` values per channel (truncating, alpha untouched).
+static FD_UNUSED void fd_dither_posterize_rgba(uint8_t *img, int w, int h, size_t stride, int levels) {
+    if (levels < 2) levels = 2;
+    const int step = 255 / (levels - 1);
+    for (int y = 0; y < h; y++) {
+        uint8_t *p = img + (size_t)y * stride;
+        for (int x = 0; x < w; x++, p += 4) {
+            p[0] = (uint8_t)((p[0] / step) * step);
+            p[1] = (uint8_t)((p[1] / step) * step);
+            p[2] = (uint8_t)((p[2] / step) * step);
+        }
+    }
+}
+
+static inline uint8_t fd_dither_clamp(int v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// Floyd–Steinberg onto the same grid (7/16 right, 3/16 down-left, 5/16 down, 1/16 down-right).
+// Serial by nature: run it on the whole image before tiling.
+static FD_UNUSED void fd_dither_fs_rgba(uint8_t *img, int w, int h, size_t stride, int levels) {
+    if (levels < 2) levels = 2;
+    const int step = 255 / (levels - 1);
+    for (int y = 0; y < h; y++) {
+        uint8_t *row = img + (size_t)y * stride;
+        uint8_t *next = (y + 1 < h) ? row + stride : NULL;
+        for (int x = 0; x < w; x++) {
+            uint8_t *px = row + (size_t)x * 4;
+            for (int c = 0; c < 3; c++) {
+                int old_val = px[c];
+                int new_val = (old_val / step) * step;
+                int error = old_val - new_val;
+                px[c] = (uint8_t)new_val;
+                if (x + 1 < w) px[4 + c] = fd_dither_clamp(px[4 + c] + error * 7 / 16);
+                if (next) {
+                    uint8_t *below = next + (size_t)x * 4;
+                    if (x > 0) below[c - 4] = fd_dither_clamp(below[c - 4] + error * 3 / 16);
+                    below[c] = fd_dither_clamp(below[c] + error * 5 / 16);
+                    if (x + 1 < w) below[4 + c] = fd_dither_clamp(below[4 + c] + error / 16);
+                }
+            }
+        }
+    }
+}
+
+static FD_UNUSED int fd_dither_from_name(const char *name) {
+    if (!name) return -1;
+    if (strcmp(name, "none") == 0) return FD_DITHER_NONE;
+    if (strcmp(name, "fs") == 0 || strcmp(name, "floyd") == 0) return FD_DITHER_FS;
+    if (strcmp(name, "bayer") == 0) return FD_DITHER_BAYER;
+    if (strcmp(name, "bluenoise") == 0 || strcmp(name, "blue") == 0) return FD_DITHER_BLUENOISE;
+    return -1;
+}
+
+#endif
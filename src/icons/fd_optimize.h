@@ -0,0 +1,154 @@
+// Palette selection shared by draw_optimize and draw_batch: RGBA image -> <= N color palette + indices.
+//
+// Order of preference:
+// 1) palette cache hit (key given): map straight to the stored preset palette, unless a sizeable
+//    color ends up far from every entry;
+// 2) the exact colors when the image has <= N of them (fd_png_palettize);
+// 3) Wu's quantizer (fd_wu.h), pure white kept if present, stored under the key for the next icons.
+//
+// Cache files live in $FD_PALETTE_CACHE (default /dev/shm/goofydeck/palettes), one per key and color
+// limit: magic, entry count (1 byte, 0 = 256), RGBA entries. Writes go through a unique temporary
+// file + rename, so concurrent writers (processes or threads) never expose a partial palette.
+//
+// Usage:
+//   uint8_t pal[256][4]; int n; const char *how;
+//   fd_opt_quantize(rgba, w, h, 64, "icon:...", pal, &n, idx, &how);   // rgba is modified (see below)
+
+#ifndef FD_OPTIMIZE_H
+#define FD_OPTIMIZE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fd_png.h"
+#include "fd_wu.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_OPT_REFINE_ITERS 2
+#define FD_OPT_FAR_DIST (3 * 32 * 32)   // squared RGBA distance of a color the palette misses
+#define FD_OPT_FAR_SHARE 100            // ... tolerated for at most 1/100 of the pixels
+#define FD_OPT_PAL_MAGIC "FDPAL1"
+#define FD_OPT_PATH_MAX 4096
+
+static FD_UNUSED int fd_opt_cache_path(const char *key, int colors, char *out, size_t cap) {
+    const char *dir = getenv("FD_PALETTE_CACHE");
+    if (!dir || !dir[0]) {
+        dir = "/dev/shm/goofydeck/palettes";
+        (void)mkdir("/dev/shm/goofydeck", 0777);
+    }
+    (void)mkdir(dir, 0777);
+    uint64_t h = 1469598103934665603ull;   // FNV-1a 64
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) h = (h ^ *p) * 1099511628211ull;
+    h = (h ^ (uint64_t)colors) * 1099511628211ull;
+    int n = snprintf(out, cap, "%s/%016llx.pal", dir, (unsigned long long)h);
+    return (n < 0 || (size_t)n >= cap) ? -1 : 0;
+}
+
+static FD_UNUSED int fd_opt_cache_load(const char *path, uint8_t pal[256][4], int max_colors) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    uint8_t hdr[7];
+    int n = 0;
+    if (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) && memcmp(hdr, FD_OPT_PAL_MAGIC, 6) == 0) {
+        n = hdr[6] ? hdr[6] : 256;
+        if (n > max_colors || fread(pal, 4, (size_t)n, f) != (size_t)n) n = 0;
+    }
+    fclose(f);
+    return n;
+}
+
+static FD_UNUSED void fd_opt_cache_store(const char *path, const uint8_t (*pal)[4], int n) {
+    static atomic_uint seq;
+    char tmp[FD_OPT_PATH_MAX];
+    unsigned s = atomic_fetch_add(&seq, 1u);
+    if (snprintf(tmp, sizeof(tmp), "%s.%d.%u.tmp", path, (int)getpid(), s) >= (int)sizeof(tmp)) return;
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return;
+    uint8_t count = (uint8_t)(n & 0xFF);
+    int ok = fwrite(FD_OPT_PAL_MAGIC, 1, 6, f) == 6 && fwrite(&count, 1, 1, f) == 1 &&
+             fwrite(pal, 4, (size_t)n, f) == (size_t)n;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok || rename(tmp, path) != 0) unlink(tmp);
+}
+
+// Quantize rgba (w x h, tightly packed) to at most `colors` entries: fills pal/pal_n and idx (w*h bytes).
+// Fully transparent pixels get RGB=0 in rgba so they share one entry. key may be NULL (no cache).
+// *how (optional) is set to "cache", "exact" or "wu". Returns 0, or -1 on allocation failure.
+static FD_UNUSED int fd_opt_quantize(uint8_t *rgba, int w, int h, int colors, const char *key, uint8_t pal[256][4],
+                                     int *pal_n, uint8_t *idx, const char **how) {
+    size_t pixels = (size_t)w * (size_t)h;
+    size_t stride = (size_t)w * 4;
+    int seen_white = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        uint8_t *px = rgba + i * 4;
+        if (px[3] == 0) px[0] = px[1] = px[2] = 0;
+        else if (px[0] == 255 && px[1] == 255 && px[2] == 255 && px[3] == 255) seen_white = 1;
+    }
+    if (colors < 1) colors = 1;
+    if (colors > 256) colors = 256;
+    int n = 0;
+    const char *path_taken = "wu";
+
+    // 1) Palette cache hit: map straight to the preset palette.
+    char cache_path[FD_OPT_PATH_MAX];
+    int use_cache = key && key[0] && fd_opt_cache_path(key, colors, cache_path, sizeof(cache_path)) == 0;
+    if (use_cache) {
+        n = fd_opt_cache_load(cache_path, pal, colors);
+        if (n > 0) {
+            size_t far = fd_wu_map((const uint8_t (*)[4])pal, n, rgba, w, h, stride, idx, FD_OPT_FAR_DIST);
+            if (far * FD_OPT_FAR_SHARE > pixels) n = 0;
+            else path_taken = "cache";
+        }
+    }
+
+    // 2) Few colors: keep them exactly.
+    if (n == 0) {
+        fd_png_enc_t exact;
+        fd_png_enc_init(&exact);
+        if (fd_png_palettize(&exact, rgba, w, h, stride) == 0 && exact.pal_n <= colors) {
+            n = exact.pal_n;
+            memcpy(pal, exact.pal, (size_t)n * 4);
+            memcpy(idx, exact.idx, pixels);
+            path_taken = "exact";
+        }
+        fd_png_enc_free(&exact);
+    }
+
+    // 3) Wu's quantizer, stored for the next icons of the preset.
+    if (n == 0) {
+        fd_wu_t wu;
+        fd_wu_init(&wu);
+        if (fd_wu_histogram(&wu, rgba, w, h, stride) == 0) n = fd_wu_build_palette(&wu, colors, FD_OPT_REFINE_ITERS);
+        if (n > 0) memcpy(pal, wu.pal, (size_t)n * 4);
+        fd_wu_free(&wu);
+        if (n == 0) return -1;
+        // Ensure pure white remains if present in the source (snap the nearest entry)
+        if (seen_white) {
+            int d = 0;
+            int k = fd_wu_nearest((const uint8_t (*)[4])pal, n, 255, 255, 255, 255, &d);
+            if (d > 0) memset(pal[k], 255, 4);
+        }
+        fd_wu_map((const uint8_t (*)[4])pal, n, rgba, w, h, stride, idx, 0);
+        if (use_cache) fd_opt_cache_store(cache_path, (const uint8_t (*)[4])pal, n);
+    }
+    *pal_n = n;
+    if (how) *how = path_taken;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,819 @@
+// Shared PNG codec for device tiles and icon tools: encoder writing into a caller-provided
+// buffer, streaming decoder to RGBA8, and small file helpers.
+//
+// Encoder
+// - fd_png_encode_rgba() picks the smallest color type that is lossless for the image:
+//   palette (1/2/4/8 bits, tRNS only if needed) when <= 256 distinct RGBA values, otherwise
+//   RGB when fully opaque, otherwise RGBA. fd_png_encode_rgba8() always writes 8-bit RGBA.
+// - Palette images are written with filter 0 (what libpng recommends for indexed data) unless
+//   fd_png_encode_indexed_z() is asked for per-row selection: minimum sum of absolute
+//   differences, or brute force (each candidate row deflated after the rows already chosen,
+//   smallest wins). Truecolor rows always get the sum-of-absolute-differences heuristic.
+// - Chunk CRCs use zlib's crc32() (slice-by-N / hardware-accelerated depending on the build).
+// - The deflate stream and all scratch buffers live in the encoder and are reused across images.
+//
+// Decoder
+// - fd_png_decode() accepts every non-interlaced color type and bit depth (16-bit is reduced
+//   to 8, tRNS honoured) and always produces 8-bit RGBA, w * 4 bytes per row.
+// - IDAT chunks are inflated in place from the input buffer, one scanline at a time, and each
+//   row is unfiltered and expanded as soon as it is complete (no concatenated IDAT copy, no
+//   whole-image scanline buffer). Avg/Paeth run on 4 x int16 vectors for 3/4-byte pixels
+//   (SSE2 / NEON through GCC vector extensions; scalar elsewhere or with FD_PNG_NO_SIMD).
+// - The inflate stream, the file buffer and the output image are reused across decodes.
+//
+// Usage:
+//   fd_png_enc_t e;
+//   fd_png_enc_init(&e);
+//   size_t cap = fd_png_bound(w, h), len = 0;
+//   uint8_t *buf = malloc(cap);
+//   if (fd_png_encode_rgba(&e, rgba, w, h, w * 4, FD_PNG_FAST, buf, cap, &len) == 0) write(fd, buf, len);
+//   fd_png_enc_free(&e);
+//
+//   fd_png_dec_t d;
+//   fd_png_dec_init(&d);
+//   if (fd_png_load(&d, "in.png") == 0) use(d.rgba, d.w, d.h);
+//   fd_png_save_rgba(&e, "out.png", d.rgba, d.w, d.h, (size_t)d.w * 4, FD_PNG_SMALL);
+//   fd_png_dec_free(&d);
+
+#ifndef FD_PNG_H
+#define FD_PNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+// Effort: FAST is tuned for per-frame tiles, SMALL trades CPU for fewer bytes on the wire.
+enum {
+    FD_PNG_FAST = 0,
+    FD_PNG_SMALL = 1
+};
+
+// zlib levels per effort (tiles are small: level changes cost little in absolute time)
+#ifndef FD_PNG_FAST_LEVEL
+#define FD_PNG_FAST_LEVEL 6
+#endif
+#ifndef FD_PNG_SMALL_LEVEL
+#define FD_PNG_SMALL_LEVEL 9
+#endif
+
+// Row filter selection for fd_png_encode_indexed_z()
+enum {
+    FD_PNG_FILTER_NONE = 0,    // filter 0 on every row
+    FD_PNG_FILTER_SAD = 1,     // per row: minimum sum of absolute (signed) differences
+    FD_PNG_FILTER_BRUTE = 2    // per row: smallest trial deflate after the previous rows
+};
+
+#define FD_PNG_BRUTE_WINDOW 8192   // trial dictionary: the last bytes of the rows already chosen
+#define FD_PNG_HASH_SIZE 1024   // open addressing, <= 256 keys => load <= 25%
+
+typedef struct {
+    z_stream zs;
+    int zs_ready;
+    int zs_level;
+    int zs_strategy;
+    uint8_t *raw;        // filtered scanlines (filter byte + row), input of deflate
+    size_t raw_cap;
+    uint8_t *idx;        // one palette index per pixel (fd_png_encode_rgba)
+    size_t idx_cap;
+    uint8_t *cand;       // 4 candidate rows for the filter heuristic
+    size_t cand_cap;
+    uint8_t *pack;       // packed palette rows (indexed filters other than none)
+    size_t pack_cap;
+    uint32_t hkey[FD_PNG_HASH_SIZE];
+    int16_t hval[FD_PNG_HASH_SIZE];   // -1 = empty
+    uint8_t pal[256][4];
+    int pal_n;
+    uint8_t *file;       // encoded image (fd_png_save_*)
+    size_t file_cap;
+} fd_png_enc_t;
+
+static FD_UNUSED void fd_png_enc_init(fd_png_enc_t *e) {
+    memset(e, 0, sizeof(*e));
+}
+
+static FD_UNUSED void fd_png_enc_free(fd_png_enc_t *e) {
+    if (!e) return;
+    if (e->zs_ready) deflateEnd(&e->zs);
+    free(e->raw);
+    free(e->idx);
+    free(e->cand);
+    free(e->pack);
+    free(e->file);
+    memset(e, 0, sizeof(*e));
+}
+
+// Worst-case encoded size of a w x h image (RGBA, incompressible), headers included.
+static FD_UNUSED size_t fd_png_bound(int w, int h) {
+    size_t raw = (size_t)h * ((size_t)w * 4 + 1);
+    // signature + IHDR + PLTE + tRNS + IDAT + IEND, stored-block overhead covered by compressBound
+    return 8 + 25 + (12 + 768) + (12 + 256) + 12 + 12 + (size_t)compressBound((uLong)raw);
+}
+
+static int fd_png_grow(uint8_t **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 0;
+    uint8_t *p = realloc(*buf, need);
+    if (!p) return -1;
+    *buf = p;
+    *cap = need;
+    return 0;
+}
+
+static inline void fd_png_put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Chunk whose data is already at out + *pos + 8: fill length/type/CRC around it.
+static int fd_png_chunk_at(uint8_t *out, size_t cap, size_t *pos, const char type[4], size_t len) {
+    if (*pos + 12 + len > cap || len > 0x7FFFFFFFu) return -1;
+    uint8_t *c = out + *pos;
+    fd_png_put32(c, (uint32_t)len);
+    memcpy(c + 4, type, 4);
+    fd_png_put32(c + 8 + len, (uint32_t)crc32(0L, c + 4, (uInt)(len + 4)));
+    *pos += 12 + len;
+    return 0;
+}
+
+static int fd_png_chunk(uint8_t *out, size_t cap, size_t *pos, const char type[4], const uint8_t *data, size_t len) {
+    if (*pos + 12 + len > cap) return -1;
+    if (len) memcpy(out + *pos + 8, data, len);
+    return fd_png_chunk_at(out, cap, pos, type, len);
+}
+
+static int fd_png_header(uint8_t *out, size_t cap, size_t *pos, int w, int h, int depth, int ctype) {
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (cap < 8) return -1;
+    memcpy(out, sig, 8);
+    *pos = 8;
+    uint8_t ihdr[13];
+    fd_png_put32(ihdr, (uint32_t)w);
+    fd_png_put32(ihdr + 4, (uint32_t)h);
+    ihdr[8] = (uint8_t)depth;
+    ihdr[9] = (uint8_t)ctype;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    return fd_png_chunk(out, cap, pos, "IHDR", ihdr, 13);
+}
+
+// Deflate raw[0..raw_len) as the IDAT payload, then IEND.
+static int fd_png_finish(fd_png_enc_t *e, size_t raw_len, int level, int strategy,
+                         uint8_t *out, size_t cap, size_t *pos) {
+    if (*pos + 12 + 12 > cap) return -1;
+    if (!e->zs_ready) {
+        memset(&e->zs, 0, sizeof(e->zs));
+        if (deflateInit2(&e->zs, level, Z_DEFLATED, 15, 9, strategy) != Z_OK) return -1;
+        e->zs_ready = 1;
+        e->zs_level = level;
+        e->zs_strategy = strategy;
+    } else {
+        if (deflateReset(&e->zs) != Z_OK) return -1;
+        if ((level != e->zs_level || strategy != e->zs_strategy) &&
+            deflateParams(&e->zs, level, strategy) != Z_OK) return -1;
+        e->zs_level = level;
+        e->zs_strategy = strategy;
+    }
+    size_t room = cap - *pos - 12 - 12;
+    e->zs.next_in = e->raw;
+    e->zs.avail_in = (uInt)raw_len;
+    e->zs.next_out = out + *pos + 8;
+    e->zs.avail_out = (uInt)(room > 0xFFFFFFFFu ? 0xFFFFFFFFu : room);
+    if (deflate(&e->zs, Z_FINISH) != Z_STREAM_END) return -1;
+    if (fd_png_chunk_at(out, cap, pos, "IDAT", (size_t)e->zs.total_out) != 0) return -1;
+    return fd_png_chunk(out, cap, pos, "IEND", NULL, 0);
+}
+
+static inline uint8_t fd_png_paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+static inline unsigned fd_png_sad(const uint8_t *r, size_t n) {
+    unsigned s = 0;
+    for (size_t i = 0; i < n; i++) s += (unsigned)abs((int8_t)r[i]);
+    return s;
+}
+
+// Sub, Up, Avg and Paeth versions of one row into cand (4 x rowbytes).
+static void fd_png_filter_cands(const uint8_t *row, const uint8_t *prev, size_t rowbytes, int bpp, uint8_t *cand) {
+    uint8_t *sub = cand, *up = cand + rowbytes, *avg = up + rowbytes, *pae = avg + rowbytes;
+    for (size_t i = 0; i < rowbytes; i++) {
+        int a = i >= (size_t)bpp ? row[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+        sub[i] = (uint8_t)(row[i] - a);
+        up[i] = (uint8_t)(row[i] - b);
+        avg[i] = (uint8_t)(row[i] - ((a + b) >> 1));
+        pae[i] = (uint8_t)(row[i] - fd_png_paeth(a, b, c));
+    }
+}
+
+// Filter rows into e->raw, picking per row the filter with the minimum sum of absolute
+// (signed) differences.
+static int fd_png_filter_adaptive(fd_png_enc_t *e, const uint8_t *img, int h, size_t rowbytes, size_t stride,
+                                  int bpp) {
+    if (fd_png_grow(&e->raw, &e->raw_cap, (size_t)h * (rowbytes + 1)) != 0) return -1;
+    if (fd_png_grow(&e->cand, &e->cand_cap, rowbytes * 4) != 0) return -1;
+    const uint8_t *prev = NULL;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *row = img + (size_t)y * stride;
+        uint8_t *dst = e->raw + (size_t)y * (rowbytes + 1);
+        fd_png_filter_cands(row, prev, rowbytes, bpp, e->cand);
+        int best = 0;
+        unsigned best_sad = fd_png_sad(row, rowbytes);
+        for (int f = 1; f < 5; f++) {
+            if (!prev && (f == 2)) continue;  // Up == None on the first row
+            unsigned s = fd_png_sad(e->cand + (size_t)(f - 1) * rowbytes, rowbytes);
+            if (s < best_sad) { best_sad = s; best = f; }
+        }
+        dst[0] = (uint8_t)best;
+        memcpy(dst + 1, best ? e->cand + (size_t)(best - 1) * rowbytes : row, rowbytes);
+        prev = row;
+    }
+    return 0;
+}
+
+// Filter rows into e->raw, picking per row the filter whose row deflates smallest with the
+// last FD_PNG_BRUTE_WINDOW bytes already chosen as dictionary (same level/strategy as the
+// final stream). Slow: 5 trial deflates per row, meant for small icons written once.
+static int fd_png_filter_brute(fd_png_enc_t *e, const uint8_t *img, int h, size_t rowbytes, size_t stride,
+                               int bpp, int level, int strategy) {
+    const size_t line = rowbytes + 1;
+    if (fd_png_grow(&e->raw, &e->raw_cap, (size_t)h * line) != 0) return -1;
+    if (fd_png_grow(&e->cand, &e->cand_cap, rowbytes * 4 + line) != 0) return -1;
+    z_stream zt;
+    memset(&zt, 0, sizeof(zt));
+    if (deflateInit2(&zt, level, Z_DEFLATED, 15, 9, strategy) != Z_OK) return -1;
+    size_t scratch_cap = (size_t)deflateBound(&zt, (uLong)line) + 64;
+    uint8_t *scratch = malloc(scratch_cap);
+    int rc = scratch ? 0 : -1;
+    uint8_t *trial = e->cand + rowbytes * 4;
+    const uint8_t *prev = NULL;
+    for (int y = 0; y < h && rc == 0; y++) {
+        const uint8_t *row = img + (size_t)y * stride;
+        uint8_t *dst = e->raw + (size_t)y * line;
+        fd_png_filter_cands(row, prev, rowbytes, bpp, e->cand);
+        size_t done = (size_t)y * line;
+        size_t ctx = done < FD_PNG_BRUTE_WINDOW ? done : FD_PNG_BRUTE_WINDOW;
+        int best = 0;
+        uLong best_len = 0;
+        for (int f = 0; f < 5 && rc == 0; f++) {
+            if (!prev && f == 2) continue;
+            trial[0] = (uint8_t)f;
+            memcpy(trial + 1, f ? e->cand + (size_t)(f - 1) * rowbytes : row, rowbytes);
+            if (deflateReset(&zt) != Z_OK ||
+                (ctx && deflateSetDictionary(&zt, e->raw + done - ctx, (uInt)ctx) != Z_OK)) {
+                rc = -1;
+                break;
+            }
+            zt.next_in = trial;
+            zt.avail_in = (uInt)line;
+            zt.next_out = scratch;
+            zt.avail_out = (uInt)scratch_cap;
+            if (deflate(&zt, Z_FINISH) != Z_STREAM_END) {
+                rc = -1;
+                break;
+            }
+            if (f == 0 || zt.total_out < best_len) {
+                best_len = zt.total_out;
+                best = f;
+            }
+        }
+        dst[0] = (uint8_t)best;
+        memcpy(dst + 1, best ? e->cand + (size_t)(best - 1) * rowbytes : row, rowbytes);
+        prev = row;
+    }
+    deflateEnd(&zt);
+    free(scratch);
+    return rc;
+}
+
+// Indexed image with explicit zlib level/strategy and row filter selection (FD_PNG_FILTER_*),
+// for callers comparing candidates.
+static FD_UNUSED int fd_png_encode_indexed_z(fd_png_enc_t *e, const uint8_t *idx, int w, int h, size_t stride,
+                                             const uint8_t (*pal)[4], int pal_n, int level, int strategy, int filter,
+                                             uint8_t *out, size_t cap, size_t *out_len) {
+    if (w <= 0 || h <= 0 || pal_n < 1 || pal_n > 256) return -1;
+    const int depth = pal_n <= 2 ? 1 : pal_n <= 4 ? 2 : pal_n <= 16 ? 4 : 8;
+    const size_t rowbytes = ((size_t)w * (size_t)depth + 7) / 8;
+    if (fd_png_grow(&e->raw, &e->raw_cap, (size_t)h * (rowbytes + 1)) != 0) return -1;
+    if (filter != FD_PNG_FILTER_NONE && fd_png_grow(&e->pack, &e->pack_cap, (size_t)h * rowbytes) != 0) return -1;
+
+    // Filter none: pack straight into e->raw after a 0 filter byte; otherwise pack, then filter.
+    const int per_byte = 8 / depth;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *s = idx + (size_t)y * stride;
+        uint8_t *d;
+        if (filter == FD_PNG_FILTER_NONE) {
+            d = e->raw + (size_t)y * (rowbytes + 1);
+            *d++ = 0;
+        } else {
+            d = e->pack + (size_t)y * rowbytes;
+        }
+        if (depth == 8) {
+            memcpy(d, s, (size_t)w);
+            continue;
+        }
+        int x = 0;
+        for (size_t b = 0; b < rowbytes; b++) {
+            unsigned v = 0;
+            for (int k = 0; k < per_byte; k++, x++) {
+                v = (v << depth) | (x < w ? s[x] : 0u);
+            }
+            d[b] = (uint8_t)v;
+        }
+    }
+    if (filter == FD_PNG_FILTER_SAD && fd_png_filter_adaptive(e, e->pack, h, rowbytes, rowbytes, 1) != 0) return -1;
+    if (filter == FD_PNG_FILTER_BRUTE &&
+        fd_png_filter_brute(e, e->pack, h, rowbytes, rowbytes, 1, level, strategy) != 0) return -1;
+
+    size_t pos = 0;
+    if (fd_png_header(out, cap, &pos, w, h, depth, 3) != 0) return -1;
+    uint8_t plte[768], trns[256];
+    int trns_n = 0;
+    for (int i = 0; i < pal_n; i++) {
+        plte[i * 3 + 0] = pal[i][0];
+        plte[i * 3 + 1] = pal[i][1];
+        plte[i * 3 + 2] = pal[i][2];
+        trns[i] = pal[i][3];
+        if (pal[i][3] != 255) trns_n = i + 1;
+    }
+    if (fd_png_chunk(out, cap, &pos, "PLTE", plte, (size_t)pal_n * 3) != 0) return -1;
+    if (trns_n > 0 && fd_png_chunk(out, cap, &pos, "tRNS", trns, (size_t)trns_n) != 0) return -1;
+    if (fd_png_finish(e, (size_t)h * (rowbytes + 1), level, strategy, out, cap, &pos) != 0) return -1;
+    *out_len = pos;
+    return 0;
+}
+
+// Indexed image: idx holds one palette index per pixel, pal holds RGBA entries.
+static FD_UNUSED int fd_png_encode_indexed(fd_png_enc_t *e, const uint8_t *idx, int w, int h, size_t stride,
+                                           const uint8_t (*pal)[4], int pal_n, int effort,
+                                           uint8_t *out, size_t cap, size_t *out_len) {
+    int level = effort == FD_PNG_SMALL ? FD_PNG_SMALL_LEVEL : FD_PNG_FAST_LEVEL;
+    return fd_png_encode_indexed_z(e, idx, w, h, stride, pal, pal_n, level, Z_DEFAULT_STRATEGY, FD_PNG_FILTER_NONE,
+                                   out, cap, out_len);
+}
+
+// Exact palette of an RGBA image into e->pal / e->idx; -1 when it has more than 256 colors.
+static int fd_png_palettize(fd_png_enc_t *e, const uint8_t *rgba, int w, int h, size_t stride) {
+    if (fd_png_grow(&e->idx, &e->idx_cap, (size_t)w * (size_t)h) != 0) return -1;
+    memset(e->hval, 0xFF, sizeof(e->hval));
+    e->pal_n = 0;
+    uint32_t last = 0;
+    int last_i = -1;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *p = rgba + (size_t)y * stride;
+        uint8_t *d = e->idx + (size_t)y * (size_t)w;
+        for (int x = 0; x < w; x++, p += 4) {
+            uint32_t key = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+            if (key == last && last_i >= 0) { d[x] = (uint8_t)last_i; continue; }
+            uint32_t hsh = (key * 2654435761u) >> 22;   // 10 bits
+            while (e->hval[hsh] >= 0 && e->hkey[hsh] != key) hsh = (hsh + 1) & (FD_PNG_HASH_SIZE - 1);
+            if (e->hval[hsh] < 0) {
+                if (e->pal_n == 256) return -1;
+                e->hkey[hsh] = key;
+                e->hval[hsh] = (int16_t)e->pal_n;
+                memcpy(e->pal[e->pal_n], p, 4);
+                e->pal_n++;
+            }
+            last = key;
+            last_i = e->hval[hsh];
+            d[x] = (uint8_t)last_i;
+        }
+    }
+
+    // Translucent entries first so tRNS stays as short as possible.
+    uint8_t remap[256];
+    uint8_t sorted[256][4];
+    int n = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < e->pal_n; i++) {
+            if ((e->pal[i][3] != 255) != (pass == 0)) continue;
+            memcpy(sorted[n], e->pal[i], 4);
+            remap[i] = (uint8_t)n++;
+        }
+    }
+    int identity = 1;
+    for (int i = 0; i < e->pal_n; i++) if (remap[i] != i) { identity = 0; break; }
+    if (!identity) {
+        memcpy(e->pal, sorted, (size_t)e->pal_n * 4);
+        size_t total = (size_t)w * (size_t)h;
+        for (size_t i = 0; i < total; i++) e->idx[i] = remap[e->idx[i]];
+    }
+    return 0;
+}
+
+static FD_UNUSED int fd_png_encode_rgba(fd_png_enc_t *e, const uint8_t *rgba, int w, int h, size_t stride,
+                                        int effort, uint8_t *out, size_t cap, size_t *out_len) {
+    if (w <= 0 || h <= 0) return -1;
+    if (fd_png_palettize(e, rgba, w, h, stride) == 0) {
+        return fd_png_encode_indexed(e, e->idx, w, h, (size_t)w, (const uint8_t (*)[4])e->pal, e->pal_n, effort,
+                                     out, cap, out_len);
+    }
+
+    int opaque = 1;
+    for (int y = 0; y < h && opaque; y++) {
+        const uint8_t *p = rgba + (size_t)y * stride;
+        for (int x = 0; x < w; x++) if (p[x * 4 + 3] != 255) { opaque = 0; break; }
+    }
+    const int bpp = opaque ? 3 : 4;
+    const size_t rowbytes = (size_t)w * (size_t)bpp;
+    const uint8_t *src = rgba;
+    size_t src_stride = stride;
+    if (opaque) {
+        // RGB copy (reuses the index buffer as scratch)
+        if (fd_png_grow(&e->idx, &e->idx_cap, rowbytes * (size_t)h) != 0) return -1;
+        for (int y = 0; y < h; y++) {
+            const uint8_t *s = rgba + (size_t)y * stride;
+            uint8_t *d = e->idx + (size_t)y * rowbytes;
+            for (int x = 0; x < w; x++, s += 4, d += 3) { d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; }
+        }
+        src = e->idx;
+        src_stride = rowbytes;
+    }
+    if (fd_png_filter_adaptive(e, src, h, rowbytes, src_stride, bpp) != 0) return -1;
+
+    size_t pos = 0;
+    if (fd_png_header(out, cap, &pos, w, h, 8, opaque ? 2 : 6) != 0) return -1;
+    int level = effort == FD_PNG_SMALL ? FD_PNG_SMALL_LEVEL : FD_PNG_FAST_LEVEL;
+    if (fd_png_finish(e, (size_t)h * (rowbytes + 1), level, Z_FILTERED, out, cap, &pos) != 0) return -1;
+    *out_len = pos;
+    return 0;
+}
+
+// Always 8-bit RGBA (tools whose output format is part of their contract).
+static FD_UNUSED int fd_png_encode_rgba8(fd_png_enc_t *e, const uint8_t *rgba, int w, int h, size_t stride,
+                                         int effort, uint8_t *out, size_t cap, size_t *out_len) {
+    if (w <= 0 || h <= 0) return -1;
+    const size_t rowbytes = (size_t)w * 4;
+    if (fd_png_filter_adaptive(e, rgba, h, rowbytes, stride, 4) != 0) return -1;
+    size_t pos = 0;
+    if (fd_png_header(out, cap, &pos, w, h, 8, 6) != 0) return -1;
+    int level = effort == FD_PNG_SMALL ? FD_PNG_SMALL_LEVEL : FD_PNG_FAST_LEVEL;
+    if (fd_png_finish(e, (size_t)h * (rowbytes + 1), level, Z_FILTERED, out, cap, &pos) != 0) return -1;
+    *out_len = pos;
+    return 0;
+}
+
+// --- Files ---
+
+// Output buffer of the fd_png_save_* helpers, large enough for any w x h image.
+static FD_UNUSED uint8_t *fd_png_out_buf(fd_png_enc_t *e, int w, int h, size_t *cap) {
+    if (w <= 0 || h <= 0) return NULL;
+    *cap = fd_png_bound(w, h);
+    if (fd_png_grow(&e->file, &e->file_cap, *cap) != 0) return NULL;
+    return e->file;
+}
+
+static FD_UNUSED int fd_png_write_file(const char *path, const uint8_t *buf, size_t len) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(buf, 1, len, f) == len;
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+static FD_UNUSED int fd_png_save_rgba(fd_png_enc_t *e, const char *path, const uint8_t *rgba, int w, int h,
+                                      size_t stride, int effort) {
+    size_t cap = 0, len = 0;
+    uint8_t *out = fd_png_out_buf(e, w, h, &cap);
+    if (!out || fd_png_encode_rgba8(e, rgba, w, h, stride, effort, out, cap, &len) != 0) return -1;
+    return fd_png_write_file(path, out, len);
+}
+
+// --- Decoder ---
+
+#ifndef FD_PNG_MAX_DIM
+#define FD_PNG_MAX_DIM 16384
+#endif
+
+typedef struct {
+    z_stream zs;
+    int zs_ready;
+    uint8_t *file;       // fd_png_load: whole file
+    size_t file_cap;
+    uint8_t *rows;       // two scanlines (filter byte + data): current and previous
+    size_t rows_cap;
+    uint8_t *rgba;       // decoded image, w * 4 bytes per row
+    size_t rgba_cap;
+    int w, h;
+    int depth, ctype;    // source format (IHDR)
+    int scalar;          // 1: portable unfilter only (benchmarks)
+} fd_png_dec_t;
+
+static FD_UNUSED void fd_png_dec_init(fd_png_dec_t *d) {
+    memset(d, 0, sizeof(*d));
+}
+
+static FD_UNUSED void fd_png_dec_free(fd_png_dec_t *d) {
+    if (!d) return;
+    if (d->zs_ready) inflateEnd(&d->zs);
+    free(d->file);
+    free(d->rows);
+    free(d->rgba);
+    memset(d, 0, sizeof(*d));
+}
+
+static inline uint32_t fd_png_get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(FD_PNG_NO_SIMD)
+#define FD_PNG_SIMD 1
+typedef int16_t fd_png_v4 __attribute__((vector_size(8)));
+
+static inline fd_png_v4 fd_png_v4_load(const uint8_t *p, int bpp) {
+    fd_png_v4 v = { p[0], p[1], p[2], bpp == 4 ? p[3] : 0 };
+    return v;
+}
+
+static inline void fd_png_v4_store(uint8_t *p, fd_png_v4 v, int bpp) {
+    p[0] = (uint8_t)v[0];
+    p[1] = (uint8_t)v[1];
+    p[2] = (uint8_t)v[2];
+    if (bpp == 4) p[3] = (uint8_t)v[3];
+}
+
+static inline fd_png_v4 fd_png_v4_abs(fd_png_v4 v) {
+    fd_png_v4 s = v >> 15;
+    return (v ^ s) - s;
+}
+
+// One lane per channel: the left-pixel dependency keeps the loop serial over pixels, the
+// channels of a pixel are computed together. The first pixel is done by the caller.
+static inline void fd_png_unfilter_avg_v(uint8_t *cur, const uint8_t *prev, size_t n, int bpp) {
+    fd_png_v4 a = fd_png_v4_load(cur, bpp);
+    for (size_t i = (size_t)bpp; i < n; i += (size_t)bpp) {
+        fd_png_v4 b = fd_png_v4_load(prev + i, bpp);
+        fd_png_v4 x = fd_png_v4_load(cur + i, bpp);
+        a = (x + ((a + b) >> 1)) & 0xFF;
+        fd_png_v4_store(cur + i, a, bpp);
+    }
+}
+
+static inline void fd_png_unfilter_paeth_v(uint8_t *cur, const uint8_t *prev, size_t n, int bpp) {
+    fd_png_v4 a = fd_png_v4_load(cur, bpp);
+    fd_png_v4 c = fd_png_v4_load(prev, bpp);
+    for (size_t i = (size_t)bpp; i < n; i += (size_t)bpp) {
+        fd_png_v4 b = fd_png_v4_load(prev + i, bpp);
+        fd_png_v4 x = fd_png_v4_load(cur + i, bpp);
+        // p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c|, |p - c| = |(b - c) + (a - c)|
+        fd_png_v4 pa = b - c, pb = a - c;
+        fd_png_v4 pc = fd_png_v4_abs(pa + pb);
+        pa = fd_png_v4_abs(pa);
+        pb = fd_png_v4_abs(pb);
+        fd_png_v4 use_a = (pa <= pb) & (pa <= pc);
+        fd_png_v4 use_b = pb <= pc;
+        fd_png_v4 pred = (use_a & a) | (~use_a & ((use_b & b) | (~use_b & c)));
+        a = (x + pred) & 0xFF;
+        fd_png_v4_store(cur + i, a, bpp);
+        c = b;
+    }
+}
+#endif
+
+// Unfilter one scanline in place; prev is the previous unfiltered row (zeros for the first one).
+static int fd_png_unfilter_row(int type, uint8_t *cur, const uint8_t *prev, size_t n, int bpp, int scalar) {
+    size_t i = 0, first = (size_t)bpp < n ? (size_t)bpp : n;
+    (void)scalar;
+    switch (type) {
+    case 0:
+        return 0;
+    case 1:
+        for (i = first; i < n; i++) cur[i] = (uint8_t)(cur[i] + cur[i - bpp]);
+        return 0;
+    case 2:
+        for (i = 0; i < n; i++) cur[i] = (uint8_t)(cur[i] + prev[i]);
+        return 0;
+    case 3:
+        for (i = 0; i < first; i++) cur[i] = (uint8_t)(cur[i] + (prev[i] >> 1));
+#ifdef FD_PNG_SIMD
+        if (!scalar && bpp == 4) { fd_png_unfilter_avg_v(cur, prev, n, 4); return 0; }
+        if (!scalar && bpp == 3) { fd_png_unfilter_avg_v(cur, prev, n, 3); return 0; }
+#endif
+        for (; i < n; i++) cur[i] = (uint8_t)(cur[i] + ((cur[i - bpp] + prev[i]) >> 1));
+        return 0;
+    case 4:
+        for (i = 0; i < first; i++) cur[i] = (uint8_t)(cur[i] + prev[i]);
+#ifdef FD_PNG_SIMD
+        if (!scalar && bpp == 4) { fd_png_unfilter_paeth_v(cur, prev, n, 4); return 0; }
+        if (!scalar && bpp == 3) { fd_png_unfilter_paeth_v(cur, prev, n, 3); return 0; }
+#endif
+        for (; i < n; i++) cur[i] = (uint8_t)(cur[i] + fd_png_paeth(cur[i - bpp], prev[i], prev[i - bpp]));
+        return 0;
+    }
+    return -1;
+}
+
+// Sample x of a row with 1/2/4/8 bits per sample.
+static inline unsigned fd_png_sample(const uint8_t *row, int x, int depth) {
+    if (depth == 8) return row[x];
+    unsigned bit = (unsigned)x * (unsigned)depth;
+    return (row[bit >> 3] >> (8 - depth - (int)(bit & 7))) & ((1u << depth) - 1);
+}
+
+typedef struct {
+    uint8_t pal[256][4];
+    int pal_n;
+    int has_key;         // tRNS for gray / RGB: samples equal to key are transparent
+    unsigned key[3];
+} fd_png_dec_aux_t;
+
+// One unfiltered scanline to RGBA8.
+static void fd_png_expand_row(const fd_png_dec_t *d, const fd_png_dec_aux_t *aux, const uint8_t *s, uint8_t *o) {
+    const int w = d->w, depth = d->depth;
+    switch (d->ctype) {
+    case 6:
+        if (depth == 8) {
+            memcpy(o, s, (size_t)w * 4);
+        } else {
+            for (int x = 0; x < w; x++, s += 8, o += 4) { o[0] = s[0]; o[1] = s[2]; o[2] = s[4]; o[3] = s[6]; }
+        }
+        break;
+    case 2:
+        for (int x = 0; x < w; x++, o += 4) {
+            unsigned r, g, b;
+            if (depth == 8) {
+                r = s[0]; g = s[1]; b = s[2];
+                o[0] = s[0]; o[1] = s[1]; o[2] = s[2];
+                s += 3;
+            } else {
+                r = ((unsigned)s[0] << 8) | s[1]; g = ((unsigned)s[2] << 8) | s[3]; b = ((unsigned)s[4] << 8) | s[5];
+                o[0] = s[0]; o[1] = s[2]; o[2] = s[4];
+                s += 6;
+            }
+            o[3] = (aux->has_key && r == aux->key[0] && g == aux->key[1] && b == aux->key[2]) ? 0 : 255;
+        }
+        break;
+    case 4:
+        for (int x = 0; x < w; x++, o += 4) {
+            uint8_t g = s[0], a = depth == 8 ? s[1] : s[2];
+            s += depth == 8 ? 2 : 4;
+            o[0] = o[1] = o[2] = g;
+            o[3] = a;
+        }
+        break;
+    case 0: {
+        const unsigned maxv = (1u << (depth > 8 ? 16 : depth)) - 1;
+        for (int x = 0; x < w; x++, o += 4) {
+            unsigned v = depth == 16 ? (((unsigned)s[2 * x] << 8) | s[2 * x + 1]) : fd_png_sample(s, x, depth);
+            uint8_t g = (uint8_t)(depth == 16 ? v >> 8 : v * 255 / maxv);
+            o[0] = o[1] = o[2] = g;
+            o[3] = (aux->has_key && v == aux->key[0]) ? 0 : 255;
+        }
+        break;
+    }
+    case 3:
+        for (int x = 0; x < w; x++, o += 4) {
+            unsigned i = fd_png_sample(s, x, depth);
+            if ((int)i < aux->pal_n) memcpy(o, aux->pal[i], 4);
+            else memset(o, 0, 4);
+        }
+        break;
+    }
+}
+
+static int fd_png_dec_start(fd_png_dec_t *d, const uint8_t *ihdr, size_t *rowbytes, int *bpp) {
+    uint32_t w = fd_png_get32(ihdr), h = fd_png_get32(ihdr + 4);
+    int depth = ihdr[8], ctype = ihdr[9];
+    if (w == 0 || h == 0 || w > FD_PNG_MAX_DIM || h > FD_PNG_MAX_DIM) return -1;
+    if (ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] != 0) return -1;   // interlaced images are not supported
+    int channels;
+    switch (ctype) {
+    case 0: channels = 1; if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) return -1; break;
+    case 3: channels = 1; if (depth != 1 && depth != 2 && depth != 4 && depth != 8) return -1; break;
+    case 2: channels = 3; if (depth != 8 && depth != 16) return -1; break;
+    case 4: channels = 2; if (depth != 8 && depth != 16) return -1; break;
+    case 6: channels = 4; if (depth != 8 && depth != 16) return -1; break;
+    default: return -1;
+    }
+    const size_t bits = (size_t)channels * (size_t)depth;
+    *rowbytes = ((size_t)w * bits + 7) / 8;
+    *bpp = bits >= 8 ? (int)(bits / 8) : 1;
+    if (fd_png_grow(&d->rows, &d->rows_cap, 2 * (*rowbytes + 1)) != 0) return -1;
+    if (fd_png_grow(&d->rgba, &d->rgba_cap, (size_t)w * (size_t)h * 4) != 0) return -1;
+    memset(d->rows + *rowbytes + 1, 0, *rowbytes + 1);   // previous row of the first one
+    if (!d->zs_ready) {
+        memset(&d->zs, 0, sizeof(d->zs));
+        if (inflateInit(&d->zs) != Z_OK) return -1;
+        d->zs_ready = 1;
+    } else if (inflateReset(&d->zs) != Z_OK) {
+        return -1;
+    }
+    d->w = (int)w;
+    d->h = (int)h;
+    d->depth = depth;
+    d->ctype = ctype;
+    return 0;
+}
+
+// Decode a PNG held in memory into d->rgba (d->w * 4 bytes per row). Chunk CRCs are not checked.
+static FD_UNUSED int fd_png_decode(fd_png_dec_t *d, const uint8_t *data, size_t len) {
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (len < 8 || memcmp(data, sig, 8) != 0) return -1;
+    d->w = d->h = 0;
+    fd_png_dec_aux_t aux;
+    aux.pal_n = 0;
+    aux.has_key = 0;
+    size_t rowbytes = 0, fill = 0;
+    int bpp = 1, y = 0, zdone = 0;
+    uint8_t *cur = NULL, *prev = NULL;
+
+    size_t pos = 8;
+    while (pos + 12 <= len) {
+        const uint32_t clen = fd_png_get32(data + pos);
+        if (clen > len - pos - 12) return -1;
+        const uint8_t *type = data + pos + 4;
+        const uint8_t *cd = data + pos + 8;
+        pos += 12 + (size_t)clen;
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (d->w || clen < 13 || fd_png_dec_start(d, cd, &rowbytes, &bpp) != 0) return -1;
+            cur = d->rows;
+            prev = d->rows + rowbytes + 1;
+        } else if (!d->w) {
+            return -1;   // IHDR must come first
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (clen % 3 != 0 || clen / 3 > 256) return -1;
+            aux.pal_n = (int)(clen / 3);
+            for (int i = 0; i < aux.pal_n; i++) {
+                aux.pal[i][0] = cd[3 * i];
+                aux.pal[i][1] = cd[3 * i + 1];
+                aux.pal[i][2] = cd[3 * i + 2];
+                aux.pal[i][3] = 255;
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (d->ctype == 3) {
+                for (uint32_t i = 0; i < clen && i < 256; i++) aux.pal[i][3] = cd[i];
+            } else if (d->ctype == 0 && clen >= 2) {
+                aux.has_key = 1;
+                aux.key[0] = ((unsigned)cd[0] << 8) | cd[1];
+            } else if (d->ctype == 2 && clen >= 6) {
+                aux.has_key = 1;
+                for (int c = 0; c < 3; c++) aux.key[c] = ((unsigned)cd[2 * c] << 8) | cd[2 * c + 1];
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            if (d->ctype == 3 && aux.pal_n == 0) return -1;
+            if (zdone || y >= d->h) continue;
+            d->zs.next_in = (Bytef *)cd;
+            d->zs.avail_in = (uInt)clen;
+            while (y < d->h) {
+                d->zs.next_out = cur + fill;
+                d->zs.avail_out = (uInt)(rowbytes + 1 - fill);
+                int ret = inflate(&d->zs, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) return -1;
+                fill = rowbytes + 1 - d->zs.avail_out;
+                if (fill == rowbytes + 1) {
+                    if (fd_png_unfilter_row(cur[0], cur + 1, prev + 1, rowbytes, bpp, d->scalar) != 0) return -1;
+                    fd_png_expand_row(d, &aux, cur + 1, d->rgba + (size_t)y * (size_t)d->w * 4);
+                    uint8_t *t = cur;
+                    cur = prev;
+                    prev = t;
+                    fill = 0;
+                    y++;
+                    if (ret == Z_OK) continue;   // more output may be pending
+                }
+                if (ret == Z_STREAM_END) zdone = 1;
+                break;   // stream end, or this chunk is consumed
+            }
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+    }
+    return (d->w && y == d->h) ? 0 : -1;
+}
+
+// Read a whole file into d->file (reused) and decode it.
+static FD_UNUSED int fd_png_load(fd_png_dec_t *d, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size <= 0 || fseek(f, 0, SEEK_SET) != 0 ||
+        fd_png_grow(&d->file, &d->file_cap, (size_t)size) != 0 ||
+        fread(d->file, 1, (size_t)size, f) != (size_t)size) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return fd_png_decode(d, d->file, (size_t)size);
+}
+
+#endif
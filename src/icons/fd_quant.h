@@ -0,0 +1,379 @@
+// Shared palette quantizer: median-cut over an RGB555 histogram, optional k-means refinement,
+// and an inverse colormap (RGB555 -> palette index) so the mapping pass is one lookup per pixel.
+//
+// Usage:
+//   fd_quant_t q;
+//   if (fd_quant_init(&q) != 0) ...;
+//   fd_quant_rgba(&q, img, w, h, colors, kmeans_iters);   // in place, alpha untouched
+//   fd_quant_free(&q);
+//
+// A context is ~1MB and can be reused across images: only the buckets touched by the
+// previous histogram are cleared, so per-tile reuse costs O(unique colors), not O(32768).
+
+#ifndef FD_QUANT_H
+#define FD_QUANT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+// SIMD index extraction reads pixels as little-endian uint32 (R in the low byte).
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define FD_QUANT_SIMD 1
+#else
+#define FD_QUANT_SIMD 0
+#endif
+
+#define FD_QUANT_BUCKETS 32768
+#define FD_QUANT_MAX_COLORS 256
+
+typedef struct {
+    uint32_t *count;    // [FD_QUANT_BUCKETS] pixels per RGB555 bucket
+    uint64_t *sum;      // [FD_QUANT_BUCKETS * 3] exact RGB sums per bucket
+    uint16_t *lut;      // [FD_QUANT_BUCKETS] inverse colormap (valid for occupied buckets)
+    uint16_t *used;     // occupied buckets, in first-seen order
+    uint16_t *tmp;      // scratch for the counting sort
+    uint8_t *mean;      // [FD_QUANT_BUCKETS * 3] mean color of occupied buckets (set by build_palette)
+    int used_n;
+    uint8_t pal[FD_QUANT_MAX_COLORS][3];
+    int pal_n;
+} fd_quant_t;
+
+typedef struct {
+    int lo, hi;         // range in q->used
+    double score;       // weighted variance (0 => cannot split)
+    int axis;
+} fd_quant_box_t;
+
+static FD_UNUSED void fd_quant_free(fd_quant_t *q) {
+    if (!q) return;
+    free(q->count);
+    free(q->sum);
+    free(q->lut);
+    free(q->used);
+    free(q->tmp);
+    free(q->mean);
+    memset(q, 0, sizeof(*q));
+}
+
+static FD_UNUSED int fd_quant_init(fd_quant_t *q) {
+    if (!q) return -1;
+    memset(q, 0, sizeof(*q));
+    q->count = calloc(FD_QUANT_BUCKETS, sizeof(uint32_t));
+    q->sum = calloc((size_t)FD_QUANT_BUCKETS * 3, sizeof(uint64_t));
+    q->lut = calloc(FD_QUANT_BUCKETS, sizeof(uint16_t));
+    q->used = malloc(FD_QUANT_BUCKETS * sizeof(uint16_t));
+    q->tmp = malloc(FD_QUANT_BUCKETS * sizeof(uint16_t));
+    q->mean = malloc((size_t)FD_QUANT_BUCKETS * 3);
+    if (!q->count || !q->sum || !q->lut || !q->used || !q->tmp || !q->mean) {
+        fd_quant_free(q);
+        return -1;
+    }
+    return 0;
+}
+
+static inline uint32_t fd_quant_idx(const uint8_t *p) {
+    return ((uint32_t)(p[0] >> 3) << 10) | ((uint32_t)(p[1] >> 3) << 5) | (uint32_t)(p[2] >> 3);
+}
+
+#if FD_QUANT_SIMD
+// RGB555 index of 4 RGBA pixels: ((v & 0xF8) << 7) | ((v & 0xF800) >> 6) | ((v & 0xF80000) >> 19)
+static inline void fd_quant_idx4(const uint8_t *p, uint32_t out[4]) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+    __m128i r = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xF8)), 7);
+    __m128i g = _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xF800)), 6);
+    __m128i b = _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xF80000)), 19);
+    _mm_storeu_si128((__m128i *)(void *)out, _mm_or_si128(_mm_or_si128(r, g), b));
+#else
+    uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(p));
+    uint32x4_t r = vshlq_n_u32(vandq_u32(v, vdupq_n_u32(0xF8)), 7);
+    uint32x4_t g = vshrq_n_u32(vandq_u32(v, vdupq_n_u32(0xF800)), 6);
+    uint32x4_t b = vshrq_n_u32(vandq_u32(v, vdupq_n_u32(0xF80000)), 19);
+    vst1q_u32(out, vorrq_u32(vorrq_u32(r, g), b));
+#endif
+}
+#endif
+
+static inline void fd_quant_hist_add(fd_quant_t *q, uint32_t idx, const uint8_t *p) {
+    // idx must be fd_quant_idx(p)
+    if (q->count[idx]++ == 0) q->used[q->used_n++] = (uint16_t)idx;
+    uint64_t *s = q->sum + (size_t)idx * 3;
+    s[0] += p[0];
+    s[1] += p[1];
+    s[2] += p[2];
+}
+
+// Clear the previous histogram (only the occupied buckets).
+static FD_UNUSED void fd_quant_reset(fd_quant_t *q) {
+    for (int i = 0; i < q->used_n; i++) {
+        uint32_t idx = q->used[i];
+        q->count[idx] = 0;
+        q->sum[idx * 3 + 0] = q->sum[idx * 3 + 1] = q->sum[idx * 3 + 2] = 0;
+    }
+    q->used_n = 0;
+    q->pal_n = 0;
+}
+
+// Build the histogram of an RGBA image (clears the previous one first).
+// Callers producing pixels on the fly can use fd_quant_reset() + fd_quant_hist_add() instead.
+static FD_UNUSED void fd_quant_histogram(fd_quant_t *q, const uint8_t *img, int w, int h) {
+    fd_quant_reset(q);
+
+    size_t pixels = (size_t)w * (size_t)h;
+    size_t i = 0;
+#if FD_QUANT_SIMD
+    uint32_t idx4[4];
+    for (; i + 4 <= pixels; i += 4) {
+        const uint8_t *p = img + i * 4;
+        fd_quant_idx4(p, idx4);
+        fd_quant_hist_add(q, idx4[0], p);
+        fd_quant_hist_add(q, idx4[1], p + 4);
+        fd_quant_hist_add(q, idx4[2], p + 8);
+        fd_quant_hist_add(q, idx4[3], p + 12);
+    }
+#endif
+    for (; i < pixels; i++) {
+        const uint8_t *p = img + i * 4;
+        fd_quant_hist_add(q, fd_quant_idx(p), p);
+    }
+}
+
+// Mean color of an occupied bucket (cached in q->mean).
+static inline void fd_quant_bucket_rgb(const fd_quant_t *q, uint32_t idx, int rgb[3]) {
+    const uint8_t *m = q->mean + (size_t)idx * 3;
+    rgb[0] = m[0];
+    rgb[1] = m[1];
+    rgb[2] = m[2];
+}
+
+static void fd_quant_box_eval(const fd_quant_t *q, fd_quant_box_t *b) {
+    double n = 0, m[3] = {0, 0, 0}, m2[3] = {0, 0, 0};
+    for (int i = b->lo; i < b->hi; i++) {
+        uint32_t idx = q->used[i];
+        double c = (double)q->count[idx];
+        int rgb[3];
+        fd_quant_bucket_rgb(q, idx, rgb);
+        n += c;
+        for (int k = 0; k < 3; k++) {
+            m[k] += c * rgb[k];
+            m2[k] += c * rgb[k] * rgb[k];
+        }
+    }
+    b->score = 0;
+    b->axis = 0;
+    if (b->hi - b->lo < 2 || n <= 0) return;
+    double best = -1;
+    for (int k = 0; k < 3; k++) {
+        double var = m2[k] - m[k] * m[k] / n; // weighted sum of squared deviations
+        if (var > best) { best = var; b->axis = k; }
+    }
+    b->score = best > 0 ? best : 0;
+}
+
+// Sort used[lo..hi) by the box axis (counting sort on the 8-bit mean), then cut at the weighted median.
+static int fd_quant_box_split(fd_quant_t *q, const fd_quant_box_t *b) {
+    uint32_t hist[256];
+    memset(hist, 0, sizeof(hist));
+    uint64_t total = 0;
+    for (int i = b->lo; i < b->hi; i++) {
+        int rgb[3];
+        fd_quant_bucket_rgb(q, q->used[i], rgb);
+        hist[rgb[b->axis]]++;
+        total += q->count[q->used[i]];
+    }
+    uint32_t pos = 0;
+    for (int v = 0; v < 256; v++) {
+        uint32_t c = hist[v];
+        hist[v] = pos;
+        pos += c;
+    }
+    for (int i = b->lo; i < b->hi; i++) {
+        int rgb[3];
+        fd_quant_bucket_rgb(q, q->used[i], rgb);
+        q->tmp[hist[rgb[b->axis]]++] = q->used[i];
+    }
+    memcpy(q->used + b->lo, q->tmp, (size_t)(b->hi - b->lo) * sizeof(uint16_t));
+
+    uint64_t acc = 0;
+    int cut = b->lo + 1;
+    for (int i = b->lo; i < b->hi - 1; i++) {
+        acc += q->count[q->used[i]];
+        cut = i + 1;
+        if (acc * 2 >= total) break;
+    }
+    return cut;
+}
+
+static inline int fd_quant_nearest(const uint8_t (*pal)[3], int pal_n, const int rgb[3]) {
+    int best_k = 0;
+    int best_d = 0x7fffffff;
+    for (int k = 0; k < pal_n; k++) {
+        int dr = rgb[0] - pal[k][0];
+        int dg = rgb[1] - pal[k][1];
+        int db = rgb[2] - pal[k][2];
+        int d = dr * dr + dg * dg + db * db;
+        if (d < best_d) { best_d = d; best_k = k; }
+    }
+    return best_k;
+}
+
+// Median-cut palette (<= colors entries), optional k-means passes, then the inverse colormap.
+static FD_UNUSED int fd_quant_build_palette(fd_quant_t *q, int colors, int kmeans_iters) {
+    if (colors < 1) colors = 1;
+    if (colors > FD_QUANT_MAX_COLORS) colors = FD_QUANT_MAX_COLORS;
+    q->pal_n = 0;
+    if (q->used_n == 0) return 0;
+
+    for (int i = 0; i < q->used_n; i++) {
+        uint32_t idx = q->used[i];
+        uint32_t c = q->count[idx];
+        const uint64_t *s = q->sum + (size_t)idx * 3;
+        uint8_t *m = q->mean + (size_t)idx * 3;
+        m[0] = (uint8_t)(s[0] / c);
+        m[1] = (uint8_t)(s[1] / c);
+        m[2] = (uint8_t)(s[2] / c);
+    }
+
+    fd_quant_box_t boxes[FD_QUANT_MAX_COLORS];
+    int nb = 1;
+    boxes[0].lo = 0;
+    boxes[0].hi = q->used_n;
+    fd_quant_box_eval(q, &boxes[0]);
+
+    while (nb < colors) {
+        int pick = -1;
+        double best = 0;
+        for (int i = 0; i < nb; i++) {
+            if (boxes[i].score > best) { best = boxes[i].score; pick = i; }
+        }
+        if (pick < 0) break;
+        fd_quant_box_t *b = &boxes[pick];
+        int cut = fd_quant_box_split(q, b);
+        boxes[nb].lo = cut;
+        boxes[nb].hi = b->hi;
+        b->hi = cut;
+        fd_quant_box_eval(q, b);
+        fd_quant_box_eval(q, &boxes[nb]);
+        nb++;
+    }
+
+    for (int i = 0; i < nb; i++) {
+        uint64_t n = 0, s[3] = {0, 0, 0};
+        for (int j = boxes[i].lo; j < boxes[i].hi; j++) {
+            uint32_t idx = q->used[j];
+            n += q->count[idx];
+            s[0] += q->sum[idx * 3 + 0];
+            s[1] += q->sum[idx * 3 + 1];
+            s[2] += q->sum[idx * 3 + 2];
+        }
+        if (n == 0) n = 1;
+        q->pal[i][0] = (uint8_t)((s[0] + n / 2) / n);
+        q->pal[i][1] = (uint8_t)((s[1] + n / 2) / n);
+        q->pal[i][2] = (uint8_t)((s[2] + n / 2) / n);
+    }
+    q->pal_n = nb;
+
+    // k-means on buckets (weighted by pixel count): cheap since it runs on unique colors only.
+    for (int it = 0; it < kmeans_iters; it++) {
+        uint64_t n[FD_QUANT_MAX_COLORS];
+        uint64_t s[FD_QUANT_MAX_COLORS][3];
+        memset(n, 0, sizeof(uint64_t) * (size_t)nb);
+        memset(s, 0, sizeof(s[0]) * (size_t)nb);
+        for (int j = 0; j < q->used_n; j++) {
+            uint32_t idx = q->used[j];
+            int rgb[3];
+            fd_quant_bucket_rgb(q, idx, rgb);
+            int k = fd_quant_nearest((const uint8_t (*)[3])q->pal, nb, rgb);
+            n[k] += q->count[idx];
+            s[k][0] += q->sum[idx * 3 + 0];
+            s[k][1] += q->sum[idx * 3 + 1];
+            s[k][2] += q->sum[idx * 3 + 2];
+        }
+        int moved = 0;
+        for (int k = 0; k < nb; k++) {
+            if (n[k] == 0) continue; // keep orphan entries where they are
+            for (int c = 0; c < 3; c++) {
+                uint8_t v = (uint8_t)((s[k][c] + n[k] / 2) / n[k]);
+                if (v != q->pal[k][c]) { q->pal[k][c] = v; moved = 1; }
+            }
+        }
+        if (!moved) break;
+    }
+
+    for (int j = 0; j < q->used_n; j++) {
+        uint32_t idx = q->used[j];
+        int rgb[3];
+        fd_quant_bucket_rgb(q, idx, rgb);
+        q->lut[idx] = (uint16_t)fd_quant_nearest((const uint8_t (*)[3])q->pal, nb, rgb);
+    }
+    return nb;
+}
+
+// Remap RGB through the inverse colormap. The image must be the one the histogram was built from.
+static FD_UNUSED void fd_quant_map(const fd_quant_t *q, uint8_t *img, int w, int h) {
+    if (q->pal_n == 0) return;
+    size_t pixels = (size_t)w * (size_t)h;
+    size_t i = 0;
+#if FD_QUANT_SIMD
+    uint32_t idx4[4];
+    for (; i + 4 <= pixels; i += 4) {
+        uint8_t *p = img + i * 4;
+        fd_quant_idx4(p, idx4);
+        for (int k = 0; k < 4; k++) {
+            const uint8_t *c = q->pal[q->lut[idx4[k]]];
+            p[k * 4 + 0] = c[0];
+            p[k * 4 + 1] = c[1];
+            p[k * 4 + 2] = c[2];
+        }
+    }
+#endif
+    for (; i < pixels; i++) {
+        uint8_t *p = img + i * 4;
+        const uint8_t *c = q->pal[q->lut[fd_quant_idx(p)]];
+        p[0] = c[0];
+        p[1] = c[1];
+        p[2] = c[2];
+    }
+}
+
+static FD_UNUSED int fd_quant_rgba(fd_quant_t *q, uint8_t *img, int w, int h, int colors, int kmeans_iters) {
+    fd_quant_histogram(q, img, w, h);
+    int n = fd_quant_build_palette(q, colors, kmeans_iters);
+    fd_quant_map(q, img, w, h);
+    return n;
+}
+
+// PSNR (dB) over RGB between two RGBA images of the same size.
+static FD_UNUSED double fd_quant_psnr(const uint8_t *a, const uint8_t *b, int w, int h) {
+    size_t pixels = (size_t)w * (size_t)h;
+    double se = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        for (int c = 0; c < 3; c++) {
+            double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+            se += d * d;
+        }
+    }
+    if (pixels == 0 || se == 0) return 99.0;
+    double mse = se / ((double)pixels * 3.0);
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+#endif
@@ -0,0 +1,216 @@
+// Span rasterizer for anti-aliased rounded rectangles (icon borders/backgrounds), shared by the
+// draw_border tools and in-process renderers.
+//
+// - For each row the covered interval is computed analytically: edge pixels [l0, l1), fully covered
+//   pixels [l1, r0), edge pixels [r0, r1). Straight sides are pixel-aligned (integer rectangle),
+//   so only rows crossing a corner have edge pixels.
+// - Edge pixels get their coverage from the signed distance of the pixel center to the shape
+//   (coverage = 0.5 - distance, clamped): one pixel wide anti-aliasing on the arcs.
+// - Full spans are written as 32-bit row fills (vectorized by the compiler), without per-pixel
+//   tests or divisions; edge pixels are blended in straight (non-premultiplied) RGBA.
+//
+// Usage:
+//   fd_rrect_t rr = fd_rrect_centered(img_w, img_h, rect_w, rect_h, radius_px);
+//   fd_raster_fill_rrect(rgba, img_w, img_h, img_w * 4, &rr, r, g, b);   // or fd_raster_clear_rrect()
+//   fd_raster_mask_rrect(mask, img_w, img_h, &rr);                        // 0..255 coverage bitmap
+//   fd_raster_over_image(bottom_rgba, top_rgba, w * h);                   // whole-image compositing (draw_over)
+
+#ifndef FD_RASTER_H
+#define FD_RASTER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+typedef struct {
+    int x, y, w, h;   // rectangle in image pixels (may extend past the image)
+    float r;          // corner radius in pixels, <= min(w, h) / 2
+} fd_rrect_t;
+
+typedef struct {
+    int l0, l1, r0, r1;   // edge [l0, l1), full [l1, r0), edge [r0, r1); unclipped
+} fd_rrect_span_t;
+
+// w x h rectangle centered in an img_w x img_h image (same rounding as the draw_border tools).
+static FD_UNUSED fd_rrect_t fd_rrect_centered(int img_w, int img_h, int w, int h, int radius) {
+    fd_rrect_t rr;
+    rr.x = (img_w - w) / 2;
+    rr.y = (img_h - h) / 2;
+    rr.w = w;
+    rr.h = h;
+    float max_r = (float)(w < h ? w : h) / 2.0f;
+    rr.r = radius < 0 ? 0.0f : ((float)radius > max_r ? max_r : (float)radius);
+    return rr;
+}
+
+// Coverage (0..255) of pixel (px, py) from the signed distance of its center.
+static inline uint8_t fd_rrect_coverage(const fd_rrect_t *rr, int px, int py) {
+    float hx = (float)rr->w * 0.5f, hy = (float)rr->h * 0.5f;
+    float qx = fabsf((float)px + 0.5f - ((float)rr->x + hx)) - (hx - rr->r);
+    float qy = fabsf((float)py + 0.5f - ((float)rr->y + hy)) - (hy - rr->r);
+    float ox = qx > 0 ? qx : 0, oy = qy > 0 ? qy : 0;
+    float in = qx > qy ? qx : qy;
+    float d = sqrtf(ox * ox + oy * oy) + (in < 0 ? in : 0) - rr->r;
+    float c = 0.5f - d;
+    if (c <= 0) return 0;
+    if (c >= 1) return 255;
+    return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+// Span of row py; 0 when the row is outside the rectangle.
+static inline int fd_rrect_span(const fd_rrect_t *rr, int py, fd_rrect_span_t *s) {
+    if (rr->w <= 0 || rr->h <= 0 || py < rr->y || py >= rr->y + rr->h) return 0;
+    float hy = (float)rr->h * 0.5f;
+    float qy = fabsf((float)py + 0.5f - ((float)rr->y + hy)) - (hy - rr->r);
+    if (qy <= 0) {   // between the corners: straight sides, whole row covered
+        s->l0 = s->l1 = rr->x;
+        s->r0 = s->r1 = rr->x + rr->w;
+        return 1;
+    }
+    float ri = rr->r - 0.5f, ro = rr->r + 0.5f;
+    float ext_in = ri > 0 && ri * ri > qy * qy ? sqrtf(ri * ri - qy * qy) : 0.0f;
+    float ext_out = sqrtf(ro * ro - qy * qy);
+    float cx = (float)rr->x + rr->r;   // left corner centers
+    int l0 = (int)floorf(cx - ext_out - 0.5f) + 1;
+    if (l0 < rr->x) l0 = rr->x;
+    int l1 = (int)ceilf(cx - ext_in - 0.5f);
+    if (ri <= 0 || ri * ri < qy * qy) l1 = rr->x + rr->w;   // no fully covered pixel on this row
+    if (l1 < l0) l1 = l0;
+    int mirror = 2 * rr->x + rr->w;   // px <-> mirror - 1 - px
+    int r0 = mirror - l1, r1 = mirror - l0;
+    if (l1 > r0) l1 = r0 = rr->x + rr->w / 2;   // corners meet: two edge runs only
+    s->l0 = l0;
+    s->l1 = l1;
+    s->r0 = r0;
+    s->r1 = r1;
+    return 1;
+}
+
+static inline void fd_raster_fill_u32(uint8_t *row, int n, uint32_t px) {
+    uint32_t *p = (uint32_t *)(void *)row;
+    for (int i = 0; i < n; i++) p[i] = px;
+}
+
+// Straight-alpha "over" of an opaque color at coverage cov.
+static inline void fd_raster_over(uint8_t *px, uint8_t r, uint8_t g, uint8_t b, unsigned cov) {
+    if (cov == 0) return;
+    if (cov >= 255 || px[3] == 0) {
+        px[0] = r;
+        px[1] = g;
+        px[2] = b;
+        px[3] = cov >= 255 ? 255 : (uint8_t)cov;
+        return;
+    }
+    unsigned da = (px[3] * (255u - cov) + 127u) / 255u;   // destination weight
+    unsigned oa = cov + da;
+    px[0] = (uint8_t)((r * cov + px[0] * da + oa / 2) / oa);
+    px[1] = (uint8_t)((g * cov + px[1] * da + oa / 2) / oa);
+    px[2] = (uint8_t)((b * cov + px[2] * da + oa / 2) / oa);
+    px[3] = (uint8_t)oa;
+}
+
+static inline void fd_raster_clip(int *a, int *b, int img_w) {
+    if (*a < 0) *a = 0;
+    if (*b > img_w) *b = img_w;
+}
+
+// Paint an opaque color over the image inside rr (anti-aliased corners).
+static FD_UNUSED void fd_raster_fill_rrect(uint8_t *rgba, int img_w, int img_h, size_t stride, const fd_rrect_t *rr,
+                                           uint8_t r, uint8_t g, uint8_t b) {
+    const uint8_t c[4] = { r, g, b, 255 };
+    uint32_t px;
+    memcpy(&px, c, 4);
+    fd_rrect_span_t s;
+    int y1 = rr->y + rr->h < img_h ? rr->y + rr->h : img_h;
+    for (int y = rr->y < 0 ? 0 : rr->y; y < y1; y++) {
+        if (!fd_rrect_span(rr, y, &s)) continue;
+        uint8_t *row = rgba + (size_t)y * stride;
+        int a = s.l1, e = s.r0;
+        fd_raster_clip(&a, &e, img_w);
+        if (e > a) fd_raster_fill_u32(row + (size_t)a * 4, e - a, px);
+        for (int side = 0; side < 2; side++) {
+            int x0 = side ? s.r0 : s.l0, x1 = side ? s.r1 : s.l1;
+            fd_raster_clip(&x0, &x1, img_w);
+            for (int x = x0; x < x1; x++) fd_raster_over(row + (size_t)x * 4, r, g, b, fd_rrect_coverage(rr, x, y));
+        }
+    }
+}
+
+// Erase the image inside rr to transparent (edge pixels keep 1 - coverage of their alpha).
+static FD_UNUSED void fd_raster_clear_rrect(uint8_t *rgba, int img_w, int img_h, size_t stride, const fd_rrect_t *rr) {
+    fd_rrect_span_t s;
+    int y1 = rr->y + rr->h < img_h ? rr->y + rr->h : img_h;
+    for (int y = rr->y < 0 ? 0 : rr->y; y < y1; y++) {
+        if (!fd_rrect_span(rr, y, &s)) continue;
+        uint8_t *row = rgba + (size_t)y * stride;
+        int a = s.l1, e = s.r0;
+        fd_raster_clip(&a, &e, img_w);
+        if (e > a) memset(row + (size_t)a * 4, 0, (size_t)(e - a) * 4);
+        for (int side = 0; side < 2; side++) {
+            int x0 = side ? s.r0 : s.l0, x1 = side ? s.r1 : s.l1;
+            fd_raster_clip(&x0, &x1, img_w);
+            for (int x = x0; x < x1; x++) {
+                uint8_t *p = row + (size_t)x * 4;
+                unsigned keep = 255u - fd_rrect_coverage(rr, x, y);
+                p[3] = (uint8_t)((p[3] * keep + 127u) / 255u);
+                if (p[3] == 0) p[0] = p[1] = p[2] = 0;
+            }
+        }
+    }
+}
+
+// Coverage bitmap of rr (img_w bytes per row, 0 outside, 255 fully inside).
+static FD_UNUSED void fd_raster_mask_rrect(uint8_t *mask, int img_w, int img_h, const fd_rrect_t *rr) {
+    memset(mask, 0, (size_t)img_w * (size_t)img_h);
+    fd_rrect_span_t s;
+    int y1 = rr->y + rr->h < img_h ? rr->y + rr->h : img_h;
+    for (int y = rr->y < 0 ? 0 : rr->y; y < y1; y++) {
+        if (!fd_rrect_span(rr, y, &s)) continue;
+        uint8_t *row = mask + (size_t)y * (size_t)img_w;
+        int a = s.l1, e = s.r0;
+        fd_raster_clip(&a, &e, img_w);
+        if (e > a) memset(row + a, 255, (size_t)(e - a));
+        for (int side = 0; side < 2; side++) {
+            int x0 = side ? s.r0 : s.l0, x1 = side ? s.r1 : s.l1;
+            fd_raster_clip(&x0, &x1, img_w);
+            for (int x = x0; x < x1; x++) row[x] = fd_rrect_coverage(rr, x, y);
+        }
+    }
+}
+
+// Straight-alpha "over" of a whole top image onto bottom (same size, tightly packed RGBA).
+static FD_UNUSED void fd_raster_over_image(uint8_t *bottom, const uint8_t *top, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        uint8_t *b = bottom + i * 4;
+        const uint8_t *t = top + i * 4;
+        uint32_t ta = t[3];
+        if (ta == 0) continue;
+        uint32_t ba = b[3];
+        if (ba == 0 && ta == 255) {
+            b[0] = t[0];
+            b[1] = t[1];
+            b[2] = t[2];
+            b[3] = 255;
+            continue;
+        }
+        uint32_t out_a = ta + (ba * (255 - ta) + 127) / 255;
+        uint32_t bt = (ba * (255 - ta) + 127) / 255;
+        b[0] = (uint8_t)((t[0] * ta + b[0] * bt + out_a / 2) / out_a);
+        b[1] = (uint8_t)((t[1] * ta + b[1] * bt + out_a / 2) / out_a);
+        b[2] = (uint8_t)((t[2] * ta + b[2] * bt + out_a / 2) / out_a);
+        b[3] = (uint8_t)out_a;
+    }
+}
+
+#endif
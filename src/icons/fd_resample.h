@@ -0,0 +1,412 @@
+// Shared RGBA resampler: separable convolution with precomputed fixed-point coefficient tables.
+//
+// - Filters: box (area average), triangle (tent), Lanczos-3. On downscale the kernel is widened by
+//   the scale factor, so every source pixel contributes (no aliasing on 4K -> 196 px).
+// - Pixels are converted to 12-bit premultiplied values (int16), weights are Q14.
+//   Optional gamma-correct mode filters in linear light (sRGB LUTs).
+// - SSE2 / NEON kernels for both passes, scalar fallback otherwise.
+//
+// Usage:
+//   fd_resampler_t rs;
+//   fd_resampler_init(&rs);
+//   fd_resample_rgba(&rs, src, sw, sh, sw * 4, dst, dw, dh, dw * 4, FD_FILTER_TRIANGLE, 0);
+//   fd_resampler_free(&rs);
+// A resampler keeps its coefficient tables and scratch rows: reuse it for same-size jobs.
+// One resampler per thread.
+
+#ifndef FD_RESAMPLE_H
+#define FD_RESAMPLE_H
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FD_RS_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FD_RS_NEON 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+enum {
+    FD_FILTER_BOX = 0,
+    FD_FILTER_TRIANGLE = 1,
+    FD_FILTER_LANCZOS3 = 2
+};
+
+// Flags
+#define FD_RS_GAMMA 1   // filter in linear light (sRGB in/out)
+
+#define FD_RS_ONE 16384 // Q14
+
+typedef struct {
+    int src_n, dst_n, filter;
+    int taps;           // taps per output (even, zero padded)
+    int32_t *start;     // first source index per output
+    int16_t *w;         // dst_n * taps weights (Q14, each row sums to FD_RS_ONE)
+    size_t cap;         // allocated outputs
+    size_t wcap;        // allocated weights
+} fd_rs_axis_t;
+
+typedef struct {
+    fd_rs_axis_t hx, vy;
+    int16_t *row;       // one converted source row (+ padding for SIMD over-reads)
+    size_t row_cap;
+    int16_t *tmp;       // horizontal pass output, dw*4 per needed source row
+    size_t tmp_cap;
+    int16_t *out;       // one vertical pass output row
+    size_t out_cap;
+} fd_resampler_t;
+
+static uint16_t fd_rs_to12_lin[256];
+static uint16_t fd_rs_to12_srgb[256];
+static uint8_t fd_rs_to8_lin[4096];
+static uint8_t fd_rs_to8_srgb[4096];
+static uint32_t fd_rs_recip[4096];
+static pthread_once_t fd_rs_tables_once = PTHREAD_ONCE_INIT;
+
+static void fd_rs_fill_tables(void) {
+    for (int i = 0; i < 256; i++) {
+        double v = i / 255.0;
+        double lin = v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+        fd_rs_to12_lin[i] = (uint16_t)((i * 4095 + 127) / 255);
+        fd_rs_to12_srgb[i] = (uint16_t)(lin * 4095.0 + 0.5);
+    }
+    for (int i = 0; i < 4096; i++) {
+        double v = i / 4095.0;
+        double s = v <= 0.0031308 ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+        fd_rs_to8_lin[i] = (uint8_t)((i * 255 + 2047) / 4095);
+        fd_rs_to8_srgb[i] = (uint8_t)(s * 255.0 + 0.5);
+        fd_rs_recip[i] = i ? (uint32_t)((4095u << 16) / (uint32_t)i) : 0;
+    }
+}
+
+// Thread-safe: workers may reach it concurrently through fd_resample_rgba_alloc.
+static FD_UNUSED void fd_rs_init_tables(void) {
+    pthread_once(&fd_rs_tables_once, fd_rs_fill_tables);
+}
+
+static FD_UNUSED void fd_resampler_init(fd_resampler_t *rs) {
+    memset(rs, 0, sizeof(*rs));
+    fd_rs_init_tables();
+}
+
+static FD_UNUSED void fd_resampler_free(fd_resampler_t *rs) {
+    if (!rs) return;
+    free(rs->hx.start);
+    free(rs->hx.w);
+    free(rs->vy.start);
+    free(rs->vy.w);
+    free(rs->row);
+    free(rs->tmp);
+    free(rs->out);
+    memset(rs, 0, sizeof(*rs));
+}
+
+static double fd_rs_sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= 3.14159265358979323846;
+    return sin(x) / x;
+}
+
+static double fd_rs_kernel(int filter, double x) {
+    if (x < 0) x = -x;
+    switch (filter) {
+        case FD_FILTER_BOX: return x <= 0.5 ? 1.0 : 0.0;
+        case FD_FILTER_LANCZOS3: return x < 3.0 ? fd_rs_sinc(x) * fd_rs_sinc(x / 3.0) : 0.0;
+        default: return x < 1.0 ? 1.0 - x : 0.0;
+    }
+}
+
+static double fd_rs_support(int filter) {
+    switch (filter) {
+        case FD_FILTER_BOX: return 0.5;
+        case FD_FILTER_LANCZOS3: return 3.0;
+        default: return 1.0;
+    }
+}
+
+// Build (or reuse) the coefficient table for one axis. Out-of-range taps are folded onto the edges.
+static int fd_rs_axis_build(fd_rs_axis_t *a, int src_n, int dst_n, int filter) {
+    if (a->w && a->src_n == src_n && a->dst_n == dst_n && a->filter == filter) return 0;
+    double scale = (double)src_n / (double)dst_n;
+    double fscale = scale > 1.0 ? scale : 1.0;
+    double support = fd_rs_support(filter) * fscale;
+    int taps = (int)ceil(support * 2.0) + 2;
+    if (taps > src_n) taps = src_n;
+    taps = (taps + 1) & ~1;
+
+    if ((size_t)dst_n > a->cap) {
+        int32_t *s = realloc(a->start, sizeof(int32_t) * (size_t)dst_n);
+        if (!s) return -1;
+        a->start = s;
+        a->cap = (size_t)dst_n;
+    }
+    size_t need_w = (size_t)dst_n * (size_t)taps;
+    if (need_w > a->wcap) {
+        int16_t *w = realloc(a->w, sizeof(int16_t) * need_w);
+        if (!w) return -1;
+        a->w = w;
+        a->wcap = need_w;
+    }
+    memset(a->w, 0, sizeof(int16_t) * need_w);
+
+    double *tmp = malloc(sizeof(double) * (size_t)taps);
+    if (!tmp) return -1;
+    for (int i = 0; i < dst_n; i++) {
+        double center = (i + 0.5) * scale;
+        int lo = (int)floor(center - support);
+        int hi = (int)ceil(center + support);
+        int first = lo < 0 ? 0 : lo;
+        int last = hi > src_n - 1 ? src_n - 1 : hi;
+        if (last - first + 1 > taps) {
+            // Keep the window centered when the kernel is wider than the table (tiny sources).
+            first = (int)floor(center) - taps / 2;
+            if (first < 0) first = 0;
+            if (first > src_n - taps) first = src_n - taps;
+            last = first + taps - 1;
+            if (last > src_n - 1) last = src_n - 1;
+        }
+        if (first > src_n - taps) first = src_n - taps; // padded taps stay inside the row
+        if (first < 0) first = 0;
+        for (int t = 0; t < taps; t++) tmp[t] = 0.0;
+        double total = 0.0;
+        for (int j = lo; j <= hi; j++) {
+            double wv = fd_rs_kernel(filter, (j + 0.5 - center) / fscale);
+            if (wv == 0.0) continue;
+            int jj = j < first ? first : (j > last ? last : j);
+            tmp[jj - first] += wv;
+            total += wv;
+        }
+        if (total == 0.0) {
+            int jj = (int)center;
+            if (jj < first) jj = first;
+            if (jj > first + taps - 1) jj = first + taps - 1;
+            tmp[jj - first] = 1.0;
+            total = 1.0;
+        }
+        int16_t *wr = a->w + (size_t)i * (size_t)taps;
+        int sum = 0, big = 0;
+        for (int t = 0; t < taps; t++) {
+            wr[t] = (int16_t)lrint(tmp[t] / total * FD_RS_ONE);
+            sum += wr[t];
+            if (wr[t] > wr[big]) big = t;
+        }
+        wr[big] = (int16_t)(wr[big] + (FD_RS_ONE - sum)); // exact unit gain
+        a->start[i] = first;
+    }
+    free(tmp);
+    a->src_n = src_n;
+    a->dst_n = dst_n;
+    a->filter = filter;
+    a->taps = taps;
+    return 0;
+}
+
+static int fd_rs_reserve16(int16_t **p, size_t *cap, size_t n) {
+    if (n <= *cap) return 0;
+    int16_t *q = realloc(*p, sizeof(int16_t) * n);
+    if (!q) return -1;
+    *p = q;
+    *cap = n;
+    return 0;
+}
+
+// 8-bit RGBA row -> 12-bit premultiplied int16 row.
+static void fd_rs_load_row(int16_t *out, const uint8_t *src, int n, const uint16_t *to12) {
+    for (int x = 0; x < n; x++) {
+        const uint8_t *p = src + (size_t)x * 4;
+        uint32_t a = p[3];
+        int16_t *o = out + (size_t)x * 4;
+        if (a == 255) {
+            o[0] = (int16_t)to12[p[0]];
+            o[1] = (int16_t)to12[p[1]];
+            o[2] = (int16_t)to12[p[2]];
+            o[3] = 4095;
+        } else {
+            o[0] = (int16_t)((to12[p[0]] * a + 127) / 255);
+            o[1] = (int16_t)((to12[p[1]] * a + 127) / 255);
+            o[2] = (int16_t)((to12[p[2]] * a + 127) / 255);
+            o[3] = (int16_t)fd_rs_to12_lin[a];
+        }
+    }
+}
+
+// 12-bit premultiplied int16 row -> 8-bit RGBA row.
+static void fd_rs_store_row(uint8_t *dst, const int16_t *in, int n, const uint8_t *to8) {
+    for (int x = 0; x < n; x++) {
+        const int16_t *v = in + (size_t)x * 4;
+        int a = v[3] < 0 ? 0 : (v[3] > 4095 ? 4095 : v[3]);
+        uint8_t *d = dst + (size_t)x * 4;
+        if (a == 0) {
+            d[0] = d[1] = d[2] = d[3] = 0;
+            continue;
+        }
+        uint32_t r = fd_rs_recip[a];
+        for (int c = 0; c < 3; c++) {
+            int s = v[c] < 0 ? 0 : v[c];
+            uint32_t u = a == 4095 ? (uint32_t)s : (uint32_t)(((uint64_t)(uint32_t)s * r + 32768u) >> 16);
+            d[c] = to8[u > 4095u ? 4095u : u];
+        }
+        d[3] = fd_rs_to8_lin[a];
+    }
+}
+
+static void fd_rs_hpass(const fd_rs_axis_t *a, const int16_t *row, int16_t *out) {
+    const int taps = a->taps;
+    for (int i = 0; i < a->dst_n; i++) {
+        const int16_t *p = row + (size_t)a->start[i] * 4;
+        const int16_t *w = a->w + (size_t)i * (size_t)taps;
+#if defined(FD_RS_SSE2)
+        __m128i acc = _mm_set1_epi32(FD_RS_ONE / 2);
+        for (int t = 0; t < taps; t += 2) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + t * 4));
+            __m128i px = _mm_unpacklo_epi16(v, _mm_srli_si128(v, 8));
+            __m128i wp = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[t + 1] << 16) | (uint16_t)w[t]));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, wp));
+        }
+        acc = _mm_srai_epi32(acc, 14);
+        _mm_storel_epi64((__m128i *)(void *)(out + (size_t)i * 4), _mm_packs_epi32(acc, acc));
+#elif defined(FD_RS_NEON)
+        int32x4_t acc = vdupq_n_s32(FD_RS_ONE / 2);
+        for (int t = 0; t < taps; t++) {
+            acc = vmlal_n_s16(acc, vld1_s16(p + t * 4), w[t]);
+        }
+        vst1_s16(out + (size_t)i * 4, vqshrn_n_s32(acc, 14));
+#else
+        int32_t acc[4] = {FD_RS_ONE / 2, FD_RS_ONE / 2, FD_RS_ONE / 2, FD_RS_ONE / 2};
+        for (int t = 0; t < taps; t++) {
+            const int16_t *q = p + t * 4;
+            acc[0] += (int32_t)w[t] * q[0];
+            acc[1] += (int32_t)w[t] * q[1];
+            acc[2] += (int32_t)w[t] * q[2];
+            acc[3] += (int32_t)w[t] * q[3];
+        }
+        for (int c = 0; c < 4; c++) {
+            int32_t v = acc[c] >> 14;
+            out[(size_t)i * 4 + c] = (int16_t)(v < -32768 ? -32768 : (v > 32767 ? 32767 : v));
+        }
+#endif
+    }
+}
+
+// out[x] = sum_t w[t] * rows[t][x] over n int16 values.
+static void fd_rs_vpass(const int16_t *const *rows, const int16_t *w, int taps, int16_t *out, int n) {
+    int x = 0;
+#if defined(FD_RS_SSE2)
+    for (; x + 8 <= n; x += 8) {
+        __m128i lo = _mm_set1_epi32(FD_RS_ONE / 2);
+        __m128i hi = lo;
+        for (int t = 0; t < taps; t += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(rows[t] + x));
+            __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(rows[t + 1] + x));
+            __m128i wp = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[t + 1] << 16) | (uint16_t)w[t]));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wp));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wp));
+        }
+        lo = _mm_srai_epi32(lo, 14);
+        hi = _mm_srai_epi32(hi, 14);
+        _mm_storeu_si128((__m128i *)(void *)(out + x), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(FD_RS_NEON)
+    for (; x + 4 <= n; x += 4) {
+        int32x4_t acc = vdupq_n_s32(FD_RS_ONE / 2);
+        for (int t = 0; t < taps; t++) {
+            acc = vmlal_n_s16(acc, vld1_s16(rows[t] + x), w[t]);
+        }
+        vst1_s16(out + x, vqshrn_n_s32(acc, 14));
+    }
+#endif
+    for (; x < n; x++) {
+        int32_t acc = FD_RS_ONE / 2;
+        for (int t = 0; t < taps; t++) acc += (int32_t)w[t] * rows[t][x];
+        acc >>= 14;
+        out[x] = (int16_t)(acc < -32768 ? -32768 : (acc > 32767 ? 32767 : acc));
+    }
+}
+
+// Resample src (sw x sh, stride in bytes) into dst (dw x dh, stride in bytes). Returns 0 or -1 (OOM).
+static FD_UNUSED int fd_resample_rgba(fd_resampler_t *rs,
+                                      const uint8_t *src, int sw, int sh, size_t sstride,
+                                      uint8_t *dst, int dw, int dh, size_t dstride,
+                                      int filter, int flags) {
+    if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0) return -1;
+    if (sw == dw && sh == dh) {
+        for (int y = 0; y < dh; y++) memcpy(dst + (size_t)y * dstride, src + (size_t)y * sstride, (size_t)dw * 4);
+        return 0;
+    }
+    fd_rs_init_tables();
+    const uint16_t *to12 = (flags & FD_RS_GAMMA) ? fd_rs_to12_srgb : fd_rs_to12_lin;
+    const uint8_t *to8 = (flags & FD_RS_GAMMA) ? fd_rs_to8_srgb : fd_rs_to8_lin;
+
+    if (fd_rs_axis_build(&rs->hx, sw, dw, filter) != 0) return -1;
+    if (fd_rs_axis_build(&rs->vy, sh, dh, filter) != 0) return -1;
+    const int vt = rs->vy.taps;
+
+    // Source rows actually referenced by the vertical table.
+    int y_lo = rs->vy.start[0];
+    int y_hi = rs->vy.start[dh - 1] + vt;
+    if (y_hi > sh) y_hi = sh;
+    size_t trow = (size_t)dw * 4;
+    if (fd_rs_reserve16(&rs->row, &rs->row_cap, ((size_t)sw + 8) * 4) != 0) return -1;
+    if (fd_rs_reserve16(&rs->tmp, &rs->tmp_cap, trow * (size_t)(y_hi - y_lo)) != 0) return -1;
+    if (fd_rs_reserve16(&rs->out, &rs->out_cap, trow) != 0) return -1;
+    memset(rs->row + (size_t)sw * 4, 0, sizeof(int16_t) * 8 * 4);
+
+    for (int y = y_lo; y < y_hi; y++) {
+        fd_rs_load_row(rs->row, src + (size_t)y * sstride, sw, to12);
+        fd_rs_hpass(&rs->hx, rs->row, rs->tmp + (size_t)(y - y_lo) * trow);
+    }
+
+    const int16_t *rows[512];
+    if (vt > (int)(sizeof(rows) / sizeof(rows[0]))) return -1;
+    for (int y = 0; y < dh; y++) {
+        int s = rs->vy.start[y];
+        for (int t = 0; t < vt; t++) {
+            int yy = s + t;
+            if (yy >= y_hi) yy = y_hi - 1; // zero-weight padding tap
+            rows[t] = rs->tmp + (size_t)(yy - y_lo) * trow;
+        }
+        fd_rs_vpass(rows, rs->vy.w + (size_t)y * (size_t)vt, vt, rs->out, dw * 4);
+        fd_rs_store_row(dst + (size_t)y * dstride, rs->out, dw, to8);
+    }
+    return 0;
+}
+
+// One-shot helper for tools that resize a single image: returns a malloc'd dw*dh*4 buffer.
+static FD_UNUSED uint8_t *fd_resample_rgba_alloc(const uint8_t *src, int sw, int sh, int dw, int dh, int filter, int flags) {
+    uint8_t *dst = malloc((size_t)dw * (size_t)dh * 4);
+    if (!dst) return NULL;
+    fd_resampler_t rs;
+    fd_resampler_init(&rs);
+    int rc = fd_resample_rgba(&rs, src, sw, sh, (size_t)sw * 4, dst, dw, dh, (size_t)dw * 4, filter, flags);
+    fd_resampler_free(&rs);
+    if (rc != 0) {
+        free(dst);
+        return NULL;
+    }
+    return dst;
+}
+
+static FD_UNUSED int fd_filter_from_name(const char *name) {
+    if (!name) return -1;
+    if (strcmp(name, "box") == 0) return FD_FILTER_BOX;
+    if (strcmp(name, "triangle") == 0 || strcmp(name, "bilinear") == 0) return FD_FILTER_TRIANGLE;
+    if (strcmp(name, "lanczos") == 0 || strcmp(name, "lanczos3") == 0) return FD_FILTER_LANCZOS3;
+    return -1;
+}
+
+#endif
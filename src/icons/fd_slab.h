@@ -0,0 +1,258 @@
+// Shared-memory icon slab between paging_daemon (writer) and ulanzi_d200_daemon (reader).
+//
+// One memfd (anonymous shared memory, unlinked POSIX shm where memfd_create is missing) split into
+// fixed-size slots. The writer encodes/copies an icon into a free slot and names it on the command
+// line as slab:<id>:<slot>:<gen>:<len>:<name> instead of a file path; the reader, which received
+// the fd once over the unix socket (SCM_RIGHTS, "slab-attach"), builds the ZIP entry straight from
+// its read-only mapping: no file open/read on either side, no copy through the socket.
+//
+// Layout (native endianness, both processes run on the same host):
+//   header  "FDSLAB1\0" u32 id u32 slots u32 slot_size u32 data_off,
+//           then per slot: u32 gen u32 len
+//   data    slot i at data_off + i * slot_size (data_off is page aligned)
+//
+// Generations: gen is odd while the writer fills the slot and even once committed, so a reference
+// carries the (gen, len) it was published with and a stale or torn slot is detected by the reader.
+// The writer must not refill a slot until the command naming it has been answered.
+
+#ifndef FD_SLAB_H
+#define FD_SLAB_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_SLAB_MAGIC "FDSLAB1"
+#define FD_SLAB_HDR 24
+#define FD_SLAB_SLOTS 32
+#define FD_SLAB_SLOT_SIZE (256u * 1024u)   // a composed 442x196 tile fits; pages are only touched when used
+#define FD_SLAB_PAGE 4096u
+#define FD_SLAB_REF_PREFIX "slab:"
+
+#if defined(__linux__) && defined(__GLIBC__) && !defined(MFD_CLOEXEC)
+// Declared by <sys/mman.h> under _GNU_SOURCE only; the symbol is always exported (glibc >= 2.27).
+int memfd_create(const char *name, unsigned int flags);
+#define MFD_CLOEXEC 1u
+#endif
+
+typedef struct {
+    uint8_t *map;
+    size_t map_len;
+    int fd;              // writer: the shared fd (passed to the reader); reader: -1 once mapped
+    uint32_t id, slots, slot_size, data_off;
+    int writable;
+} fd_slab_t;
+
+static FD_UNUSED void fd_slab_init(fd_slab_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+}
+
+static FD_UNUSED void fd_slab_free(fd_slab_t *s) {
+    if (s->map) munmap(s->map, s->map_len);
+    if (s->fd >= 0) close(s->fd);
+    fd_slab_init(s);
+}
+
+static inline atomic_uint *fd_slab_gen_ptr(const fd_slab_t *s, uint32_t slot) {
+    return (atomic_uint *)(void *)(s->map + FD_SLAB_HDR + (size_t)slot * 8);
+}
+
+static inline uint32_t *fd_slab_len_ptr(const fd_slab_t *s, uint32_t slot) {
+    return (uint32_t *)(void *)(s->map + FD_SLAB_HDR + (size_t)slot * 8 + 4);
+}
+
+static inline uint8_t *fd_slab_data(const fd_slab_t *s, uint32_t slot) {
+    return s->map + s->data_off + (size_t)slot * s->slot_size;
+}
+
+static FD_UNUSED int fd_slab_open_shared(void) {
+#ifdef MFD_CLOEXEC
+    return memfd_create("goofydeck-slab", MFD_CLOEXEC);
+#else
+    // No memfd: a POSIX shm object unlinked right away is just as anonymous.
+    char name[64];
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    snprintf(name, sizeof(name), "/goofydeck-slab-%d-%ld", (int)getpid(), (long)ts.tv_nsec);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+    return fd;
+#endif
+}
+
+// Writer: create and map a slab of `slots` x `slot_size` bytes. Returns 0 or -1.
+static FD_UNUSED int fd_slab_create(fd_slab_t *s, uint32_t slots, uint32_t slot_size) {
+    fd_slab_init(s);
+    if (slots == 0 || slot_size == 0) return -1;
+    uint32_t data_off = (FD_SLAB_HDR + slots * 8u + FD_SLAB_PAGE - 1) / FD_SLAB_PAGE * FD_SLAB_PAGE;
+    size_t len = (size_t)data_off + (size_t)slots * slot_size;
+    int fd = fd_slab_open_shared();
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)len) != 0) { close(fd); return -1; }
+    void *m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) { close(fd); return -1; }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s->map = (uint8_t *)m;
+    s->map_len = len;
+    s->fd = fd;
+    s->id = ((uint32_t)getpid() * 2654435761u) ^ (uint32_t)ts.tv_nsec ^ (uint32_t)ts.tv_sec;
+    s->slots = slots;
+    s->slot_size = slot_size;
+    s->data_off = data_off;
+    s->writable = 1;
+    uint32_t hdr[4] = { s->id, slots, slot_size, data_off };
+    memcpy(s->map, FD_SLAB_MAGIC, 8);
+    memcpy(s->map + 8, hdr, sizeof(hdr));   // the slot table is already zero (gen 0 = empty)
+    return 0;
+}
+
+// Reader: map the slab behind `fd` read-only and validate its header. fd is closed in all cases.
+static FD_UNUSED int fd_slab_attach(fd_slab_t *s, int fd) {
+    fd_slab_init(s);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)FD_SLAB_PAGE) { close(fd); return -1; }
+    size_t len = (size_t)st.st_size;
+    void *m = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    uint32_t hdr[4];
+    memcpy(hdr, (const uint8_t *)m + 8, sizeof(hdr));
+    uint64_t need = (uint64_t)hdr[3] + (uint64_t)hdr[1] * hdr[2];
+    if (memcmp(m, FD_SLAB_MAGIC, 8) != 0 || hdr[1] == 0 || hdr[2] == 0 ||
+        hdr[3] < FD_SLAB_HDR + (uint64_t)hdr[1] * 8 || need > len) {
+        munmap(m, len);
+        return -1;
+    }
+    s->map = (uint8_t *)m;
+    s->map_len = len;
+    s->id = hdr[0];
+    s->slots = hdr[1];
+    s->slot_size = hdr[2];
+    s->data_off = hdr[3];
+    return 0;
+}
+
+// Writer: open a slot for filling (marks it busy) and return its buffer (slot_size bytes).
+static FD_UNUSED uint8_t *fd_slab_begin(fd_slab_t *s, uint32_t slot) {
+    if (!s->writable || slot >= s->slots) return NULL;
+    atomic_uint *g = fd_slab_gen_ptr(s, slot);
+    uint32_t gen = atomic_load_explicit(g, memory_order_relaxed);
+    if (!(gen & 1u)) atomic_store_explicit(g, gen + 1u, memory_order_relaxed);   // already odd: never committed
+    atomic_thread_fence(memory_order_release);
+    return fd_slab_data(s, slot);
+}
+
+// Writer: publish `len` bytes written since fd_slab_begin. Returns the generation to reference
+// (0 when len does not fit: the slot stays empty).
+static FD_UNUSED uint32_t fd_slab_commit(fd_slab_t *s, uint32_t slot, uint32_t len) {
+    if (!s->writable || slot >= s->slots) return 0;
+    if (len > s->slot_size) len = 0;
+    *fd_slab_len_ptr(s, slot) = len;
+    uint32_t gen = atomic_fetch_add_explicit(fd_slab_gen_ptr(s, slot), 1u, memory_order_release) + 1u;
+    return len ? gen : 0;
+}
+
+// Reader: bytes of slot `slot` if it still holds what the reference (id, gen, len) named, else NULL.
+static FD_UNUSED const uint8_t *fd_slab_get(const fd_slab_t *s, uint32_t id, uint32_t slot, uint32_t gen,
+                                            uint32_t len) {
+    if (!s->map || id != s->id || slot >= s->slots || gen == 0 || (gen & 1u) || len == 0 || len > s->slot_size)
+        return NULL;
+    if (atomic_load_explicit(fd_slab_gen_ptr(s, slot), memory_order_acquire) != gen) return NULL;
+    if (*fd_slab_len_ptr(s, slot) != len) return NULL;
+    return fd_slab_data(s, slot);
+}
+
+// Reader: parse slab:<id>:<slot>:<gen>:<len>:<name>. Returns the bytes (NULL if malformed or stale)
+// and points *name at the entry name inside ref.
+static FD_UNUSED const uint8_t *fd_slab_resolve(const fd_slab_t *s, const char *ref, uint32_t *len_out,
+                                                const char **name) {
+    if (strncmp(ref, FD_SLAB_REF_PREFIX, 5) != 0) return NULL;
+    unsigned long v[4];
+    const char *p = ref + 5;
+    for (int i = 0; i < 4; i++) {
+        char *end = NULL;
+        v[i] = strtoul(p, &end, i == 0 ? 16 : 10);
+        if (end == p || *end != ':' || v[i] > 0xFFFFFFFFul) return NULL;
+        p = end + 1;
+    }
+    if (!*p || strchr(p, '/')) return NULL;
+    const uint8_t *data = fd_slab_get(s, (uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2], (uint32_t)v[3]);
+    if (!data) return NULL;
+    *len_out = (uint32_t)v[3];
+    *name = p;
+    return data;
+}
+
+// Send one command line together with a file descriptor (SCM_RIGHTS).
+static FD_UNUSED int fd_slab_send_fd(int sock, const char *line, size_t len, int fd) {
+    union { struct cmsghdr h; char buf[CMSG_SPACE(sizeof(int))]; } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    struct iovec iov = { .iov_base = (void *)line, .iov_len = len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    ssize_t n;
+    do n = sendmsg(sock, &msg, 0); while (n < 0 && errno == EINTR);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+// read() replacement for a command line that may carry one file descriptor: *fd_out gets it (or -1).
+// Extra descriptors are closed.
+static FD_UNUSED ssize_t fd_slab_recv_line(int sock, char *buf, size_t cap, int *fd_out) {
+    union { struct cmsghdr h; char buf[CMSG_SPACE(4 * sizeof(int))]; } ctl;
+    struct iovec iov = { .iov_base = buf, .iov_len = cap };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    *fd_out = -1;
+    ssize_t n;
+    do n = recvmsg(sock, &msg, 0); while (n < 0 && errno == EINTR);
+    if (n < 0) return n;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        size_t nfd = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < nfd; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+            if (*fd_out < 0) *fd_out = fd;
+            else close(fd);
+        }
+    }
+    return n;
+}
+
+#endif
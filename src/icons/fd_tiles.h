@@ -0,0 +1,305 @@
+// 14-tile page renderer shared by send_image_page and send_video_page_wrapper.
+//
+// Page geometry: 5x3 grid where the last row holds buttons 11-13 and the wide button 14
+// (columns 4-5 plus the gap). Reference: a 1280x720 image gives 196x196 tiles with a 50 px gap.
+//
+// fd_tiles_t is a persistent thread pool: each tile is resampled straight from the source image
+// into its slice of an arena (fd_resample.h), optionally ordered-dithered (fd_dither.h) and
+// quantized (fd_quant.h), then PNG-encoded into a reused buffer (fd_png.h). Arenas, filter tables,
+// quantizers and encoders are allocated once and reused from one frame to the next.
+//
+// Usage:
+//   fd_tiles_t t;
+//   fd_tiles_init(&t, fd_tiles_online_cpus());
+//   fd_page_crop_16_9(w, h, &cx, &cy, &cw, &ch);
+//   fd_page_layout(cw, ch, 100, 100, &L);
+//   fd_tiles_layout(&t, &L);
+//   fd_tiles_run(&t, img + cy * stride + cx * 4, cw, ch, stride, &params);
+//   ... t.tiles[i].png / t.tiles[i].png_len ...
+//   fd_tiles_destroy(&t);
+
+#ifndef FD_TILES_H
+#define FD_TILES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "fd_quant.h"
+#include "fd_resample.h"
+#include "fd_dither.h"
+#include "fd_png.h"
+
+#define FD_TILES_COUNT 14
+#define FD_TILES_MAX_THREADS 8
+
+typedef struct {
+    int btn, gap, final_btn;
+    int x[5], y[3];
+} fd_page_layout_t;
+
+// Tile size follows the source resolution (196 px at 1280 wide), then magnify/quality percentages.
+static FD_UNUSED void fd_page_layout(int sw, int sh, int magnify_percent, int quality_percent, fd_page_layout_t *L) {
+    double scale_factor = (double)sw / 1280.0;
+    int base_icon_size = (int)(196 * scale_factor);
+    int base_gap = (int)(50 * scale_factor);
+
+    L->btn = (base_icon_size * magnify_percent) / 100;
+    L->gap = (base_gap * magnify_percent) / 100;
+    if (L->btn < 8) L->btn = 8;
+    if (L->gap < 1) L->gap = 1;
+
+    L->final_btn = (L->btn * quality_percent) / 100;
+    if (L->final_btn < 4) L->final_btn = 4;
+
+    int margin_x = (sw - (L->btn * 5 + L->gap * 4)) / 2;
+    int margin_y = (sh - (L->btn * 3 + L->gap * 2)) / 2;
+    for (int c = 0; c < 5; c++) L->x[c] = margin_x + c * (L->btn + L->gap);
+    for (int r = 0; r < 3; r++) L->y[r] = margin_y + r * (L->btn + L->gap);
+}
+
+// Centered 16:9 rectangle (crop only, no resize).
+static FD_UNUSED void fd_page_crop_16_9(int sw, int sh, int *cx, int *cy, int *cw, int *ch) {
+    double aspect = (double)sw / sh;
+    double target_aspect = 16.0 / 9.0;
+    *cx = 0; *cy = 0; *cw = sw; *ch = sh;
+    if (fabs(aspect - target_aspect) < 0.01) return;
+    if (aspect > target_aspect) {
+        *cw = (int)(sh * target_aspect);
+        *cx = (sw - *cw) / 2;
+    } else {
+        *ch = (int)(sw / target_aspect);
+        *cy = (sh - *ch) / 2;
+    }
+}
+
+typedef struct {
+    int quantize;         // median-cut per tile (0: keep resampled colors)
+    int colors;
+    int kmeans_iters;
+    int filter;           // FD_FILTER_*
+    int rs_flags;         // FD_RS_GAMMA
+    int dither;           // FD_DITHER_BAYER / FD_DITHER_BLUENOISE are applied per tile; others ignored
+    int png_effort;       // FD_PNG_FAST / FD_PNG_SMALL
+} fd_tiles_params_t;
+
+static FD_UNUSED void fd_tiles_params_default(fd_tiles_params_t *p) {
+    memset(p, 0, sizeof(*p));
+    p->quantize = 1;
+    p->colors = 8;
+    p->filter = FD_FILTER_TRIANGLE;
+    p->png_effort = FD_PNG_FAST;
+}
+
+typedef struct {
+    int sx, sy, sw, sh;   // source rectangle
+    int dw, dh;           // final size
+    uint8_t *out;         // RGBA slice of the arena (dw*dh*4)
+    uint8_t *png;         // encoded PNG (slice of png_arena, png_cap bytes)
+    size_t png_cap;
+    size_t png_len;
+    int png_status;       // 0 = ok, -1 = encode failed
+} fd_tile_t;
+
+typedef struct fd_tiles fd_tiles_t;
+
+typedef struct {
+    fd_tiles_t *eng;
+    fd_quant_t quant;
+    fd_resampler_t rs;    // coefficient tables reused (13 identical square tiles)
+    fd_png_enc_t png;
+} fd_tiles_worker_t;
+
+struct fd_tiles {
+    uint8_t *arena;
+    size_t arena_cap;
+    uint8_t *png_arena;
+    size_t png_arena_cap;
+    fd_tile_t tiles[FD_TILES_COUNT];
+    int job_count;
+
+    // Current frame
+    const uint8_t *src;
+    int src_w, src_h;
+    size_t src_stride;    // bytes
+    fd_tiles_params_t params;
+    fd_dither_t dither;   // ordered dithering (m == NULL: off)
+    int dither_kind;
+
+    pthread_t threads[FD_TILES_MAX_THREADS];
+    fd_tiles_worker_t workers[FD_TILES_MAX_THREADS];
+    int thread_count;
+    int next_job;
+    int done_jobs;
+    int shutdown;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+// Source rectangle clamped to the image (magnify > 100% can overflow it).
+static inline void fd_tiles_clip(const fd_tiles_t *e, const fd_tile_t *j, int *sx, int *sy, int *sw, int *sh) {
+    *sw = j->sw < e->src_w ? j->sw : e->src_w;
+    *sh = j->sh < e->src_h ? j->sh : e->src_h;
+    *sx = j->sx < 0 ? 0 : (j->sx > e->src_w - *sw ? e->src_w - *sw : j->sx);
+    *sy = j->sy < 0 ? 0 : (j->sy > e->src_h - *sh ? e->src_h - *sh : j->sy);
+}
+
+// Resample into the arena, quantize the final-size pixels (no off-palette colors reintroduced
+// by the resize), then encode.
+static void fd_tiles_render(fd_tiles_worker_t *wk, const fd_tiles_t *e, fd_tile_t *j) {
+    const fd_tiles_params_t *p = &e->params;
+    int sx, sy, sw, sh;
+    fd_tiles_clip(e, j, &sx, &sy, &sw, &sh);
+    const uint8_t *base = e->src + (size_t)sy * e->src_stride + (size_t)sx * 4;
+    if (fd_resample_rgba(&wk->rs, base, sw, sh, e->src_stride, j->out, j->dw, j->dh, (size_t)j->dw * 4,
+                         p->filter, p->rs_flags) != 0) {
+        memset(j->out, 0, (size_t)j->dw * (size_t)j->dh * 4);
+        j->png_status = -1;
+        return;
+    }
+    // Fixed thresholds per tile position: same source pixel => same output from frame to frame
+    if (e->dither.m) fd_dither_ordered_rgba(&e->dither, j->out, j->dw, j->dh, (size_t)j->dw * 4, 0, 0);
+    if (p->quantize) fd_quant_rgba(&wk->quant, j->out, j->dw, j->dh, p->colors, p->kmeans_iters);
+    j->png_status = fd_png_encode_rgba(&wk->png, j->out, j->dw, j->dh, (size_t)j->dw * 4, p->png_effort,
+                                       j->png, j->png_cap, &j->png_len);
+}
+
+static void *fd_tiles_worker(void *arg) {
+    fd_tiles_worker_t *wk = (fd_tiles_worker_t *)arg;
+    fd_tiles_t *e = wk->eng;
+    pthread_mutex_lock(&e->mutex);
+    for (;;) {
+        while (!e->shutdown && e->next_job >= e->job_count) {
+            pthread_cond_wait(&e->work_cond, &e->mutex);
+        }
+        if (e->shutdown) break;
+        int id = e->next_job++;
+        pthread_mutex_unlock(&e->mutex);
+
+        fd_tiles_render(wk, e, &e->tiles[id]);
+
+        pthread_mutex_lock(&e->mutex);
+        if (++e->done_jobs == e->job_count) pthread_cond_signal(&e->done_cond);
+    }
+    pthread_mutex_unlock(&e->mutex);
+    return NULL;
+}
+
+static FD_UNUSED void fd_tiles_destroy(fd_tiles_t *e) {
+    pthread_mutex_lock(&e->mutex);
+    e->shutdown = 1;
+    pthread_cond_broadcast(&e->work_cond);
+    pthread_mutex_unlock(&e->mutex);
+    for (int i = 0; i < e->thread_count; i++) pthread_join(e->threads[i], NULL);
+    for (int i = 0; i < FD_TILES_MAX_THREADS; i++) {
+        fd_quant_free(&e->workers[i].quant);
+        fd_resampler_free(&e->workers[i].rs);
+        fd_png_enc_free(&e->workers[i].png);
+    }
+    pthread_cond_destroy(&e->done_cond);
+    pthread_cond_destroy(&e->work_cond);
+    pthread_mutex_destroy(&e->mutex);
+    free(e->arena);
+    free(e->png_arena);
+    memset(e, 0, sizeof(*e));
+}
+
+static FD_UNUSED int fd_tiles_init(fd_tiles_t *e, int thread_count) {
+    memset(e, 0, sizeof(*e));
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > FD_TILES_MAX_THREADS) thread_count = FD_TILES_MAX_THREADS;
+    if (pthread_mutex_init(&e->mutex, NULL) != 0) return -1;
+    pthread_cond_init(&e->work_cond, NULL);
+    pthread_cond_init(&e->done_cond, NULL);
+    for (int i = 0; i < thread_count; i++) {
+        e->workers[i].eng = e;
+        fd_resampler_init(&e->workers[i].rs);
+        fd_png_enc_init(&e->workers[i].png);
+        if (fd_quant_init(&e->workers[i].quant) != 0 ||
+            pthread_create(&e->threads[i], NULL, fd_tiles_worker, &e->workers[i]) != 0) {
+            fd_tiles_destroy(e);
+            return -1;
+        }
+        e->thread_count = i + 1;
+    }
+    return 0;
+}
+
+// Place the 14 tiles and size the arenas. Only reallocates when the page grows, so the
+// memory footprint stays fixed from one frame to the next.
+static FD_UNUSED int fd_tiles_layout(fd_tiles_t *e, const fd_page_layout_t *L) {
+    size_t need = 0, png_need = 0;
+    for (int i = 0; i < FD_TILES_COUNT; i++) {
+        fd_tile_t *j = &e->tiles[i];
+        int r2 = (i < 10) ? i / 5 : 2;
+        int c = (i < 10) ? i % 5 : (i - 10);
+        j->sx = (i < 13) ? L->x[c] : L->x[3];
+        j->sy = L->y[r2];
+        j->sw = (i < 13) ? L->btn : L->btn + L->gap + L->btn;
+        j->sh = L->btn;
+        j->dw = (i < 13) ? L->final_btn : L->final_btn + L->gap + L->final_btn;
+        j->dh = L->final_btn;
+        need += (size_t)j->dw * (size_t)j->dh * 4;
+        j->png_cap = fd_png_bound(j->dw, j->dh);
+        png_need += j->png_cap;
+    }
+    if (need > e->arena_cap) {
+        uint8_t *a = realloc(e->arena, need);
+        if (!a) return -1;
+        e->arena = a;
+        e->arena_cap = need;
+    }
+    if (png_need > e->png_arena_cap) {
+        uint8_t *a = realloc(e->png_arena, png_need);
+        if (!a) return -1;
+        e->png_arena = a;
+        e->png_arena_cap = png_need;
+    }
+    size_t off = 0, png_off = 0;
+    for (int i = 0; i < FD_TILES_COUNT; i++) {
+        e->tiles[i].out = e->arena + off;
+        off += (size_t)e->tiles[i].dw * (size_t)e->tiles[i].dh * 4;
+        e->tiles[i].png = e->png_arena + png_off;
+        png_off += e->tiles[i].png_cap;
+    }
+    return 0;
+}
+
+// Render the 14 tiles of src (blocking).
+static FD_UNUSED void fd_tiles_run(fd_tiles_t *e, const uint8_t *src, int src_w, int src_h, size_t src_stride,
+                                   const fd_tiles_params_t *params) {
+    pthread_mutex_lock(&e->mutex);
+    e->src = src;
+    e->src_w = src_w;
+    e->src_h = src_h;
+    e->src_stride = src_stride;
+    e->params = *params;
+    int kind = (params->dither == FD_DITHER_BAYER || params->dither == FD_DITHER_BLUENOISE) ? params->dither : 0;
+    if (kind != e->dither_kind) {
+        e->dither_kind = kind;
+        if (!kind || fd_dither_init(&e->dither, kind, 6) != 0) memset(&e->dither, 0, sizeof(e->dither));
+    }
+    e->done_jobs = 0;
+    e->next_job = 0;
+    e->job_count = FD_TILES_COUNT;
+    pthread_cond_broadcast(&e->work_cond);
+    while (e->done_jobs < e->job_count) {
+        pthread_cond_wait(&e->done_cond, &e->mutex);
+    }
+    e->job_count = 0;
+    e->next_job = 0;
+    pthread_mutex_unlock(&e->mutex);
+}
+
+static FD_UNUSED int fd_tiles_online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > FD_TILES_MAX_THREADS) n = FD_TILES_MAX_THREADS;
+    return (int)n;
+}
+
+#endif
@@ -0,0 +1,371 @@
+// Wu's color quantizer (X. Wu, "Efficient Statistical Computations for Optimal Color
+// Quantization", Graphics Gems II) in RGBA, for icons with alpha.
+//
+// - Wu's greedy splitting: the box with the largest variance is cut next, on the axis and position
+//   maximising the between-class variance; palette entries are the exact pixel means of the boxes.
+// - Icons hold tens to a few thousand distinct colors, so the moments are taken over the sparse
+//   exact-color histogram (hash of RGBA colors, per-box bins along each axis) instead of Wu's dense
+//   moment tables: full 8-bit cut positions, no multi-megabyte tables to clear and cumulate.
+// - Alpha is the fourth axis. Fully transparent pixels count as (0,0,0,0) whatever their RGB.
+// - A few Lloyd passes over the histogram (weighted by pixel count) then move entries to the mean of
+//   the colors nearest to them (skipped when colors x entries is large, e.g. photos).
+// - fd_wu_map() assigns each pixel the nearest entry by RGBA distance (memoised per color) and
+//   reports the largest group of same-colored pixels left far from every entry, so a palette
+//   computed for another image (palette cache) can be checked while it is applied.
+//
+// Usage:
+//   fd_wu_t q;
+//   fd_wu_init(&q);
+//   if (fd_wu_histogram(&q, rgba, w, h, w * 4) != 0) ...;
+//   int n = fd_wu_build_palette(&q, colors, 2);
+//   fd_wu_map((const uint8_t (*)[4])q.pal, n, rgba, w, h, w * 4, idx, 0);
+//   fd_wu_free(&q);
+
+#ifndef FD_WU_H
+#define FD_WU_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#ifndef FD_UNUSED
+#define FD_UNUSED __attribute__((unused))
+#endif
+#else
+#ifndef FD_UNUSED
+#define FD_UNUSED
+#endif
+#endif
+
+#define FD_WU_MAX_COLORS 256
+#define FD_WU_REFINE_BUDGET (4u << 20)   // Lloyd passes only when colors * entries stays below
+#define FD_WU_MEMO 4096                  // fd_wu_map color memo (direct mapped, 12-bit hash)
+
+typedef struct {
+    uint32_t *hkey;      // open addressing: RGBA key
+    int32_t *hval;       // -1 = empty, else index in rgba/count
+    uint32_t hcap;
+    uint8_t (*rgba)[4];  // distinct colors
+    uint32_t *count;     // pixels per color
+    uint32_t *order;     // color indices, grouped per box
+    uint32_t n, cap;
+    uint8_t pal[FD_WU_MAX_COLORS][4];
+    int pal_n;
+} fd_wu_t;
+
+typedef struct {
+    uint32_t start, end;   // range in q->order
+    uint8_t lo[4], hi[4];  // color bounds per axis (R, G, B, A)
+    uint64_t wt, sum[4];
+    double var;            // sum of squared distances to the mean
+} fd_wu_box_t;
+
+static FD_UNUSED void fd_wu_init(fd_wu_t *q) {
+    memset(q, 0, sizeof(*q));
+}
+
+static FD_UNUSED void fd_wu_free(fd_wu_t *q) {
+    if (!q) return;
+    free(q->hkey);
+    free(q->hval);
+    free(q->rgba);
+    free(q->count);
+    free(q->order);
+    memset(q, 0, sizeof(*q));
+}
+
+static inline uint32_t fd_wu_hash(uint32_t key, uint32_t mask) {
+    return ((key * 2654435761u) >> 12) & mask;
+}
+
+static int fd_wu_rehash(fd_wu_t *q, uint32_t hcap) {
+    uint32_t *hkey = malloc(hcap * sizeof(uint32_t));
+    int32_t *hval = malloc(hcap * sizeof(int32_t));
+    if (!hkey || !hval) {
+        free(hkey);
+        free(hval);
+        return -1;
+    }
+    memset(hval, 0xFF, hcap * sizeof(int32_t));
+    for (uint32_t i = 0; i < q->hcap; i++) {
+        if (q->hval[i] < 0) continue;
+        uint32_t s = fd_wu_hash(q->hkey[i], hcap - 1);
+        while (hval[s] >= 0) s = (s + 1) & (hcap - 1);
+        hkey[s] = q->hkey[i];
+        hval[s] = q->hval[i];
+    }
+    free(q->hkey);
+    free(q->hval);
+    q->hkey = hkey;
+    q->hval = hval;
+    q->hcap = hcap;
+    return 0;
+}
+
+static int fd_wu_grow(fd_wu_t *q) {
+    uint32_t cap = q->cap ? q->cap * 2 : 1024;
+    void *a = realloc(q->rgba, (size_t)cap * 4);
+    if (!a) return -1;
+    q->rgba = a;
+    void *b = realloc(q->count, (size_t)cap * sizeof(uint32_t));
+    if (!b) return -1;
+    q->count = b;
+    q->cap = cap;
+    return 0;
+}
+
+// Distinct-color histogram of an RGBA image. 0 on success, -1 on allocation failure.
+static FD_UNUSED int fd_wu_histogram(fd_wu_t *q, const uint8_t *rgba, int w, int h, size_t stride) {
+    q->n = 0;
+    q->pal_n = 0;
+    if (q->hcap == 0 && fd_wu_rehash(q, 4096) != 0) return -1;
+    memset(q->hval, 0xFF, q->hcap * sizeof(int32_t));
+    uint32_t last = 0;
+    int32_t last_i = -1;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *p = rgba + (size_t)y * stride;
+        for (int x = 0; x < w; x++, p += 4) {
+            uint32_t key = 0;
+            if (p[3]) key = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+            if (key == last && last_i >= 0) {
+                q->count[last_i]++;
+                continue;
+            }
+            uint32_t s = fd_wu_hash(key, q->hcap - 1);
+            while (q->hval[s] >= 0 && q->hkey[s] != key) s = (s + 1) & (q->hcap - 1);
+            int32_t i = q->hval[s];
+            if (i < 0) {
+                if (q->n == q->cap && fd_wu_grow(q) != 0) return -1;
+                i = (int32_t)q->n++;
+                q->hkey[s] = key;
+                q->hval[s] = i;
+                q->rgba[i][0] = (uint8_t)key;
+                q->rgba[i][1] = (uint8_t)(key >> 8);
+                q->rgba[i][2] = (uint8_t)(key >> 16);
+                q->rgba[i][3] = (uint8_t)(key >> 24);
+                q->count[i] = 0;
+                if (q->n * 2 > q->hcap && fd_wu_rehash(q, q->hcap * 2) != 0) return -1;
+            }
+            last = key;
+            last_i = i;
+            q->count[i]++;
+        }
+    }
+    return 0;
+}
+
+// Moments, bounds and variance of the colors order[start, end).
+static void fd_wu_box_stats(const fd_wu_t *q, fd_wu_box_t *b) {
+    uint64_t sq = 0;
+    b->wt = 0;
+    for (int c = 0; c < 4; c++) {
+        b->sum[c] = 0;
+        b->lo[c] = 255;
+        b->hi[c] = 0;
+    }
+    for (uint32_t i = b->start; i < b->end; i++) {
+        const uint8_t *px = q->rgba[q->order[i]];
+        uint64_t n = q->count[q->order[i]];
+        b->wt += n;
+        for (int c = 0; c < 4; c++) {
+            b->sum[c] += n * px[c];
+            sq += n * (uint64_t)(px[c] * px[c]);
+            if (px[c] < b->lo[c]) b->lo[c] = px[c];
+            if (px[c] > b->hi[c]) b->hi[c] = px[c];
+        }
+    }
+    double d = 0;
+    for (int c = 0; c < 4; c++) d += (double)b->sum[c] * (double)b->sum[c];
+    b->var = (b->end - b->start > 1 && b->wt) ? (double)sq - d / (double)b->wt : 0;
+}
+
+// Cut b1 in two (b2 gets the colors above the cut) where sum(|sum|^2 / n) of the halves is largest.
+static int fd_wu_cut(fd_wu_t *q, fd_wu_box_t *b1, fd_wu_box_t *b2) {
+    uint64_t bw[256], bs[256][4];
+    double best = -1;
+    int best_axis = -1, best_pos = 0;
+    for (int axis = 0; axis < 4; axis++) {
+        int lo = b1->lo[axis], hi = b1->hi[axis];
+        if (lo == hi) continue;
+        memset(bw + lo, 0, (size_t)(hi - lo + 1) * sizeof(bw[0]));
+        memset(bs + lo, 0, (size_t)(hi - lo + 1) * sizeof(bs[0]));
+        for (uint32_t i = b1->start; i < b1->end; i++) {
+            const uint8_t *px = q->rgba[q->order[i]];
+            uint64_t n = q->count[q->order[i]];
+            int v = px[axis];
+            bw[v] += n;
+            for (int c = 0; c < 4; c++) bs[v][c] += n * px[c];
+        }
+        uint64_t lw = 0, ls[4] = { 0, 0, 0, 0 };
+        for (int v = lo; v < hi; v++) {
+            lw += bw[v];
+            for (int c = 0; c < 4; c++) ls[c] += bs[v][c];
+            if (lw == 0 || lw == b1->wt) continue;
+            double l = 0, r = 0;
+            for (int c = 0; c < 4; c++) {
+                double rs = (double)(b1->sum[c] - ls[c]);
+                l += (double)ls[c] * (double)ls[c];
+                r += rs * rs;
+            }
+            double score = l / (double)lw + r / (double)(b1->wt - lw);
+            if (score > best) {
+                best = score;
+                best_axis = axis;
+                best_pos = v;
+            }
+        }
+    }
+    if (best_axis < 0) return -1;
+
+    uint32_t i = b1->start, j = b1->end;
+    while (i < j) {
+        if (q->rgba[q->order[i]][best_axis] <= best_pos) {
+            i++;
+        } else {
+            uint32_t t = q->order[i];
+            q->order[i] = q->order[--j];
+            q->order[j] = t;
+        }
+    }
+    b2->start = i;
+    b2->end = b1->end;
+    b1->end = i;
+    fd_wu_box_stats(q, b1);
+    fd_wu_box_stats(q, b2);
+    return 0;
+}
+
+static inline int fd_wu_nearest(const uint8_t (*pal)[4], int pal_n, int r, int g, int b, int a, int *dist) {
+    int best = 0, best_d = 0x7fffffff;
+    for (int k = 0; k < pal_n; k++) {
+        int dr = r - pal[k][0], dg = g - pal[k][1], db = b - pal[k][2], da = a - pal[k][3];
+        int d = dr * dr + dg * dg + db * db + da * da;
+        if (d < best_d) {
+            best_d = d;
+            best = k;
+            if (d == 0) break;
+        }
+    }
+    if (dist) *dist = best_d;
+    return best;
+}
+
+// Palette of <= colors entries from the histogram (q->pal, returned count). Translucent
+// entries come first so the tRNS chunk stays short.
+static FD_UNUSED int fd_wu_build_palette(fd_wu_t *q, int colors, int refine_iters) {
+    if (colors < 1) colors = 1;
+    if (colors > FD_WU_MAX_COLORS) colors = FD_WU_MAX_COLORS;
+    q->pal_n = 0;
+    if (q->n == 0) return 0;
+    free(q->order);
+    q->order = malloc((size_t)q->n * sizeof(uint32_t));
+    if (!q->order) return 0;
+    for (uint32_t i = 0; i < q->n; i++) q->order[i] = i;
+
+    fd_wu_box_t box[FD_WU_MAX_COLORS];
+    box[0].start = 0;
+    box[0].end = q->n;
+    fd_wu_box_stats(q, &box[0]);
+    int n = 1;
+    while (n < colors) {
+        int next = 0;
+        for (int i = 1; i < n; i++) if (box[i].var > box[next].var) next = i;
+        if (box[next].var <= 0) break;
+        if (fd_wu_cut(q, &box[next], &box[n]) == 0) n++;
+        else box[next].var = 0;   // cannot be cut
+    }
+
+    int pn = 0;
+    for (int i = 0; i < n; i++) {
+        if (box[i].wt == 0) continue;
+        for (int c = 0; c < 4; c++) q->pal[pn][c] = (uint8_t)((box[i].sum[c] + box[i].wt / 2) / box[i].wt);
+        pn++;
+    }
+
+    // Lloyd passes on the distinct colors, weighted by their pixel count.
+    if ((uint64_t)q->n * (uint64_t)pn > FD_WU_REFINE_BUDGET) refine_iters = 0;
+    for (int it = 0; it < refine_iters; it++) {
+        uint64_t acc[FD_WU_MAX_COLORS][5];
+        memset(acc, 0, sizeof(acc[0]) * (size_t)pn);
+        for (uint32_t j = 0; j < q->n; j++) {
+            const uint8_t *px = q->rgba[j];
+            int k = fd_wu_nearest((const uint8_t (*)[4])q->pal, pn, px[0], px[1], px[2], px[3], NULL);
+            acc[k][4] += q->count[j];
+            for (int c = 0; c < 4; c++) acc[k][c] += (uint64_t)q->count[j] * px[c];
+        }
+        int moved = 0;
+        for (int k = 0; k < pn; k++) {
+            if (acc[k][4] == 0) continue;
+            for (int c = 0; c < 4; c++) {
+                uint8_t v = (uint8_t)((acc[k][c] + acc[k][4] / 2) / acc[k][4]);
+                if (v != q->pal[k][c]) {
+                    q->pal[k][c] = v;
+                    moved = 1;
+                }
+            }
+        }
+        if (!moved) break;
+    }
+
+    uint8_t sorted[FD_WU_MAX_COLORS][4];
+    int sn = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int k = 0; k < pn; k++) {
+            if ((q->pal[k][3] != 255) == (pass == 0)) memcpy(sorted[sn++], q->pal[k], 4);
+        }
+    }
+    memcpy(q->pal, sorted, (size_t)pn * 4);
+    q->pal_n = pn;
+    return pn;
+}
+
+// Nearest palette entry for every pixel (transparent pixels as (0,0,0,0)) into idx (w bytes per
+// row). Returns the pixel count of the most frequent color farther than far_limit (squared RGBA
+// distance; 0 disables the check): antialiased edges spread over many colors, a color the palette
+// misses (new background, other icon color) piles up on one.
+static FD_UNUSED size_t fd_wu_map(const uint8_t (*pal)[4], int pal_n, const uint8_t *rgba, int w, int h,
+                                  size_t stride, uint8_t *idx, int far_limit) {
+    uint32_t memo_key[FD_WU_MEMO];
+    uint16_t memo_val[FD_WU_MEMO];   // index | 0x8000 when farther than far_limit, 0xFFFF = empty
+    uint32_t memo_far[FD_WU_MEMO];   // pixels of a far color seen so far
+    memset(memo_val, 0xFF, sizeof(memo_val));
+    size_t worst = 0;
+    uint32_t last = 0, slot = 0;
+    uint16_t v = 0xFFFF;
+    for (int y = 0; y < h; y++) {
+        const uint8_t *p = rgba + (size_t)y * stride;
+        uint8_t *o = idx + (size_t)y * (size_t)w;
+        for (int x = 0; x < w; x++, p += 4) {
+            int r = p[0], g = p[1], b = p[2], a = p[3];
+            if (a == 0) r = g = b = 0;
+            uint32_t key = (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+            if (key == last && v != 0xFFFF) {   // runs of one color
+                if (v & 0x8000) {
+                    if (++memo_far[slot] > worst) worst = memo_far[slot];
+                }
+                o[x] = (uint8_t)(v & 0xFF);
+                continue;
+            }
+            last = key;
+            slot = (key * 2654435761u) >> (32 - 12);
+            v = memo_val[slot];
+            if (v == 0xFFFF || memo_key[slot] != key) {
+                int d = 0;
+                v = (uint16_t)fd_wu_nearest(pal, pal_n, r, g, b, a, &d);
+                if (far_limit > 0 && d > far_limit) v |= 0x8000;
+                memo_key[slot] = key;
+                memo_val[slot] = v;
+                memo_far[slot] = 0;
+            }
+            if (v & 0x8000) {
+                if (++memo_far[slot] > worst) worst = memo_far[slot];
+            }
+            o[x] = (uint8_t)(v & 0xFF);
+        }
+    }
+    return worst;
+}
+
+#endif
@@ -17,6 +17,8 @@
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <hidapi/hidapi.h>
 #include <zlib.h>
 #include <inttypes.h>
@@ -30,6 +32,10 @@
 #define FD_UNUSED
 #endif
 
+#include "src/icons/fd_d2v.h"
+#include "src/icons/fd_devzip.h"
+#include "src/icons/fd_slab.h"
+
 #define VID 0x2207
 #define PID 0x0019
 #define PACKET_SIZE 1024
@@ -378,22 +384,6 @@ static int send_command(hid_device *dev, uint16_t cmd, const uint8_t *data, size
     return write_packet(dev, packet, PACKET_SIZE);
 }
 
-static int has_invalid_bytes(const uint8_t *buf, size_t len) {
-    for (size_t i = 1016; i < len; i += 1024) {
-        if (buf[i] == 0x00 || buf[i] == 0x7c) return 1;
-    }
-    return 0;
-}
-
-static size_t patch_invalid_bytes(uint8_t *buf, size_t len) {
-    size_t patched_count = 0;
-    for (size_t i = 1016; i < len; i += 1024) {
-        if (buf[i] == 0x00 || buf[i] == 0x7c) { buf[i] = 0x11; patched_count++; }
-        // sleep(0);
-    }
-    return patched_count;
-}
-
 static uint16_t rd_le16(const uint8_t *p) {
     return (uint16_t)p[0] | (uint16_t)((uint16_t)p[1] << 8);
 }
@@ -413,7 +403,7 @@ static uint8_t *prepare_zip_buffer(const uint8_t *buf, size_t len, size_t *out_l
         if (!tmp) return NULL;
         memcpy(tmp, buf, len);
         if (pad > 0) memset(tmp + len, 0x00, pad);
-        if (!has_invalid_bytes(tmp, nlen)) {
+        if (!fd_devzip_bad_bytes(tmp, nlen)) {
             if (pad > 0 && g_debug) {
                 time_t t=time(NULL); struct tm *tm=localtime(&t); char ts[32]; strftime(ts,sizeof(ts),"%Y-%m-%d %H:%M:%S",tm);
                 // fprintf(stderr, "\r[%s] padding %d byte(s) resolved invalid bytes\033[K", ts, pad);
@@ -424,7 +414,7 @@ static uint8_t *prepare_zip_buffer(const uint8_t *buf, size_t len, size_t *out_l
             return tmp;
         }
         if (pad == MAX_PADDING_RETRIES) {
-            *patched_count = patch_invalid_bytes(tmp, nlen);
+            *patched_count = fd_devzip_patch(tmp, nlen);
             if (*patched_count > 0) *did_patch = 1;
             *pad_used = pad;
             *out_len = nlen;
@@ -788,12 +778,12 @@ static int send_zip(hid_device *dev, const char *path) {
             zipbuf = NULL;
             continue;
         }
-        if (!has_invalid_bytes(zipbuf, ziplen)) {
+        if (!fd_devzip_bad_bytes(zipbuf, ziplen)) {
             pad_used = pad;
             break;
         }
         if (pad == MAX_PADDING_RETRIES) {
-            patched_count = patch_invalid_bytes(zipbuf, ziplen);
+            patched_count = fd_devzip_patch(zipbuf, ziplen);
             pad_used = pad;
             break;
         }
@@ -821,10 +811,6 @@ static int send_zip(hid_device *dev, const char *path) {
     return res;
 }
 
-static int send_zip_buffer(hid_device *dev, const uint8_t *buf, size_t sz, int pad_used, size_t patched_count) {
-    return send_zip_buffer_cmd(dev, buf, sz, 0x0001, pad_used, patched_count);
-}
-
 // --- ZIP build from directory (icons + manifest) ---
 typedef struct {
     int btn_index; // 0-based button index
@@ -833,6 +819,8 @@ typedef struct {
     char *label;
     uint8_t *data;
     size_t data_len;
+    bool borrowed; // data points into the slab mapping: not freed
+    char *ref;     // borrowed: the slab reference, resolved again before sending
 } IconItem;
 
 static char *basename_dup(const char *path) {
@@ -841,6 +829,31 @@ static char *basename_dup(const char *path) {
     return strdup(base);
 }
 
+// Icon slab shared by paging_daemon (slab-attach, src/icons/fd_slab.h): one client at a time.
+static fd_slab_t g_slab;
+
+// --button-N value: a file path, or a slab reference (slab:<id>:<slot>:<gen>:<len>:<name>) whose
+// bytes are used in place. 0 = item filled, 1 = skip (no such file), -1 = stale/unknown slab reference.
+static int icon_item_source(IconItem *it, const char *value) {
+    if (strncmp(value, FD_SLAB_REF_PREFIX, 5) == 0) {
+        uint32_t len = 0;
+        const char *name = NULL;
+        const uint8_t *data = fd_slab_resolve(&g_slab, value, &len, &name);
+        if (!data) return -1;
+        it->data = (uint8_t *)data;
+        it->data_len = len;
+        it->borrowed = true;
+        it->ref = strdup(value);
+        it->name = strdup(name);
+        return 0;
+    }
+    struct stat st;
+    if (stat(value,&st)!=0 || !S_ISREG(st.st_mode)) return 1;
+    it->path = strdup(value);
+    it->name = basename_dup(value);
+    return 0;
+}
+
 static FD_UNUSED char *label_from_name(const char *name) {
     const char *dot = strrchr(name, '.');
     size_t len = dot ? (size_t)(dot - name) : strlen(name);
@@ -925,115 +938,51 @@ static int sb_append_json_string(StrBuf *sb, const char *s) {
     return r;
 }
 
-static int build_manifest(const IconItem *items, size_t count, StrBuf *out) {
-    sb_init(out);
-    sb_append(out, "{");
-    for (size_t i = 0; i < count; i++) {
-        int idx = items[i].btn_index;
-        int row = idx / 5;
-        int col = idx % 5;
-        if (i > 0) sb_append(out, ",");
-        sb_appendf(out, "\"%d_%d\":{\"State\":0,\"ViewParam\":[{\"Icon\":\"icons/%s\",\"Text\":", col, row, items[i].name);
-        sb_append_json_string(out, items[i].label ? items[i].label : "");
-        sb_append(out, "}]}");
-    }
-    sb_append(out, "}");
-    return 0;
-}
-
-static int build_zip_with_dummy(const IconItem *items, size_t count, size_t dummy_len, uint8_t **out_buf, size_t *out_len) {
-    if (count == 0) return -1;
-    ZipWriter zw;
-    zw_init(&zw);
-    if (dummy_len > 0) {
-        uint8_t *dummy = malloc(dummy_len);
-        if (!dummy) { zw_free(&zw); return -1; }
-        memset(dummy, 0x01, dummy_len); // avoid 0x00/0x7c
-        zw_add_entry(&zw, "dummy.txt", dummy, dummy_len);
-        free(dummy);
-    }
-    StrBuf manifest;
-    build_manifest(items, count, &manifest);
-    zw_add_entry(&zw, "manifest.json", (const uint8_t *)manifest.data, manifest.len);
+// Page ZIP (dummy.txt padding search, manifest, icons/<name>) built by fd_devzip_solve, the shared
+// builder kernel_bench measures. Items without bytes (unreadable path) are left out of the page.
+static int build_zip_from_icons(const IconItem *items, size_t count, uint8_t **out_buf, size_t *out_len, int *pad_used, size_t *patched_count) {
+    *pad_used = 0;
+    *patched_count = 0;
+    if (count == 0 || count > 14) return -1;
+    fd_devzip_icon_t icons[14];
+    uint8_t *alloc[14] = {0};
+    int n = 0;
     for (size_t i = 0; i < count; i++) {
-        const uint8_t *buf = NULL;
-        size_t sz = 0;
-        uint8_t *alloc = NULL;
-        if (items[i].data && items[i].data_len > 0) {
-            buf = items[i].data;
-            sz = items[i].data_len;
-        } else if (items[i].path) {
+        const uint8_t *buf = items[i].data;
+        size_t sz = items[i].data_len;
+        if ((!buf || sz == 0) && items[i].path) {
             FILE *f = fopen(items[i].path, "rb");
             if (!f) continue;
             fseek(f, 0, SEEK_END);
             long lsz = ftell(f);
             fseek(f, 0, SEEK_SET);
-            if (lsz <= 0) { fclose(f); continue; }
-            alloc = malloc((size_t)lsz);
-            if (!alloc) { fclose(f); continue; }
-            if (fread(alloc, 1, (size_t)lsz, f) != (size_t)lsz) { free(alloc); fclose(f); continue; }
+            if (lsz <= 0 || !(alloc[n] = malloc((size_t)lsz)) || fread(alloc[n], 1, (size_t)lsz, f) != (size_t)lsz) {
+                free(alloc[n]);
+                alloc[n] = NULL;
+                fclose(f);
+                continue;
+            }
             fclose(f);
-            buf = alloc;
+            buf = alloc[n];
             sz = (size_t)lsz;
-        } else {
-            continue;
         }
-        char icon_name[512];
-        snprintf(icon_name, sizeof(icon_name), "icons/%s", items[i].name);
-        zw_add_entry(&zw, icon_name, buf, sz);
-        if (alloc) free(alloc);
+        if (!buf || sz == 0) continue;
+        icons[n] = (fd_devzip_icon_t){ .btn = items[i].btn_index, .name = items[i].name, .label = items[i].label,
+                                       .data = buf, .len = sz };
+        n++;
     }
-    uint8_t *zipbuf = NULL;
-    size_t ziplen = 0;
-    zw_finalize(&zw, &zipbuf, &ziplen);
-    zw_free(&zw);
-    sb_free(&manifest);
-    *out_buf = zipbuf;
-    *out_len = ziplen;
-    return 0;
-}
-
-static int build_zip_from_rgba_icons(const IconItem *items, size_t count, uint8_t **out_buf, size_t *out_len, int *pad_used, size_t *patched_count);
-
-static int build_zip_from_icons(const IconItem *items, size_t count, uint8_t **out_buf, size_t *out_len, int *pad_used, size_t *patched_count) {
-    *pad_used = 0;
-    *patched_count = 0;
-    if (count == 0) return -1;
-    for (int pad = 0; pad <= MAX_PADDING_RETRIES; pad++) {
-        uint8_t *zipbuf = NULL; size_t ziplen = 0;
-        if (build_zip_with_dummy(items, count, (size_t)pad, &zipbuf, &ziplen) != 0 || !zipbuf) {
-            if (zipbuf) free(zipbuf);
-            continue;
-        }
-        if (!has_invalid_bytes(zipbuf, ziplen)) {
-            *out_buf = zipbuf;
-            *out_len = ziplen;
-            *pad_used = pad;
-            if (pad > 0 && g_debug) {
-                time_t t=time(NULL); struct tm *tm=localtime(&t); char ts[32]; strftime(ts,sizeof(ts),"%Y-%m-%d %H:%M:%S",tm);
-                // fprintf(stderr, "\r[%s] padding %d byte(s) resolved invalid bytes\033[K", ts, pad);
-                fflush(stderr);
-            }
-            return 0;
-        }
-        if (pad == MAX_PADDING_RETRIES) {
-            *patched_count = patch_invalid_bytes(zipbuf, ziplen);
-            *out_buf = zipbuf;
-            *out_len = ziplen;
-            *pad_used = pad;
-            return 0;
-        }
-        free(zipbuf);
+    fd_devzip_t z;
+    fd_devzip_init(&z);
+    int rc = -1;
+    if (n > 0 && fd_devzip_solve(&z, icons, n, MAX_PADDING_RETRIES, pad_used, patched_count) == 0) {
+        *out_buf = z.zip;   // ownership passes to the caller
+        *out_len = z.zip_len;
+        z.zip = NULL;
+        rc = 0;
     }
-    return -1;
-}
-
-static int send_partial_update(hid_device *dev, const IconItem *items, size_t count) {
-    uint8_t *zipbuf=NULL; size_t ziplen=0; int pad_used=0; size_t patched=0;
-    if (build_zip_from_icons(items, count, &zipbuf, &ziplen, &pad_used, &patched)!=0 || !zipbuf) return -1;
-    int res = send_zip_buffer_cmd(dev, zipbuf, ziplen, 0x000d, pad_used, patched);
-    free(zipbuf);
-    return res;
+    fd_devzip_free(&z);
+    for (int i = 0; i < n; i++) free(alloc[i]);
+    return rc;
 }
 
 static void trim_line(char *line) {
@@ -1093,6 +1042,576 @@ static void rb_subs_broadcast(RbSubs *s, const char *msg) {
     }
 }
 
+// Frame stream session (stream-begin): one persistent connection that pushes pre-encoded pages
+// without a socket round-trip + argv parsing + file I/O per frame.
+// Frame (little-endian): "D2FR" u16 cmd (0x0001 full / 0x000d partial) u16 mask (bit i = button i+1),
+// then for each set bit in increasing order: u32 len + PNG bytes. One "ok\n"/"err\n" reply per frame.
+#define STREAM_MAGIC "D2FR"
+#define STREAM_HDR_LEN 8
+#define STREAM_MAX_ICON (1u << 20)
+#define STREAM_MAX_BUFFERED (16u << 20)
+typedef struct {
+    int fd;
+    Buf in;
+    uint32_t seq;
+} StreamSession;
+
+static void stream_close(StreamSession *s) {
+    if (s->fd >= 0) close(s->fd);
+    s->fd = -1;
+    buf_free(&s->in);
+}
+
+static void stream_open(StreamSession *s, int fd) {
+    stream_close(s); // a new client replaces the previous one
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    s->fd = fd;
+    buf_init(&s->in);
+}
+
+// Length of the complete frame at the start of p, 0 if more bytes are needed, -1 if malformed.
+static long stream_frame_len(const uint8_t *p, size_t n) {
+    if (n < STREAM_HDR_LEN) return 0;
+    if (memcmp(p, STREAM_MAGIC, 4) != 0) return -1;
+    uint16_t mask = rd_le16(p + 6);
+    if (mask == 0 || (mask >> 14) != 0) return -1;
+    size_t off = STREAM_HDR_LEN;
+    for (int i = 0; i < 14; i++) {
+        if (!(mask & (1u << i))) continue;
+        if (n < off + 4) return 0;
+        uint32_t len = rd_le32(p + off);
+        if (len == 0 || len > STREAM_MAX_ICON) return -1;
+        off += 4 + len;
+        if (n < off) return 0;
+    }
+    return (long)off;
+}
+
+static int stream_send_frame(StreamSession *s, hid_device *dev, const uint8_t *p) {
+    uint16_t cmd = rd_le16(p + 4);
+    uint16_t mask = rd_le16(p + 6);
+    IconItem items[14];
+    char names[14][32];
+    size_t count = 0;
+    size_t off = STREAM_HDR_LEN;
+    memset(items, 0, sizeof(items));
+    for (int i = 0; i < 14; i++) {
+        if (!(mask & (1u << i))) continue;
+        uint32_t len = rd_le32(p + off);
+        // Unique names per frame: the device caches icons by name.
+        snprintf(names[count], sizeof(names[count]), "s%u_%d.png", (unsigned)s->seq, i + 1);
+        items[count].btn_index = i;
+        items[count].name = names[count];
+        items[count].label = "";
+        items[count].data = (uint8_t *)(p + off + 4);
+        items[count].data_len = len;
+        count++;
+        off += 4 + len;
+    }
+    s->seq++;
+    if (cmd != 0x0001 && cmd != 0x000d) return -1;
+    uint8_t *zipbuf = NULL; size_t ziplen = 0; int pad_used = 0; size_t patched = 0;
+    if (build_zip_from_icons(items, count, &zipbuf, &ziplen, &pad_used, &patched) != 0 || !zipbuf) return -1;
+    int res = send_zip_buffer_cmd(dev, zipbuf, ziplen, cmd, pad_used, patched);
+    free(zipbuf);
+    return res;
+}
+
+// Drain the socket and send every complete frame.
+static void stream_pump(StreamSession *s, hid_device *dev) {
+    if (s->fd < 0) return;
+    // Bounded read-ahead: a client pipelining frames waits on the socket, not on our memory.
+    while (s->in.len < STREAM_MAX_BUFFERED) {
+        if (buf_reserve(&s->in, 65536) != 0) { stream_close(s); return; }
+        ssize_t n = read(s->fd, s->in.data + s->in.len, s->in.cap - s->in.len);
+        if (n > 0) { s->in.len += (size_t)n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            stream_close(s);
+            return;
+        }
+        break;
+    }
+    size_t pos = 0;
+    while (pos < s->in.len) {
+        long flen = stream_frame_len(s->in.data + pos, s->in.len - pos);
+        if (flen == 0) break;
+        if (flen < 0 || !dev) {
+            const char *msg = flen < 0 ? "err\n" : "err no_device\n";
+            write(s->fd, msg, strlen(msg));
+            stream_close(s);
+            return;
+        }
+        if (stream_send_frame(s, dev, s->in.data + pos) == 0) write(s->fd, "ok\n", 3);
+        else write(s->fd, "err\n", 4);
+        pos += (size_t)flen;
+    }
+    if (pos > 0) {
+        memmove(s->in.data, s->in.data + pos, s->in.len - pos);
+        s->in.len -= pos;
+    }
+}
+
+// Pre-rendered video playback (video-play): a .d2v file (src/icons/fd_d2v.h) already holds the
+// HID packets of every page; it is mapped read-only and written as-is, no per-frame ZIP work.
+// Frame k is due at t0 + (tick) / (fps * rate): deadlines are absolute, so a slow upload never
+// shifts the clock; when the link falls behind, the frames whose slot has passed are dropped.
+typedef struct {
+    uint8_t *map;            // NULL: not playing
+    size_t map_len;
+    fd_d2v_info_t info;
+    uint32_t cur;            // next frame to send
+    double fps;              // nominal rate (file header or --fps)
+    double rate;             // speed factor (video-rate)
+    double t0;               // CLOCK_MONOTONIC time of tick 0 (reset on play/seek/rate/resume)
+    uint64_t tick;           // frame slots elapsed since t0
+    double next;             // deadline of frame cur = t0 + tick / (fps * rate)
+    int loop;
+    int paused;
+    // live counters (video-stats)
+    uint64_t sent, dropped;  // frames shown on time / skipped
+    uint64_t uploads;        // frames that needed a HID write
+    double upload_ms, upload_max_ms; // moving average / max of the HID write time of a frame
+    double win_t;            // achieved fps: frames sent since win_t, refreshed every second
+    uint32_t win_n;
+    double achieved;
+} VideoPlayer;
+
+static double mono_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void video_stop(VideoPlayer *v) {
+    if (v->map) munmap(v->map, v->map_len);
+    memset(v, 0, sizeof(*v));
+}
+
+static double video_period(const VideoPlayer *v) {
+    return 1.0 / (v->fps * v->rate);
+}
+
+// Restart the schedule from frame cur, due now.
+static void video_anchor(VideoPlayer *v) {
+    v->t0 = mono_now();
+    v->tick = 0;
+    v->next = v->t0;
+}
+
+static int video_open(VideoPlayer *v, const char *path, double fps, int loop, const char **err) {
+    video_stop(v);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { *err = "open"; return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); *err = "open"; return -1; }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { *err = "mmap"; return -1; }
+    (void)posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    v->map = map;
+    v->map_len = (size_t)st.st_size;
+    if (fd_d2v_parse(v->map, v->map_len, &v->info) != 0) {
+        video_stop(v);
+        *err = "format";
+        return -1;
+    }
+    if (fps <= 0.0 && v->info.fps_num > 0 && v->info.fps_den > 0) fps = (double)v->info.fps_num / v->info.fps_den;
+    if (fps <= 0.0) fps = 30.0;
+    v->fps = fps;
+    v->rate = 1.0;
+    v->loop = loop;
+    v->cur = 0;
+    video_anchor(v);
+    v->win_t = v->t0;
+    return 0;
+}
+
+static void video_pause(VideoPlayer *v, int paused) {
+    if (!v->map || v->paused == paused) return;
+    v->paused = paused;
+    if (!paused) {
+        video_anchor(v);
+        v->win_t = v->t0;
+        v->win_n = 0;
+    }
+}
+
+// Absolute (N) or relative (+N / -N) seek, clamped to the file. Delta-encoded files
+// (partial frames) restart from the full page at or before N so no tile is left stale.
+static void video_seek(VideoPlayer *v, const char *arg) {
+    if (!v->map) return;
+    long n = strtol(arg, NULL, 10);
+    if (arg[0] == '+' || arg[0] == '-') n += (long)v->cur;
+    if (n < 0) n = 0;
+    if (n >= (long)v->info.frame_count) n = (long)v->info.frame_count - 1;
+    for (; n > 0; n--) {
+        fd_d2v_frame_t f;
+        fd_d2v_frame(v->map, &v->info, (uint32_t)n, &f);
+        if (f.flags & FD_D2V_FRAME_FULL) break;
+    }
+    v->cur = (uint32_t)n;
+    video_anchor(v);
+}
+
+static void video_set_rate(VideoPlayer *v, double rate) {
+    if (!v->map) return;
+    if (rate < 0.05) rate = 0.05;
+    if (rate > 16.0) rate = 16.0;
+    v->rate = rate;
+    video_anchor(v);
+}
+
+static int video_stats(const VideoPlayer *v, char *out, size_t cap) {
+    if (!v->map) return snprintf(out, cap, "ok state=stopped\n");
+    return snprintf(out, cap,
+                    "ok state=%s frame=%u frames=%u fps=%.3f rate=%.2f achieved=%.2f sent=%" PRIu64
+                    " dropped=%" PRIu64 " uploads=%" PRIu64 " upload_ms=%.2f upload_max_ms=%.2f\n",
+                    v->paused ? "paused" : "playing", (unsigned)v->cur, (unsigned)v->info.frame_count,
+                    v->fps, v->rate, v->achieved, v->sent, v->dropped, v->uploads, v->upload_ms,
+                    v->upload_max_ms);
+}
+
+// Write the frame that is due, if any. -1: HID write failed.
+static int video_step(VideoPlayer *v, hid_device *dev) {
+    if (!v->map || !dev || v->paused) return 0;
+    double now = mono_now();
+    if (now < v->next) return 0;
+    const double period = video_period(v);
+    const uint32_t count = v->info.frame_count;
+
+    // Behind schedule: jump towards the frame whose slot contains `now` so wall-clock (and audio) sync
+    // holds. A partial frame (delta .d2v) only updates the tiles that changed since the previous one,
+    // so the jump lands on the latest full page among the frames it would pass; with none, frames go
+    // out back to back (partials are small) until a later jump reaches a full page (--keyframe).
+    uint64_t due = (uint64_t)((now - v->t0) / period);
+    if (due > v->tick) {
+        uint64_t skip = due - v->tick;
+        if (!v->loop && v->cur + skip >= count) skip = count - 1 - v->cur; // always show the last frame
+        uint64_t land = 0;
+        uint64_t low = skip > count ? skip - count + 1 : 1;
+        for (uint64_t k = skip; k >= low && k > 0; k--) {
+            fd_d2v_frame_t kf;
+            fd_d2v_frame(v->map, &v->info, (uint32_t)((v->cur + k) % count), &kf);
+            if (kf.flags & FD_D2V_FRAME_FULL) {
+                land = k;
+                break;
+            }
+        }
+        v->cur = (uint32_t)((v->cur + land) % count);
+        v->dropped += land;
+        v->tick += land;
+    }
+
+    fd_d2v_frame_t f;
+    fd_d2v_frame(v->map, &v->info, v->cur, &f);
+    const uint8_t *p = v->map + f.offset;
+    for (uint32_t k = 0; k < f.packets; k++) {
+        if (write_packet(dev, p + (size_t)k * PACKET_SIZE, PACKET_SIZE) < 0) return -1;
+    }
+    double done = mono_now();
+    if (f.packets > 0) { // 0: page unchanged (delta), nothing written
+        double up = (done - now) * 1000.0;
+        v->upload_ms = v->uploads ? v->upload_ms * 0.9 + up * 0.1 : up;
+        if (up > v->upload_max_ms) v->upload_max_ms = up;
+        v->uploads++;
+        log_sendzip(rd_le32(p + 4), 0, 0, 0);
+    }
+    v->sent++;
+    if (done - v->win_t >= 1.0) {
+        v->achieved = v->win_n / (done - v->win_t);
+        v->win_t = done;
+        v->win_n = 0;
+    }
+    v->win_n++;
+
+    v->tick++;
+    v->next = v->t0 + (double)v->tick * period;
+    if (++v->cur >= count) {
+        if (v->loop) v->cur = 0;
+        else video_stop(v);
+    }
+    return 0;
+}
+
+// Upload queue (set-buttons-explicit, set-buttons-explicit-14, set-partial-explicit): uploads are
+// queued by lane and written one ZIP at a time, highest lane first, and pending connections are
+// accepted between two uploads, so a tap never waits behind more than the ZIP already on the wire
+// (preemption at ZIP boundaries). The client gets its reply once its own upload has been sent.
+// Lane: --lane=nav|state|bg on the command line; default nav for pages, state for partials.
+enum { LANE_NAV, LANE_STATE, LANE_BG, LANE_COUNT };
+static const char *const k_lane_names[LANE_COUNT] = { "nav", "state", "bg" };
+#define UPLOAD_QUEUE_MAX 32
+
+typedef struct {
+    int cfd;             // client waiting for the reply
+    int lane;
+    uint16_t cmd;        // 0x0001 page, 0x000d partial
+    uint64_t seq;        // FIFO order inside a lane
+    double enq;          // mono_now() at enqueue
+    IconItem items[14];
+    size_t count;
+} Upload;
+
+typedef struct {
+    Upload q[UPLOAD_QUEUE_MAX];
+    size_t n;
+    uint64_t seq;
+    // stats
+    uint64_t sent[LANE_COUNT], failed[LANE_COUNT], dropped[LANE_COUNT];
+    double wait_sum_ms[LANE_COUNT], wait_max_ms[LANE_COUNT];
+} UploadQueue;
+
+static void icon_item_free(IconItem *it) {
+    free(it->path);
+    free(it->name);
+    free(it->label);
+    free(it->ref);
+    if (it->data && !it->borrowed) free(it->data);
+    memset(it, 0, sizeof(*it));
+}
+
+static void upload_free(Upload *u) {
+    for (size_t i = 0; i < u->count; i++) icon_item_free(&u->items[i]);
+    u->count = 0;
+}
+
+static void upload_reply(Upload *u, const char *msg) {
+    if (u->cfd < 0) return;
+    write(u->cfd, msg, strlen(msg));
+    close(u->cfd);
+    u->cfd = -1;
+}
+
+// Parse --label-N= / --button-N= (1..max_btn, no label on button 14) / --lane= into u.
+// Returns 0, or -1 when a slab reference is stale (see icon_item_source).
+static int upload_parse(char *p, int max_btn, Upload *u) {
+    char *argv[64];
+    int argc = 0;
+    char *labels[14] = {0};
+    bool slab_stale = false;
+    while (*p && argc < 64) {
+        while (*p==' ') p++;
+        if (!*p) break;
+        argv[argc++] = p;
+        while (*p && *p!=' ') p++;
+        if (*p) { *p='\0'; p++; }
+    }
+    // first pass: collect labels and the lane
+    for (int i=0;i<argc;i++) {
+        if (strncmp(argv[i],"--label-",8)==0) {
+            int idx = atoi(argv[i]+8) - 1;
+            if (idx >=0 && idx < max_btn && idx < 13) {
+                char *eq = strchr(argv[i],'=');
+                if (eq && eq[1]) {
+                    free(labels[idx]);
+                    labels[idx] = strdup(eq+1);
+                }
+            }
+        } else if (strncmp(argv[i],"--lane=",7)==0) {
+            for (int l=0;l<LANE_COUNT;l++) {
+                if (strcmp(argv[i]+7, k_lane_names[l])==0) u->lane = l;
+            }
+        }
+    }
+    for (int i=0;i<argc && u->count<14;i++) {
+        if (strncmp(argv[i],"--button-",9)==0) {
+            int idx = atoi(argv[i]+9) - 1;
+            if (idx < 0 || idx >= max_btn) continue;
+            char *eq = strchr(argv[i],'=');
+            if (!eq || !eq[1]) continue;
+            IconItem *it = &u->items[u->count];
+            int src = icon_item_source(it, eq+1);
+            if (src < 0) slab_stale = true;
+            if (src != 0) continue;
+            it->btn_index = idx;
+            it->label = strdup(labels[idx] ? labels[idx] : "");
+            u->count++;
+        }
+    }
+    for (int i=0;i<14;i++) free(labels[i]);
+    return slab_stale ? -1 : 0;
+}
+
+// Copy of src that owns its bytes: src may be a slab slot or a temp file its client reuses or
+// deletes once answered, while the copy waits in a lower lane.
+static int icon_item_clone_owned(IconItem *dst, const IconItem *src) {
+    memset(dst, 0, sizeof(*dst));
+    dst->btn_index = src->btn_index;
+    dst->name = strdup(src->name ? src->name : "");
+    dst->label = strdup(src->label ? src->label : "");
+    if (src->data && src->data_len > 0) {
+        dst->data = malloc(src->data_len);
+        if (dst->data) memcpy(dst->data, src->data, src->data_len);
+        dst->data_len = src->data_len;
+    } else if (src->path) {
+        FILE *f = fopen(src->path, "rb");
+        if (f) {
+            struct stat st;
+            if (fstat(fileno(f), &st) == 0 && st.st_size > 0 && (dst->data = malloc((size_t)st.st_size)) != NULL) {
+                dst->data_len = fread(dst->data, 1, (size_t)st.st_size, f);
+            }
+            fclose(f);
+        }
+    }
+    if (!dst->name || !dst->label || !dst->data || dst->data_len == 0) {
+        icon_item_free(dst);
+        return -1;
+    }
+    return 0;
+}
+
+static void upload_queue_drop(UploadQueue *uq, size_t i, const char *reply) {
+    Upload *u = &uq->q[i];
+    uq->dropped[u->lane]++;
+    upload_reply(u, reply);
+    upload_free(u);
+    memmove(&uq->q[i], &uq->q[i + 1], (uq->n - i - 1) * sizeof(Upload));
+    uq->n--;
+}
+
+// u jumps ahead of the queued uploads of lower lanes: what they would write on u's buttons is stale.
+// A page u replaces every one of them; a partial u removes its buttons from queued partials (dropped
+// once empty) and replaces them in queued pages, which must still rewrite the whole screen.
+static void upload_queue_supersede(UploadQueue *uq, const Upload *u) {
+    for (size_t i = uq->n; i-- > 0;) {
+        Upload *q = &uq->q[i];
+        if (q->lane <= u->lane) continue;
+        if (u->cmd == 0x0001) {
+            upload_queue_drop(uq, i, "ok superseded\n");
+            continue;
+        }
+        for (size_t k = 0; k < u->count; k++) {
+            for (size_t j = 0; j < q->count; j++) {
+                if (q->items[j].btn_index != u->items[k].btn_index) continue;
+                IconItem copy;
+                if (q->cmd == 0x0001 && icon_item_clone_owned(&copy, &u->items[k]) == 0) {
+                    icon_item_free(&q->items[j]);
+                    q->items[j] = copy;
+                } else if (q->cmd != 0x0001) {
+                    icon_item_free(&q->items[j]);
+                    memmove(&q->items[j], &q->items[j + 1], (q->count - j - 1) * sizeof(IconItem));
+                    q->count--;
+                }
+                break;
+            }
+        }
+        if (q->count == 0) upload_queue_drop(uq, i, "ok superseded\n");
+    }
+}
+
+// Slab items of u must still name committed slots of the current slab: a queued upload outlives the
+// command that published them. Refreshes the pointers; -1 when one is stale (slot reused, slab replaced).
+static int upload_slab_check(Upload *u) {
+    for (size_t i = 0; i < u->count; i++) {
+        IconItem *it = &u->items[i];
+        if (!it->borrowed) continue;
+        uint32_t len = 0;
+        const char *name = NULL;
+        const uint8_t *data = it->ref ? fd_slab_resolve(&g_slab, it->ref, &len, &name) : NULL;
+        if (!data || len != it->data_len) return -1;
+        it->data = (uint8_t *)data;
+    }
+    return 0;
+}
+
+// Before g_slab is unmapped: queued uploads copy their slab bytes, or fail with err slab when stale.
+static void upload_queue_unborrow(UploadQueue *uq) {
+    for (size_t i = uq->n; i-- > 0;) {
+        Upload *q = &uq->q[i];
+        bool ok = upload_slab_check(q) == 0;
+        for (size_t j = 0; ok && j < q->count; j++) {
+            if (!q->items[j].borrowed) continue;
+            IconItem copy;
+            if (icon_item_clone_owned(&copy, &q->items[j]) != 0) {
+                ok = false;
+                break;
+            }
+            icon_item_free(&q->items[j]);
+            q->items[j] = copy;
+        }
+        if (!ok) upload_queue_drop(uq, i, "err slab\n");
+    }
+}
+
+// Takes ownership of u (items and cfd).
+static void upload_queue_push(UploadQueue *uq, Upload *u) {
+    if (uq->n >= UPLOAD_QUEUE_MAX) {
+        upload_reply(u, "err busy\n");
+        upload_free(u);
+        return;
+    }
+    upload_queue_supersede(uq, u);
+    u->seq = uq->seq++;
+    u->enq = mono_now();
+    uq->q[uq->n++] = *u;
+}
+
+// Send the oldest upload of the highest non-empty lane. -1: HID write failed.
+static int upload_queue_step(UploadQueue *uq, hid_device *dev) {
+    if (uq->n == 0 || !dev) return 0;
+    size_t best = 0;
+    for (size_t i = 1; i < uq->n; i++) {
+        const Upload *a = &uq->q[i], *b = &uq->q[best];
+        if (a->lane < b->lane || (a->lane == b->lane && a->seq < b->seq)) best = i;
+    }
+    Upload u = uq->q[best];
+    memmove(&uq->q[best], &uq->q[best + 1], (uq->n - best - 1) * sizeof(Upload));
+    uq->n--;
+
+    double wait_ms = (mono_now() - u.enq) * 1000.0;
+    uq->wait_sum_ms[u.lane] += wait_ms;
+    if (wait_ms > uq->wait_max_ms[u.lane]) uq->wait_max_ms[u.lane] = wait_ms;
+    if (upload_slab_check(&u) != 0) {
+        uq->failed[u.lane]++;
+        upload_reply(&u, "err slab\n");
+        upload_free(&u);
+        return 0;
+    }
+    uint8_t *zipbuf=NULL; size_t ziplen=0; int pad_used=0; size_t patched=0;
+    int res = -1;
+    if (build_zip_from_icons(u.items, u.count, &zipbuf, &ziplen, &pad_used, &patched)==0 && zipbuf) {
+        res = send_zip_buffer_cmd(dev, zipbuf, ziplen, u.cmd, pad_used, patched);
+        free(zipbuf);
+    }
+    if (res == 0) uq->sent[u.lane]++;
+    else uq->failed[u.lane]++;
+    upload_reply(&u, res == 0 ? "ok\n" : "err\n");
+    upload_free(&u);
+    return res;
+}
+
+// Device gone: nobody will send the queued uploads.
+static void upload_queue_fail_all(UploadQueue *uq, const char *reply) {
+    while (uq->n > 0) {
+        uq->failed[uq->q[uq->n - 1].lane]++;
+        upload_reply(&uq->q[uq->n - 1], reply);
+        upload_free(&uq->q[uq->n - 1]);
+        uq->n--;
+    }
+}
+
+static int upload_queue_stats(const UploadQueue *uq, char *out, size_t cap) {
+    size_t queued[LANE_COUNT] = {0};
+    for (size_t i = 0; i < uq->n; i++) queued[uq->q[i].lane]++;
+    int w = snprintf(out, cap, "ok queued=%zu", uq->n);
+    for (int l = 0; l < LANE_COUNT && w > 0 && (size_t)w < cap; l++) {
+        uint64_t done = uq->sent[l] + uq->failed[l];
+        w += snprintf(out + w, cap - (size_t)w,
+                      " %s_queued=%zu %s_sent=%" PRIu64 " %s_failed=%" PRIu64 " %s_dropped=%" PRIu64
+                      " %s_wait_ms=%.2f %s_wait_max_ms=%.2f",
+                      k_lane_names[l], queued[l], k_lane_names[l], uq->sent[l], k_lane_names[l], uq->failed[l],
+                      k_lane_names[l], uq->dropped[l], k_lane_names[l], done ? uq->wait_sum_ms[l] / (double)done : 0.0,
+                      k_lane_names[l], uq->wait_max_ms[l]);
+    }
+    if (w < 0) return 0;
+    if ((size_t)w + 1 >= cap) w = (int)cap - 2;
+    out[w++] = '\n';
+    out[w] = '\0';
+    return w;
+}
+
 static int make_listen_socket(void) {
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (fd < 0) { perror("socket"); exit(1); }
@@ -1132,6 +1651,13 @@ int main(void) {
 
     RbSubs rb_subs;
     memset(&rb_subs, 0, sizeof(rb_subs));
+    StreamSession stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.fd = -1;
+    fd_slab_init(&g_slab);
+    static UploadQueue uploads;
+    VideoPlayer video;
+    memset(&video, 0, sizeof(video));
     double down_time[14] = {0};
     int hold_emitted[14] = {0};
     int longhold_emitted[14] = {0};
@@ -1172,15 +1698,33 @@ int main(void) {
         }
 
         int cfd = accept(listen_fd, NULL, NULL);
+        bool accepted = cfd >= 0;
         if (cfd >= 0) {
             int cflags = fcntl(cfd, F_GETFL, 0);
             if (cflags >= 0) fcntl(cfd, F_SETFL, cflags & ~O_NONBLOCK); // blocking for command handling
             char line[2048];
-            ssize_t n = read(cfd, line, sizeof(line) - 1);
+            int passed_fd = -1;
+            ssize_t n = fd_slab_recv_line(cfd, line, sizeof(line) - 1, &passed_fd);
             if (n > 0) {
                 line[n] = '\0';
                 trim_line(line);
 
+                // slab-attach (+ fd via SCM_RIGHTS): map the client's icon slab, replacing any previous one.
+                // Does not need the HID device.
+                if (strncmp(line, "slab-attach", 11) == 0) {
+                    upload_queue_unborrow(&uploads);   // nothing queued may point into the old mapping
+                    fd_slab_free(&g_slab);
+                    if (passed_fd >= 0 && fd_slab_attach(&g_slab, passed_fd) == 0) {
+                        char resp[64];
+                        int rl = snprintf(resp, sizeof(resp), "ok slots=%u size=%u\n", g_slab.slots, g_slab.slot_size);
+                        write(cfd, resp, (size_t)rl);
+                    } else {
+                        write(cfd, "err\n", 4);
+                    }
+                    passed_fd = -1;
+                    goto cmd_done;
+                }
+
                 // ping is a daemon health/status check. It must work even if the USB HID device is missing.
                 // This is used by paging_daemon to detect device reconnect and resync state.
                 if (strncmp(line, "ping", 4) == 0) {
@@ -1236,203 +1780,84 @@ int main(void) {
                     char *path=line+12; while(*path==' ') path++;
                     if (send_zip(dev,path)==0) write(cfd,"ok\n",3);
                     else { perror("send_zip"); write(cfd,"err\n",4); }
-                } else if (strncmp(line,"set-buttons-explicit-14",23)==0) {
-                    char *p = line + 23;
-                    char *argv[64];
-                    int argc = 0;
-                    char *labels[14] = {0};
-                    while (*p && argc < 64) {
-                        while (*p==' ') p++;
-                        if (!*p) break;
-                        argv[argc++] = p;
-                        while (*p && *p!=' ') p++;
-                        if (*p) { *p='\0'; p++; }
-                    }
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--label-",8)==0) {
-                            int idx = atoi(argv[i]+8) - 1;
-                            if (idx >=0 && idx < 14) {
-                                char *eq = strchr(argv[i],'=');
-                                if (eq && eq[1]) {
-                                    free(labels[idx]);
-                                    labels[idx] = strdup(eq+1);
-                                }
-                            }
-                        }
-                    }
-                    IconItem items[14]; memset(items, 0, sizeof(items));
-                    size_t icount=0;
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--button-",9)==0) {
-                            int idx = atoi(argv[i]+9) - 1;
-                            if (idx < 0 || idx >=14) continue;
-                            char *eq = strchr(argv[i],'=');
-                            if (!eq || !eq[1]) continue;
-                            const char *path = eq+1;
-                            struct stat st;
-                            if (stat(path,&st)!=0 || !S_ISREG(st.st_mode)) continue;
-                            items[icount].btn_index = idx;
-                            items[icount].path = strdup(path);
-                            items[icount].name = basename_dup(path);
-                            if (idx == 13) {
-                                items[icount].label = strdup(""); // ignore label for 14
-                            } else if (labels[idx]) {
-                                items[icount].label = strdup(labels[idx]);
-                            } else {
-                                items[icount].label = strdup("");
-                            }
-                            icount++;
-                        }
-                    }
-                    if (icount==0) { write(cfd,"err\n",4); }
-                    else {
-                        uint8_t *zipbuf=NULL; size_t ziplen=0; int pad_used=0; size_t patched=0;
-                        if (build_zip_from_icons(items, icount, &zipbuf, &ziplen, &pad_used, &patched)==0 && zipbuf) {
-                            int res = send_zip_buffer_cmd(dev, zipbuf, ziplen, 0x0001, pad_used, patched);
-                            free(zipbuf);
-                            if (res==0) write(cfd,"ok\n",3);
-                            else write(cfd,"err\n",4);
-                        } else {
-                            write(cfd,"err\n",4);
-                        }
-                    }
-                    for (size_t i=0;i<icount;i++) {
-                        free(items[i].path);
-                        free(items[i].name);
-                        free(items[i].label);
-                        if (items[i].data) free(items[i].data);
-                    }
-                    for (int i=0;i<14;i++) free(labels[i]);
-                } else if (strncmp(line,"set-buttons-explicit",20)==0) {
-                    char *p = line + 20;
-                    char *argv[64];
-                    int argc = 0;
-                    char *labels[13] = {0};
-                    while (*p && argc < 64) {
-                        while (*p==' ') p++;
-                        if (!*p) break;
-                        argv[argc++] = p;
-                        while (*p && *p!=' ') p++;
-                        if (*p) { *p='\0'; p++; }
-                    }
-                    // first pass: collect labels
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--label-",8)==0) {
-                            int idx = atoi(argv[i]+8) - 1;
-                            if (idx >=0 && idx < 13) {
-                                char *eq = strchr(argv[i],'=');
-                                if (eq && eq[1]) {
-                                    free(labels[idx]);
-                                    labels[idx] = strdup(eq+1);
-                                }
-                            }
-                        }
+                } else if (strncmp(line,"set-buttons-explicit",20)==0 || strncmp(line,"set-partial-explicit",20)==0) {
+                    bool wide = strncmp(line,"set-buttons-explicit-14",23)==0;
+                    bool partial = line[4]=='p';
+                    Upload u; memset(&u, 0, sizeof(u));
+                    u.cmd = partial ? 0x000d : 0x0001;
+                    u.lane = partial ? LANE_STATE : LANE_NAV;
+                    if (upload_parse(line + (wide ? 23 : 20), wide ? 14 : 13, &u) != 0) {
+                        write(cfd,"err slab\n",9);
+                        upload_free(&u);
+                    } else if (u.count==0) {
+                        write(cfd,"err\n",4);
+                        upload_free(&u);
+                    } else {
+                        u.cfd = cfd;
+                        cfd = -1; // answered once sent (upload_queue_step)
+                        upload_queue_push(&uploads, &u);
                     }
-                    IconItem items[13]; memset(items, 0, sizeof(items));
-                    size_t icount=0;
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--button-",9)==0) {
-                            int idx = atoi(argv[i]+9) - 1;
-                            if (idx < 0 || idx >=13) continue;
-                            char *eq = strchr(argv[i],'=');
-                            if (!eq || !eq[1]) continue;
-                            const char *path = eq+1;
-                            struct stat st;
-                            if (stat(path,&st)!=0 || !S_ISREG(st.st_mode)) continue;
-                            items[icount].btn_index = idx;
-                            items[icount].path = strdup(path);
-                            items[icount].name = basename_dup(path);
-                            if (labels[idx]) {
-                                items[icount].label = strdup(labels[idx]);
-                            } else {
-                                items[icount].label = strdup("");
-                            }
-                            icount++;
-                        }
-                    }
-                    if (icount==0) { write(cfd,"err\n",4); }
-                    else {
-                        uint8_t *zipbuf=NULL; size_t ziplen=0;
-                        int pad_used=0; size_t patched=0;
-                        if (build_zip_from_icons(items, icount, &zipbuf, &ziplen, &pad_used, &patched)==0 && zipbuf) {
-                            int res = send_zip_buffer(dev, zipbuf, ziplen, pad_used, patched);
-                            free(zipbuf);
-                            if (res==0) write(cfd,"ok\n",3);
-                            else write(cfd,"err\n",4);
-                        } else {
-                            write(cfd,"err\n",4);
-                        }
-                    }
-                    for (size_t i=0;i<icount;i++) {
-                        free(items[i].path);
-                        free(items[i].name);
-                        free(items[i].label);
-                    }
-                    for (int i=0;i<13;i++) free(labels[i]);
-                } else if (strncmp(line,"set-partial-explicit",20)==0) {
-                    char *p = line + 20;
-                    char *argv[64];
-                    int argc = 0;
-                    char *labels[13] = {0};
-                    while (*p && argc < 64) {
-                        while (*p==' ') p++;
-                        if (!*p) break;
-                        argv[argc++] = p;
-                        while (*p && *p!=' ') p++;
-                        if (*p) { *p='\0'; p++; }
-                    }
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--label-",8)==0) {
-                            int idx = atoi(argv[i]+8) - 1;
-                            if (idx >=0 && idx < 13) {
-                                char *eq = strchr(argv[i],'=');
-                                if (eq && eq[1]) {
-                                    free(labels[idx]);
-                                    labels[idx] = strdup(eq+1);
-                                }
-                            }
-                        }
-                    }
-                    IconItem items[13]; memset(items, 0, sizeof(items));
-                    size_t icount=0;
-                    for (int i=0;i<argc;i++) {
-                        if (strncmp(argv[i],"--button-",9)==0) {
-                            int idx = atoi(argv[i]+9) - 1;
-                            if (idx < 0 || idx >=13) continue;
-                            char *eq = strchr(argv[i],'=');
-                            if (!eq || !eq[1]) continue;
-                            const char *path = eq+1;
-                            struct stat st;
-                            if (stat(path,&st)!=0 || !S_ISREG(st.st_mode)) continue;
-                            items[icount].btn_index = idx;
-                            items[icount].path = strdup(path);
-                            items[icount].name = basename_dup(path);
-                            if (labels[idx]) items[icount].label = strdup(labels[idx]);
-                            else items[icount].label = strdup("");
-                            icount++;
-                        }
-                    }
-                    if (icount==0) { write(cfd,"err\n",4); }
-                    else {
-                        int res = send_partial_update(dev, items, icount);
-                        if (res==0) write(cfd,"ok\n",3); else write(cfd,"err\n",4);
-                    }
-                    for (size_t i=0;i<icount;i++) {
-                        free(items[i].path);
-                        free(items[i].name);
-                        free(items[i].label);
-                        if (items[i].data) free(items[i].data);
-                    }
-                    for (int i=0;i<13;i++) free(labels[i]);
+                } else if (strncmp(line,"stats",5)==0) {
+                    char reply[1024];
+                    int n = upload_queue_stats(&uploads, reply, sizeof(reply));
+                    write(cfd, reply, (size_t)n);
                 } else if (strncmp(line,"read-buttons",12)==0) {
                     write(cfd,"ok\n",3);
                     rb_subs_add(&rb_subs, cfd);
                     cfd = -1; // keep open
+                } else if (strncmp(line,"video-play ",11)==0) {
+                    // video-play <file.d2v> [--fps=F] [--loop]
+                    char *p = line + 11;
+                    char *path = NULL;
+                    double fps = 0.0;
+                    int loop = 0;
+                    for (char *tok = strtok(p, " "); tok; tok = strtok(NULL, " ")) {
+                        if (strncmp(tok, "--fps=", 6) == 0) fps = atof(tok + 6);
+                        else if (strcmp(tok, "--loop") == 0) loop = 1;
+                        else if (!path) path = tok;
+                    }
+                    const char *err = "usage";
+                    if (path && video_open(&video, path, fps, loop, &err) == 0) {
+                        char reply[96];
+                        int n = snprintf(reply, sizeof(reply), "ok frames=%u fps=%.3f\n",
+                                         (unsigned)video.info.frame_count, video.fps);
+                        write(cfd, reply, (size_t)n);
+                    } else {
+                        char reply[64];
+                        int n = snprintf(reply, sizeof(reply), "err %s\n", err);
+                        write(cfd, reply, (size_t)n);
+                    }
+                } else if (strncmp(line,"video-stop",10)==0) {
+                    video_stop(&video);
+                    write(cfd,"ok\n",3);
+                } else if (strncmp(line,"video-pause",11)==0 || strncmp(line,"video-resume",12)==0) {
+                    if (!video.map) { write(cfd,"err stopped\n",12); goto cmd_done; }
+                    video_pause(&video, line[6] == 'p');
+                    write(cfd,"ok\n",3);
+                } else if (strncmp(line,"video-seek ",11)==0) {
+                    // video-seek N | +N | -N (frames)
+                    if (!video.map) { write(cfd,"err stopped\n",12); goto cmd_done; }
+                    video_seek(&video, line + 11);
+                    write(cfd,"ok\n",3);
+                } else if (strncmp(line,"video-rate ",11)==0) {
+                    if (!video.map) { write(cfd,"err stopped\n",12); goto cmd_done; }
+                    video_set_rate(&video, atof(line + 11));
+                    write(cfd,"ok\n",3);
+                } else if (strncmp(line,"video-stats",11)==0) {
+                    char reply[256];
+                    int n = video_stats(&video, reply, sizeof(reply));
+                    write(cfd, reply, (size_t)n);
+                } else if (strncmp(line,"stream-begin",12)==0) {
+                    // Frames follow on this connection once "ok" has been read by the client.
+                    write(cfd,"ok\n",3);
+                    stream_open(&stream, cfd);
+                    cfd = -1; // keep open
                 } else {
                     write(cfd,"unknown\n",8);
                 }
 cmd_done:
             }
+            if (passed_fd >= 0) close(passed_fd);
             if (cfd != -1) close(cfd);
         } else {
             if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
@@ -1441,10 +1866,26 @@ cmd_done:
             }
         }
 
+        // One queued upload per pass, only once no connection is pending: a tap that arrived during
+        // the previous upload is queued (and ranked) before the next one is picked.
+        if (!dev) upload_queue_fail_all(&uploads, "err no_device\n");
+        else if (!accepted) upload_queue_step(&uploads, dev);
+
+        stream_pump(&stream, dev);
+
+        if (video_step(&video, dev) != 0) {
+            video_stop(&video);
+            rb_subs_broadcast(&rb_subs, "evt disconnected\n");
+            hid_close(dev);
+            dev = NULL;
+            next_reconnect = 0.0;
+        }
+
         // stream button events to read-buttons subscribers (only when device is connected)
         if (rb_subs.nfds > 0 && dev) {
             uint8_t buf[PACKET_SIZE];
-            int r = hid_read_timeout(dev, buf, sizeof(buf), 50);
+            // Short wait while a frame stream is open or uploads are queued so they aren't held back.
+            int r = hid_read_timeout(dev, buf, sizeof(buf), (stream.fd >= 0 || uploads.n > 0 || (video.map && !video.paused)) ? 1 : 50);
             if (r > 0 && buf[0]==HEADER0 && buf[1]==HEADER1) {
                 uint16_t cmd=((uint16_t)buf[2]<<8)|buf[3];
                 if (cmd==0x0101 || cmd==0x0102) {
@@ -1583,10 +2024,37 @@ cmd_done:
             last_keepalive = now_keep;
         }
 
-        struct timespec ts = { .tv_sec = 0, .tv_nsec = 5 * 1000 * 1000 }; // 5ms
-        nanosleep(&ts, NULL);
+        // Never sleep past the next video frame deadline.
+        long sleep_ns = 5 * 1000 * 1000; // 5ms
+        int video_due = 0;
+        if (video.map && !video.paused && dev) {
+            double wait = video.next - mono_now();
+            if (wait * 1e9 < (double)sleep_ns) {
+                sleep_ns = wait > 0.0 ? (long)(wait * 1e9) : 0;
+                video_due = 1;
+            }
+        }
+        if (stream.fd >= 0) {
+            // Wake up as soon as the next frame arrives instead of sleeping a fixed 5ms.
+            struct pollfd pfd = { .fd = stream.fd, .events = POLLIN };
+            poll(&pfd, 1, (int)(sleep_ns / 1000000));
+        } else if (video_due) {
+            // Sleep until the deadline itself (absolute), not "remaining time" computed earlier.
+            struct timespec ts;
+            ts.tv_sec = (time_t)video.next;
+            ts.tv_nsec = (long)((video.next - (double)ts.tv_sec) * 1e9);
+            if (ts.tv_nsec >= 1000000000L) ts.tv_nsec = 999999999L;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && running) {}
+        } else if (sleep_ns > 0) {
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = sleep_ns };
+            nanosleep(&ts, NULL);
+        }
     }
 
+    video_stop(&video);
+    stream_close(&stream);
+    upload_queue_fail_all(&uploads, "err\n");
+    fd_slab_free(&g_slab);
 	    while (rb_subs.nfds > 0) rb_subs_remove_idx(&rb_subs, 0);
 	    close(listen_fd);
     if (dev) hid_close(dev);